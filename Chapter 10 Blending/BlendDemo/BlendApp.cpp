@@ -372,6 +372,7 @@ void BlendApp::OnKeyboardInput(const GameTimer& gt)
  
 void BlendApp::UpdateCamera(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Convert Spherical to Cartesian coordinates.
 	mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
 	mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
@@ -412,6 +413,7 @@ void BlendApp::AnimateMaterials(const GameTimer& gt)
 
 void BlendApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -436,6 +438,7 @@ void BlendApp::UpdateObjectCBs(const GameTimer& gt)
 
 void BlendApp::UpdateMaterialCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
 	for(auto& e : mMaterials)
 	{
@@ -462,6 +465,7 @@ void BlendApp::UpdateMaterialCBs(const GameTimer& gt)
 
 void BlendApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = XMLoadFloat4x4(&mView);
 	XMMATRIX proj = XMLoadFloat4x4(&mProj);
 
@@ -497,6 +501,7 @@ void BlendApp::UpdateMainPassCB(const GameTimer& gt)
 
 void BlendApp::UpdateWaves(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Every quarter second, generate a random wave.
 	static float t_base = 0.0f;
 	if((mTimer.TotalTime() - t_base) >= 0.25f)
@@ -990,6 +995,7 @@ void BlendApp::BuildRenderItems()
 
 void BlendApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+    PROFILE_FUNCTION();
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
     UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
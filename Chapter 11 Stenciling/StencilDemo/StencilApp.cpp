@@ -6,6 +6,7 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/MeshCache.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -429,6 +430,7 @@ void StencilApp::OnKeyboardInput(const GameTimer& gt)
  
 void StencilApp::UpdateCamera(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Convert Spherical to Cartesian coordinates.
 	mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
 	mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
@@ -450,6 +452,7 @@ void StencilApp::AnimateMaterials(const GameTimer& gt)
 
 void StencilApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -474,6 +477,7 @@ void StencilApp::UpdateObjectCBs(const GameTimer& gt)
 
 void StencilApp::UpdateMaterialCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
 	for(auto& e : mMaterials)
 	{
@@ -500,6 +504,7 @@ void StencilApp::UpdateMaterialCBs(const GameTimer& gt)
 
 void StencilApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = XMLoadFloat4x4(&mView);
 	XMMATRIX proj = XMLoadFloat4x4(&mProj);
 
@@ -536,6 +541,7 @@ void StencilApp::UpdateMainPassCB(const GameTimer& gt)
 
 void StencilApp::UpdateReflectedPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	mReflectedPassCB = mMainPassCB;
 
 	XMVECTOR mirrorPlane = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f); // xy plane
@@ -820,43 +826,26 @@ void StencilApp::BuildRoomGeometry()
 
 void StencilApp::BuildSkullGeometry()
 {
-	std::ifstream fin("Models/skull.txt");
-	
-	if(!fin)
+	MeshCache mesh;
+	if(!mesh.Load("Models/skull.txt"))
 	{
 		MessageBox(0, L"Models/skull.txt not found.", 0, 0);
 		return;
 	}
 
-	UINT vcount = 0;
-	UINT tcount = 0;
-	std::string ignore;
+	const UINT vcount = mesh.VertexCount();
 
-	fin >> ignore >> vcount;
-	fin >> ignore >> tcount;
-	fin >> ignore >> ignore >> ignore >> ignore;
-	
 	std::vector<Vertex> vertices(vcount);
 	for(UINT i = 0; i < vcount; ++i)
 	{
-		fin >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
-		fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
+		vertices[i].Pos = mesh.Positions()[i];
+		vertices[i].Normal = mesh.Normals()[i];
 
 		// Model does not have texture coordinates, so just zero them out.
 		vertices[i].TexC = { 0.0f, 0.0f };
 	}
 
-	fin >> ignore;
-	fin >> ignore;
-	fin >> ignore;
-
-	std::vector<std::int32_t> indices(3 * tcount);
-	for(UINT i = 0; i < tcount; ++i)
-	{
-		fin >> indices[i*3+0] >> indices[i*3+1] >> indices[i*3+2];
-	}
-
-	fin.close();
+	std::vector<std::int32_t> indices(mesh.Indices(), mesh.Indices() + mesh.IndexCount());
  
 	//
 	// Pack the indices of all the meshes into one index buffer.
@@ -1173,6 +1162,7 @@ void StencilApp::BuildRenderItems()
 
 void StencilApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+    PROFILE_FUNCTION();
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
     UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
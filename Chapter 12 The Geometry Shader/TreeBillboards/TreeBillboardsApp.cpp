@@ -378,6 +378,7 @@ void TreeBillboardsApp::OnKeyboardInput(const GameTimer& gt)
  
 void TreeBillboardsApp::UpdateCamera(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Convert Spherical to Cartesian coordinates.
 	mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
 	mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
@@ -418,6 +419,7 @@ void TreeBillboardsApp::AnimateMaterials(const GameTimer& gt)
 
 void TreeBillboardsApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -442,6 +444,7 @@ void TreeBillboardsApp::UpdateObjectCBs(const GameTimer& gt)
 
 void TreeBillboardsApp::UpdateMaterialCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
 	for(auto& e : mMaterials)
 	{
@@ -468,6 +471,7 @@ void TreeBillboardsApp::UpdateMaterialCBs(const GameTimer& gt)
 
 void TreeBillboardsApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = XMLoadFloat4x4(&mView);
 	XMMATRIX proj = XMLoadFloat4x4(&mProj);
 
@@ -503,6 +507,7 @@ void TreeBillboardsApp::UpdateMainPassCB(const GameTimer& gt)
 
 void TreeBillboardsApp::UpdateWaves(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Every quarter second, generate a random wave.
 	static float t_base = 0.0f;
 	if((mTimer.TotalTime() - t_base) >= 0.25f)
@@ -1136,6 +1141,7 @@ void TreeBillboardsApp::BuildRenderItems()
 
 void TreeBillboardsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+    PROFILE_FUNCTION();
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
     UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
@@ -394,6 +394,7 @@ void BlurApp::OnKeyboardInput(const GameTimer& gt)
  
 void BlurApp::UpdateCamera(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Convert Spherical to Cartesian coordinates.
 	mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
 	mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
@@ -434,6 +435,7 @@ void BlurApp::AnimateMaterials(const GameTimer& gt)
 
 void BlurApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -458,6 +460,7 @@ void BlurApp::UpdateObjectCBs(const GameTimer& gt)
 
 void BlurApp::UpdateMaterialCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
 	for(auto& e : mMaterials)
 	{
@@ -484,6 +487,7 @@ void BlurApp::UpdateMaterialCBs(const GameTimer& gt)
 
 void BlurApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = XMLoadFloat4x4(&mView);
 	XMMATRIX proj = XMLoadFloat4x4(&mProj);
 
@@ -519,6 +523,7 @@ void BlurApp::UpdateMainPassCB(const GameTimer& gt)
 
 void BlurApp::UpdateWaves(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Every quarter second, generate a random wave.
 	static float t_base = 0.0f;
 	if((mTimer.TotalTime() - t_base) >= 0.25f)
@@ -1093,6 +1098,7 @@ void BlurApp::BuildRenderItems()
 
 void BlurApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+    PROFILE_FUNCTION();
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
     UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
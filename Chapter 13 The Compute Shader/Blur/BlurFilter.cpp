@@ -3,6 +3,7 @@
 //***************************************************************************************
 
 #include "BlurFilter.h"
+#include "../../Common/CpuBlur.h"
  
 BlurFilter::BlurFilter(ID3D12Device* device, 
 	                   UINT width, UINT height,
@@ -130,33 +131,10 @@ void BlurFilter::Execute(ID3D12GraphicsCommandList* cmdList,
  
 std::vector<float> BlurFilter::CalcGaussWeights(float sigma)
 {
-	float twoSigma2 = 2.0f*sigma*sigma;
+	// Shared with CpuBlurFilter, so both blur with the same weights.
+	std::vector<float> weights = CalcGaussBlurWeights(sigma);
 
-	// Estimate the blur radius based on sigma since sigma controls the "width" of the bell curve.
-	// For example, for sigma = 3, the width of the bell curve is 
-	int blurRadius = (int)ceil(2.0f * sigma);
-
-	assert(blurRadius <= MaxBlurRadius);
-
-	std::vector<float> weights;
-	weights.resize(2 * blurRadius + 1);
-	
-	float weightSum = 0.0f;
-
-	for(int i = -blurRadius; i <= blurRadius; ++i)
-	{
-		float x = (float)i;
-
-		weights[i+blurRadius] = expf(-x*x / twoSigma2);
-
-		weightSum += weights[i+blurRadius];
-	}
-
-	// Divide by the sum so all the weights add up to 1.0.
-	for(int i = 0; i < weights.size(); ++i)
-	{
-		weights[i] /= weightSum;
-	}
+	assert((int)weights.size() / 2 <= MaxBlurRadius);
 
 	return weights;
 }
@@ -0,0 +1,234 @@
+//***************************************************************************************
+// main.cpp
+//
+// Checks CpuBlurFilter, with no window or device:
+//   - every half converts to a float and back to itself, and floats round to the
+//     nearest half, ties to even, overflowing to infinity from 65520,
+//   - UNORM channels decode and encode back to themselves and saturate out-of-range
+//     values and NaN,
+//   - the banded, transposing, SIMD executor gives the same bits as a texel-by-texel
+//     loop written like Blur.hlsl, for every format, odd sizes, repeated blurs and
+//     different thread counts,
+//   - a flat image stays flat.
+// Then it times both at 1920x1080 with the four blurs BlurApp runs.
+// Exits with 1 if a check fails.
+//***************************************************************************************
+
+#include "../../Common/CpuBlur.h"
+#include "../../Common/CheckUtil.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+typedef std::chrono::steady_clock Clock;
+
+const char* FormatName(CpuImageFormat format)
+{
+	switch(format)
+	{
+	case CpuImageFormat::R32G32B32A32_FLOAT: return "R32G32B32A32_FLOAT";
+	case CpuImageFormat::R16G16B16A16_FLOAT: return "R16G16B16A16_FLOAT";
+	case CpuImageFormat::R8G8B8A8_UNORM: return "R8G8B8A8_UNORM";
+	case CpuImageFormat::R32_FLOAT: return "R32_FLOAT";
+	case CpuImageFormat::R16_UNORM: return "R16_UNORM";
+	}
+	return "?";
+}
+
+CpuImage RandomImage(CpuImageFormat format, std::uint32_t width, std::uint32_t height, std::uint32_t seed)
+{
+	CpuImage image(format, width, height);
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> value(0.0f, 1.0f);
+	std::vector<float> row((std::size_t)width*CpuImageChannelCount(format));
+
+	// Float images get values past 1 too, as HDR targets hold.
+	const float scale = format == CpuImageFormat::R16G16B16A16_FLOAT || format == CpuImageFormat::R32G32B32A32_FLOAT ? 4.0f : 1.0f;
+	for(std::uint32_t y = 0; y < height; ++y)
+	{
+		for(float& v : row)
+			v = scale*value(rng);
+		EncodeCpuImageRow(image, y, 0, width, row.data());
+	}
+	return image;
+}
+
+// Blur.hlsl one texel at a time: clamp each sample to the edge, sum the weights from
+// -radius to radius and store through the format after each pass.
+void ReferenceBlur(CpuImage& image, const std::vector<float>& weights, int blurCount)
+{
+	const int width = (int)image.Width;
+	const int height = (int)image.Height;
+	const int channels = (int)CpuImageChannelCount(image.Format);
+	const int radius = (int)weights.size() / 2;
+
+	std::vector<float> in((std::size_t)width*height*channels);
+	std::vector<float> out(in.size());
+	auto load = [&]()
+	{
+		for(int y = 0; y < height; ++y)
+			DecodeCpuImageRow(image, y, 0, width, in.data() + (std::size_t)y*width*channels);
+	};
+	auto store = [&]()
+	{
+		for(int y = 0; y < height; ++y)
+			EncodeCpuImageRow(image, y, 0, width, out.data() + (std::size_t)y*width*channels);
+	};
+
+	for(int n = 0; n < blurCount; ++n)
+	{
+		for(int pass = 0; pass < 2; ++pass)
+		{
+			load();
+			for(int y = 0; y < height; ++y)
+			{
+				for(int x = 0; x < width; ++x)
+				{
+					for(int c = 0; c < channels; ++c)
+					{
+						float sum = 0.0f;
+						for(int i = -radius; i <= radius; ++i)
+						{
+							int sx = pass == 0 ? std::min(std::max(x + i, 0), width - 1) : x;
+							int sy = pass == 1 ? std::min(std::max(y + i, 0), height - 1) : y;
+							float product = weights[i + radius]*in[((std::size_t)sy*width + sx)*channels + c];
+							sum = sum + product;
+						}
+						out[((std::size_t)y*width + x)*channels + c] = sum;
+					}
+				}
+			}
+			store();
+		}
+	}
+}
+
+void CheckConversions()
+{
+	int roundTripFailures = 0;
+	for(std::uint32_t h = 0; h < 0x10000; ++h)
+	{
+		bool nan = (h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0;
+		if(!nan && CpuFloatToHalf(CpuHalfToFloat((std::uint16_t)h)) != h)
+			++roundTripFailures;
+	}
+	Check(roundTripFailures == 0, "every half round trips, " + std::to_string(roundTripFailures) + " did not");
+
+	Check(CpuHalfToFloat(0x3c00) == 1.0f && CpuHalfToFloat(0xc000) == -2.0f && CpuHalfToFloat(0x0001) == std::ldexp(1.0f, -24),
+		"halves decode");
+	Check(CpuFloatToHalf(65519.0f) == 0x7bff && CpuFloatToHalf(65520.0f) == 0x7c00 && CpuFloatToHalf(1e9f) == 0x7c00,
+		"halves overflow to infinity from 65520");
+	Check(CpuFloatToHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3c00 && CpuFloatToHalf(1.0f + 3*std::ldexp(1.0f, -11)) == 0x3c02,
+		"normal halves round ties to even");
+	Check(CpuFloatToHalf(std::ldexp(1.0f, -25)) == 0x0000 && CpuFloatToHalf(3*std::ldexp(1.0f, -25)) == 0x0002,
+		"denormal halves round ties to even");
+	Check((CpuFloatToHalf(std::numeric_limits<float>::quiet_NaN()) & 0x7fff) > 0x7c00, "NaN stays NaN");
+
+	CpuImage rgba(CpuImageFormat::R8G8B8A8_UNORM, 64, 1);
+	for(std::uint32_t i = 0; i < 256; ++i)
+		rgba.Texels[i] = (std::uint8_t)i;
+	std::vector<float> values(256);
+	DecodeCpuImageRow(rgba, 0, 0, 64, values.data());
+	bool decoded = true;
+	for(std::uint32_t i = 0; i < 256; ++i)
+		decoded = decoded && values[i] == i / 255.0f;
+	Check(decoded, "RGBA8 decodes to c/255");
+
+	values[0] = -1.0f;
+	values[1] = 2.0f;
+	values[2] = std::numeric_limits<float>::quiet_NaN();
+	values[3] = 0.5f;
+	std::vector<std::uint8_t> before = rgba.Texels;
+	EncodeCpuImageRow(rgba, 0, 0, 64, values.data());
+	Check(std::memcmp(rgba.Texels.data() + 4, before.data() + 4, 252) == 0, "RGBA8 encodes back to itself");
+	Check(rgba.Texels[0] == 0 && rgba.Texels[1] == 255 && rgba.Texels[2] == 0 && rgba.Texels[3] == 128,
+		"RGBA8 saturates, NaN stores 0 and 0.5 rounds to 128");
+
+	CpuImage r16(CpuImageFormat::R16_UNORM, 4, 1);
+	float r16Values[4] = { 0.0f, 1.0f, 1.5f, 0.25f };
+	EncodeCpuImageRow(r16, 0, 0, 4, r16Values);
+	float r16Decoded[4];
+	DecodeCpuImageRow(r16, 0, 0, 4, r16Decoded);
+	Check(r16Decoded[0] == 0.0f && r16Decoded[1] == 1.0f && r16Decoded[2] == 1.0f && r16Decoded[3] == 16384 / 65535.0f,
+		"R16 saturates and rounds");
+}
+
+void CheckBlur()
+{
+	const CpuImageFormat formats[] =
+	{
+		CpuImageFormat::R8G8B8A8_UNORM, CpuImageFormat::R16G16B16A16_FLOAT, CpuImageFormat::R32G32B32A32_FLOAT,
+		CpuImageFormat::R16_UNORM
+	};
+	const std::uint32_t sizes[][2] = { { 1, 1 }, { 2, 3 }, { 17, 5 }, { 300, 37 }, { 257, 513 } };
+
+	ThreadPool onePool(1);
+	ThreadPool threePool(3);
+	ThreadPool* pools[] = { &onePool, &threePool };
+
+	CpuBlurFilter filter;
+	Check(filter.Radius() == 5 && filter.Weights().size() == 11, "sigma 2.5 gives BlurFilter's 11 weights");
+
+	std::uint32_t seed = 1;
+	for(CpuImageFormat format : formats)
+	{
+		for(const auto& size : sizes)
+		{
+			for(int blurCount = 1; blurCount <= 3; blurCount += 2)
+			{
+				for(ThreadPool* pool : pools)
+				{
+					CpuImage expected = RandomImage(format, size[0], size[1], seed);
+					CpuImage image = expected;
+					++seed;
+
+					ReferenceBlur(expected, filter.Weights(), blurCount);
+					filter.Execute(image, blurCount, *pool);
+
+					Check(image.Texels == expected.Texels, std::string(FormatName(format)) + " " +
+						std::to_string(size[0]) + "x" + std::to_string(size[1]) + " blurred " + std::to_string(blurCount) +
+						" times on " + std::to_string(pool->ConcurrencyLevel()) + " threads matches Blur.hlsl");
+				}
+			}
+		}
+	}
+
+	CpuImage flat(CpuImageFormat::R8G8B8A8_UNORM, 40, 30);
+	std::memset(flat.Texels.data(), 200, flat.Texels.size());
+	CpuImage flatBlurred = flat;
+	filter.Execute(flatBlurred, 4);
+	Check(flatBlurred.Texels == flat.Texels, "a flat image stays flat");
+}
+
+void TimeBlur()
+{
+	CpuBlurFilter filter;
+	CpuImage source = RandomImage(CpuImageFormat::R8G8B8A8_UNORM, 1920, 1080, 99);
+
+	CpuImage image = source;
+	auto start = Clock::now();
+	filter.Execute(image, 4);
+	double executorMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	CpuImage expected = source;
+	start = Clock::now();
+	ReferenceBlur(expected, filter.Weights(), 4);
+	double referenceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	Check(image.Texels == expected.Texels, "1920x1080 matches Blur.hlsl");
+	std::printf("1920x1080 RGBA8, 4 blurs: executor %.1f ms on %u threads, texel loop %.1f ms\n",
+		executorMs, ThreadPool::Default().ConcurrencyLevel(), referenceMs);
+}
+
+int main()
+{
+	CheckConversions();
+	CheckBlur();
+	TimeBlur();
+
+	return CheckExitCode();
+}
@@ -0,0 +1,276 @@
+//***************************************************************************************
+// main.cpp
+//
+// Checks CpuSobelEdgeMap and CpuSobelComposite, with no window or device:
+//   - the tiled SIMD kernels match a texel-by-texel loop written like Sobel.hlsl and
+//     Composite.hlsl, with the edge map stored to a texture in between, to within a
+//     step of the output format, for 8-bit, half and float images, single-channel
+//     inputs, odd sizes that cut tiles short and different thread counts,
+//   - a flat image has no edges away from its border, and a step has one.
+// Then it times both at 1920x1080 and 3840x2160.
+// Exits with 1 if a check fails.
+//***************************************************************************************
+
+#include "../../Common/CpuSobel.h"
+#include "../../Common/CheckUtil.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+typedef std::chrono::steady_clock Clock;
+
+const char* FormatName(CpuImageFormat format)
+{
+	switch(format)
+	{
+	case CpuImageFormat::R32G32B32A32_FLOAT: return "R32G32B32A32_FLOAT";
+	case CpuImageFormat::R16G16B16A16_FLOAT: return "R16G16B16A16_FLOAT";
+	case CpuImageFormat::R8G8B8A8_UNORM: return "R8G8B8A8_UNORM";
+	case CpuImageFormat::R32_FLOAT: return "R32_FLOAT";
+	case CpuImageFormat::R16_UNORM: return "R16_UNORM";
+	}
+	return "?";
+}
+
+// Smooth color ramps with a little noise, so edge values spread over [0, 1] rather than
+// all saturating.
+CpuImage SceneImage(CpuImageFormat format, std::uint32_t width, std::uint32_t height, std::uint32_t seed)
+{
+	CpuImage image(format, width, height);
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> noise(-0.03f, 0.03f);
+	const std::uint32_t channels = CpuImageChannelCount(format);
+	std::vector<float> row((std::size_t)width*channels);
+	for(std::uint32_t y = 0; y < height; ++y)
+	{
+		for(std::uint32_t x = 0; x < width; ++x)
+		{
+			for(std::uint32_t c = 0; c < channels; ++c)
+				row[x*channels + c] = 0.5f + 0.4f*std::sin(0.05f*x + 0.03f*y + 1.7f*c) + noise(rng);
+		}
+		EncodeCpuImageRow(image, y, 0, width, row.data());
+	}
+	return image;
+}
+
+// gInput[xy]: zero outside the image, and (r, 0, 0, 1) from a single-channel texture.
+void Load(const CpuImage& image, int x, int y, float c[4])
+{
+	c[0] = c[1] = c[2] = c[3] = 0.0f;
+	if(x < 0 || y < 0 || x >= (int)image.Width || y >= (int)image.Height)
+		return;
+	DecodeCpuImageRow(image, y, x, 1, c);
+	if(CpuImageChannelCount(image.Format) == 1)
+		c[3] = 1.0f;
+}
+
+void Store(CpuImage& image, int x, int y, const float c[4])
+{
+	EncodeCpuImageRow(image, y, x, 1, c);
+}
+
+// Sobel.hlsl, one texel at a time.
+void ReferenceEdgeMap(const CpuImage& input, CpuImage& edgeMap)
+{
+	for(int y = 0; y < (int)input.Height; ++y)
+	{
+		for(int x = 0; x < (int)input.Width; ++x)
+		{
+			float c[3][3][4];
+			for(int i = 0; i < 3; ++i)
+			{
+				for(int j = 0; j < 3; ++j)
+					Load(input, x - 1 + j, y - 1 + i, c[i][j]);
+			}
+
+			float mag[4];
+			for(int k = 0; k < 4; ++k)
+			{
+				float gx = -1.0f*c[0][0][k] - 2.0f*c[1][0][k] - 1.0f*c[2][0][k] + 1.0f*c[0][2][k] + 2.0f*c[1][2][k] + 1.0f*c[2][2][k];
+				float gy = -1.0f*c[2][0][k] - 2.0f*c[2][1][k] - 1.0f*c[2][1][k] + 1.0f*c[0][0][k] + 2.0f*c[0][1][k] + 1.0f*c[0][2][k];
+				mag[k] = std::sqrt(gx*gx + gy*gy);
+			}
+
+			float lum = mag[0]*0.299f + mag[1]*0.587f + mag[2]*0.114f;
+			float e = 1.0f - (lum > 0.0f ? (lum < 1.0f ? lum : 1.0f) : 0.0f);
+			float texel[4] = { e, e, e, e };
+			Store(edgeMap, x, y, texel);
+		}
+	}
+}
+
+// Sobel.hlsl into an edge map of the input's format, then Composite.hlsl.
+void ReferenceComposite(const CpuImage& input, CpuImage& output)
+{
+	CpuImage edgeMap(input.Format, input.Width, input.Height);
+	ReferenceEdgeMap(input, edgeMap);
+
+	for(int y = 0; y < (int)input.Height; ++y)
+	{
+		for(int x = 0; x < (int)input.Width; ++x)
+		{
+			float c[4], e[4], texel[4];
+			Load(input, x, y, c);
+			Load(edgeMap, x, y, e);
+			for(int k = 0; k < 4; ++k)
+				texel[k] = c[k]*e[k];
+			Store(output, x, y, texel);
+		}
+	}
+}
+
+// The largest difference between two images of the same size and format, decoded.
+float MaxDifference(const CpuImage& a, const CpuImage& b)
+{
+	const std::uint32_t channels = CpuImageChannelCount(a.Format);
+	std::vector<float> rowA((std::size_t)a.Width*channels);
+	std::vector<float> rowB((std::size_t)a.Width*channels);
+	float maxDifference = 0.0f;
+	for(std::uint32_t y = 0; y < a.Height; ++y)
+	{
+		DecodeCpuImageRow(a, y, 0, a.Width, rowA.data());
+		DecodeCpuImageRow(b, y, 0, b.Width, rowB.data());
+		for(std::size_t i = 0; i < rowA.size(); ++i)
+			maxDifference = std::max(maxDifference, std::fabs(rowA[i] - rowB[i]));
+	}
+	return maxDifference;
+}
+
+// The kernels and the texel loop evaluate the same expressions, so they give the same
+// bits unless the compiler fuses multiplies and adds differently in each, as /fp:fast
+// with /arch:AVX2 or -ffp-contract=fast may.  That moves a result by a rounding error,
+// which can still round to the neighboring value of the format, so images may differ
+// by one step of their format.  Values are in [0, 1].
+float Tolerance(CpuImageFormat format)
+{
+	switch(format)
+	{
+	case CpuImageFormat::R8G8B8A8_UNORM: return 1.0f / 255.0f + 1e-6f;
+	case CpuImageFormat::R16_UNORM: return 1.0f / 65535.0f + 1e-7f;
+	case CpuImageFormat::R16G16B16A16_FLOAT: return 1.0f / 1024.0f;
+	case CpuImageFormat::R32_FLOAT:
+	case CpuImageFormat::R32G32B32A32_FLOAT: return 1e-5f;
+	}
+	return 0.0f;
+}
+
+bool Matches(const CpuImage& image, const CpuImage& expected)
+{
+	return MaxDifference(image, expected) <= Tolerance(image.Format);
+}
+
+std::string Describe(const CpuImage& input, CpuImageFormat outputFormat, const ThreadPool& pool)
+{
+	return std::string(FormatName(input.Format)) + " to " + FormatName(outputFormat) + " " +
+		std::to_string(input.Width) + "x" + std::to_string(input.Height) + " on " +
+		std::to_string(pool.ConcurrencyLevel()) + " threads";
+}
+
+void CheckAgainstShaders()
+{
+	const CpuImageFormat pairs[][2] =
+	{
+		{ CpuImageFormat::R8G8B8A8_UNORM, CpuImageFormat::R8G8B8A8_UNORM },
+		{ CpuImageFormat::R16G16B16A16_FLOAT, CpuImageFormat::R16G16B16A16_FLOAT },
+		{ CpuImageFormat::R32G32B32A32_FLOAT, CpuImageFormat::R32G32B32A32_FLOAT },
+		{ CpuImageFormat::R16_UNORM, CpuImageFormat::R16_UNORM },
+		{ CpuImageFormat::R16G16B16A16_FLOAT, CpuImageFormat::R8G8B8A8_UNORM },
+		{ CpuImageFormat::R16_UNORM, CpuImageFormat::R8G8B8A8_UNORM },
+	};
+	const std::uint32_t sizes[][2] = { { 1, 1 }, { 2, 2 }, { 5, 3 }, { 300, 37 }, { 513, 70 } };
+
+	ThreadPool onePool(1);
+	ThreadPool threePool(3);
+	ThreadPool* pools[] = { &onePool, &threePool };
+
+	std::uint32_t seed = 1;
+	for(const auto& formats : pairs)
+	{
+		for(const auto& size : sizes)
+		{
+			for(ThreadPool* pool : pools)
+			{
+				CpuImage input = SceneImage(formats[0], size[0], size[1], seed++);
+
+				CpuImage expectedEdges(formats[1], size[0], size[1]);
+				CpuImage edges(formats[1], size[0], size[1]);
+				ReferenceEdgeMap(input, expectedEdges);
+				CpuSobelEdgeMap(input, edges, *pool);
+				Check(Matches(edges, expectedEdges), "edge map of " + Describe(input, formats[1], *pool) + " matches Sobel.hlsl");
+
+				CpuImage expected(formats[1], size[0], size[1]);
+				CpuImage output(formats[1], size[0], size[1]);
+				ReferenceComposite(input, expected);
+				CpuSobelComposite(input, output, *pool);
+				Check(Matches(output, expected), "composite of " + Describe(input, formats[1], *pool) + " matches Composite.hlsl");
+			}
+		}
+	}
+}
+
+void CheckEdges()
+{
+	// Flat gray: white inside, dark along the border, where loads past the edge read 0.
+	CpuImage flat(CpuImageFormat::R32G32B32A32_FLOAT, 20, 10);
+	std::vector<float> gray(4*20, 0.5f);
+	for(std::uint32_t y = 0; y < 10; ++y)
+		EncodeCpuImageRow(flat, y, 0, 20, gray.data());
+
+	CpuImage edges(CpuImageFormat::R32G32B32A32_FLOAT, 20, 10);
+	CpuSobelEdgeMap(flat, edges);
+	float inside[4], border[4];
+	DecodeCpuImageRow(edges, 5, 10, 1, inside);
+	DecodeCpuImageRow(edges, 0, 10, 1, border);
+	Check(inside[0] == 1.0f && inside[3] == 1.0f, "a flat image has no edges inside");
+	Check(border[0] < 0.5f, "loads past the border read as black");
+
+	// A vertical black-to-white step: an edge either side of it, none away from it.
+	CpuImage step(CpuImageFormat::R8G8B8A8_UNORM, 16, 8);
+	for(std::uint32_t y = 0; y < 8; ++y)
+	{
+		for(std::uint32_t x = 0; x < 16; ++x)
+			std::memset(step.Row(y) + 4*x, x < 8 ? 0 : 255, 4);
+	}
+	CpuImage stepEdges(CpuImageFormat::R8G8B8A8_UNORM, 16, 8);
+	CpuSobelEdgeMap(step, stepEdges);
+	Check(stepEdges.Row(4)[4*7] == 0 && stepEdges.Row(4)[4*8] == 0, "a step is an edge");
+	Check(stepEdges.Row(4)[4*3] == 255 && stepEdges.Row(4)[4*11] == 255, "either side of a step is flat");
+}
+
+void Time(CpuImageFormat format, std::uint32_t width, std::uint32_t height)
+{
+	CpuImage input = SceneImage(format, width, height, 7);
+
+	CpuImage output(format, width, height);
+	auto start = Clock::now();
+	CpuSobelComposite(input, output);
+	double tiledMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	CpuImage expected(format, width, height);
+	start = Clock::now();
+	ReferenceComposite(input, expected);
+	double referenceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	Check(Matches(output, expected), std::string(FormatName(format)) + " " + std::to_string(width) + "x" +
+		std::to_string(height) + " matches the shaders");
+	std::printf("%ux%u %s edge detect and composite: tiled %.1f ms on %u threads, texel loop %.1f ms\n",
+		width, height, FormatName(format), tiledMs, ThreadPool::Default().ConcurrencyLevel(), referenceMs);
+}
+
+int main()
+{
+	CheckAgainstShaders();
+	CheckEdges();
+
+	Time(CpuImageFormat::R8G8B8A8_UNORM, 1920, 1080);
+	Time(CpuImageFormat::R8G8B8A8_UNORM, 3840, 2160);
+	Time(CpuImageFormat::R16G16B16A16_FLOAT, 1920, 1080);
+	Time(CpuImageFormat::R16G16B16A16_FLOAT, 3840, 2160);
+	Time(CpuImageFormat::R32G32B32A32_FLOAT, 3840, 2160);
+
+	return CheckExitCode();
+}
@@ -463,6 +463,7 @@ void SobelApp::OnKeyboardInput(const GameTimer& gt)
  
 void SobelApp::UpdateCamera(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Convert Spherical to Cartesian coordinates.
 	mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
 	mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
@@ -503,6 +504,7 @@ void SobelApp::AnimateMaterials(const GameTimer& gt)
 
 void SobelApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -529,6 +531,7 @@ void SobelApp::UpdateObjectCBs(const GameTimer& gt)
 
 void SobelApp::UpdateMaterialCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
 	for(auto& e : mMaterials)
 	{
@@ -555,6 +558,7 @@ void SobelApp::UpdateMaterialCBs(const GameTimer& gt)
 
 void SobelApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = XMLoadFloat4x4(&mView);
 	XMMATRIX proj = XMLoadFloat4x4(&mProj);
 
@@ -590,6 +594,7 @@ void SobelApp::UpdateMainPassCB(const GameTimer& gt)
 
 void SobelApp::UpdateWavesGPU(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Every quarter second, generate a random wave.
 	static float t_base = 0.0f;
 	if((mTimer.TotalTime() - t_base) >= 0.25f)
@@ -1268,6 +1273,7 @@ void SobelApp::BuildRenderItems()
 
 void SobelApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+    PROFILE_FUNCTION();
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
     UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
@@ -1299,6 +1305,7 @@ void SobelApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::ve
 
 void SobelApp::DrawFullscreenQuad(ID3D12GraphicsCommandList* cmdList)
 {
+	PROFILE_FUNCTION();
 	// Null-out IA stage since we build the vertex off the SV_VertexID in the shader.
 	cmdList->IASetVertexBuffers(0, 1, nullptr);
 	cmdList->IASetIndexBuffer(nullptr);
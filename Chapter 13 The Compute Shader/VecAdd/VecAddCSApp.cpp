@@ -336,6 +336,7 @@ void VecAddCSApp::OnMouseMove(WPARAM btnState, int x, int y)
  
 void VecAddCSApp::DoComputeWork()
 {
+	PROFILE_FUNCTION();
 	// Reuse the memory associated with command recording.
 	// We can only reset when the associated command lists have finished execution on the GPU.
 	ThrowIfFailed(mDirectCmdListAlloc->Reset());
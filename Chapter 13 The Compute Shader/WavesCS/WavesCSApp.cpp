@@ -388,6 +388,7 @@ void WavesCSApp::OnKeyboardInput(const GameTimer& gt)
  
 void WavesCSApp::UpdateCamera(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Convert Spherical to Cartesian coordinates.
 	mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
 	mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
@@ -428,6 +429,7 @@ void WavesCSApp::AnimateMaterials(const GameTimer& gt)
 
 void WavesCSApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -454,6 +456,7 @@ void WavesCSApp::UpdateObjectCBs(const GameTimer& gt)
 
 void WavesCSApp::UpdateMaterialCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
 	for(auto& e : mMaterials)
 	{
@@ -480,6 +483,7 @@ void WavesCSApp::UpdateMaterialCBs(const GameTimer& gt)
 
 void WavesCSApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = XMLoadFloat4x4(&mView);
 	XMMATRIX proj = XMLoadFloat4x4(&mProj);
 
@@ -515,6 +519,7 @@ void WavesCSApp::UpdateMainPassCB(const GameTimer& gt)
 
 void WavesCSApp::UpdateWavesGPU(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Every quarter second, generate a random wave.
 	static float t_base = 0.0f;
 	if((mTimer.TotalTime() - t_base) >= 0.25f)
@@ -1082,6 +1087,7 @@ void WavesCSApp::BuildRenderItems()
 
 void WavesCSApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+    PROFILE_FUNCTION();
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
     UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
@@ -0,0 +1,241 @@
+//***************************************************************************************
+// main.cpp
+//
+// Frustum culling benchmark on the instancing demo's scene: a grid of skulls spaced as in
+// InstancingAndCullingApp::BuildRenderItems, viewed by a camera circling and crossing the
+// grid with the demo's lens.  Compares, per frame:
+//   - the demo's original test (invert each world matrix, move the frustum into local
+//     space, BoundingFrustum::Contains),
+//   - CullBoxesScalar and CullBoxes over world-space boxes,
+//   - CullingBvh.
+// The SIMD mask and the BVH's visible set must match the scalar mask, except for boxes
+// touching a plane to within rounding: a /fp:fast build may contract the plane tests
+// into multiply-adds differently in each.
+//
+// Usage: CullBench [skull.txt] [frames]
+//***************************************************************************************
+
+#include "../../Common/MathHelper.h"
+#include "../../Common/MeshCache.h"
+#include "../../Common/FrustumCuller.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace DirectX;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Scene
+{
+	std::vector<XMFLOAT4X4> World;
+	std::vector<BoundingBox> WorldBounds;
+};
+
+// n*n*n instances 50 units apart, centered on the origin.  n = 5 is the demo's scene.
+Scene BuildScene(int n, const BoundingBox& localBounds)
+{
+	const float spacing = 50.0f;
+	const float offset = -0.5f*spacing*(n - 1);
+
+	Scene scene;
+	for(int k = 0; k < n; ++k)
+	{
+		for(int i = 0; i < n; ++i)
+		{
+			for(int j = 0; j < n; ++j)
+			{
+				XMMATRIX world = XMMatrixTranslation(offset + j*spacing, offset + i*spacing, offset + k*spacing);
+
+				XMFLOAT4X4 W;
+				XMStoreFloat4x4(&W, world);
+				scene.World.push_back(W);
+
+				BoundingBox bounds;
+				localBounds.Transform(bounds, world);
+				scene.WorldBounds.push_back(bounds);
+			}
+		}
+	}
+
+	return scene;
+}
+
+// Camera for frame f of frameCount: half the frames circle the grid, the rest fly
+// through it.
+XMMATRIX CameraView(int f, int frameCount, float gridRadius)
+{
+	float t = (float)f / (float)frameCount;
+	float angle = XM_2PI * t;
+
+	XMVECTOR eye;
+	if(f < frameCount / 2)
+		eye = XMVectorSet(1.5f*gridRadius*cosf(angle), 0.3f*gridRadius, 1.5f*gridRadius*sinf(angle), 1.0f);
+	else
+		eye = XMVectorSet(0.5f*gridRadius*cosf(angle), 0.0f, 0.5f*gridRadius*sinf(angle), 1.0f);
+
+	XMVECTOR target = XMVectorSet(gridRadius*sinf(3.0f*angle)*0.3f, 0.0f, 0.0f, 1.0f);
+	return XMMatrixLookAtLH(eye, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+}
+
+// True if box touches one of the frustum's planes so closely that rounding can put it
+// on either side: d + r, recomputed in double, is within a few float ulps of the terms
+// it is summed from.
+bool OnPlane(const CullingFrustum& frustum, const BoundingBox& box)
+{
+	const XMFLOAT3& c = box.Center;
+	const XMFLOAT3& e = box.Extents;
+	for(const XMFLOAT4& n : frustum.Planes)
+	{
+		double d = (double)n.x*c.x + (double)n.y*c.y + (double)n.z*c.z + n.w;
+		double r = std::fabs((double)n.x)*e.x + std::fabs((double)n.y)*e.y + std::fabs((double)n.z)*e.z;
+		double scale = std::fabs((double)n.x*c.x) + std::fabs((double)n.y*c.y) + std::fabs((double)n.z*c.z) +
+			std::fabs((double)n.w) + r;
+		if(std::fabs(d + r) <= 1e-5*scale)
+			return true;
+	}
+	return false;
+}
+
+// Returns the first box whose bit differs between masks a and b while it is clear of
+// every plane, or count if they agree.
+std::uint32_t FindMismatch(const CullingFrustum& frustum, const std::vector<BoundingBox>& bounds,
+	const std::uint32_t* a, const std::uint32_t* b, std::uint32_t count)
+{
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		std::uint32_t bit = 1u << (i % 32);
+		if((a[i / 32] & bit) != (b[i / 32] & bit) && !OnPlane(frustum, bounds[i]))
+			return i;
+	}
+	return count;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string skullFilename = argc > 1 ? argv[1] : "../InstancingAndCulling/Models/skull.txt";
+	int frameCount = argc > 2 ? MathHelper::Max(2, std::atoi(argv[2])) : 100;
+
+	MeshCache skull;
+	if(!skull.Load(skullFilename))
+	{
+		std::printf("Could not load %s.\n", skullFilename.c_str());
+		return 1;
+	}
+	const BoundingBox& localBounds = skull.Bounds();
+
+	// Same lens as InstancingAndCullingApp::OnResize for an 800x600 window.
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, 800.0f / 600.0f, 1.0f, 1000.0f);
+
+	BoundingFrustum camFrustum;
+	BoundingFrustum::CreateFromMatrix(camFrustum, proj);
+
+	const int gridSizes[] = { 5, 22, 47 };
+
+	// BoundingFrustum::Contains also tests the frustum corners against the box, while the
+	// plane test lets boxes just outside a corner through, so "visible" can be slightly
+	// above "original".
+	std::printf("%9s %9s %9s %12s %12s %12s %12s\n", "instances", "visible", "original",
+		"original ms", "scalar ms", "simd ms", "bvh ms");
+
+	for(int n : gridSizes)
+	{
+		Scene scene = BuildScene(n, localBounds);
+		const std::uint32_t count = (std::uint32_t)scene.World.size();
+		const float gridRadius = 25.0f*(n - 1) + 50.0f;
+
+		CullingBoxList boxes;
+		boxes.Resize(count);
+		for(std::uint32_t i = 0; i < count; ++i)
+			boxes.SetBox(i, scene.WorldBounds[i]);
+
+		CullingBvh bvh;
+		bvh.Build(scene.WorldBounds.data(), count);
+
+		std::vector<std::uint32_t> scalarMask(boxes.MaskWordCount());
+		std::vector<std::uint32_t> simdMask(boxes.MaskWordCount());
+		std::vector<std::uint32_t> bvhMask(boxes.MaskWordCount());
+		std::vector<std::uint32_t> visible;
+		std::vector<std::uint32_t> bvhVisible;
+		visible.reserve(count);
+		bvhVisible.reserve(count);
+
+		double originalMs = 0.0, scalarMs = 0.0, simdMs = 0.0, bvhMs = 0.0;
+		size_t visibleTotal = 0;
+		size_t originalVisibleTotal = 0;
+
+		for(int f = 0; f < frameCount; ++f)
+		{
+			XMMATRIX view = CameraView(f, frameCount, gridRadius);
+			XMVECTOR viewDet = XMMatrixDeterminant(view);
+			XMMATRIX invView = XMMatrixInverse(&viewDet, view);
+			CullingFrustum frustum = CullingFrustum::FromViewProj(XMMatrixMultiply(view, proj));
+
+			auto t0 = Clock::now();
+
+			for(std::uint32_t i = 0; i < count; ++i)
+			{
+				XMMATRIX world = XMLoadFloat4x4(&scene.World[i]);
+				XMVECTOR worldDet = XMMatrixDeterminant(world);
+				XMMATRIX invWorld = XMMatrixInverse(&worldDet, world);
+
+				BoundingFrustum localSpaceFrustum;
+				camFrustum.Transform(localSpaceFrustum, XMMatrixMultiply(invView, invWorld));
+				if(localSpaceFrustum.Contains(localBounds) != DISJOINT)
+					++originalVisibleTotal;
+			}
+
+			auto t1 = Clock::now();
+			CullBoxesScalar(frustum, boxes, 0, count, scalarMask.data());
+			auto t2 = Clock::now();
+			CullBoxes(frustum, boxes, 0, count, simdMask.data());
+			visible.clear();
+			AppendVisibleIndices(simdMask.data(), 0, count, visible);
+			auto t3 = Clock::now();
+			bvh.Cull(frustum, bvhVisible);
+			auto t4 = Clock::now();
+
+			std::uint32_t mismatch = FindMismatch(frustum, scene.WorldBounds, scalarMask.data(), simdMask.data(), count);
+			if(mismatch != count)
+			{
+				std::printf("Scalar and SIMD masks differ for box %u of %u, frame %d.\n", mismatch, count, f);
+				return 1;
+			}
+
+			bool repeated = false;
+			std::fill(bvhMask.begin(), bvhMask.end(), 0u);
+			for(std::uint32_t i : bvhVisible)
+			{
+				std::uint32_t bit = 1u << (i % 32);
+				repeated = repeated || (bvhMask[i / 32] & bit) != 0;
+				bvhMask[i / 32] |= bit;
+			}
+			if(repeated)
+			{
+				std::printf("BVH reports an instance twice at %u instances, frame %d.\n", count, f);
+				return 1;
+			}
+
+			mismatch = FindMismatch(frustum, scene.WorldBounds, scalarMask.data(), bvhMask.data(), count);
+			if(mismatch != count)
+			{
+				std::printf("BVH and scalar culling differ for box %u of %u, frame %d.\n", mismatch, count, f);
+				return 1;
+			}
+
+			originalMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+			scalarMs += std::chrono::duration<double, std::milli>(t2 - t1).count();
+			simdMs += std::chrono::duration<double, std::milli>(t3 - t2).count();
+			bvhMs += std::chrono::duration<double, std::milli>(t4 - t3).count();
+			visibleTotal += visible.size();
+		}
+
+		std::printf("%9u %9u %9u %12.4f %12.4f %12.4f %12.4f\n", count, (UINT)(visibleTotal / frameCount),
+			(UINT)(originalVisibleTotal / frameCount), originalMs / frameCount, scalarMs / frameCount, simdMs / frameCount, bvhMs / frameCount);
+	}
+
+	return 0;
+}
@@ -7,6 +7,12 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/MeshCache.h"
+#include "../../Common/MeshSimplifier.h"
+#include "../../Common/CullingBvh.h"
+#include "../../Common/StreamingCopy.h"
+#include "../../Common/StreamedTextures.h"
+#include "../../Common/ThreadPool.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -18,6 +24,34 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
+// Instances are culled and staged in chunks of this many, one chunk per task.
+const UINT gInstanceChunkSize = 256;
+
+// Levels of detail per mesh, and how many pixels a LOD's error may cover on screen
+// before the next finer one is drawn.
+const UINT gMaxLods = 4;
+const float gMaxLodPixelError = 1.0f;
+
+// Bytes of texture data the streamer may keep resident.  The tails of all the textures
+// fit with room to spare, but not every mip of every texture.
+const std::uint64_t gTextureMemoryBudget = 1 << 20;
+
+// The visible instances of one chunk, transposed and ready for the instance buffer, with
+// one staging list per LOD.  The vectors are reserved for a full chunk up front, so
+// culling and staging never grow them.  The frame is not allocation free, though: each
+// ParallelForRange still queues a std::function, and may grow the pool's deque, for
+// every helper thread it wakes.
+struct InstanceChunk
+{
+	std::vector<std::uint32_t> Visible;
+	std::vector<InstanceData> Staging[gMaxLods];
+	UINT Offset[gMaxLods] = {};
+
+	// The most texels across each streamed texture needs for the chunk's visible
+	// instances.
+	std::vector<float> TextureTexels;
+};
+
 // Lightweight structure stores parameters to draw a shape.  This will
 // vary from app-to-app.
 struct RenderItem
@@ -50,11 +84,24 @@ struct RenderItem
 	BoundingBox Bounds;
 	std::vector<InstanceData> Instances;
 
+	// World-space bounds of Instances, and the chunks of the last cull.  Chunk c covers
+	// the positions [c*gInstanceChunkSize, (c+1)*gInstanceChunkSize) of the BVH's tree
+	// order, so each chunk's instances are close together in space.
+	CullingBvh InstanceBvh;
+	std::vector<InstanceChunk> InstanceChunks;
+
     // DrawIndexedInstanced parameters.
     UINT IndexCount = 0;
 	UINT InstanceCount = 0;
     UINT StartIndexLocation = 0;
     int BaseVertexLocation = 0;
+
+	// Index ranges of the levels of detail, finest first, and where the instances drawn
+	// with each start in the instance buffer after the last cull.  The instance buffer
+	// holds them in LOD order, so each LOD is one instanced draw.
+	std::vector<MeshLod> Lods;
+	UINT LodInstanceCount[gMaxLods] = {};
+	UINT LodInstanceOffset[gMaxLods] = {};
 };
 
 class InstancingAndCullingApp : public D3DApp
@@ -109,7 +156,10 @@ private:
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
-	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
+	std::unique_ptr<StreamedTextures> mStreamedTextures;
+
+	// The streamed texture of each material, by MatCBIndex.
+	std::vector<std::uint32_t> mMaterialTextures;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
 
@@ -124,8 +174,14 @@ private:
 	UINT mInstanceCount = 0;
 
 	bool mFrustumCullingEnabled = true;
+	bool mLodEnabled = true;
 
-	BoundingFrustum mCamFrustum;
+	std::vector<MeshLod> mSkullLods;
+
+	// Sub-stages of Update in the frame telemetry.
+	std::uint32_t mFenceWaitScope = FrameTelemetry::InvalidScope;
+	std::uint32_t mCullScope = FrameTelemetry::InvalidScope;
+	std::uint32_t mUploadScope = FrameTelemetry::InvalidScope;
 
     PassConstants mMainPassCB;
 
@@ -160,6 +216,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 InstancingAndCullingApp::InstancingAndCullingApp(HINSTANCE hInstance)
     : D3DApp(hInstance)
 {
+	mFenceWaitScope = mTelemetry.RegisterScope("FenceWait");
+	mCullScope = mTelemetry.RegisterScope("Cull");
+	mUploadScope = mTelemetry.RegisterScope("Upload");
 }
 
 InstancingAndCullingApp::~InstancingAndCullingApp()
@@ -208,8 +267,6 @@ void InstancingAndCullingApp::OnResize()
     D3DApp::OnResize();
 
 	mCamera.SetLens(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
-
-	BoundingFrustum::CreateFromMatrix(mCamFrustum, mCamera.GetProj());
 }
 
 void InstancingAndCullingApp::Update(const GameTimer& gt)
@@ -224,6 +281,7 @@ void InstancingAndCullingApp::Update(const GameTimer& gt)
     // If not, wait until the GPU has completed commands up to this fence point.
     if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
     {
+		FrameTelemetry::ScopeTimer scope(mTelemetry, mFenceWaitScope);
         HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
         ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
         WaitForSingleObject(eventHandle, INFINITE);
@@ -248,6 +306,13 @@ void InstancingAndCullingApp::Draw(const GameTimer& gt)
     // Reusing the command list reuses memory.
     ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
 
+	// Stream textures in and out, then point this frame resource's table at them.  The
+	// GPU is done with the table, as Update waited for the frame that last used it.
+	mStreamedTextures->Update(mCommandList.Get(), mFence->GetCompletedValue(), mCurrentFence + 1);
+	const UINT srvTableStart = mCurrFrameResourceIndex*mStreamedTextures->Count();
+	mStreamedTextures->WriteDescriptors(CD3DX12_CPU_DESCRIPTOR_HANDLE(
+		mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), srvTableStart, mCbvSrvDescriptorSize), mCbvSrvDescriptorSize);
+
     mCommandList->RSSetViewports(1, &mScreenViewport);
     mCommandList->RSSetScissorRects(1, &mScissorRect);
 
@@ -276,7 +341,8 @@ void InstancingAndCullingApp::Draw(const GameTimer& gt)
 	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
 
 	// Bind all the textures used in this scene.
-	mCommandList->SetGraphicsRootDescriptorTable(3, mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	mCommandList->SetGraphicsRootDescriptorTable(3, CD3DX12_GPU_DESCRIPTOR_HANDLE(
+		mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart(), srvTableStart, mCbvSrvDescriptorSize));
 
     DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
 
@@ -355,6 +421,12 @@ void InstancingAndCullingApp::OnKeyboardInput(const GameTimer& gt)
 	if(GetAsyncKeyState('2') & 0x8000)
 		mFrustumCullingEnabled = false;
 
+	if(GetAsyncKeyState('3') & 0x8000)
+		mLodEnabled = true;
+
+	if(GetAsyncKeyState('4') & 0x8000)
+		mLodEnabled = false;
+
 	mCamera.UpdateViewMatrix();
 }
  
@@ -365,56 +437,158 @@ void InstancingAndCullingApp::AnimateMaterials(const GameTimer& gt)
 
 void InstancingAndCullingApp::UpdateInstanceData(const GameTimer& gt)
 {
-	XMMATRIX view = mCamera.GetView();
-	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+	PROFILE_FUNCTION();
+	// Cull in world space against the planes of the view-projection matrix, so the
+	// instances need neither their world matrix inverted nor the frustum transformed.
+	XMMATRIX viewProj = XMMatrixMultiply(mCamera.GetView(), mCamera.GetProj());
+	CullingFrustum frustum = CullingFrustum::FromViewProj(viewProj);
+
+	XMVECTOR eyePos = mCamera.GetPosition();
+	const float pixelsPerUnit = LodPixelsPerUnit(mCamera.GetProj4x4f(), (float)mClientHeight);
 
 	auto currInstanceBuffer = mCurrFrameResource->InstanceBuffer.get();
+	ThreadPool& pool = ThreadPool::Default();
+
+	// Every render item adds its texture requests below, so start from none once.
+	mStreamedTextures->Streamer().ClearRequests();
 	for(auto& e : mAllRitems)
 	{
 		const auto& instanceData = e->Instances;
-
-		int visibleInstanceCount = 0;
-
-		for(UINT i = 0; i < (UINT)instanceData.size(); ++i)
+		auto& chunks = e->InstanceChunks;
+		const UINT instanceCount = (UINT)instanceData.size();
+		const UINT lodCount = mLodEnabled ? (UINT)e->Lods.size() : 1;
+		const float boundsRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&e->Bounds.Extents)));
+
+		// Cull each chunk and stage its visible instances transposed, so culling and the
+		// matrix math touch only cached memory.  Each visible instance also picks its LOD
+		// from the distance to its bounding sphere, and estimates from it how many texels
+		// across its texture would take to cover it on screen.
+		FrameTelemetry::ScopeTimer cullScope(mTelemetry, mCullScope);
+		pool.ParallelForRange(0, (int)chunks.size(), 1, [&](int chunkBegin, int chunkEnd)
 		{
-			XMMATRIX world = XMLoadFloat4x4(&instanceData[i].World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&instanceData[i].TexTransform);
-
-			XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(world), world);
+			PROFILE_SCOPE("CullChunks");
+			for(int c = chunkBegin; c < chunkEnd; ++c)
+			{
+				UINT first = c*gInstanceChunkSize;
+				UINT last = MathHelper::Min(first + gInstanceChunkSize, instanceCount);
+
+				auto& visible = chunks[c].Visible;
+				visible.clear();
+				if(mFrustumCullingEnabled)
+				{
+					e->InstanceBvh.CullRange(frustum, first, last, visible);
+				}
+				else
+				{
+					for(UINT i = first; i < last; ++i)
+						visible.push_back(i);
+				}
+
+				auto& staging = chunks[c].Staging;
+				for(auto& lodStaging : staging)
+					lodStaging.clear();
+
+				auto& textureTexels = chunks[c].TextureTexels;
+				std::fill(textureTexels.begin(), textureTexels.end(), 0.0f);
+
+				for(UINT i = 0; i < (UINT)visible.size(); ++i)
+				{
+					const InstanceData& instance = instanceData[visible[i]];
+					XMMATRIX world = XMLoadFloat4x4(&instance.World);
+					XMMATRIX texTransform = XMLoadFloat4x4(&instance.TexTransform);
+
+					float scale = MathHelper::Max(XMVectorGetX(XMVector3Length(world.r[0])),
+						MathHelper::Max(XMVectorGetX(XMVector3Length(world.r[1])), XMVectorGetX(XMVector3Length(world.r[2]))));
+					XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&e->Bounds.Center), world);
+					float distance = MathHelper::Max(XMVectorGetX(XMVector3Length(XMVectorSubtract(center, eyePos))) - scale*boundsRadius, 0.0f);
+
+					UINT lod = 0;
+					if(lodCount > 1)
+						lod = MathHelper::Min(SelectLod(e->Lods, distance, scale, pixelsPerUnit, gMaxLodPixelError), lodCount - 1);
+
+					// The bounding sphere's diameter in pixels, over how many times the
+					// texture repeats across it.
+					float repeat = MathHelper::Max(XMVectorGetX(XMVector2Length(texTransform.r[0])), XMVectorGetX(XMVector2Length(texTransform.r[1])));
+					float texels = 2.0f*scale*boundsRadius*pixelsPerUnit / MathHelper::Max(distance, 1.0f) / MathHelper::Max(repeat, 0.01f);
+					float& chunkTexels = textureTexels[mMaterialTextures[instance.MaterialIndex]];
+					chunkTexels = MathHelper::Max(chunkTexels, texels);
+
+					staging[lod].emplace_back();
+					InstanceData& data = staging[lod].back();
+					XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
+					XMStoreFloat4x4(&data.TexTransform, XMMatrixTranspose(texTransform));
+					data.MaterialIndex = instance.MaterialIndex;
+				}
+			}
+		});
+		cullScope.Stop();
 
-			// View space to the object's local space.
-			XMMATRIX viewToLocal = XMMatrixMultiply(invView, invWorld);
- 
-			// Transform the camera frustum from view space to the object's local space.
-			BoundingFrustum localSpaceFrustum;
-			mCamFrustum.Transform(localSpaceFrustum, viewToLocal);
+		// The visible instances are packed by LOD, then in chunk order; a prefix sum over
+		// the staging sizes gives where each chunk's run of each LOD starts.
+		UINT visibleCount = 0;
+		for(UINT lod = 0; lod < gMaxLods; ++lod)
+		{
+			e->LodInstanceOffset[lod] = visibleCount;
+			for(auto& chunk : chunks)
+			{
+				chunk.Offset[lod] = visibleCount;
+				visibleCount += (UINT)chunk.Staging[lod].size();
+			}
+			e->LodInstanceCount[lod] = visibleCount - e->LodInstanceOffset[lod];
+		}
 
-			// Perform the box/frustum intersection test in local space.
-			if((localSpaceFrustum.Contains(e->Bounds) != DirectX::DISJOINT) || (mFrustumCullingEnabled==false))
+		// Write the instance data to structured buffer for the visible objects.  Each
+		// chunk's LOD runs go out as contiguous streaming stores rather than one 144-byte
+		// write per instance.
+		FrameTelemetry::ScopeTimer uploadScope(mTelemetry, mUploadScope);
+		// The chunks are copied as packed InstanceData arrays, so the buffer's elements
+		// must not be padded.
+		assert(currInstanceBuffer->ElementByteSize() == sizeof(InstanceData));
+		BYTE* mappedInstances = currInstanceBuffer->MappedData();
+		pool.ParallelForRange(0, (int)chunks.size(), 1, [&](int chunkBegin, int chunkEnd)
+		{
+			PROFILE_SCOPE("CopyChunks");
+			for(int c = chunkBegin; c < chunkEnd; ++c)
 			{
-				InstanceData data;
-				XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
-				XMStoreFloat4x4(&data.TexTransform, XMMatrixTranspose(texTransform));
-				data.MaterialIndex = instanceData[i].MaterialIndex;
+				for(UINT lod = 0; lod < gMaxLods; ++lod)
+				{
+					const auto& staging = chunks[c].Staging[lod];
+					if(!staging.empty())
+						StreamingCopy(mappedInstances + (size_t)chunks[c].Offset[lod]*sizeof(InstanceData),
+							staging.data(), staging.size()*sizeof(InstanceData));
+				}
+			}
+		});
+		uploadScope.Stop();
 
-				// Write the instance data to structured buffer for the visible objects.
-				currInstanceBuffer->CopyData(visibleInstanceCount++, data);
+		// Ask the streamer for the finest mips any chunk wants; Draw applies what it loads.
+		for(auto& chunk : chunks)
+		{
+			for(std::uint32_t t = 0; t < (std::uint32_t)chunk.TextureTexels.size(); ++t)
+			{
+				if(chunk.TextureTexels[t] > 0.0f)
+					mStreamedTextures->Streamer().Request(t, chunk.TextureTexels[t]);
 			}
 		}
 
-		e->InstanceCount = visibleInstanceCount;
+		e->InstanceCount = visibleCount;
 
 		std::wostringstream outs;
 		outs.precision(6);
 		outs << L"Instancing and Culling Demo" <<
 			L"    " << e->InstanceCount <<
-			L" objects visible out of " << e->Instances.size();
+			L" objects visible out of " << e->Instances.size() << L", per LOD";
+		for(UINT lod = 0; lod < (UINT)e->Lods.size(); ++lod)
+			outs << L" " << e->LodInstanceCount[lod];
+		outs << L", textures " << mStreamedTextures->Streamer().ResidentBytes() / 1024 <<
+			L"/" << mStreamedTextures->Streamer().MemoryBudget() / 1024 << L" KB";
 		mMainWndCaption = outs.str();
 	}
 }
 
 void InstancingAndCullingApp::UpdateMaterialBuffer(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
 	for(auto& e : mMaterials)
 	{
@@ -442,6 +616,7 @@ void InstancingAndCullingApp::UpdateMaterialBuffer(const GameTimer& gt)
 
 void InstancingAndCullingApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX proj = mCamera.GetProj();
 
@@ -477,62 +652,27 @@ void InstancingAndCullingApp::UpdateMainPassCB(const GameTimer& gt)
 
 void InstancingAndCullingApp::LoadTextures()
 {
-	auto bricksTex = std::make_unique<Texture>();
-	bricksTex->Name = "bricksTex";
-	bricksTex->Filename = L"../../Textures/bricks.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), bricksTex->Filename.c_str(),
-		bricksTex->Resource, bricksTex->UploadHeap));
-
-	auto stoneTex = std::make_unique<Texture>();
-	stoneTex->Name = "stoneTex";
-	stoneTex->Filename = L"../../Textures/stone.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), stoneTex->Filename.c_str(),
-		stoneTex->Resource, stoneTex->UploadHeap));
-
-	auto tileTex = std::make_unique<Texture>();
-	tileTex->Name = "tileTex";
-	tileTex->Filename = L"../../Textures/tile.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), tileTex->Filename.c_str(),
-		tileTex->Resource, tileTex->UploadHeap));
-
-	auto crateTex = std::make_unique<Texture>();
-	crateTex->Name = "crateTex";
-	crateTex->Filename = L"../../Textures/WoodCrate01.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), crateTex->Filename.c_str(),
-		crateTex->Resource, crateTex->UploadHeap));
-
-	auto iceTex = std::make_unique<Texture>();
-	iceTex->Name = "iceTex";
-	iceTex->Filename = L"../../Textures/ice.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), iceTex->Filename.c_str(),
-		iceTex->Resource, iceTex->UploadHeap));
-
-	auto grassTex = std::make_unique<Texture>();
-	grassTex->Name = "grassTex";
-	grassTex->Filename = L"../../Textures/grass.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), grassTex->Filename.c_str(),
-		grassTex->Resource, grassTex->UploadHeap));
-
-	auto defaultTex = std::make_unique<Texture>();
-	defaultTex->Name = "defaultTex";
-	defaultTex->Filename = L"../../Textures/white1x1.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), defaultTex->Filename.c_str(),
-		defaultTex->Resource, defaultTex->UploadHeap));
-
-	mTextures[bricksTex->Name] = std::move(bricksTex);
-	mTextures[stoneTex->Name] = std::move(stoneTex);
-	mTextures[tileTex->Name] = std::move(tileTex);
-	mTextures[crateTex->Name] = std::move(crateTex);
-	mTextures[iceTex->Name] = std::move(iceTex);
-	mTextures[grassTex->Name] = std::move(grassTex);
-	mTextures[defaultTex->Name] = std::move(defaultTex);
+	PROFILE_FUNCTION();
+
+	// Adding a texture reads only its header and starts loading its tail on an I/O
+	// thread.  Finer mips stream in as the instances using it come into view.  The order
+	// is the order of the SRVs, which the materials' DiffuseSrvHeapIndex refers to.
+	TextureStreamerSettings settings;
+	settings.MemoryBudget = gTextureMemoryBudget;
+	mStreamedTextures = std::make_unique<StreamedTextures>(md3dDevice.Get(), settings);
+
+	mStreamedTextures->Add(L"../../Textures/bricks.dds");
+	mStreamedTextures->Add(L"../../Textures/stone.dds");
+	mStreamedTextures->Add(L"../../Textures/tile.dds");
+	mStreamedTextures->Add(L"../../Textures/WoodCrate01.dds");
+	mStreamedTextures->Add(L"../../Textures/ice.dds");
+	mStreamedTextures->Add(L"../../Textures/grass.dds");
+	mStreamedTextures->Add(L"../../Textures/white1x1.dds");
+
+	// The tails are small, so wait for them and upload them with the other
+	// initialization commands; the first frame then has every texture.
+	mStreamedTextures->Streamer().Wait();
+	mStreamedTextures->Update(mCommandList.Get(), mFence->GetCompletedValue(), mCurrentFence + 1);
 }
 
 void InstancingAndCullingApp::BuildRootSignature()
@@ -578,10 +718,12 @@ void InstancingAndCullingApp::BuildRootSignature()
 void InstancingAndCullingApp::BuildDescriptorHeaps()
 {
 	//
-	// Create the SRV heap.
+	// Create the SRV heap.  Each frame resource has its own table of the textures, since
+	// the SRVs are rewritten as the textures stream while earlier frames may still be
+	// reading theirs.
 	//
 	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 7;
+	srvHeapDesc.NumDescriptors = gNumFrameResources*mStreamedTextures->Count();
 	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
@@ -589,66 +731,12 @@ void InstancingAndCullingApp::BuildDescriptorHeaps()
 	//
 	// Fill out the heap with actual descriptors.
 	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-	auto bricksTex = mTextures["bricksTex"]->Resource;
-	auto stoneTex = mTextures["stoneTex"]->Resource;
-	auto tileTex = mTextures["tileTex"]->Resource;
-	auto crateTex = mTextures["crateTex"]->Resource;
-	auto iceTex = mTextures["iceTex"]->Resource;
-	auto grassTex = mTextures["grassTex"]->Resource;
-	auto defaultTex = mTextures["defaultTex"]->Resource;
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = bricksTex->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = bricksTex->GetDesc().MipLevels;
-	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	md3dDevice->CreateShaderResourceView(bricksTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = stoneTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = stoneTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(stoneTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = tileTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = tileTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(tileTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = crateTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = crateTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(crateTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = iceTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = iceTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(iceTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = grassTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = grassTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(grassTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = defaultTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = defaultTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(defaultTex.Get(), &srvDesc, hDescriptor);
+	for(int i = 0; i < gNumFrameResources; ++i)
+	{
+		CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
+			i*mStreamedTextures->Count(), mCbvSrvDescriptorSize);
+		mStreamedTextures->WriteDescriptors(hDescriptor, mCbvSrvDescriptorSize);
+	}
 }
 
 void InstancingAndCullingApp::BuildShadersAndInputLayout()
@@ -672,72 +760,30 @@ void InstancingAndCullingApp::BuildShadersAndInputLayout()
 
 void InstancingAndCullingApp::BuildSkullGeometry()
 {
-	std::ifstream fin("Models/skull.txt");
-
-	if(!fin)
+	MeshCache mesh;
+	if(!mesh.Load("Models/skull.txt"))
 	{
 		MessageBox(0, L"Models/skull.txt not found.", 0, 0);
 		return;
 	}
 
-	UINT vcount = 0;
-	UINT tcount = 0;
-	std::string ignore;
-
-	fin >> ignore >> vcount;
-	fin >> ignore >> tcount;
-	fin >> ignore >> ignore >> ignore >> ignore;
-
-	XMFLOAT3 vMinf3(+MathHelper::Infinity, +MathHelper::Infinity, +MathHelper::Infinity);
-	XMFLOAT3 vMaxf3(-MathHelper::Infinity, -MathHelper::Infinity, -MathHelper::Infinity);
-
-	XMVECTOR vMin = XMLoadFloat3(&vMinf3);
-	XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
+	const UINT vcount = mesh.VertexCount();
 
 	std::vector<Vertex> vertices(vcount);
 	for(UINT i = 0; i < vcount; ++i)
 	{
-		fin >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
-		fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
-
-		XMVECTOR P = XMLoadFloat3(&vertices[i].Pos);
-
-		// Project point onto unit sphere and generate spherical texture coordinates.
-		XMFLOAT3 spherePos;
-		XMStoreFloat3(&spherePos, XMVector3Normalize(P));
-
-		float theta = atan2f(spherePos.z, spherePos.x);
-
-		// Put in [0, 2pi].
-		if(theta < 0.0f)
-			theta += XM_2PI;
-
-		float phi = acosf(spherePos.y);
-
-		float u = theta / (2.0f*XM_PI);
-		float v = phi / XM_PI;
-
-		vertices[i].TexC = { u, v };
+		vertices[i].Pos = mesh.Positions()[i];
+		vertices[i].Normal = mesh.Normals()[i];
 
-		vMin = XMVectorMin(vMin, P);
-		vMax = XMVectorMax(vMax, P);
+		// Spherical texture coordinates are generated once when the cache is built.
+		vertices[i].TexC = mesh.TexCoords()[i];
 	}
 
-	BoundingBox bounds;
-	XMStoreFloat3(&bounds.Center, 0.5f*(vMin + vMax));
-	XMStoreFloat3(&bounds.Extents, 0.5f*(vMax - vMin));
+	BoundingBox bounds = mesh.Bounds();
 
-	fin >> ignore;
-	fin >> ignore;
-	fin >> ignore;
-
-	std::vector<std::int32_t> indices(3 * tcount);
-	for(UINT i = 0; i < tcount; ++i)
-	{
-		fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
-	}
-
-	fin.close();
+	// The LODs go after the full mesh in the same index buffer, all over the one vertex buffer.
+	std::vector<std::uint32_t> indices(mesh.Indices(), mesh.Indices() + mesh.IndexCount());
+	BuildLodChain(mesh.Positions(), sizeof(XMFLOAT3), vcount, indices, mSkullLods, gMaxLods);
 
 	//
 	// Pack the indices of all the meshes into one index buffer.
@@ -745,7 +791,7 @@ void InstancingAndCullingApp::BuildSkullGeometry()
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::int32_t);
+	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint32_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "skullGeo";
@@ -768,7 +814,7 @@ void InstancingAndCullingApp::BuildSkullGeometry()
 	geo->IndexBufferByteSize = ibByteSize;
 
 	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
+	submesh.IndexCount = mSkullLods[0].IndexCount;
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 	submesh.Bounds = bounds;
@@ -885,6 +931,10 @@ void InstancingAndCullingApp::BuildMaterials()
 	mMaterials["ice0"] = std::move(ice0);
 	mMaterials["grass0"] = std::move(grass0);
 	mMaterials["skullMat"] = std::move(skullMat);
+
+	mMaterialTextures.resize(mMaterials.size());
+	for(auto& e : mMaterials)
+		mMaterialTextures[e.second->MatCBIndex] = e.second->DiffuseSrvHeapIndex;
 }
 
 void InstancingAndCullingApp::BuildRenderItems()
@@ -901,6 +951,7 @@ void InstancingAndCullingApp::BuildRenderItems()
 	skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
 	skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
 	skullRitem->Bounds = skullRitem->Geo->DrawArgs["skull"].Bounds;
+	skullRitem->Lods = mSkullLods;
 
 	// Generate instance data.
 	const int n = 5;
@@ -939,6 +990,24 @@ void InstancingAndCullingApp::BuildRenderItems()
 	}
 
 
+	// Instances that move need InstanceBvh.SetBounds and a Refit before the next cull.
+	std::vector<BoundingBox> instanceBounds(mInstanceCount);
+	for(UINT i = 0; i < mInstanceCount; ++i)
+	{
+		XMMATRIX world = XMLoadFloat4x4(&skullRitem->Instances[i].World);
+		skullRitem->Bounds.Transform(instanceBounds[i], world);
+	}
+	skullRitem->InstanceBvh.Build(instanceBounds.data(), mInstanceCount);
+
+	skullRitem->InstanceChunks.resize((mInstanceCount + gInstanceChunkSize - 1) / gInstanceChunkSize);
+	for(auto& chunk : skullRitem->InstanceChunks)
+	{
+		chunk.Visible.reserve(gInstanceChunkSize);
+		for(auto& staging : chunk.Staging)
+			staging.reserve(gInstanceChunkSize);
+		chunk.TextureTexels.resize(mStreamedTextures->Count());
+	}
+
 	mAllRitems.push_back(std::move(skullRitem));
 	
 	// All the render items are opaque.
@@ -948,6 +1017,7 @@ void InstancingAndCullingApp::BuildRenderItems()
 
 void InstancingAndCullingApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+    PROFILE_FUNCTION();
     // For each render item...
     for(size_t i = 0; i < ritems.size(); ++i)
     {
@@ -958,11 +1028,25 @@ void InstancingAndCullingApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList
         cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
 		// Set the instance buffer to use for this render-item.  For structured buffers, we can bypass 
-		// the heap and set as a root descriptor.
+		// the heap and set as a root descriptor.  The shader indexes the buffer with
+		// SV_InstanceID, which does not include StartInstanceLocation, so each LOD's draw
+		// points the root descriptor at its own run of instances instead.
+		// An item without LODs draws its whole index range; UpdateInstanceData stages all
+		// of its instances as LOD 0.
 		auto instanceBuffer = mCurrFrameResource->InstanceBuffer->Resource();
-		mCommandList->SetGraphicsRootShaderResourceView(0, instanceBuffer->GetGPUVirtualAddress());
+		const UINT lodCount = (UINT)ri->Lods.size();
+		for(UINT lod = 0; lod < MathHelper::Max(lodCount, 1u); ++lod)
+		{
+			if(ri->LodInstanceCount[lod] == 0)
+				continue;
+
+			mCommandList->SetGraphicsRootShaderResourceView(0, instanceBuffer->GetGPUVirtualAddress() +
+				(UINT64)ri->LodInstanceOffset[lod]*sizeof(InstanceData));
 
-        cmdList->DrawIndexedInstanced(ri->IndexCount, ri->InstanceCount, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+			UINT indexCount = lodCount > 0 ? ri->Lods[lod].IndexCount : ri->IndexCount;
+			UINT startIndex = lodCount > 0 ? ri->Lods[lod].StartIndexLocation : ri->StartIndexLocation;
+			cmdList->DrawIndexedInstanced(indexCount, ri->LodInstanceCount[lod], startIndex, ri->BaseVertexLocation, 0);
+		}
     }
 }
 
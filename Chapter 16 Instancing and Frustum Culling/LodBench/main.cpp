@@ -0,0 +1,203 @@
+//***************************************************************************************
+// main.cpp
+//
+// Level of detail benchmark.  Builds the skull's LOD chain as InstancingAndCullingApp does,
+// checks every LOD (indices in range, no degenerate triangles, no open edges that the full
+// mesh does not have, so seams stay closed), then flies the CullBench camera over grids of
+// skulls and counts the triangles submitted per frame with and without LOD selection, at
+// the demo's one pixel error for an 800x600 window.
+//
+// Usage: LodBench [skull.txt] [frames]
+//***************************************************************************************
+
+#include "../../Common/MathHelper.h"
+#include "../../Common/MeshCache.h"
+#include "../../Common/MeshSimplifier.h"
+#include "../../Common/CullingBvh.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <tuple>
+
+using namespace DirectX;
+
+typedef std::chrono::steady_clock Clock;
+
+// Half edges between distinct positions that have no opposite half edge, so vertices split
+// along a seam count as one.
+std::size_t OpenEdgeCount(const XMFLOAT3* positions, std::uint32_t vertexCount, const std::uint32_t* indices, std::size_t indexCount)
+{
+	std::map<std::tuple<float, float, float>, std::uint32_t> ids;
+	std::vector<std::uint32_t> positionId(vertexCount);
+	for(std::uint32_t v = 0; v < vertexCount; ++v)
+		positionId[v] = ids.emplace(std::make_tuple(positions[v].x, positions[v].y, positions[v].z), (std::uint32_t)ids.size()).first->second;
+
+	std::vector<std::uint64_t> halfEdges;
+	for(std::size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		for(int k = 0; k < 3; ++k)
+			halfEdges.push_back((std::uint64_t)positionId[indices[i + k]] << 32 | positionId[indices[i + (k + 1) % 3]]);
+	}
+	std::sort(halfEdges.begin(), halfEdges.end());
+
+	std::size_t open = 0;
+	for(std::uint64_t e : halfEdges)
+	{
+		if(!std::binary_search(halfEdges.begin(), halfEdges.end(), e << 32 | e >> 32))
+			++open;
+	}
+	return open;
+}
+
+// CullBench::CameraView, returning the eye too.
+XMMATRIX CameraView(int f, int frameCount, float gridRadius, XMVECTOR& eye)
+{
+	float t = (float)f / (float)frameCount;
+	float angle = XM_2PI * t;
+
+	if(f < frameCount / 2)
+		eye = XMVectorSet(1.5f*gridRadius*cosf(angle), 0.3f*gridRadius, 1.5f*gridRadius*sinf(angle), 1.0f);
+	else
+		eye = XMVectorSet(0.5f*gridRadius*cosf(angle), 0.0f, 0.5f*gridRadius*sinf(angle), 1.0f);
+
+	XMVECTOR target = XMVectorSet(gridRadius*sinf(3.0f*angle)*0.3f, 0.0f, 0.0f, 1.0f);
+	return XMMatrixLookAtLH(eye, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+}
+
+int main(int argc, char* argv[])
+{
+	std::string skullFilename = argc > 1 ? argv[1] : "../InstancingAndCulling/Models/skull.txt";
+	int frameCount = argc > 2 ? MathHelper::Max(2, std::atoi(argv[2])) : 100;
+
+	MeshCache skull;
+	if(!skull.Load(skullFilename))
+	{
+		std::printf("Could not load %s.\n", skullFilename.c_str());
+		return 1;
+	}
+	const std::uint32_t vertexCount = skull.VertexCount();
+	const BoundingBox& localBounds = skull.Bounds();
+
+	std::vector<std::uint32_t> indices(skull.Indices(), skull.Indices() + skull.IndexCount());
+	std::vector<MeshLod> lods;
+
+	auto b0 = Clock::now();
+	BuildLodChain(skull.Positions(), sizeof(XMFLOAT3), vertexCount, indices, lods, 4);
+	auto b1 = Clock::now();
+
+	std::printf("LOD chain built in %.1f ms\n", std::chrono::duration<double, std::milli>(b1 - b0).count());
+	std::printf("%4s %9s %9s %11s\n", "lod", "triangles", "error", "open edges");
+
+	const std::size_t fullOpen = OpenEdgeCount(skull.Positions(), vertexCount, indices.data(), lods[0].IndexCount);
+
+	for(std::uint32_t l = 0; l < (std::uint32_t)lods.size(); ++l)
+	{
+		const std::uint32_t* lodIndices = &indices[lods[l].StartIndexLocation];
+		for(std::uint32_t i = 0; i < lods[l].IndexCount; i += 3)
+		{
+			const std::uint32_t* tri = &lodIndices[i];
+			if(tri[0] >= vertexCount || tri[1] >= vertexCount || tri[2] >= vertexCount)
+			{
+				std::printf("LOD %u has an index out of range.\n", l);
+				return 1;
+			}
+			if(tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0])
+			{
+				std::printf("LOD %u has a degenerate triangle.\n", l);
+				return 1;
+			}
+		}
+
+		std::size_t open = OpenEdgeCount(skull.Positions(), vertexCount, lodIndices, lods[l].IndexCount);
+		std::printf("%4u %9u %9.4f %11zu\n", l, lods[l].IndexCount / 3, lods[l].Error, open);
+		if(open > fullOpen)
+		{
+			std::printf("LOD %u opened a crack.\n", l);
+			return 1;
+		}
+	}
+
+	// Same lens as InstancingAndCullingApp::OnResize for an 800x600 window.
+	XMFLOAT4X4 proj4x4;
+	XMStoreFloat4x4(&proj4x4, XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, 800.0f / 600.0f, 1.0f, 1000.0f));
+	XMMATRIX proj = XMLoadFloat4x4(&proj4x4);
+	const float pixelsPerUnit = LodPixelsPerUnit(proj4x4, 600.0f);
+	const float boundsRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&localBounds.Extents)));
+
+	std::printf("\n%9s %9s %14s %14s %7s %9s   %s\n", "instances", "visible", "full tris", "lod tris",
+		"ratio", "select us", "instances per lod");
+
+	const int gridSizes[] = { 5, 22 };
+	for(int n : gridSizes)
+	{
+		// n*n*n instances 50 units apart, centered on the origin, as in CullBench.
+		const float spacing = 50.0f;
+		const float offset = -0.5f*spacing*(n - 1);
+		const float gridRadius = 25.0f*(n - 1) + 50.0f;
+
+		std::vector<XMFLOAT3> centers;
+		std::vector<BoundingBox> worldBounds;
+		for(int k = 0; k < n; ++k)
+		{
+			for(int i = 0; i < n; ++i)
+			{
+				for(int j = 0; j < n; ++j)
+				{
+					XMMATRIX world = XMMatrixTranslation(offset + j*spacing, offset + i*spacing, offset + k*spacing);
+					BoundingBox bounds;
+					localBounds.Transform(bounds, world);
+					worldBounds.push_back(bounds);
+					centers.push_back(bounds.Center);
+				}
+			}
+		}
+		const std::uint32_t count = (std::uint32_t)worldBounds.size();
+
+		CullingBvh bvh;
+		bvh.Build(worldBounds.data(), count);
+
+		std::vector<std::uint32_t> visible;
+		visible.reserve(count);
+
+		double selectMs = 0.0;
+		std::size_t visibleTotal = 0, fullTriangles = 0, lodTriangles = 0;
+		std::size_t lodInstances[4] = {};
+
+		for(int f = 0; f < frameCount; ++f)
+		{
+			XMVECTOR eye;
+			XMMATRIX view = CameraView(f, frameCount, gridRadius, eye);
+			CullingFrustum frustum = CullingFrustum::FromViewProj(XMMatrixMultiply(view, proj));
+
+			visible.clear();
+			bvh.Cull(frustum, visible);
+
+			auto t0 = Clock::now();
+			for(std::uint32_t i : visible)
+			{
+				float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&centers[i]), eye))) - boundsRadius;
+				std::uint32_t lod = SelectLod(lods, MathHelper::Max(distance, 0.0f), 1.0f, pixelsPerUnit, 1.0f);
+
+				++lodInstances[lod];
+				lodTriangles += lods[lod].IndexCount / 3;
+			}
+			auto t1 = Clock::now();
+
+			selectMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+			visibleTotal += visible.size();
+			fullTriangles += visible.size()*(lods[0].IndexCount / 3);
+		}
+
+		std::printf("%9u %9.1f %14.0f %14.0f %6.1f%% %9.2f  ", count, (double)visibleTotal / frameCount,
+			(double)fullTriangles / frameCount, (double)lodTriangles / frameCount,
+			fullTriangles ? 100.0*lodTriangles / fullTriangles : 0.0, 1000.0*selectMs / frameCount);
+		for(std::uint32_t l = 0; l < (std::uint32_t)lods.size(); ++l)
+			std::printf(" %8.1f", (double)lodInstances[l] / frameCount);
+		std::printf("\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,228 @@
+//***************************************************************************************
+// main.cpp
+//
+// Meshlet culling benchmark.  Splits the skull and the LandAndWaves hills (the demo's
+// 50x50 vertex grid of 49x49 quads, and 256x256 quads) into meshlets and culls them
+// from cameras circling each mesh and skimming over it, with the demo lenses.  The skull
+// is drawn with a world matrix that rotates, stretches and moves it, so the local space
+// culling is exercised.
+//
+// Every frame is checked against the triangles themselves: a triangle that faces the eye
+// and is not entirely behind one frustum plane must be in a visible meshlet.  "ideal" is
+// the share of such triangles, the floor for any culler that keeps whole triangles.
+//
+// Usage: MeshletBench [skull.txt] [frames]
+//***************************************************************************************
+
+#include "../../Common/MathHelper.h"
+#include "../../Common/MeshCache.h"
+#include "../../Common/MeshletBuilder.h"
+#include "../../Common/MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace DirectX;
+
+typedef std::chrono::steady_clock Clock;
+
+struct NamedMesh
+{
+	std::string Name;
+	std::vector<XMFLOAT3> Positions;
+	std::vector<std::uint32_t> Indices;
+	XMFLOAT4X4 World = MathHelper::Identity4x4();
+};
+
+// LandAndWavesApp::BuildLandGeometry with an m*m vertex grid, which has (m-1)*(m-1) quads.
+NamedMesh BuildLand(std::uint32_t m)
+{
+	// Optimized after the heights are set, since the overdraw sort uses the positions.
+	GeometryGenerator geoGen(false);
+	GeometryGenerator::MeshData grid = geoGen.CreateGrid(160.0f, 160.0f, m, m);
+	for(auto& v : grid.Vertices)
+		v.Position.y = 0.3f*(v.Position.z*sinf(0.1f*v.Position.x) + v.Position.x*cosf(0.1f*v.Position.z));
+	OptimizeMesh(grid);
+
+	NamedMesh mesh;
+	mesh.Name = "land " + std::to_string(m - 1) + "x" + std::to_string(m - 1);
+	for(const auto& v : grid.Vertices)
+		mesh.Positions.push_back(v.Position);
+	mesh.Indices = grid.Indices32;
+	return mesh;
+}
+
+// Every triangle rotated to start at its lowest index, in sorted order.
+std::vector<std::array<std::uint32_t, 3>> SortedTriangles(const std::vector<std::uint32_t>& indices)
+{
+	std::vector<std::array<std::uint32_t, 3>> triangles(indices.size() / 3);
+	for(std::size_t t = 0; t < triangles.size(); ++t)
+	{
+		const std::uint32_t* i = &indices[3*t];
+		int k = i[0] <= i[1] && i[0] <= i[2] ? 0 : (i[1] <= i[2] ? 1 : 2);
+		triangles[t] = { i[k], i[(k + 1) % 3], i[(k + 2) % 3] };
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// Eye for frame f of frameCount: half the frames circle the mesh from above, the rest
+// skim low over it.
+XMVECTOR CameraEye(int f, int frameCount, const BoundingSphere& bounds)
+{
+	float t = (float)f / (float)frameCount;
+	float angle = XM_2PI*t;
+	float r = bounds.Radius;
+
+	XMVECTOR offset;
+	if(f < frameCount / 2)
+		offset = XMVectorSet(2.0f*r*cosf(angle), r*(0.3f + 0.8f*t), 2.0f*r*sinf(angle), 0.0f);
+	else
+		offset = XMVectorSet(0.6f*r*cosf(angle), 0.25f*r, 0.6f*r*sinf(angle), 0.0f);
+
+	return XMVectorAdd(XMLoadFloat3(&bounds.Center), offset);
+}
+
+int main(int argc, char* argv[])
+{
+	std::string skullFilename = argc > 1 ? argv[1] : "../InstancingAndCulling/Models/skull.txt";
+	int frameCount = argc > 2 ? MathHelper::Max(2, std::atoi(argv[2])) : 100;
+
+	std::vector<NamedMesh> meshes;
+	{
+		MeshCache skull;
+		if(!skull.Load(skullFilename))
+		{
+			std::printf("Could not load %s.\n", skullFilename.c_str());
+			return 1;
+		}
+
+		NamedMesh mesh;
+		mesh.Name = "skull";
+		mesh.Positions.assign(skull.Positions(), skull.Positions() + skull.VertexCount());
+		mesh.Indices.assign(skull.Indices(), skull.Indices() + skull.IndexCount());
+		XMStoreFloat4x4(&mesh.World, XMMatrixScaling(1.0f, 1.5f, 0.8f)*XMMatrixRotationY(0.7f)*XMMatrixTranslation(10.0f, -3.0f, 20.0f));
+		meshes.push_back(mesh);
+	}
+	meshes.push_back(BuildLand(50));
+	meshes.push_back(BuildLand(257));
+
+	// The lenses of InstancingAndCullingApp and LandAndWavesApp for an 800x600 window.
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, 800.0f / 600.0f, 1.0f, 1000.0f);
+
+	std::printf("%-12s %9s %8s %7s %7s %9s %9s %8s %8s %8s %8s\n", "mesh", "triangles", "meshlets",
+		"tris", "verts", "build ms", "cull us", "visible", "ideal", "backface", "frustum");
+
+	for(const NamedMesh& mesh : meshes)
+	{
+		const std::uint32_t vertexCount = (std::uint32_t)mesh.Positions.size();
+		const std::uint32_t triCount = (std::uint32_t)(mesh.Indices.size() / 3);
+		XMMATRIX world = XMLoadFloat4x4(&mesh.World);
+		XMVECTOR worldDet = XMMatrixDeterminant(world);
+		XMMATRIX invWorld = XMMatrixInverse(&worldDet, world);
+
+		std::vector<XMFLOAT3> worldPositions(vertexCount);
+		for(std::uint32_t i = 0; i < vertexCount; ++i)
+			XMStoreFloat3(&worldPositions[i], XMVector3TransformCoord(XMLoadFloat3(&mesh.Positions[i]), world));
+
+		BoundingSphere worldBounds;
+		BoundingSphere::CreateFromPoints(worldBounds, vertexCount, worldPositions.data(), sizeof(XMFLOAT3));
+
+		auto b0 = Clock::now();
+		MeshletSet meshlets;
+		if(!BuildMeshlets(mesh.Positions.data(), sizeof(XMFLOAT3), vertexCount, mesh.Indices.data(), mesh.Indices.size(), meshlets))
+		{
+			std::printf("%s has an index out of range.\n", mesh.Name.c_str());
+			return 1;
+		}
+		auto b1 = Clock::now();
+		const std::uint32_t meshletCount = (std::uint32_t)meshlets.Meshlets.size();
+
+		// The meshlets must hold exactly the mesh's triangles, with the same winding.
+		std::vector<std::uint32_t> rebuilt;
+		for(std::uint32_t i = 0; i < meshletCount; ++i)
+			AppendMeshletIndices(meshlets, i, rebuilt);
+		if(SortedTriangles(rebuilt) != SortedTriangles(mesh.Indices))
+		{
+			std::printf("%s: the meshlets do not hold the mesh's triangles.\n", mesh.Name.c_str());
+			return 1;
+		}
+
+		const float epsilon = 1e-4f*worldBounds.Radius;
+		std::vector<std::uint32_t> visible;
+		std::vector<std::uint8_t> meshletVisible(meshletCount);
+		double cullMs = 0.0;
+		std::size_t visibleTriangles = 0, idealTriangles = 0, backfaceCulled = 0, frustumCulled = 0;
+
+		for(int f = 0; f < frameCount; ++f)
+		{
+			XMVECTOR eye = CameraEye(f, frameCount, worldBounds);
+			XMMATRIX view = XMMatrixLookAtLH(eye, XMLoadFloat3(&worldBounds.Center), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+
+			auto t0 = Clock::now();
+			CullingFrustum localFrustum = CullingFrustum::FromViewProj(XMMatrixMultiply(world, viewProj));
+			XMVECTOR localEye = XMVector3TransformCoord(eye, invWorld);
+			visible.clear();
+			MeshletCullStats stats = CullMeshlets(meshlets, localFrustum, localEye, visible);
+			auto t1 = Clock::now();
+
+			cullMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+			visibleTriangles += stats.VisibleTriangles;
+			backfaceCulled += stats.BackfaceCulled;
+			frustumCulled += stats.FrustumCulled;
+
+			std::fill(meshletVisible.begin(), meshletVisible.end(), 0);
+			for(std::uint32_t i : visible)
+				meshletVisible[i] = 1;
+
+			CullingFrustum frustum = CullingFrustum::FromViewProj(viewProj);
+			for(std::uint32_t m = 0; m < meshletCount; ++m)
+			{
+				const Meshlet& meshlet = meshlets.Meshlets[m];
+				for(std::uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+				{
+					const std::uint8_t* local = &meshlets.Triangles[3*((std::size_t)meshlet.TriangleOffset + t)];
+					XMVECTOR p[3];
+					for(int k = 0; k < 3; ++k)
+						p[k] = XMLoadFloat3(&worldPositions[meshlets.Vertices[meshlet.VertexOffset + local[k]]]);
+
+					XMVECTOR n = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(p[1], p[0]), XMVectorSubtract(p[2], p[0])));
+					bool seen = XMVectorGetX(XMVector3Dot(n, XMVectorSubtract(eye, p[0]))) > epsilon;
+					for(int plane = 0; plane < 6 && seen; ++plane)
+					{
+						XMVECTOR P = XMLoadFloat4(&frustum.Planes[plane]);
+						float d = MathHelper::Max(XMVectorGetX(XMPlaneDotCoord(P, p[0])),
+							MathHelper::Max(XMVectorGetX(XMPlaneDotCoord(P, p[1])), XMVectorGetX(XMPlaneDotCoord(P, p[2]))));
+						seen = d > epsilon;
+					}
+
+					if(seen)
+					{
+						++idealTriangles;
+						if(!meshletVisible[m])
+						{
+							std::printf("%s, frame %d: meshlet %u was culled but triangle %u of it is visible.\n",
+								mesh.Name.c_str(), f, m, t);
+							return 1;
+						}
+					}
+				}
+			}
+		}
+
+		const double frameTriangles = (double)triCount*frameCount;
+		const double frameMeshlets = (double)meshletCount*frameCount;
+		std::printf("%-12s %9u %8u %7.1f %7.1f %9.2f %9.2f %7.1f%% %7.1f%% %7.1f%% %7.1f%%\n", mesh.Name.c_str(),
+			triCount, meshletCount, (double)triCount / meshletCount, (double)meshlets.Vertices.size() / meshletCount,
+			std::chrono::duration<double, std::milli>(b1 - b0).count(), 1000.0*cullMs / frameCount,
+			100.0*visibleTriangles / frameTriangles, 100.0*idealTriangles / frameTriangles,
+			100.0*backfaceCulled / frameMeshlets, 100.0*frustumCulled / frameMeshlets);
+	}
+
+	return 0;
+}
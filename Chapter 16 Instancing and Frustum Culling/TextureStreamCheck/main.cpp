@@ -0,0 +1,373 @@
+//***************************************************************************************
+// main.cpp
+//
+// Runs TextureStreamer over every DDS file in a directory, with no window or device, and
+// checks what InstancingAndCulling relies on:
+//   - the tails come in first and alone, and are in well before the files could be read
+//     whole, which is what LoadTextures did before,
+//   - later loads stream in one mip of a texture at a time, and FirstResidentMip follows
+//     the changes,
+//   - with room, every texture reaches the mip its request calls for,
+//   - the resident mips never go over the budget, and once loading settles
+//     no texture waiting for a mip could evict a less magnified one,
+//   - moving the requests to other textures evicts the ones no longer seen to make room,
+//   - lowering the budget evicts down to it.
+// Exits with 1 if a check fails.
+//
+// Usage: TextureStreamCheck [directory]
+//***************************************************************************************
+
+#include "../../Common/TextureStreamer.h"
+#include "../../Common/CheckUtil.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <dirent.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+// The .dds files in directory, sorted.
+std::vector<std::string> ListDdsFiles(const std::string& directory)
+{
+	std::vector<std::string> names;
+
+#if defined(_WIN32)
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((directory + "\\*.dds").c_str(), &data);
+	if(find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			names.push_back(data.cFileName);
+		} while(FindNextFileA(find, &data));
+		FindClose(find);
+	}
+#else
+	DIR* dir = opendir(directory.c_str());
+	if(dir != nullptr)
+	{
+		while(dirent* entry = readdir(dir))
+		{
+			std::string name = entry->d_name;
+			if(name.size() > 4 && name.compare(name.size() - 4, 4, ".dds") == 0)
+				names.push_back(name);
+		}
+		closedir(dir);
+	}
+#endif
+
+	std::sort(names.begin(), names.end());
+
+	std::vector<std::string> paths;
+	for(const auto& name : names)
+		paths.push_back(directory + "/" + name);
+	return paths;
+}
+
+// Stands in for the renderer: keeps its own first resident mip per texture from the
+// changes alone, and checks each change against the streamer.
+class ResidencyTracker
+{
+public:
+	ResidencyTracker(const TextureStreamer& streamer, std::uint64_t tailBytes)
+		: mTailBytes(tailBytes)
+	{
+		for(std::uint32_t i = 0; i < streamer.TextureCount(); ++i)
+			mFirstMip.push_back(streamer.File(i).Texture().MipCount);
+	}
+
+	// Updates the streamer and applies its changes; returns how many there were.
+	size_t Update(TextureStreamer& streamer)
+	{
+		mChanges.clear();
+		streamer.Update(mChanges);
+
+		for(const auto& change : mChanges)
+		{
+			const std::uint32_t t = change.Texture;
+			const std::uint32_t mipCount = streamer.File(t).Texture().MipCount;
+			const std::string name = "texture " + std::to_string(t);
+
+			Check(change.OldFirstMip == mFirstMip[t], name + ": change does not start where the last one ended");
+			Check(change.NewFirstMip == streamer.FirstResidentMip(t), name + ": change does not end at FirstResidentMip");
+			if(change.OldFirstMip == mipCount)
+				Check(change.NewFirstMip == streamer.TailMip(t), name + ": first load is not the tail");
+			else
+				Check(change.NewFirstMip <= streamer.TailMip(t), name + ": tail evicted");
+
+			// Mips stream in one at a time; evictions may take several at once.
+			if(change.OldFirstMip != mipCount && change.NewFirstMip < change.OldFirstMip)
+				Check(change.NewFirstMip + 1 == change.OldFirstMip, name + ": more than one mip streamed in at once");
+
+			// Read the loaded mips as the renderer's upload would.
+			if(change.NewFirstMip < change.OldFirstMip)
+			{
+				const DdsFile& file = streamer.File(t);
+				for(const auto& sub : file.Texture().Subresources)
+				{
+					if(sub.MipLevel >= change.NewFirstMip && sub.MipLevel < change.OldFirstMip)
+					{
+						const std::uint8_t* data = file.Data(sub);
+						mChecksum += data[0] + data[sub.Size - 1];
+						mLoadedBytes += sub.Size;
+					}
+				}
+			}
+
+			mFirstMip[t] = change.NewFirstMip;
+		}
+
+		Check(streamer.ResidentBytes() <= std::max(streamer.MemoryBudget(), mTailBytes), "over budget");
+		return mChanges.size();
+	}
+
+	// Updates until nothing is loading and nothing changes; returns the updates it took.
+	int Settle(TextureStreamer& streamer)
+	{
+		const int maxUpdates = 10000;
+		for(int updates = 1; updates <= maxUpdates; ++updates)
+		{
+			streamer.Wait();
+			size_t changes = Update(streamer);
+			if(changes == 0 && streamer.LoadsInFlight() == 0)
+				return updates;
+		}
+		Check(false, "residency still changing after " + std::to_string(maxUpdates) + " updates");
+		return maxUpdates;
+	}
+
+	std::uint64_t LoadedBytes()const { return mLoadedBytes; }
+
+private:
+	std::uint64_t mTailBytes = 0;
+	std::vector<std::uint32_t> mFirstMip;
+	std::vector<TextureResidencyChange> mChanges;
+	std::uint64_t mLoadedBytes = 0;
+	std::uint64_t mChecksum = 0;
+};
+
+std::uint64_t TailBytes(const TextureStreamer& streamer)
+{
+	std::uint64_t bytes = 0;
+	for(std::uint32_t i = 0; i < streamer.TextureCount(); ++i)
+	{
+		for(const auto& sub : streamer.File(i).Texture().Subresources)
+		{
+			if(sub.MipLevel >= streamer.TailMip(i))
+				bytes += sub.Size;
+		}
+	}
+	return bytes;
+}
+
+float TopSize(const TextureStreamer& streamer, std::uint32_t texture)
+{
+	const DdsSubresource& top = streamer.File(texture).Texture().Subresources[0];
+	return (float)std::max(top.Width, top.Height);
+}
+
+float Magnification(const TextureStreamer& streamer, std::uint32_t texture, float texels, std::uint32_t mip)
+{
+	const DdsSubresource& sub = streamer.File(texture).Texture().Subresources[mip];
+	return texels / (float)std::max(sub.Width, sub.Height);
+}
+
+std::uint64_t MipBytes(const TextureStreamer& streamer, std::uint32_t texture, std::uint32_t mip)
+{
+	std::uint64_t bytes = 0;
+	for(const auto& sub : streamer.File(texture).Texture().Subresources)
+	{
+		if(sub.MipLevel == mip)
+			bytes += sub.Size;
+	}
+	return bytes;
+}
+
+// Once settled under a budget: every texture still short of its desired mip must be
+// unable to fit its next mip, even by evicting every less magnified mip.
+void CheckSettled(const TextureStreamer& streamer, const std::vector<float>& texels, const char* phase)
+{
+	for(std::uint32_t a = 0; a < streamer.TextureCount(); ++a)
+	{
+		std::uint32_t first = streamer.FirstResidentMip(a);
+		if(first <= streamer.DesiredMip(a))
+			continue;
+
+		float wanted = Magnification(streamer, a, texels[a], first - 1);
+		std::uint64_t freeable = 0;
+		for(std::uint32_t b = 0; b < streamer.TextureCount(); ++b)
+		{
+			for(std::uint32_t mip = streamer.FirstResidentMip(b); b != a && mip < streamer.TailMip(b); ++mip)
+			{
+				if(Magnification(streamer, b, texels[b], mip) < wanted)
+					freeable += MipBytes(streamer, b, mip);
+			}
+		}
+
+		std::uint64_t room = streamer.MemoryBudget() - std::min(streamer.MemoryBudget(), streamer.ResidentBytes());
+		Check(MipBytes(streamer, a, first - 1) > room + freeable,
+			std::string(phase) + ": texture " + std::to_string(a) + " could have streamed in its next mip");
+	}
+}
+
+void Request(TextureStreamer& streamer, const std::vector<float>& texels)
+{
+	streamer.ClearRequests();
+	for(std::uint32_t i = 0; i < streamer.TextureCount(); ++i)
+	{
+		if(texels[i] > 0.0f)
+			streamer.Request(i, texels[i]);
+	}
+}
+
+void PrintResidency(const TextureStreamer& streamer, const char* phase)
+{
+	std::printf("%s: %.2f of %.2f MB resident, budget %.2f MB, %llu loads, %llu evictions\n", phase,
+		streamer.ResidentBytes() / (1024.0*1024.0), streamer.TotalBytes() / (1024.0*1024.0),
+		streamer.MemoryBudget() / (1024.0*1024.0),
+		(unsigned long long)streamer.LoadCount(), (unsigned long long)streamer.EvictionCount());
+}
+
+int main(int argc, char* argv[])
+{
+	std::string directory = argc > 1 ? argv[1] : "../../Textures";
+	std::vector<std::string> paths = ListDdsFiles(directory);
+	if(paths.empty())
+	{
+		std::printf("No .dds files in %s.\n", directory.c_str());
+		return 1;
+	}
+
+	//
+	// The old LoadTextures read every file whole before the first frame.
+	//
+
+	auto readStart = Clock::now();
+	std::uint64_t readBytes = 0;
+	for(const auto& path : paths)
+	{
+		std::ifstream fin(path, std::ios::binary | std::ios::ate);
+		std::vector<char> bytes((size_t)fin.tellg());
+		fin.seekg(0);
+		fin.read(bytes.data(), bytes.size());
+		readBytes += bytes.size();
+	}
+	double readMs = std::chrono::duration<double, std::milli>(Clock::now() - readStart).count();
+
+	//
+	// Tails first.
+	//
+
+	TextureStreamerSettings settings;
+	settings.MemoryBudget = 1ull << 40;
+	TextureStreamer streamer(settings);
+
+	auto addStart = Clock::now();
+	for(const auto& path : paths)
+	{
+		DdsError error;
+		if(streamer.Add(path, &error) == TextureStreamer::InvalidTexture)
+			Check(false, path + ": " + DdsErrorString(error));
+	}
+	double addMs = std::chrono::duration<double, std::milli>(Clock::now() - addStart).count();
+
+	const std::uint32_t textureCount = streamer.TextureCount();
+	const std::uint64_t tailBytes = TailBytes(streamer);
+	ResidencyTracker tracker(streamer, tailBytes);
+
+	streamer.Wait();
+	tracker.Update(streamer);
+	double tailMs = std::chrono::duration<double, std::milli>(Clock::now() - addStart).count();
+
+	Check(streamer.ResidentBytes() == tailBytes, "resident after the tails is not the tails");
+	for(std::uint32_t i = 0; i < textureCount; ++i)
+		Check(streamer.FirstResidentMip(i) == streamer.TailMip(i), "texture " + std::to_string(i) + " tail is not in");
+
+	std::printf("%u textures, %.2f MB: reading every file whole %.3f ms; adding %.3f ms, tails in at %.3f ms (%.2f MB)\n",
+		textureCount, readBytes / (1024.0*1024.0), readMs, addMs, tailMs, tailBytes / (1024.0*1024.0));
+
+	// Nothing requested: nothing more streams in.
+	std::vector<float> texels(textureCount, 0.0f);
+	Request(streamer, texels);
+	tracker.Settle(streamer);
+	Check(streamer.ResidentBytes() == tailBytes, "unrequested textures streamed past their tails");
+
+	//
+	// Room for everything: each texture reaches the mip its request calls for.
+	//
+
+	for(std::uint32_t i = 0; i < textureCount; ++i)
+		texels[i] = TopSize(streamer, i) / (float)(1 << (i % 4));
+	Request(streamer, texels);
+	int updates = tracker.Settle(streamer);
+	for(std::uint32_t i = 0; i < textureCount; ++i)
+	{
+		std::uint32_t expected = std::min(i % 4, streamer.TailMip(i));
+		Check(streamer.FirstResidentMip(i) == expected, "texture " + std::to_string(i) + " did not reach mip " + std::to_string(expected));
+	}
+	PrintResidency(streamer, "room for all");
+	std::printf("  settled in %d updates\n", updates);
+
+	//
+	// A budget of the tails and a fraction of the rest, with every texture wanting its
+	// full size: the most magnified go first and the budget holds.
+	//
+
+	streamer.SetMemoryBudget(tailBytes + (streamer.TotalBytes() - tailBytes) / 4);
+	for(std::uint32_t i = 0; i < textureCount; ++i)
+		texels[i] = TopSize(streamer, i)*(1.0f + i % 3);
+	Request(streamer, texels);
+	tracker.Settle(streamer);
+	CheckSettled(streamer, texels, "tight budget");
+	PrintResidency(streamer, "tight budget");
+
+	//
+	// The view moves: only the first half of the textures is seen, so the second half
+	// must give up its mips to it.
+	//
+
+	std::uint64_t evictionsBefore = streamer.EvictionCount();
+	for(std::uint32_t i = 0; i < textureCount; ++i)
+		texels[i] = i < textureCount / 2 ? TopSize(streamer, i)*2.0f : 0.0f;
+	Request(streamer, texels);
+	tracker.Settle(streamer);
+	CheckSettled(streamer, texels, "view moved");
+
+	std::uint64_t seenBytes = 0;
+	for(std::uint32_t i = 0; i < textureCount / 2; ++i)
+	{
+		for(std::uint32_t mip = streamer.FirstResidentMip(i); mip < streamer.TailMip(i); ++mip)
+			seenBytes += MipBytes(streamer, i, mip);
+	}
+	PrintResidency(streamer, "view moved");
+	std::printf("  %.2f MB above the tails is on seen textures, %llu evictions\n", seenBytes / (1024.0*1024.0),
+		(unsigned long long)(streamer.EvictionCount() - evictionsBefore));
+
+	//
+	// A lower budget evicts down to it without new requests, and never the tails.
+	//
+
+	streamer.SetMemoryBudget(tailBytes + (streamer.TotalBytes() - tailBytes) / 16);
+	tracker.Settle(streamer);
+	PrintResidency(streamer, "lower budget");
+
+	streamer.SetMemoryBudget(0);
+	tracker.Settle(streamer);
+	Check(streamer.ResidentBytes() == tailBytes, "a zero budget did not evict down to the tails");
+	PrintResidency(streamer, "zero budget");
+
+	std::printf("%.2f MB streamed in across the run\n", tracker.LoadedBytes() / (1024.0*1024.0));
+
+	return CheckExitCode();
+}
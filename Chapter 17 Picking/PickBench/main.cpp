@@ -0,0 +1,171 @@
+//***************************************************************************************
+// main.cpp
+//
+// Picking benchmark.  Builds scenes of 1, 64 and 1000 copies of a model merged into one
+// mesh, then casts rays from random points around the scene through random points of it.
+// Compares the demo's original test (every triangle with TriangleTests::Intersects) with
+// TriangleBvh and fails if they disagree on whether or where a ray hits.
+//
+// Usage: PickBench [model.txt] [rays]
+//***************************************************************************************
+
+#include "../../Common/MathHelper.h"
+#include "../../Common/MeshCache.h"
+#include "../../Common/TriangleBvh.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace DirectX;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Scene
+{
+	std::vector<XMFLOAT3> Positions;
+	std::vector<std::uint32_t> Indices;
+	BoundingBox Bounds;
+};
+
+// n*n*n copies of the mesh, each turned about y by a random angle, on a grid spaced so
+// the copies touch.
+Scene BuildScene(const MeshCache& mesh, int n)
+{
+	const BoundingBox& bounds = mesh.Bounds();
+	const float spacing = 2.0f*MathHelper::Max(bounds.Extents.x, MathHelper::Max(bounds.Extents.y, bounds.Extents.z));
+	const float offset = -0.5f*spacing*(n - 1);
+
+	Scene scene;
+	scene.Positions.reserve((size_t)mesh.VertexCount()*n*n*n);
+	scene.Indices.reserve((size_t)mesh.IndexCount()*n*n*n);
+
+	for(int copy = 0; copy < n*n*n; ++copy)
+	{
+		XMMATRIX world = XMMatrixTranslation(-bounds.Center.x, -bounds.Center.y, -bounds.Center.z) *
+			XMMatrixRotationY(MathHelper::RandF(0.0f, XM_2PI)) *
+			XMMatrixTranslation(offset + (copy % n)*spacing, offset + (copy / n % n)*spacing, offset + (copy / (n*n))*spacing);
+
+		std::uint32_t baseVertex = (std::uint32_t)scene.Positions.size();
+		for(std::uint32_t i = 0; i < mesh.VertexCount(); ++i)
+		{
+			XMFLOAT3 p;
+			XMStoreFloat3(&p, XMVector3TransformCoord(XMLoadFloat3(&mesh.Positions()[i]), world));
+			scene.Positions.push_back(p);
+		}
+		for(std::uint32_t i = 0; i < mesh.IndexCount(); ++i)
+			scene.Indices.push_back(baseVertex + mesh.Indices()[i]);
+	}
+
+	BoundingBox::CreateFromPoints(scene.Bounds, scene.Positions.size(), scene.Positions.data(), sizeof(XMFLOAT3));
+	return scene;
+}
+
+// The demo's original loop over every triangle.
+bool IntersectAll(const Scene& scene, FXMVECTOR origin, FXMVECTOR direction, float& tmin, std::uint32_t& triangle)
+{
+	bool found = false;
+	tmin = MathHelper::Infinity;
+
+	const std::uint32_t triCount = (std::uint32_t)scene.Indices.size() / 3;
+	for(std::uint32_t i = 0; i < triCount; ++i)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&scene.Positions[scene.Indices[i*3 + 0]]);
+		XMVECTOR v1 = XMLoadFloat3(&scene.Positions[scene.Indices[i*3 + 1]]);
+		XMVECTOR v2 = XMLoadFloat3(&scene.Positions[scene.Indices[i*3 + 2]]);
+
+		float t = 0.0f;
+		if(TriangleTests::Intersects(origin, direction, v0, v1, v2, t) && t < tmin)
+		{
+			tmin = t;
+			triangle = i;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+XMVECTOR RandomPointInBox(const BoundingBox& box, float scale)
+{
+	return XMVectorSet(
+		box.Center.x + scale*box.Extents.x*MathHelper::RandF(-1.0f, 1.0f),
+		box.Center.y + scale*box.Extents.y*MathHelper::RandF(-1.0f, 1.0f),
+		box.Center.z + scale*box.Extents.z*MathHelper::RandF(-1.0f, 1.0f), 1.0f);
+}
+
+int main(int argc, char* argv[])
+{
+	std::string modelFilename = argc > 1 ? argv[1] : "../Picking/Models/car.txt";
+	int rayCount = argc > 2 ? MathHelper::Max(1, std::atoi(argv[2])) : 2000;
+
+	MeshCache mesh;
+	if(!mesh.Load(modelFilename))
+	{
+		std::printf("Could not load %s.\n", modelFilename.c_str());
+		return 1;
+	}
+
+	std::srand(1);
+
+	// The brute force loop is only timed on a few rays of the large scenes.
+	const int gridSizes[] = { 1, 4, 10 };
+
+	std::printf("%10s %8s %10s %10s %14s %14s %8s\n", "triangles", "nodes", "build ms", "hits",
+		"all us/ray", "bvh us/ray", "speedup");
+
+	for(int n : gridSizes)
+	{
+		Scene scene = BuildScene(mesh, n);
+		const std::uint32_t triCount = (std::uint32_t)scene.Indices.size() / 3;
+
+		auto b0 = Clock::now();
+		TriangleBvh bvh;
+		bvh.Build(scene.Positions.data(), sizeof(XMFLOAT3), scene.Indices.data(), triCount);
+		auto b1 = Clock::now();
+
+		const int bruteRays = MathHelper::Max(1, MathHelper::Min(rayCount, (int)(200000000ull / MathHelper::Max(triCount, 1u))));
+
+		double allMs = 0.0, bvhMs = 0.0;
+		int hits = 0;
+
+		for(int r = 0; r < rayCount; ++r)
+		{
+			XMVECTOR origin = RandomPointInBox(scene.Bounds, 3.0f);
+			XMVECTOR direction = XMVector3Normalize(XMVectorSubtract(RandomPointInBox(scene.Bounds, 0.5f), origin));
+
+			auto t0 = Clock::now();
+			TriangleRayHit hit;
+			bool bvhFound = bvh.Intersect(origin, direction, hit);
+			auto t1 = Clock::now();
+			bvhMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+			hits += bvhFound ? 1 : 0;
+
+			if(r >= bruteRays)
+				continue;
+
+			float tmin = 0.0f;
+			std::uint32_t triangle = 0;
+			auto t2 = Clock::now();
+			bool allFound = IntersectAll(scene, origin, direction, tmin, triangle);
+			auto t3 = Clock::now();
+			allMs += std::chrono::duration<double, std::milli>(t3 - t2).count();
+
+			// Rays through a shared edge can report either triangle, so compare distances.
+			if(allFound != bvhFound || (allFound && std::fabs(tmin - hit.T) > 1e-4f*MathHelper::Max(1.0f, tmin)))
+			{
+				std::printf("Ray %d disagrees: all %d t=%f tri=%u, bvh %d t=%f tri=%u.\n", r,
+					(int)allFound, tmin, triangle, (int)bvhFound, hit.T, hit.Triangle);
+				return 1;
+			}
+		}
+
+		double allUs = 1000.0*allMs / bruteRays;
+		double bvhUs = 1000.0*bvhMs / rayCount;
+		std::printf("%10u %8u %10.1f %10d %14.2f %14.3f %7.0fx\n", triCount, bvh.NodeCount(),
+			std::chrono::duration<double, std::milli>(b1 - b0).count(), hits, allUs, bvhUs, allUs / bvhUs);
+	}
+
+	return 0;
+}
@@ -7,6 +7,8 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/MeshCache.h"
+#include "../../Common/TriangleBvh.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -55,6 +57,10 @@ struct RenderItem
     UINT IndexCount = 0;
     UINT StartIndexLocation = 0;
     int BaseVertexLocation = 0;
+
+	// Triangles of the drawn submesh in local space, for picking.  Its triangle i is the
+	// one at StartIndexLocation + 3*i.
+	const TriangleBvh* PickBvh = nullptr;
 };
 
 enum class RenderLayer : int
@@ -116,6 +122,7 @@ private:
 	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
+	std::unordered_map<std::string, std::unique_ptr<TriangleBvh>> mPickBvhs;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
@@ -376,6 +383,7 @@ void PickingApp::AnimateMaterials(const GameTimer& gt)
 
 void PickingApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -401,6 +409,7 @@ void PickingApp::UpdateObjectCBs(const GameTimer& gt)
 
 void PickingApp::UpdateMaterialBuffer(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
 	for(auto& e : mMaterials)
 	{
@@ -428,6 +437,7 @@ void PickingApp::UpdateMaterialBuffer(const GameTimer& gt)
 
 void PickingApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX proj = mCamera.GetProj();
 
@@ -563,57 +573,27 @@ void PickingApp::BuildShadersAndInputLayout()
 
 void PickingApp::BuildCarGeometry()
 {
-	std::ifstream fin("Models/car.txt");
-
-	if(!fin)
+	MeshCache mesh;
+	if(!mesh.Load("Models/car.txt"))
 	{
 		MessageBox(0, L"Models/car.txt not found.", 0, 0);
 		return;
 	}
 
-	UINT vcount = 0;
-	UINT tcount = 0;
-	std::string ignore;
-
-	fin >> ignore >> vcount;
-	fin >> ignore >> tcount;
-	fin >> ignore >> ignore >> ignore >> ignore;
-
-	XMFLOAT3 vMinf3(+MathHelper::Infinity, +MathHelper::Infinity, +MathHelper::Infinity);
-	XMFLOAT3 vMaxf3(-MathHelper::Infinity, -MathHelper::Infinity, -MathHelper::Infinity);
-
-	XMVECTOR vMin = XMLoadFloat3(&vMinf3);
-	XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
+	const UINT vcount = mesh.VertexCount();
 
 	std::vector<Vertex> vertices(vcount);
 	for(UINT i = 0; i < vcount; ++i)
 	{
-		fin >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
-		fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
-
-		XMVECTOR P = XMLoadFloat3(&vertices[i].Pos);
+		vertices[i].Pos = mesh.Positions()[i];
+		vertices[i].Normal = mesh.Normals()[i];
 
 		vertices[i].TexC = { 0.0f, 0.0f };
-
-		vMin = XMVectorMin(vMin, P);
-		vMax = XMVectorMax(vMax, P);
 	}
 
-	BoundingBox bounds;
-	XMStoreFloat3(&bounds.Center, 0.5f*(vMin + vMax));
-	XMStoreFloat3(&bounds.Extents, 0.5f*(vMax - vMin));
-
-	fin >> ignore;
-	fin >> ignore;
-	fin >> ignore;
+	BoundingBox bounds = mesh.Bounds();
 
-	std::vector<std::int32_t> indices(3 * tcount);
-	for(UINT i = 0; i < tcount; ++i)
-	{
-		fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
-	}
-
-	fin.close();
+	std::vector<std::int32_t> indices(mesh.Indices(), mesh.Indices() + mesh.IndexCount());
 
 	//
 	// Pack the indices of all the meshes into one index buffer.
@@ -651,6 +631,13 @@ void PickingApp::BuildCarGeometry()
 
 	geo->DrawArgs["car"] = submesh;
 
+	// Picking tests rays against the system memory copies, so the tree is built from them.
+	auto carBvh = std::make_unique<TriangleBvh>();
+	carBvh->Build(geo->VertexBufferCPU->GetBufferPointer(), sizeof(Vertex),
+		(const std::uint32_t*)geo->IndexBufferCPU->GetBufferPointer() + submesh.StartIndexLocation,
+		submesh.IndexCount / 3, submesh.BaseVertexLocation);
+	mPickBvhs["car"] = std::move(carBvh);
+
 	mGeometries[geo->Name] = std::move(geo);
 }
 
@@ -760,6 +747,7 @@ void PickingApp::BuildRenderItems()
 	carRitem->IndexCount = carRitem->Geo->DrawArgs["car"].IndexCount;
 	carRitem->StartIndexLocation = carRitem->Geo->DrawArgs["car"].StartIndexLocation;
 	carRitem->BaseVertexLocation = carRitem->Geo->DrawArgs["car"].BaseVertexLocation;
+	carRitem->PickBvh = mPickBvhs["car"].get();
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(carRitem.get());
 
 	auto pickedRitem = std::make_unique<RenderItem>();
@@ -787,6 +775,7 @@ void PickingApp::BuildRenderItems()
 
 void PickingApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+    PROFILE_FUNCTION();
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
  
 	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
@@ -886,79 +875,44 @@ void PickingApp::Pick(int sx, int sy)
 	// Assume nothing is picked to start, so the picked render-item is invisible.
 	mPickedRitem->Visible = false;
 
+	// Distance along the view space ray to the nearest hit over all render items.
+	float nearestT = MathHelper::Infinity;
+
 	// Check if we picked an opaque render item.  A real app might keep a separate "picking list"
 	// of objects that can be selected.   
 	for(auto ri : mRitemLayer[(int)RenderLayer::Opaque])
 	{
-		auto geo = ri->Geo;
-
-		// Skip invisible render-items.
-		if(ri->Visible == false)
+		// Skip invisible render-items and items that cannot be picked.
+		if(ri->Visible == false || ri->PickBvh == nullptr)
 			continue;
 
 		XMMATRIX W = XMLoadFloat4x4(&ri->World);
 		XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(W), W);
 
-		// Tranform ray to vi space of Mesh.
+		// Tranform ray to vi space of Mesh.  Every item starts from the view space ray.
 		XMMATRIX toLocal = XMMatrixMultiply(invView, invWorld);
 
-		rayOrigin = XMVector3TransformCoord(rayOrigin, toLocal);
-		rayDir = XMVector3TransformNormal(rayDir, toLocal);
+		XMVECTOR localOrigin = XMVector3TransformCoord(rayOrigin, toLocal);
+		XMVECTOR localDir = XMVector3TransformNormal(rayDir, toLocal);
 
-		// Make the ray direction unit length for the intersection tests.
-		rayDir = XMVector3Normalize(rayDir);
-
-		// If we hit the bounding box of the Mesh, then we might have picked a Mesh triangle,
-		// so do the ray/triangle tests.
-		//
-		// If we did not hit the bounding box, then it is impossible that we hit 
-		// the Mesh, so do not waste effort doing ray/triangle tests.
-		float tmin = 0.0f;
-		if(ri->Bounds.Intersects(rayOrigin, rayDir, tmin))
+		// The local direction is not normalized, so hit distances are in multiples of the
+		// view space direction and compare across render items whatever their scale.
+		TriangleRayHit hit;
+		if(ri->PickBvh->Intersect(localOrigin, localDir, hit, nearestT))
 		{
-			// NOTE: For the demo, we know what to cast the vertex/index data to.  If we were mixing
-			// formats, some metadata would be needed to figure out what to cast it to.
-			auto vertices = (Vertex*)geo->VertexBufferCPU->GetBufferPointer();
-			auto indices = (std::uint32_t*)geo->IndexBufferCPU->GetBufferPointer();
-			UINT triCount = ri->IndexCount / 3;
-
-			// Find the nearest ray/triangle intersection.
-			tmin = MathHelper::Infinity;
-			for(UINT i = 0; i < triCount; ++i)
-			{
-				// Indices for this triangle.
-				UINT i0 = indices[i * 3 + 0];
-				UINT i1 = indices[i * 3 + 1];
-				UINT i2 = indices[i * 3 + 2];
-
-				// Vertices for this triangle.
-				XMVECTOR v0 = XMLoadFloat3(&vertices[i0].Pos);
-				XMVECTOR v1 = XMLoadFloat3(&vertices[i1].Pos);
-				XMVECTOR v2 = XMLoadFloat3(&vertices[i2].Pos);
-
-				// We have to iterate over all the triangles in order to find the nearest intersection.
-				float t = 0.0f;
-				if(TriangleTests::Intersects(rayOrigin, rayDir, v0, v1, v2, t))
-				{
-					if(t < tmin)
-					{
-						// This is the new nearest picked triangle.
-						tmin = t;
-						UINT pickedTriangle = i;
-
-						mPickedRitem->Visible = true;
-						mPickedRitem->IndexCount = 3;
-						mPickedRitem->BaseVertexLocation = 0;
-
-						// Picked render item needs same world matrix as object picked.
-						mPickedRitem->World = ri->World;
-						mPickedRitem->NumFramesDirty = gNumFrameResources;
-
-						// Offset to the picked triangle in the mesh index buffer.
-						mPickedRitem->StartIndexLocation = 3 * pickedTriangle;
-					}
-				}
-			}
+			// This is the new nearest picked triangle.
+			nearestT = hit.T;
+
+			mPickedRitem->Visible = true;
+			mPickedRitem->IndexCount = 3;
+			mPickedRitem->BaseVertexLocation = ri->BaseVertexLocation;
+
+			// Picked render item needs same world matrix as object picked.
+			mPickedRitem->World = ri->World;
+			mPickedRitem->NumFramesDirty = gNumFrameResources;
+
+			// Offset to the picked triangle in the mesh index buffer.
+			mPickedRitem->StartIndexLocation = ri->StartIndexLocation + 3*hit.Triangle;
 		}
 	}
 }
\ No newline at end of file
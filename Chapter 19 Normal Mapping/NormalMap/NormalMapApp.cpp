@@ -370,6 +370,7 @@ void NormalMapApp::AnimateMaterials(const GameTimer& gt)
 
 void NormalMapApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -395,6 +396,7 @@ void NormalMapApp::UpdateObjectCBs(const GameTimer& gt)
 
 void NormalMapApp::UpdateMaterialBuffer(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
 	for(auto& e : mMaterials)
 	{
@@ -423,6 +425,7 @@ void NormalMapApp::UpdateMaterialBuffer(const GameTimer& gt)
 
 void NormalMapApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX proj = mCamera.GetProj();
 
@@ -982,6 +985,7 @@ void NormalMapApp::BuildRenderItems()
 
 void NormalMapApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+    PROFILE_FUNCTION();
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
  
 	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
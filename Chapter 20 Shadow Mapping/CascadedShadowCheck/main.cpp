@@ -0,0 +1,217 @@
+//***************************************************************************************
+// main.cpp
+//
+// Checks the CascadedShadows math with no window or device:
+//   - split depths run from the near plane to the shadow distance, uniform at lambda 0
+//     and logarithmic at lambda 1,
+//   - every cascade's sphere holds its slice of the view frustum, and the slice lands
+//     inside the shadow map and inside the culling frustum,
+//   - casters between a cascade and the light are kept, casters behind it are not,
+//   - turning the camera leaves every cascade's scale unchanged, and moving it shifts
+//     world points by whole shadow map texels,
+//   - a light pointing straight down still works.
+// Then it prints the world size of a texel per cascade next to the single projection
+// ShadowMapApp fits around its whole scene.
+// Exits with 1 if a check fails.
+//***************************************************************************************
+
+#include "../../Common/CascadedShadows.h"
+#include "../../Common/CheckUtil.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+using namespace DirectX;
+
+// The camera as SetLens and LookAt build it in the shadow samples.
+ShadowCascadeCamera MakeCamera(XMFLOAT3 position, float yaw, float pitch)
+{
+	ShadowCascadeCamera camera;
+	camera.Position = position;
+	camera.Look = XMFLOAT3(std::cos(pitch)*std::sin(yaw), std::sin(pitch), std::cos(pitch)*std::cos(yaw));
+	camera.FovY = 0.25f*XM_PI;
+	camera.Aspect = 16.0f / 9.0f;
+	camera.NearZ = 1.0f;
+	camera.FarZ = 1000.0f;
+	return camera;
+}
+
+// The four corners of the view frustum at view depth z.
+void SliceCorners(const ShadowCascadeCamera& camera, float z, XMVECTOR corners[4])
+{
+	XMVECTOR look = XMLoadFloat3(&camera.Look);
+	XMVECTOR right = XMVector3Normalize(XMVector3Cross(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), look));
+	XMVECTOR up = XMVector3Cross(look, right);
+	float h = z*std::tan(0.5f*camera.FovY);
+	float w = h*camera.Aspect;
+	XMVECTOR center = XMVectorAdd(XMLoadFloat3(&camera.Position), XMVectorScale(look, z));
+	for(int i = 0; i < 4; ++i)
+	{
+		corners[i] = XMVectorAdd(center, XMVectorAdd(XMVectorScale(right, (i & 1) ? w : -w),
+			XMVectorScale(up, (i & 2) ? h : -h)));
+	}
+}
+
+XMFLOAT3 ToShadowMap(const ShadowCascade& cascade, FXMVECTOR p)
+{
+	XMFLOAT3 t;
+	XMStoreFloat3(&t, XMVector3TransformCoord(p, XMLoadFloat4x4(&cascade.ShadowTransform)));
+	return t;
+}
+
+bool Visible(const ShadowCascade& cascade, FXMVECTOR p, float extent)
+{
+	return cascade.Frustum.Classify(p, XMVectorReplicate(extent)) != DISJOINT;
+}
+
+void CheckSplits()
+{
+	float splits[ShadowCascadeSettings::MaxCascadeCount + 1];
+
+	CalcShadowCascadeSplits(1.0f, 81.0f, 4, 0.0f, splits);
+	Check(splits[0] == 1.0f && splits[4] == 81.0f && std::fabs(splits[2] - 41.0f) < 1e-4f, "lambda 0 splits uniformly");
+
+	CalcShadowCascadeSplits(1.0f, 81.0f, 4, 1.0f, splits);
+	Check(std::fabs(splits[1] - 3.0f) < 1e-4f && std::fabs(splits[2] - 9.0f) < 1e-4f &&
+		std::fabs(splits[3] - 27.0f) < 1e-3f, "lambda 1 splits logarithmically");
+
+	for(int count = 1; count <= ShadowCascadeSettings::MaxCascadeCount; ++count)
+	{
+		CalcShadowCascadeSplits(0.5f, 300.0f, count, 0.75f, splits);
+		bool increasing = splits[0] == 0.5f && splits[count] == 300.0f;
+		for(int i = 0; i < count; ++i)
+			increasing = increasing && splits[i] < splits[i + 1];
+		Check(increasing, std::to_string(count) + " splits increase from near to far");
+	}
+}
+
+void CheckCascades(const ShadowCascadeCamera& camera, FXMVECTOR lightDir, const ShadowCascadeSettings& settings,
+	const std::string& what)
+{
+	std::vector<ShadowCascade> cascades;
+	CalcShadowCascades(camera, lightDir, settings, cascades);
+	Check((int)cascades.size() == settings.CascadeCount, what + ": one cascade per split");
+
+	for(std::size_t c = 0; c < cascades.size(); ++c)
+	{
+		const ShadowCascade& cascade = cascades[c];
+		std::string name = what + ", cascade " + std::to_string(c);
+
+		bool inSphere = true, inMap = true, inFrustum = true;
+		for(float z : { cascade.SplitNear, cascade.SplitFar })
+		{
+			XMVECTOR corners[4];
+			SliceCorners(camera, z, corners);
+			for(XMVECTOR p : corners)
+			{
+				float d = XMVectorGetX(XMVector3Length(XMVectorSubtract(p, XMLoadFloat3(&cascade.Bounds.Center))));
+				inSphere = inSphere && d <= cascade.Bounds.Radius*1.0001f;
+
+				XMFLOAT3 t = ToShadowMap(cascade, p);
+				inMap = inMap && t.x > 0.0f && t.x < 1.0f && t.y > 0.0f && t.y < 1.0f && t.z > 0.0f && t.z < 1.0f;
+
+				inFrustum = inFrustum && Visible(cascade, p, 0.01f);
+			}
+		}
+		Check(inSphere, name + ": the sphere holds the frustum slice");
+		Check(inMap, name + ": the frustum slice is inside the shadow map");
+		Check(inFrustum, name + ": the frustum slice is inside the culling frustum");
+
+		// Casters up to CasterDistance toward the light from the sphere are kept; things
+		// beyond the sphere, away from the light, cannot cast into it.
+		XMVECTOR center = XMLoadFloat3(&cascade.Bounds.Center);
+		XMVECTOR towardLight = XMVectorScale(lightDir, -(cascade.Bounds.Radius + 0.9f*settings.CasterDistance));
+		XMVECTOR awayFromLight = XMVectorScale(lightDir, 2.0f*cascade.Bounds.Radius);
+		Check(Visible(cascade, XMVectorAdd(center, towardLight), 0.1f), name + ": casters toward the light are kept");
+		Check(!Visible(cascade, XMVectorAdd(center, awayFromLight), 0.1f), name + ": casters behind the cascade are culled");
+	}
+}
+
+// A fixed world point's shadow map coordinates, in texels, from two camera placements.
+// With snapping, the difference is a whole number of texels.
+bool MovesWholeTexels(const ShadowCascade& a, const ShadowCascade& b, std::uint32_t shadowMapSize)
+{
+	XMVECTOR p = XMLoadFloat3(&a.Bounds.Center);
+	XMFLOAT3 ta = ToShadowMap(a, p);
+	XMFLOAT3 tb = ToShadowMap(b, p);
+	float dx = (tb.x - ta.x)*shadowMapSize;
+	float dy = (tb.y - ta.y)*shadowMapSize;
+	return std::fabs(dx - std::round(dx)) < 0.01f && std::fabs(dy - std::round(dy)) < 0.01f;
+}
+
+void CheckStability(FXMVECTOR lightDir, const ShadowCascadeSettings& settings)
+{
+	std::mt19937 rng(25);
+	std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+	std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+
+	ShadowCascadeCamera camera = MakeCamera(XMFLOAT3(3.0f, 4.0f, -20.0f), 0.3f, -0.2f);
+	std::vector<ShadowCascade> first;
+	CalcShadowCascades(camera, lightDir, settings, first);
+
+	bool sameScale = true, wholeTexels = true;
+	for(int frame = 0; frame < 100; ++frame)
+	{
+		// Walk a little and look somewhere else, as a player would.
+		camera = MakeCamera(XMFLOAT3(camera.Position.x + step(rng), camera.Position.y + 0.2f*step(rng),
+			camera.Position.z + step(rng)), angle(rng), 0.4f*step(rng));
+
+		std::vector<ShadowCascade> cascades;
+		CalcShadowCascades(camera, lightDir, settings, cascades);
+		for(std::size_t c = 0; c < cascades.size(); ++c)
+		{
+			sameScale = sameScale && cascades[c].LightProj._11 == first[c].LightProj._11 &&
+				cascades[c].LightProj._22 == first[c].LightProj._22;
+			wholeTexels = wholeTexels && MovesWholeTexels(first[c], cascades[c], settings.ShadowMapSize);
+		}
+	}
+	Check(sameScale, "turning and moving the camera keeps every cascade's scale");
+	Check(wholeTexels, "moving the camera shifts world points by whole texels");
+}
+
+void PrintTexelSizes(const ShadowCascadeSettings& settings)
+{
+	std::vector<ShadowCascade> cascades;
+	CalcShadowCascades(MakeCamera(XMFLOAT3(0.0f, 2.0f, -15.0f), 0.0f, 0.0f),
+		XMVector3Normalize(XMVectorSet(0.57735f, -0.57735f, 0.57735f, 0.0f)), settings, cascades);
+
+	std::printf("%u texel cascades, world units per texel:", settings.ShadowMapSize);
+	for(const ShadowCascade& cascade : cascades)
+		std::printf(" %.4f (to %.1f)", 2.0f / (cascade.LightProj._11*settings.ShadowMapSize), cascade.SplitFar);
+
+	// ShadowMapApp: one 2048 map around a sphere of radius sqrt(10^2 + 15^2).
+	std::printf("\nShadowMapApp's 2048 texel scene fit: %.4f\n", 2.0f*std::sqrt(325.0f) / 2048.0f);
+}
+
+int main()
+{
+	CheckSplits();
+
+	ShadowCascadeSettings settings;
+	XMVECTOR slanted = XMVector3Normalize(XMVectorSet(0.57735f, -0.57735f, 0.57735f, 0.0f));
+	XMVECTOR down = XMVectorSet(0.0f, -1.0f, 0.0f, 0.0f);
+
+	CheckCascades(MakeCamera(XMFLOAT3(0.0f, 2.0f, -15.0f), 0.0f, 0.0f), slanted, settings, "slanted light");
+	CheckCascades(MakeCamera(XMFLOAT3(5.0f, 30.0f, 7.0f), 2.0f, -1.2f), down, settings, "light straight down");
+
+	ShadowCascadeSettings one = settings;
+	one.CascadeCount = 1;
+	one.ShadowMapSize = 512;
+	CheckCascades(MakeCamera(XMFLOAT3(-100.0f, 0.0f, 250.0f), -2.5f, 0.4f), slanted, one, "one cascade");
+
+	ShadowCascadeSettings many = settings;
+	many.CascadeCount = ShadowCascadeSettings::MaxCascadeCount;
+	many.SplitLambda = 0.95f;
+	many.ShadowDistance = 2000.0f;
+	CheckCascades(MakeCamera(XMFLOAT3(0.0f, 2.0f, -15.0f), 1.0f, 0.1f), slanted, many, "eight cascades to the far plane");
+
+	CheckStability(slanted, settings);
+	CheckStability(down, settings);
+
+	ShadowCascadeSettings small = settings;
+	small.ShadowMapSize = 1024;
+	PrintTexelSizes(small);
+
+	return CheckExitCode();
+}
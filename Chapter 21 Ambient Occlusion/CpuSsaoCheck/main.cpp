@@ -0,0 +1,259 @@
+//***************************************************************************************
+// main.cpp
+//
+// Runs CpuSsao on a ray-cast scene, a floor meeting a back wall with a sphere resting
+// on the floor, with no window or device, and checks:
+//   - the tiled SIMD path matches the texel-by-texel one, at odd sizes that cut tiles
+//     short, with and without blurring, on different thread counts,
+//   - open wall is unoccluded, and the crease and the sphere's contact are darker,
+//   - blurring keeps open wall at 1 and the wall beside the sphere lit.
+// Then it times both at 1920x1080, blurring 3 times as SsaoApp does.
+// Exits with 1 if a check fails.
+//***************************************************************************************
+
+#include "../../Common/CpuSsao.h"
+#include "../../Common/CpuBlur.h"
+#include "../../Common/CheckUtil.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+using namespace DirectX;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Scene
+{
+	XMFLOAT4X4 Proj;
+	CpuImage Depth;
+	CpuImage Normals;
+};
+
+// Floor at y = -1, back wall at z = 6 and a sphere of radius 0.7 on the floor at
+// z = 4, seen from the origin looking down +z.  Misses get the app's clear values.
+Scene RayCastScene(std::uint32_t width, std::uint32_t height)
+{
+	Scene scene;
+	XMStoreFloat4x4(&scene.Proj, XMMatrixPerspectiveFovLH(0.25f*3.14159265f, (float)width / height, 1.0f, 1000.0f));
+	scene.Depth = CpuImage(CpuImageFormat::R32_FLOAT, width, height);
+	scene.Normals = CpuImage(CpuImageFormat::R16G16B16A16_FLOAT, width, height);
+
+	const float cx = 0.0f, cy = -0.3f, cz = 4.0f, radius = 0.7f;
+	std::vector<float> depthRow(width);
+	std::vector<float> normalRow(4*(std::size_t)width);
+	for(std::uint32_t y = 0; y < height; ++y)
+	{
+		for(std::uint32_t x = 0; x < width; ++x)
+		{
+			float ndcX = 2.0f*(x + 0.5f) / width - 1.0f;
+			float ndcY = 1.0f - 2.0f*(y + 0.5f) / height;
+			float dx = ndcX / scene.Proj._11;
+			float dy = ndcY / scene.Proj._22;
+			float dz = 1.0f;
+
+			float t = 1e30f;
+			float n[3] = { 0.0f, 0.0f, 1.0f };
+			if(dy < 0.0f && -1.0f / dy < t)
+			{
+				t = -1.0f / dy;
+				n[0] = 0.0f; n[1] = 1.0f; n[2] = 0.0f;
+			}
+			if(6.0f < t)
+			{
+				t = 6.0f;
+				n[0] = 0.0f; n[1] = 0.0f; n[2] = -1.0f;
+			}
+			float b = dx*cx + dy*cy + dz*cz;
+			float c = cx*cx + cy*cy + cz*cz - radius*radius;
+			float a = dx*dx + dy*dy + dz*dz;
+			float disc = b*b - a*c;
+			if(disc > 0.0f)
+			{
+				float ts = (b - std::sqrt(disc)) / a;
+				if(ts > 0.0f && ts < t)
+				{
+					t = ts;
+					n[0] = (t*dx - cx) / radius; n[1] = (t*dy - cy) / radius; n[2] = (t*dz - cz) / radius;
+				}
+			}
+
+			// z_ndc = A + B/viewZ.
+			float viewZ = t*dz;
+			depthRow[x] = t < 1e30f ? scene.Proj._33 + scene.Proj._43 / viewZ : 1.0f;
+			normalRow[4*x + 0] = n[0];
+			normalRow[4*x + 1] = n[1];
+			normalRow[4*x + 2] = n[2];
+			normalRow[4*x + 3] = 0.0f;
+		}
+		EncodeCpuImageRow(scene.Depth, y, 0, width, depthRow.data());
+		EncodeCpuImageRow(scene.Normals, y, 0, width, normalRow.data());
+	}
+	return scene;
+}
+
+// As Ssao::BuildOffsetVectors and Ssao::BuildRandomVectorTexture, with a fixed seed.
+void BuildVectors(CpuSsaoConstants& constants, CpuImage& randomVectorMap)
+{
+	std::mt19937 rng(2015);
+	std::uniform_real_distribution<float> length(0.25f, 1.0f);
+	const float directions[14][3] =
+	{
+		{ +1, +1, +1 }, { -1, -1, -1 }, { -1, +1, +1 }, { +1, -1, -1 },
+		{ +1, +1, -1 }, { -1, -1, +1 }, { -1, +1, -1 }, { +1, -1, +1 },
+		{ -1, 0, 0 }, { +1, 0, 0 }, { 0, -1, 0 }, { 0, +1, 0 }, { 0, 0, -1 }, { 0, 0, +1 },
+	};
+	for(int i = 0; i < 14; ++i)
+	{
+		const float* d = directions[i];
+		float s = length(rng) / std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+		constants.OffsetVectors[i] = XMFLOAT4(s*d[0], s*d[1], s*d[2], 0.0f);
+	}
+
+	randomVectorMap = CpuImage(CpuImageFormat::R8G8B8A8_UNORM, 256, 256);
+	for(std::uint8_t& texel : randomVectorMap.Texels)
+		texel = (std::uint8_t)(rng() & 0xff);
+}
+
+float AmbientAt(const CpuImage& ambientMap, float u, float v)
+{
+	float value;
+	DecodeCpuImageRow(ambientMap, (std::uint32_t)(v*ambientMap.Height), (std::uint32_t)(u*ambientMap.Width), 1, &value);
+	return value;
+}
+
+// The tiled and scalar paths evaluate the same expressions, so they give the same bits
+// unless the compiler fuses multiplies and adds differently in each, as /fp:fast with
+// /arch:AVX2 or -ffp-contract=fast may.  A rounding error can then move an ambient value
+// to the neighboring R16_UNORM step, or flip one of the occlusion and blur tests, so a
+// few texels may differ slightly.
+bool MatchesScalar(const CpuImage& ambientMap, const CpuImage& expected)
+{
+	std::vector<float> row(ambientMap.Width);
+	std::vector<float> expectedRow(ambientMap.Width);
+	float maxDifference = 0.0f;
+	std::size_t differing = 0;
+	for(std::uint32_t y = 0; y < ambientMap.Height; ++y)
+	{
+		DecodeCpuImageRow(ambientMap, y, 0, ambientMap.Width, row.data());
+		DecodeCpuImageRow(expected, y, 0, expected.Width, expectedRow.data());
+		for(std::uint32_t x = 0; x < ambientMap.Width; ++x)
+		{
+			float difference = std::fabs(row[x] - expectedRow[x]);
+			maxDifference = std::max(maxDifference, difference);
+			differing += difference > 0.0f ? 1 : 0;
+		}
+	}
+	return maxDifference <= 1.0f / 256.0f && differing*1000 <= (std::size_t)ambientMap.Width*ambientMap.Height;
+}
+
+void CheckTiledMatchesScalar(const CpuSsaoConstants& constants, const CpuImage& randomVectorMap)
+{
+	const std::uint32_t sizes[][2] = { { 64, 48 }, { 101, 67 }, { 333, 200 } };
+	const int blurCounts[] = { 0, 1, 4 };
+
+	ThreadPool onePool(1);
+	ThreadPool threePool(3);
+	ThreadPool* pools[] = { &onePool, &threePool };
+
+	for(const auto& size : sizes)
+	{
+		Scene scene = RayCastScene(size[0], size[1]);
+		CpuSsaoConstants sceneConstants = constants;
+		sceneConstants.Proj = scene.Proj;
+		CpuSsao ssao(sceneConstants);
+
+		for(int blurCount : blurCounts)
+		{
+			CpuImage expected(CpuImageFormat::R16_UNORM, size[0] / 2, size[1] / 2);
+			ssao.ComputeSsaoScalar(scene.Depth, scene.Normals, randomVectorMap, expected, blurCount);
+
+			for(ThreadPool* pool : pools)
+			{
+				CpuImage ambientMap(CpuImageFormat::R16_UNORM, size[0] / 2, size[1] / 2);
+				ssao.ComputeSsao(scene.Depth, scene.Normals, randomVectorMap, ambientMap, blurCount, *pool);
+				Check(MatchesScalar(ambientMap, expected), std::to_string(size[0]) + "x" + std::to_string(size[1]) +
+					" blurred " + std::to_string(blurCount) + " times on " + std::to_string(pool->ConcurrencyLevel()) +
+					" threads matches the scalar path");
+			}
+		}
+	}
+}
+
+void CheckOcclusion(const CpuSsaoConstants& constants, const CpuImage& randomVectorMap)
+{
+	Scene scene = RayCastScene(640, 480);
+	CpuSsaoConstants sceneConstants = constants;
+	sceneConstants.Proj = scene.Proj;
+	CpuSsao ssao(sceneConstants);
+
+	CpuImage raw(CpuImageFormat::R16_UNORM, 320, 240);
+	CpuImage blurred(CpuImageFormat::R16_UNORM, 320, 240);
+	ssao.ComputeSsao(scene.Depth, scene.Normals, randomVectorMap, raw, 0);
+	ssao.ComputeSsao(scene.Depth, scene.Normals, randomVectorMap, blurred, 3);
+
+	// Screen positions: open wall up and left of the sphere, the wall just above the
+	// crease, where the floor is in front of the samples, and the floor just in front of
+	// where the sphere touches it.
+	const float wallU = 0.2f, wallV = 0.15f;
+	const float creaseU = 0.2f, creaseV = 0.5f + 0.5f*(1.0f / 6.0f)*scene.Proj._22 - 0.01f;
+	const float contactU = 0.5f, contactV = 0.5f + 0.5f*(1.0f / 3.35f)*scene.Proj._22;
+
+	float wall = AmbientAt(blurred, wallU, wallV);
+	float crease = AmbientAt(blurred, creaseU, creaseV);
+	float contact = AmbientAt(blurred, contactU, contactV);
+	std::printf("ambient: open wall %.3f, crease %.3f, sphere contact %.3f\n", wall, crease, contact);
+
+	Check(AmbientAt(raw, wallU, wallV) == 1.0f && wall == 1.0f, "open wall is unoccluded");
+	Check(crease < 0.9f, "the floor-wall crease is occluded");
+	Check(contact < 0.9f, "the floor under the sphere is occluded");
+
+	// The wall just outside the sphere's silhouette stays lit once blurred.
+	const float edgeV = 0.5f + 0.5f*(0.3f / 4.0f)*scene.Proj._22;
+	const float wallDepth = scene.Proj._33 + scene.Proj._43 / 6.0f;
+	std::uint32_t edgeX = 320;
+	float depth = 0.0f;
+	while(edgeX < 639 && depth != wallDepth)
+		DecodeCpuImageRow(scene.Depth, (std::uint32_t)(edgeV*480), ++edgeX, 1, &depth);
+	float edgeU = (edgeX + 4.0f) / 640;
+	Check(AmbientAt(raw, edgeU, edgeV) == 1.0f && AmbientAt(blurred, edgeU, edgeV) > 0.95f,
+		"the wall beside the sphere stays lit");
+}
+
+void Time(const CpuSsaoConstants& constants, const CpuImage& randomVectorMap)
+{
+	Scene scene = RayCastScene(1920, 1080);
+	CpuSsaoConstants sceneConstants = constants;
+	sceneConstants.Proj = scene.Proj;
+	CpuSsao ssao(sceneConstants);
+
+	CpuImage ambientMap(CpuImageFormat::R16_UNORM, 960, 540);
+	auto start = Clock::now();
+	ssao.ComputeSsao(scene.Depth, scene.Normals, randomVectorMap, ambientMap, 3);
+	double tiledMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	CpuImage expected(CpuImageFormat::R16_UNORM, 960, 540);
+	start = Clock::now();
+	ssao.ComputeSsaoScalar(scene.Depth, scene.Normals, randomVectorMap, expected, 3);
+	double scalarMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	Check(MatchesScalar(ambientMap, expected), "1920x1080 matches the scalar path");
+	std::printf("1920x1080, 3 blurs: tiled %.1f ms on %u threads, scalar %.1f ms\n",
+		tiledMs, ThreadPool::Default().ConcurrencyLevel(), scalarMs);
+}
+
+int main()
+{
+	CpuSsaoConstants constants;
+	constants.BlurWeights = CalcGaussBlurWeights(2.5f);
+	CpuImage randomVectorMap;
+	BuildVectors(constants, randomVectorMap);
+
+	CheckTiledMatchesScalar(constants, randomVectorMap);
+	CheckOcclusion(constants, randomVectorMap);
+	Time(constants, randomVectorMap);
+
+	return CheckExitCode();
+}
@@ -0,0 +1,372 @@
+//***************************************************************************************
+// main.cpp
+//
+// Runs ShaderCache with a stand-in compiler, with no Direct3D, and checks:
+//   - a cold build compiles every shader once, in parallel, and a shader requested
+//     twice compiles once,
+//   - building one shader at a time and saving once, as d3dUtil does, stores them all,
+//   - a warm build out of the saved store compiles nothing and returns the same bytes,
+//   - editing an included file recompiles only the shaders that include it, and the
+//     stale entries are replaced rather than piling up,
+//   - defines, entry points and flags key separately,
+//   - includes resolve against the including file's directory and then the root
+//     file's, includes in comments are ignored, and a missing include that appears later
+//     changes the key,
+//   - a failed compile fails only its own request and is not stored,
+//   - a corrupt store opens empty and is rebuilt.
+// Then it scans the Ssao sample's shaders and times hashing their keys.
+// Exits with 1 if a check fails.
+//
+// Usage: ShaderCacheCheck [Ssao shader directory]
+//***************************************************************************************
+
+#include "../../Common/ShaderCache.h"
+#include "../../Common/CheckUtil.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+	#include <direct.h>
+#else
+	#include <sys/stat.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+void WriteText(const std::string& filename, const std::string& text)
+{
+	std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+	fout << text;
+}
+
+void MakeDirectory(const std::string& name)
+{
+#if defined(_WIN32)
+	_mkdir(name.c_str());
+#else
+	mkdir(name.c_str(), 0755);
+#endif
+}
+
+// "Compiles" a shader into the request's fields plus the hash of its source, so the
+// bytecode changes whenever a real compiler's would.  Each compile takes a few
+// milliseconds, and the most compiles seen running at once is kept.
+class FakeCompiler : public ShaderCompiler
+{
+public:
+	std::string Version()const override { return "fake 1"; }
+
+	bool Compile(const ShaderCompileRequest& request, std::vector<std::uint8_t>& bytecode, std::string& messages) override
+	{
+		int running = ++mRunning;
+		int peak = mPeak.load();
+		while(running > peak && !mPeak.compare_exchange_weak(peak, running)) {}
+		++mCalls;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		--mRunning;
+
+		if(request.EntryPoint == "Broken")
+		{
+			messages = request.Filename + ": error X3000: syntax error";
+			return false;
+		}
+
+		std::vector<ShaderDependency> dependencies;
+		ScanShaderDependencies(request.Filename, dependencies);
+		std::uint64_t hash = 0;
+		for(const auto& d : dependencies)
+			hash = HashShaderBytes(&d.ContentHash, sizeof(d.ContentHash), hash);
+
+		std::string text = request.EntryPoint + "|" + request.Target + "|" + std::to_string(request.Flags);
+		for(const auto& define : request.Defines)
+			text += "|" + define.Name + "=" + define.Definition;
+		text += "|" + std::to_string(hash);
+		bytecode.assign(text.begin(), text.end());
+		return true;
+	}
+
+	int Calls()const { return mCalls; }
+	int Peak()const { return mPeak; }
+	void Reset() { mCalls = 0; mPeak = 0; }
+
+private:
+	std::atomic<int> mCalls{ 0 };
+	std::atomic<int> mRunning{ 0 };
+	std::atomic<int> mPeak{ 0 };
+};
+
+ShaderCompileRequest MakeRequest(const std::string& filename, const std::string& entryPoint,
+	const std::string& target, std::vector<ShaderDefine> defines = {}, std::uint32_t flags = 0)
+{
+	ShaderCompileRequest request;
+	request.Filename = filename;
+	request.EntryPoint = entryPoint;
+	request.Target = target;
+	request.Defines = defines;
+	request.Flags = flags;
+	return request;
+}
+
+std::vector<std::uint8_t> BytesOf(const ShaderCache& cache, std::size_t request)
+{
+	const std::uint8_t* p = cache.Bytecode(request);
+	return std::vector<std::uint8_t>(p, p + cache.BytecodeSize(request));
+}
+
+std::vector<std::vector<std::uint8_t>> AllBytes(const ShaderCache& cache, std::size_t count)
+{
+	std::vector<std::vector<std::uint8_t>> bytes;
+	for(std::size_t i = 0; i < count; ++i)
+		bytes.push_back(BytesOf(cache, i));
+	return bytes;
+}
+
+int CountHits(const ShaderCache& cache, std::size_t count)
+{
+	int hits = 0;
+	for(std::size_t i = 0; i < count; ++i)
+		hits += cache.WasHit(i) ? 1 : 0;
+	return hits;
+}
+
+void CheckCache()
+{
+	const std::string dir = "ShaderCacheCheckTemp/";
+	const std::string store = dir + "ShaderCache.bin";
+	MakeDirectory("ShaderCacheCheckTemp");
+	MakeDirectory(dir + "Include");
+	std::remove(store.c_str());
+	std::remove((dir + "Include/Late.hlsl").c_str());
+
+	WriteText(dir + "Common.hlsl", "// Common.hlsl\nfloat4 gColor;\n");
+	WriteText(dir + "Lighting.hlsl", "#include \"Common.hlsl\"\nfloat3 Light() { return 1; }\n");
+	WriteText(dir + "Include/Nested.hlsl", "// Found in the root file's directory.\n#include \"Common.hlsl\"\n");
+	WriteText(dir + "Default.hlsl",
+		"#include \"Lighting.hlsl\"\n"
+		"  #  include <Include/Nested.hlsl>\n"
+		"// #include \"Commented.hlsl\"\n"
+		"/* #include \"Commented.hlsl\"\n   #include \"Commented.hlsl\" */\n"
+		"float4 VS() : SV_Position { return gColor; }\n"
+		"float4 PS() : SV_Target { return float4(Light(), 1); }\n");
+	WriteText(dir + "Sky.hlsl", "float4 VS() : SV_Position { return 0; }\nfloat4 PS() : SV_Target { return 0; }\n");
+	WriteText(dir + "Late.hlsl", "#include \"Include/Late.hlsl\"\nfloat4 PS() : SV_Target { return 0; }\n");
+
+	//
+	// Dependency scanning.
+	//
+
+	std::vector<ShaderDependency> dependencies;
+	ScanShaderDependencies(dir + "Default.hlsl", dependencies);
+	std::vector<std::string> names;
+	for(const auto& d : dependencies)
+		names.push_back(d.Filename.substr(dir.size()) + (d.Found ? "" : " (missing)"));
+	std::vector<std::string> expected = { "Default.hlsl", "Lighting.hlsl", "Common.hlsl", "Include/Nested.hlsl" };
+	Check(names == expected, "Default.hlsl depends on Default, Lighting, Common and Include/Nested once each, without the commented includes");
+
+	FakeCompiler compiler;
+	ThreadPool pool(4);
+
+	std::vector<ShaderCompileRequest> requests =
+	{
+		MakeRequest(dir + "Default.hlsl", "VS", "vs_5_1"),
+		MakeRequest(dir + "Default.hlsl", "PS", "ps_5_1"),
+		MakeRequest(dir + "Default.hlsl", "PS", "ps_5_1", { { "ALPHA_TEST", "1" } }),
+		MakeRequest(dir + "Sky.hlsl", "VS", "vs_5_1"),
+		MakeRequest(dir + "Sky.hlsl", "PS", "ps_5_1"),
+		MakeRequest(dir + "Sky.hlsl", "PS", "ps_5_1", {}, 1),
+		MakeRequest(dir + "Default.hlsl", "VS", "vs_5_1"),
+		MakeRequest(dir + "Late.hlsl", "PS", "ps_5_1"),
+	};
+	const std::size_t count = requests.size();
+	const std::size_t uniqueCount = count - 1;
+
+	//
+	// Cold: everything compiles, once, in parallel.
+	//
+
+	std::vector<std::vector<std::uint8_t>> coldBytes;
+	{
+		ShaderCache cache(compiler);
+		cache.Open(store);
+		Check(cache.EntryCount() == 0, "a missing store opens empty");
+
+		Check(cache.Build(requests, pool), "cold build succeeds");
+		Check(compiler.Calls() == (int)uniqueCount, "cold build compiles each distinct shader once, got " + std::to_string(compiler.Calls()));
+		Check(compiler.Peak() > 1, "cold build compiles in parallel");
+		Check(CountHits(cache, count) == 0, "cold build has no hits");
+		coldBytes = AllBytes(cache, count);
+		Check(coldBytes[0] == coldBytes[6], "a repeated request gets the same bytecode");
+		Check(coldBytes[1] != coldBytes[2] && coldBytes[4] != coldBytes[5], "defines and flags key separately");
+
+		Check(cache.Save(), "save succeeds");
+		Check(cache.EntryCount() == uniqueCount, "the store holds each distinct shader");
+		Check(AllBytes(cache, count) == coldBytes, "the results survive Save moving them into the store mapping");
+	}
+
+	//
+	// One shader per Build and a single Save, as d3dUtil does until FlushShaderCache.
+	//
+
+	compiler.Reset();
+	const std::string batchStore = dir + "OneAtATime.bin";
+	std::remove(batchStore.c_str());
+	{
+		ShaderCache cache(compiler);
+		cache.Open(batchStore);
+		bool same = true;
+		for(std::size_t i = 0; i < count; ++i)
+			same = cache.Build({ requests[i] }, pool) && BytesOf(cache, 0) == coldBytes[i] && same;
+		Check(same, "one shader per build gets the batch's bytecode");
+		Check(compiler.Calls() == (int)uniqueCount, "a shader built again before Save compiles once, got " + std::to_string(compiler.Calls()));
+		Check(cache.Save() && cache.EntryCount() == uniqueCount, "one Save stores the shaders of every build before it");
+	}
+	compiler.Reset();
+	{
+		ShaderCache cache(compiler);
+		cache.Open(batchStore);
+		Check(cache.Build(requests, pool) && compiler.Calls() == 0 && AllBytes(cache, count) == coldBytes,
+			"the store saved once serves every shader");
+	}
+
+	//
+	// Warm: nothing compiles.
+	//
+
+	compiler.Reset();
+	auto warmStart = Clock::now();
+	{
+		ShaderCache cache(compiler);
+		cache.Open(store);
+		Check(cache.EntryCount() == uniqueCount, "the store reopens with every entry");
+		Check(cache.Build(requests, pool), "warm build succeeds");
+		Check(compiler.Calls() == 0, "warm build compiles nothing");
+		Check(CountHits(cache, count) == (int)count, "warm build hits every request");
+		Check(AllBytes(cache, count) == coldBytes, "warm build returns the cold build's bytecode");
+		Check(cache.Save(), "saving with nothing new succeeds");
+	}
+	double warmMs = std::chrono::duration<double, std::milli>(Clock::now() - warmStart).count();
+
+	//
+	// Editing a shared include recompiles only its users, replacing their entries.
+	//
+
+	compiler.Reset();
+	WriteText(dir + "Common.hlsl", "// Common.hlsl\nfloat4 gColor;\nfloat gTime;\n");
+	{
+		ShaderCache cache(compiler);
+		cache.Open(store);
+		Check(cache.Build(requests, pool), "build after the edit succeeds");
+		Check(compiler.Calls() == 3, "editing Common.hlsl recompiles the three Default.hlsl shaders, got " + std::to_string(compiler.Calls()));
+		Check(!cache.WasHit(0) && !cache.WasHit(1) && !cache.WasHit(2) && cache.WasHit(3) && cache.WasHit(4) && cache.WasHit(5),
+			"only the shaders including Common.hlsl miss");
+		Check(BytesOf(cache, 0) != coldBytes[0], "the edited shader's bytecode changes");
+		Check(cache.Save(), "save after the edit succeeds");
+		Check(cache.EntryCount() == uniqueCount, "stale entries are replaced, not kept, got " + std::to_string(cache.EntryCount()));
+	}
+
+	//
+	// A missing include that appears later changes the key.
+	//
+
+	compiler.Reset();
+	{
+		ShaderCache cache(compiler);
+		cache.Open(store);
+		std::uint64_t before = cache.Key(requests[7]);
+		WriteText(dir + "Include/Late.hlsl", "float gLate;\n");
+		Check(cache.Key(requests[7]) != before, "creating a missing include changes the key");
+		Check(cache.Build(requests, pool) && compiler.Calls() == 1 && !cache.WasHit(7), "the shader waiting on it recompiles");
+		Check(cache.Save(), "save after the new include succeeds");
+	}
+
+	//
+	// A failed compile fails only its request and is not stored.
+	//
+
+	compiler.Reset();
+	{
+		std::vector<ShaderCompileRequest> broken = requests;
+		broken.push_back(MakeRequest(dir + "Sky.hlsl", "Broken", "ps_5_1"));
+
+		ShaderCache cache(compiler);
+		cache.Open(store);
+		Check(!cache.Build(broken, pool), "a build with a failed compile fails");
+		Check(!cache.Succeeded(count) && !cache.Messages(count).empty(), "the failed request has its messages");
+		Check(CountHits(cache, count) == (int)count, "the other requests still hit");
+		Check(cache.Save() && cache.EntryCount() == uniqueCount, "the failure is not stored");
+	}
+
+	//
+	// A corrupt store opens empty and is rebuilt.
+	//
+
+	compiler.Reset();
+	{
+		std::fstream f(store, std::ios::binary | std::ios::in | std::ios::out);
+		f.seekp(8);
+		const char garbage[8] = { '\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\xff', '\x7f' };
+		f.write(garbage, sizeof(garbage));
+	}
+	{
+		ShaderCache cache(compiler);
+		cache.Open(store);
+		Check(cache.EntryCount() == 0, "a store with a bad entry count opens empty");
+		Check(cache.Build(requests, pool) && compiler.Calls() == (int)uniqueCount, "a corrupt store is rebuilt");
+		Check(cache.Save(), "the rebuilt store saves");
+	}
+	WriteText(store, "SHDC");
+	{
+		ShaderCache cache(compiler);
+		cache.Open(store);
+		Check(cache.EntryCount() == 0, "a truncated store opens empty");
+	}
+
+	std::printf("cache: %d distinct shaders, warm build %.2f ms\n", (int)uniqueCount, warmMs);
+}
+
+void ScanSsaoShaders(const std::string& directory)
+{
+	const char* files[] = { "Default.hlsl", "Shadows.hlsl", "ShadowDebug.hlsl", "DrawNormals.hlsl",
+		"Ssao.hlsl", "SsaoBlur.hlsl", "Sky.hlsl" };
+
+	std::vector<ShaderCompileRequest> requests;
+	for(const char* file : files)
+	{
+		requests.push_back(MakeRequest(directory + file, "VS", "vs_5_1"));
+		requests.push_back(MakeRequest(directory + file, "PS", "ps_5_1"));
+	}
+
+	std::vector<ShaderDependency> dependencies;
+	ScanShaderDependencies(directory + "Default.hlsl", dependencies);
+	if(dependencies.empty() || !dependencies[0].Found)
+	{
+		std::printf("skipping the Ssao shaders: %sDefault.hlsl not found\n", directory.c_str());
+		return;
+	}
+	Check(dependencies.size() == 3 && dependencies[1].Found && dependencies[2].Found,
+		"Default.hlsl includes Common.hlsl, which includes LightingUtil.hlsl");
+
+	FakeCompiler compiler;
+	ShaderCache cache(compiler);
+	auto start = Clock::now();
+	std::uint64_t combined = 0;
+	for(const auto& request : requests)
+		combined ^= cache.Key(request);
+	double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	std::printf("ssao: %d shaders keyed in %.2f ms (%016llx)\n", (int)requests.size(), ms, (unsigned long long)combined);
+}
+
+int main(int argc, char* argv[])
+{
+	CheckCache();
+	ScanSsaoShaders(argc > 1 ? std::string(argv[1]) + "/" : std::string("../Ssao/Shaders/"));
+
+	return CheckExitCode();
+}
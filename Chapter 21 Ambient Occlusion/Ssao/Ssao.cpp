@@ -38,6 +38,11 @@ void Ssao::GetOffsetVectors(DirectX::XMFLOAT4 offsets[14])
     std::copy(&mOffsets[0], &mOffsets[14], &offsets[0]);
 }
 
+const CpuImage& Ssao::RandomVectorMapData()const
+{
+    return mRandomVectorMapData;
+}
+
 std::vector<float> Ssao::CalcGaussWeights(float sigma)
 {
     float twoSigma2 = 2.0f*sigma*sigma;
@@ -393,7 +398,9 @@ void Ssao::BuildRandomVectorTexture(ID3D12GraphicsCommandList* cmdList)
         nullptr,
         IID_PPV_ARGS(mRandomVectorMapUploadBuffer.GetAddressOf())));
 
-    XMCOLOR initData[256 * 256];
+    // Kept as the texture's bytes so CpuSsao reads the same vectors the shader does.
+    mRandomVectorMapData = CpuImage(CpuImageFormat::R8G8B8A8_UNORM, 256, 256);
+    XMCOLOR* initData = reinterpret_cast<XMCOLOR*>(mRandomVectorMapData.Texels.data());
     for(int i = 0; i < 256; ++i)
     {
         for(int j = 0; j < 256; ++j)
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "../../Common/d3dUtil.h"
+#include "../../Common/CpuImage.h"
 #include "FrameResource.h"
  
  
@@ -33,6 +34,10 @@ public:
     void GetOffsetVectors(DirectX::XMFLOAT4 offsets[14]);
     std::vector<float> CalcGaussWeights(float sigma);
 
+    // The random vectors uploaded to the random vector map, as the shader reads them,
+    // for CpuSsao.
+    const CpuImage& RandomVectorMapData()const;
+
 
 	ID3D12Resource* NormalMap();
 	ID3D12Resource* AmbientMap();
@@ -123,6 +128,7 @@ private:
 	UINT mRenderTargetHeight;
 
     DirectX::XMFLOAT4 mOffsets[14];
+    CpuImage mRandomVectorMapData;
 
 	D3D12_VIEWPORT mViewport;
 	D3D12_RECT mScissorRect;
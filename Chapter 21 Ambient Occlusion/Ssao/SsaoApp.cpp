@@ -7,6 +7,7 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/MeshCache.h"
 #include "FrameResource.h"
 #include "ShadowMap.h"
 #include "Ssao.h"
@@ -520,6 +521,7 @@ void SsaoApp::AnimateMaterials(const GameTimer& gt)
 
 void SsaoApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -545,6 +547,7 @@ void SsaoApp::UpdateObjectCBs(const GameTimer& gt)
 
 void SsaoApp::UpdateMaterialBuffer(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
 	for(auto& e : mMaterials)
 	{
@@ -573,6 +576,7 @@ void SsaoApp::UpdateMaterialBuffer(const GameTimer& gt)
 
 void SsaoApp::UpdateShadowTransform(const GameTimer& gt)
 {
+    PROFILE_FUNCTION();
     // Only the first "main" light casts a shadow.
     XMVECTOR lightDir = XMLoadFloat3(&mRotatedLightDirections[0]);
     XMVECTOR lightPos = -2.0f*mSceneBounds.Radius*lightDir;
@@ -613,6 +617,7 @@ void SsaoApp::UpdateShadowTransform(const GameTimer& gt)
 
 void SsaoApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX proj = mCamera.GetProj();
 
@@ -660,6 +665,7 @@ void SsaoApp::UpdateMainPassCB(const GameTimer& gt)
 
 void SsaoApp::UpdateShadowPassCB(const GameTimer& gt)
 {
+    PROFILE_FUNCTION();
     XMMATRIX view = XMLoadFloat4x4(&mLightView);
     XMMATRIX proj = XMLoadFloat4x4(&mLightProj);
 
@@ -689,6 +695,7 @@ void SsaoApp::UpdateShadowPassCB(const GameTimer& gt)
 
 void SsaoApp::UpdateSsaoCB(const GameTimer& gt)
 {
+    PROFILE_FUNCTION();
     SsaoConstants ssaoCB;
 
     XMMATRIX P = mCamera.GetProj();
@@ -980,27 +987,43 @@ void SsaoApp::BuildShadersAndInputLayout()
 		NULL, NULL
 	};
 
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
+	// Compiled as one batch, so the shaders not in the shader cache compile in parallel.
+	const struct
+	{
+		const char* Name;
+		d3dUtil::ShaderDesc Desc;
+	} shaders[] =
+	{
+		{ "standardVS", { L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1" } },
+		{ "opaquePS", { L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1" } },
 
-    mShaders["shadowVS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["shadowOpaquePS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", nullptr, "PS", "ps_5_1");
-    mShaders["shadowAlphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Shadows.hlsl", alphaTestDefines, "PS", "ps_5_1");
-	
-    mShaders["debugVS"] = d3dUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["debugPS"] = d3dUtil::CompileShader(L"Shaders\\ShadowDebug.hlsl", nullptr, "PS", "ps_5_1");
+		{ "shadowVS", { L"Shaders\\Shadows.hlsl", nullptr, "VS", "vs_5_1" } },
+		{ "shadowOpaquePS", { L"Shaders\\Shadows.hlsl", nullptr, "PS", "ps_5_1" } },
+		{ "shadowAlphaTestedPS", { L"Shaders\\Shadows.hlsl", alphaTestDefines, "PS", "ps_5_1" } },
 
-    mShaders["drawNormalsVS"] = d3dUtil::CompileShader(L"Shaders\\DrawNormals.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["drawNormalsPS"] = d3dUtil::CompileShader(L"Shaders\\DrawNormals.hlsl", nullptr, "PS", "ps_5_1");
+		{ "debugVS", { L"Shaders\\ShadowDebug.hlsl", nullptr, "VS", "vs_5_1" } },
+		{ "debugPS", { L"Shaders\\ShadowDebug.hlsl", nullptr, "PS", "ps_5_1" } },
 
-    mShaders["ssaoVS"] = d3dUtil::CompileShader(L"Shaders\\Ssao.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["ssaoPS"] = d3dUtil::CompileShader(L"Shaders\\Ssao.hlsl", nullptr, "PS", "ps_5_1");
+		{ "drawNormalsVS", { L"Shaders\\DrawNormals.hlsl", nullptr, "VS", "vs_5_1" } },
+		{ "drawNormalsPS", { L"Shaders\\DrawNormals.hlsl", nullptr, "PS", "ps_5_1" } },
 
-    mShaders["ssaoBlurVS"] = d3dUtil::CompileShader(L"Shaders\\SsaoBlur.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["ssaoBlurPS"] = d3dUtil::CompileShader(L"Shaders\\SsaoBlur.hlsl", nullptr, "PS", "ps_5_1");
+		{ "ssaoVS", { L"Shaders\\Ssao.hlsl", nullptr, "VS", "vs_5_1" } },
+		{ "ssaoPS", { L"Shaders\\Ssao.hlsl", nullptr, "PS", "ps_5_1" } },
 
-	mShaders["skyVS"] = d3dUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["skyPS"] = d3dUtil::CompileShader(L"Shaders\\Sky.hlsl", nullptr, "PS", "ps_5_1");
+		{ "ssaoBlurVS", { L"Shaders\\SsaoBlur.hlsl", nullptr, "VS", "vs_5_1" } },
+		{ "ssaoBlurPS", { L"Shaders\\SsaoBlur.hlsl", nullptr, "PS", "ps_5_1" } },
+
+		{ "skyVS", { L"Shaders\\Sky.hlsl", nullptr, "VS", "vs_5_1" } },
+		{ "skyPS", { L"Shaders\\Sky.hlsl", nullptr, "PS", "ps_5_1" } },
+	};
+
+	std::vector<d3dUtil::ShaderDesc> descs;
+	for(const auto& shader : shaders)
+		descs.push_back(shader.Desc);
+
+	std::vector<ComPtr<ID3DBlob>> byteCode = d3dUtil::CompileShaders(descs);
+	for(size_t i = 0; i < descs.size(); ++i)
+		mShaders[shaders[i].Name] = byteCode[i];
 
     mInputLayout =
     {
@@ -1160,38 +1183,23 @@ void SsaoApp::BuildShapeGeometry()
 
 void SsaoApp::BuildSkullGeometry()
 {
-    std::ifstream fin("Models/skull.txt");
-
-    if (!fin)
+    MeshCache mesh;
+    if (!mesh.Load("Models/skull.txt"))
     {
         MessageBox(0, L"Models/skull.txt not found.", 0, 0);
         return;
     }
 
-    UINT vcount = 0;
-    UINT tcount = 0;
-    std::string ignore;
-
-    fin >> ignore >> vcount;
-    fin >> ignore >> tcount;
-    fin >> ignore >> ignore >> ignore >> ignore;
-
-    XMFLOAT3 vMinf3(+MathHelper::Infinity, +MathHelper::Infinity, +MathHelper::Infinity);
-    XMFLOAT3 vMaxf3(-MathHelper::Infinity, -MathHelper::Infinity, -MathHelper::Infinity);
-
-    XMVECTOR vMin = XMLoadFloat3(&vMinf3);
-    XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
+    const UINT vcount = mesh.VertexCount();
 
     std::vector<Vertex> vertices(vcount);
     for (UINT i = 0; i < vcount; ++i)
     {
-        fin >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
-        fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
+        vertices[i].Pos = mesh.Positions()[i];
+        vertices[i].Normal = mesh.Normals()[i];
 
         vertices[i].TexC = { 0.0f, 0.0f };
 
-        XMVECTOR P = XMLoadFloat3(&vertices[i].Pos);
-
         XMVECTOR N = XMLoadFloat3(&vertices[i].Normal);
 
         // Generate a tangent vector so normal mapping works.  We aren't applying
@@ -1209,27 +1217,11 @@ void SsaoApp::BuildSkullGeometry()
             XMVECTOR T = XMVector3Normalize(XMVector3Cross(N, up));
             XMStoreFloat3(&vertices[i].TangentU, T);
         }
-
-
-        vMin = XMVectorMin(vMin, P);
-        vMax = XMVectorMax(vMax, P);
     }
 
-    BoundingBox bounds;
-    XMStoreFloat3(&bounds.Center, 0.5f*(vMin + vMax));
-    XMStoreFloat3(&bounds.Extents, 0.5f*(vMax - vMin));
-
-    fin >> ignore;
-    fin >> ignore;
-    fin >> ignore;
-
-    std::vector<std::int32_t> indices(3 * tcount);
-    for (UINT i = 0; i < tcount; ++i)
-    {
-        fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
-    }
+    BoundingBox bounds = mesh.Bounds();
 
-    fin.close();
+    std::vector<std::int32_t> indices(mesh.Indices(), mesh.Indices() + mesh.IndexCount());
 
     //
     // Pack the indices of all the meshes into one index buffer.
@@ -1642,6 +1634,7 @@ void SsaoApp::BuildRenderItems()
 
 void SsaoApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+    PROFILE_FUNCTION();
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
  
 	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
@@ -1665,6 +1658,7 @@ void SsaoApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vec
 
 void SsaoApp::DrawSceneToShadowMap()
 {
+    PROFILE_FUNCTION();
     mCommandList->RSSetViewports(1, &mShadowMap->Viewport());
     mCommandList->RSSetScissorRects(1, &mShadowMap->ScissorRect());
 
@@ -1696,6 +1690,7 @@ void SsaoApp::DrawSceneToShadowMap()
  
 void SsaoApp::DrawNormalsAndDepth()
 {
+	PROFILE_FUNCTION();
 	mCommandList->RSSetViewports(1, &mScreenViewport);
     mCommandList->RSSetScissorRects(1, &mScissorRect);
 
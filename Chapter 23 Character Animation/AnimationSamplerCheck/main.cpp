@@ -0,0 +1,138 @@
+//***************************************************************************************
+// main.cpp
+//
+// Checks AnimationSampler against SkinnedData::GetFinalTransforms, the reference path,
+// on every clip of a skinned model.  Each clip is played forward at 60 Hz past its end,
+// backward to before its start, and at random times, with one set of key cursors kept
+// across the whole run as an instance would keep them.  Every palette entry must be
+// within 4e-5 of the reference.  The same runs are then repeated on the compressed clips.
+// Exits with 1 if a check fails.
+//
+// Usage: AnimationSamplerCheck [model.m3d]
+//***************************************************************************************
+
+#include "../SkinnedMesh/LoadM3d.h"
+#include "../SkinnedMesh/AnimationSampler.h"
+#include "../SkinnedMesh/AnimationCompression.h"
+#include "../../Common/CheckUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+const float Tolerance = 4e-5f;
+
+// Largest difference over every entry of count matrices.
+float MaxDifference(const XMFLOAT4X4* a, const XMFLOAT4X4* b, UINT count)
+{
+	float maxDiff = 0.0f;
+	for(UINT i = 0; i < count; ++i)
+	{
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+				maxDiff = std::max(maxDiff, std::fabs(a[i].m[r][c] - b[i].m[r][c]));
+		}
+	}
+	return maxDiff;
+}
+
+// Samples clip at each of times through one set of cursors and compares every palette
+// with the reference.
+void CheckPlayback(const SkinnedData& skinInfo, const AnimationSampler& sampler, UINT clip,
+	const std::vector<float>& times, const std::string& what)
+{
+	const UINT numBones = sampler.BoneCount();
+	const std::string& clipName = sampler.GetClipName(clip);
+
+	std::vector<UINT> keyCursors(numBones, 0);
+	std::vector<XMFLOAT4X4> scratch(numBones);
+	std::vector<XMFLOAT4X4> sampled(numBones);
+	std::vector<XMFLOAT4X4> reference(numBones);
+
+	float maxDiff = 0.0f;
+	float worstTime = 0.0f;
+	for(float t : times)
+	{
+		AnimationSampler::SampleRequest request;
+		request.Clip = clip;
+		request.TimePos = t;
+		request.KeyCursors = keyCursors.data();
+		request.FinalTransforms = sampled.data();
+		sampler.Sample(request, scratch.data());
+
+		skinInfo.GetFinalTransforms(clipName, t, reference);
+
+		float diff = MaxDifference(sampled.data(), reference.data(), numBones);
+		if(diff > maxDiff)
+		{
+			maxDiff = diff;
+			worstTime = t;
+		}
+	}
+
+	std::printf("%-44s max |diff| %.2e at t = %.4f\n", what.c_str(), maxDiff, worstTime);
+	Check(maxDiff <= Tolerance, what + ": exceeds the tolerance");
+}
+
+void CheckClips(const SkinnedData& skinInfo, const std::string& label)
+{
+	AnimationSampler sampler;
+	sampler.Build(skinInfo);
+
+	std::mt19937 rng(4);
+	for(UINT clip = 0; clip < sampler.ClipCount(); ++clip)
+	{
+		float start = sampler.GetClipStartTime(clip);
+		float end = sampler.GetClipEndTime(clip);
+		std::string name = label + " \"" + sampler.GetClipName(clip) + "\"";
+
+		// Both directions run a little past the keys to cover the clamping.
+		std::vector<float> forward, backward, random;
+		for(float t = start - 0.1f; t <= end + 0.1f; t += 1.0f / 60.0f)
+			forward.push_back(t);
+		backward.assign(forward.rbegin(), forward.rend());
+
+		std::uniform_real_distribution<float> anyTime(start - 0.1f, end + 0.1f);
+		for(int i = 0; i < 1000; ++i)
+			random.push_back(anyTime(rng));
+
+		CheckPlayback(skinInfo, sampler, clip, forward, name + " forward");
+		CheckPlayback(skinInfo, sampler, clip, backward, name + " backward");
+		CheckPlayback(skinInfo, sampler, clip, random, name + " random");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string m3dFilename = argc > 1 ? argv[1] : "../SkinnedMesh/Models/soldier.m3d";
+
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<std::uint32_t> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3dMaterial> mats;
+	SkinnedData skinInfo;
+
+	M3DLoader loader;
+	if(!loader.LoadM3d(m3dFilename, vertices, indices, subsets, mats, skinInfo))
+	{
+		std::printf("Could not load %s.\n", m3dFilename.c_str());
+		return 1;
+	}
+	if(skinInfo.Animations().empty())
+	{
+		std::printf("%s has no animation clips.\n", m3dFilename.c_str());
+		return 1;
+	}
+
+	std::printf("%s: %u bones\n", m3dFilename.c_str(), skinInfo.BoneCount());
+
+	CheckClips(skinInfo, "keyed");
+
+	CompressAnimations(skinInfo, AnimationCompressionSettings());
+	CheckClips(skinInfo, "compressed");
+
+	return CheckExitCode();
+}
@@ -0,0 +1,140 @@
+//***************************************************************************************
+// main.cpp
+//
+// Headless crowd animation benchmark.  Drives 1k-10k instances of a skinned model through
+// CrowdAnimator and reports the time per frame for each thread count.
+//
+// Usage: CrowdBench [model.m3d] [frames]
+//***************************************************************************************
+
+#include "../SkinnedMesh/LoadM3d.h"
+#include "../SkinnedMesh/CrowdAnimator.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace DirectX;
+
+typedef std::chrono::steady_clock Clock;
+
+struct FrameStats
+{
+	double MeanMs = 0.0;
+	double BestMs = 0.0;
+};
+
+// Adds instanceCount instances spread over the clip so they do not all sample the
+// same keys.
+void PopulateCrowd(CrowdAnimator& crowd, const AnimationSampler& sampler, UINT clip, UINT instanceCount)
+{
+	float clipLength = sampler.GetClipEndTime(clip);
+	for(UINT i = 0; i < instanceCount; ++i)
+		crowd.AddInstance(clip, clipLength * (float)i / (float)instanceCount);
+}
+
+FrameStats RunFrames(CrowdAnimator& crowd, std::vector<SkinnedConstants>& palettes, int frameCount)
+{
+	const float dt = 1.0f / 60.0f;
+
+	// Warm up caches and let the pool threads spin up.
+	for(int i = 0; i < 5; ++i)
+		crowd.Update(dt, palettes.data());
+
+	FrameStats stats;
+	stats.BestMs = 1e30;
+
+	double total = 0.0;
+	for(int i = 0; i < frameCount; ++i)
+	{
+		auto start = Clock::now();
+		crowd.Update(dt, palettes.data());
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		stats.BestMs = MathHelper::Min(stats.BestMs, ms);
+		total += ms;
+	}
+	stats.MeanMs = total / frameCount;
+
+	return stats;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string m3dFilename = argc > 1 ? argv[1] : "../SkinnedMesh/Models/soldier.m3d";
+	int frameCount = argc > 2 ? MathHelper::Max(1, std::atoi(argv[2])) : 60;
+
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<std::uint32_t> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3dMaterial> mats;
+	SkinnedData skinInfo;
+
+	M3DLoader loader;
+	if(!loader.LoadM3dCached(m3dFilename, vertices, indices, subsets, mats, skinInfo))
+	{
+		std::printf("Could not load %s.\n", m3dFilename.c_str());
+		return 1;
+	}
+
+	AnimationSampler sampler;
+	sampler.Build(skinInfo);
+	if(sampler.ClipCount() == 0)
+	{
+		std::printf("%s has no animation clips.\n", m3dFilename.c_str());
+		return 1;
+	}
+
+	const UINT clip = 0;
+	std::printf("%s: %u bones, clip \"%s\"\n", m3dFilename.c_str(), sampler.BoneCount(),
+		sampler.GetClipName(clip).c_str());
+
+	// Thread counts to compare: 1, 2, 4, ... and the hardware concurrency.
+	std::vector<UINT> threadCounts;
+	UINT hardwareThreads = MathHelper::Max(1u, std::thread::hardware_concurrency());
+	for(UINT n = 1; n < hardwareThreads; n *= 2)
+		threadCounts.push_back(n);
+	threadCounts.push_back(hardwareThreads);
+
+	const UINT instanceCounts[] = { 1000, 2500, 5000, 10000 };
+
+	std::printf("%9s %8s %12s %12s %9s\n", "instances", "threads", "mean ms", "best ms", "speedup");
+
+	for(UINT instanceCount : instanceCounts)
+	{
+		std::vector<SkinnedConstants> reference(instanceCount);
+		double serialMs = 0.0;
+
+		for(UINT threads : threadCounts)
+		{
+			// One thread means no pool; otherwise the calling thread joins threads-1 workers.
+			std::unique_ptr<ThreadPool> pool;
+			if(threads > 1)
+				pool = std::make_unique<ThreadPool>(threads - 1);
+
+			CrowdAnimator crowd(sampler, pool.get());
+			PopulateCrowd(crowd, sampler, clip, instanceCount);
+
+			std::vector<SkinnedConstants> palettes(instanceCount);
+			FrameStats stats = RunFrames(crowd, palettes, frameCount);
+
+			// Every run advances the same number of frames, so the palettes must agree
+			// with the single-threaded run bit for bit.
+			if(threads == 1)
+			{
+				reference = palettes;
+				serialMs = stats.MeanMs;
+			}
+			else if(std::memcmp(reference.data(), palettes.data(), instanceCount*sizeof(SkinnedConstants)) != 0)
+			{
+				std::printf("Mismatch between 1 and %u threads at %u instances.\n", threads, instanceCount);
+				return 1;
+			}
+
+			std::printf("%9u %8u %12.3f %12.3f %8.2fx\n", instanceCount, threads,
+				stats.MeanMs, stats.BestMs, serialMs / stats.MeanMs);
+		}
+	}
+
+	return 0;
+}
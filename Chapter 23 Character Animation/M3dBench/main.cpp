@@ -0,0 +1,222 @@
+//***************************************************************************************
+// main.cpp
+//
+// Converts a text .m3d model to .m3db, checks that both load to the same data, and times
+// the two loaders.  Then compresses the animation clips and reports their size and the
+// largest distance between vertices skinned with them and with the raw keys.
+//
+// Usage: M3dBench [model.m3d] [iterations]
+//***************************************************************************************
+
+#include "../SkinnedMesh/LoadM3d.h"
+#include "../SkinnedMesh/AnimationCompression.h"
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+struct ModelData
+{
+	std::vector<M3DLoader::SkinnedVertex> Vertices;
+	std::vector<std::uint32_t> Indices;
+	std::vector<M3DLoader::Subset> Subsets;
+	std::vector<M3DLoader::M3dMaterial> Mats;
+	SkinnedData SkinInfo;
+};
+
+template<typename T>
+bool SameBytes(const std::vector<T>& a, const std::vector<T>& b)
+{
+	return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size()*sizeof(T)) == 0);
+}
+
+bool SameModel(const ModelData& a, const ModelData& b)
+{
+	if(!SameBytes(a.Vertices, b.Vertices) || !SameBytes(a.Indices, b.Indices) ||
+	   !SameBytes(a.Subsets, b.Subsets) || a.Mats.size() != b.Mats.size())
+		return false;
+
+	for(size_t i = 0; i < a.Mats.size(); ++i)
+	{
+		const M3DLoader::M3dMaterial& ma = a.Mats[i];
+		const M3DLoader::M3dMaterial& mb = b.Mats[i];
+		if(ma.Name != mb.Name || ma.MaterialTypeName != mb.MaterialTypeName ||
+		   ma.DiffuseMapName != mb.DiffuseMapName || ma.NormalMapName != mb.NormalMapName ||
+		   ma.AlphaClip != mb.AlphaClip || ma.Roughness != mb.Roughness ||
+		   std::memcmp(&ma.DiffuseAlbedo, &mb.DiffuseAlbedo, sizeof(ma.DiffuseAlbedo)) != 0 ||
+		   std::memcmp(&ma.FresnelR0, &mb.FresnelR0, sizeof(ma.FresnelR0)) != 0)
+			return false;
+	}
+
+	if(a.SkinInfo.BoneHierarchy() != b.SkinInfo.BoneHierarchy() ||
+	   !SameBytes(a.SkinInfo.BoneOffsets(), b.SkinInfo.BoneOffsets()) ||
+	   a.SkinInfo.Animations().size() != b.SkinInfo.Animations().size())
+		return false;
+
+	for(const auto& clip : a.SkinInfo.Animations())
+	{
+		auto it = b.SkinInfo.Animations().find(clip.first);
+		if(it == b.SkinInfo.Animations().end() ||
+		   it->second.BoneAnimations.size() != clip.second.BoneAnimations.size())
+			return false;
+
+		for(size_t i = 0; i < clip.second.BoneAnimations.size(); ++i)
+		{
+			if(!SameBytes(clip.second.BoneAnimations[i].Keyframes, it->second.BoneAnimations[i].Keyframes))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+// Skins a vertex the way the vertex shader does.  finalTransforms are transposed, as
+// GetFinalTransforms writes them for the constant buffer.
+DirectX::XMVECTOR SkinPosition(const M3DLoader::SkinnedVertex& v, const std::vector<DirectX::XMFLOAT4X4>& finalTransforms)
+{
+	using namespace DirectX;
+
+	float weights[4] = { v.BoneWeights.x, v.BoneWeights.y, v.BoneWeights.z, 0.0f };
+	weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
+
+	XMVECTOR pos = XMLoadFloat3(&v.Pos);
+	XMVECTOR skinned = XMVectorZero();
+	for(int i = 0; i < 4; ++i)
+	{
+		XMMATRIX M = XMMatrixTranspose(XMLoadFloat4x4(&finalTransforms[v.BoneIndices[i]]));
+		skinned = XMVectorAdd(skinned, XMVectorScale(XMVector3TransformCoord(pos, M), weights[i]));
+	}
+
+	return skinned;
+}
+
+// Largest distance between the skinned vertices of clipName in a and b, sampled at 240
+// points over the clip.
+float MaxSkinnedError(const SkinnedData& a, const SkinnedData& b, const std::string& clipName,
+	const std::vector<M3DLoader::SkinnedVertex>& vertices)
+{
+	using namespace DirectX;
+
+	float startTime = a.GetClipStartTime(clipName);
+	float endTime = a.GetClipEndTime(clipName);
+
+	std::vector<XMFLOAT4X4> ta(a.BoneCount());
+	std::vector<XMFLOAT4X4> tb(b.BoneCount());
+
+	float maxError = 0.0f;
+	const int sampleCount = 240;
+	for(int i = 0; i <= sampleCount; ++i)
+	{
+		float t = startTime + (endTime - startTime) * (float)i / (float)sampleCount;
+		a.GetFinalTransforms(clipName, t, ta);
+		b.GetFinalTransforms(clipName, t, tb);
+
+		for(const M3DLoader::SkinnedVertex& v : vertices)
+		{
+			XMVECTOR diff = XMVectorSubtract(SkinPosition(v, ta), SkinPosition(v, tb));
+			maxError = MathHelper::Max(maxError, XMVectorGetX(XMVector3Length(diff)));
+		}
+	}
+
+	return maxError;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string m3dFilename = argc > 1 ? argv[1] : "../SkinnedMesh/Models/soldier.m3d";
+	int iterations = argc > 2 ? MathHelper::Max(1, std::atoi(argv[2])) : 10;
+	std::string m3dbFilename = m3dFilename + "b";
+
+	M3DLoader loader;
+	if(!loader.ConvertM3dToM3db(m3dFilename, m3dbFilename))
+	{
+		std::printf("Could not convert %s.\n", m3dFilename.c_str());
+		return 1;
+	}
+
+	ModelData text;
+	ModelData binary;
+	if(!loader.LoadM3d(m3dFilename, text.Vertices, text.Indices, text.Subsets, text.Mats, text.SkinInfo) ||
+	   !loader.LoadM3db(m3dbFilename, binary.Vertices, binary.Indices, binary.Subsets, binary.Mats, binary.SkinInfo))
+	{
+		std::printf("Could not load %s.\n", m3dFilename.c_str());
+		return 1;
+	}
+
+	if(!SameModel(text, binary))
+	{
+		std::printf("Round trip mismatch: %s and %s differ.\n", m3dFilename.c_str(), m3dbFilename.c_str());
+		return 1;
+	}
+
+	std::printf("%s: %u vertices, %u triangles, %u bones, %u clips\n", m3dFilename.c_str(),
+		(UINT)text.Vertices.size(), (UINT)text.Indices.size() / 3,
+		text.SkinInfo.BoneCount(), (UINT)text.SkinInfo.Animations().size());
+
+	typedef std::chrono::steady_clock Clock;
+
+	auto timeLoads = [&](bool useBinary)
+	{
+		double best = 1e30;
+		double total = 0.0;
+		for(int i = 0; i < iterations; ++i)
+		{
+			ModelData model;
+			auto start = Clock::now();
+			if(useBinary)
+				loader.LoadM3db(m3dbFilename, model.Vertices, model.Indices, model.Subsets, model.Mats, model.SkinInfo);
+			else
+				loader.LoadM3d(m3dFilename, model.Vertices, model.Indices, model.Subsets, model.Mats, model.SkinInfo);
+			double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			best = MathHelper::Min(best, ms);
+			total += ms;
+		}
+
+		std::printf("%-6s best %8.2f ms   mean %8.2f ms\n", useBinary ? ".m3db" : ".m3d", best, total / iterations);
+		return best;
+	};
+
+	double textMs = timeLoads(false);
+	double binaryMs = timeLoads(true);
+
+	std::printf("speedup %.1fx over %d iterations\n", textMs / binaryMs, iterations);
+
+	//
+	// Animation compression.  The compressed clips also go through .m3db and must come
+	// back bit for bit.
+	//
+
+	ModelData compressed;
+	loader.LoadM3d(m3dFilename, compressed.Vertices, compressed.Indices, compressed.Subsets, compressed.Mats, compressed.SkinInfo);
+	CompressAnimations(compressed.SkinInfo, AnimationCompressionSettings());
+
+	std::string compressedFilename = m3dFilename + "b.compressed";
+	ModelData reloaded;
+	if(!loader.SaveM3db(compressedFilename, compressed.Vertices, compressed.Indices, compressed.Subsets, compressed.Mats, compressed.SkinInfo) ||
+	   !loader.LoadM3db(compressedFilename, reloaded.Vertices, reloaded.Indices, reloaded.Subsets, reloaded.Mats, reloaded.SkinInfo))
+	{
+		std::printf("Could not round trip the compressed clips through %s.\n", compressedFilename.c_str());
+		return 1;
+	}
+
+	for(const auto& clip : text.SkinInfo.Animations())
+	{
+		const AnimationClip& packed = compressed.SkinInfo.Animations().at(clip.first);
+		size_t rawBytes = AnimationClipByteSize(clip.second);
+		size_t packedBytes = AnimationClipByteSize(packed);
+
+		if(MaxSkinnedError(compressed.SkinInfo, reloaded.SkinInfo, clip.first, text.Vertices) != 0.0f)
+		{
+			std::printf("Compressed clip \"%s\" changed through %s.\n", clip.first.c_str(), compressedFilename.c_str());
+			return 1;
+		}
+
+		std::printf("clip \"%s\": %u -> %u bytes (%.1fx), max vertex error %g\n",
+			clip.first.c_str(), (UINT)rawBytes, (UINT)packedBytes, (double)rawBytes / (double)packedBytes,
+			MaxSkinnedError(text.SkinInfo, compressed.SkinInfo, clip.first, text.Vertices));
+	}
+
+	return 0;
+}
@@ -0,0 +1,382 @@
+//***************************************************************************************
+// AnimationCompression.cpp
+//***************************************************************************************
+
+#include "AnimationCompression.h"
+#include "AnimationSampler.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// The three smallest components of a unit quaternion lie in [-1/sqrt(2), 1/sqrt(2)].
+	const float Sqrt2 = 1.41421356f;
+	const float QuantizeMax = 32767.0f;
+
+	float Distance(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&a), XMLoadFloat3(&b))));
+	}
+
+	float MaxDifference(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return MathHelper::Max(fabsf(a.x - b.x), MathHelper::Max(fabsf(a.y - b.y), fabsf(a.z - b.z)));
+	}
+
+	// Angle of the rotation taking a to b; q and -q are the same rotation.  Computed from
+	// the chord between the quaternions, since acos of their dot product cannot resolve
+	// angles much below 1e-3 in single precision.
+	float AngleBetween(FXMVECTOR a, FXMVECTOR b)
+	{
+		XMVECTOR na = XMQuaternionNormalize(a);
+		XMVECTOR nb = XMQuaternionNormalize(b);
+		float chord = MathHelper::Min(
+			XMVectorGetX(XMVector4Length(XMVectorSubtract(na, nb))),
+			XMVectorGetX(XMVector4Length(XMVectorAdd(na, nb))));
+		return 4.0f*asinf(MathHelper::Min(0.5f*chord, 1.0f));
+	}
+
+	XMFLOAT3 Lerp(const XMFLOAT3& a, const XMFLOAT3& b, float t)
+	{
+		XMFLOAT3 r;
+		XMStoreFloat3(&r, XMVectorLerp(XMLoadFloat3(&a), XMLoadFloat3(&b), t));
+		return r;
+	}
+
+	// Source keys of one bone plus the rotations as they will decode, so the error checks
+	// include the quantization error.
+	struct BoneSource
+	{
+		const std::vector<Keyframe>* Keys;
+		std::vector<XMFLOAT4> Rotations;
+		std::uint32_t Animated;
+		float MaxRotationError;
+	};
+
+	// True if interpolating between keys a and b reproduces every source key between them
+	// within the error bounds, for every animated channel.
+	bool SegmentFits(const BoneSource& bone, UINT a, UINT b, const AnimationCompressionSettings& settings)
+	{
+		const std::vector<Keyframe>& keys = *bone.Keys;
+		const float span = keys[b].TimePos - keys[a].TimePos;
+
+		for(UINT k = a + 1; k < b; ++k)
+		{
+			float t = span > 0.0f ? (keys[k].TimePos - keys[a].TimePos) / span : 0.0f;
+
+			if((bone.Animated & CompressedClip::AnimatedTranslation) &&
+			   Distance(Lerp(keys[a].Translation, keys[b].Translation, t), keys[k].Translation) > settings.MaxTranslationError)
+				return false;
+
+			if((bone.Animated & CompressedClip::AnimatedScale) &&
+			   MaxDifference(Lerp(keys[a].Scale, keys[b].Scale, t), keys[k].Scale) > settings.MaxScaleError)
+				return false;
+
+			if(bone.Animated & CompressedClip::AnimatedRotation)
+			{
+				XMVECTOR q = XMQuaternionSlerp(XMLoadFloat4(&bone.Rotations[a]), XMLoadFloat4(&bone.Rotations[b]), t);
+				if(AngleBetween(q, XMLoadFloat4(&keys[k].RotationQuat)) > bone.MaxRotationError)
+					return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+PackedQuaternion PackQuaternion(const XMFLOAT4& q)
+{
+	XMFLOAT4 n;
+	XMStoreFloat4(&n, XMQuaternionNormalize(XMLoadFloat4(&q)));
+	float c[4] = { n.x, n.y, n.z, n.w };
+
+	UINT largest = 0;
+	for(UINT i = 1; i < 4; ++i)
+	{
+		if(fabsf(c[i]) > fabsf(c[largest]))
+			largest = i;
+	}
+
+	// q and -q are the same rotation; flip so the dropped component is positive and can
+	// be rebuilt as +sqrt(1 - a^2 - b^2 - c^2).
+	float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+
+	std::uint64_t bits = (std::uint64_t)largest << 45;
+	UINT shift = 30;
+	for(UINT i = 0; i < 4; ++i)
+	{
+		if(i == largest)
+			continue;
+
+		float v = MathHelper::Clamp(sign*c[i] / Sqrt2 + 0.5f, 0.0f, 1.0f);
+		bits |= (std::uint64_t)(v*QuantizeMax + 0.5f) << shift;
+		shift -= 15;
+	}
+
+	PackedQuaternion p;
+	p.Bits[0] = (std::uint16_t)(bits >> 32);
+	p.Bits[1] = (std::uint16_t)(bits >> 16);
+	p.Bits[2] = (std::uint16_t)bits;
+	return p;
+}
+
+XMFLOAT4 UnpackQuaternion(const PackedQuaternion& p)
+{
+	std::uint64_t bits = ((std::uint64_t)p.Bits[0] << 32) | ((std::uint64_t)p.Bits[1] << 16) | p.Bits[2];
+	UINT largest = (UINT)(bits >> 45) & 3;
+
+	float c[4];
+	float sumSq = 0.0f;
+	UINT shift = 30;
+	for(UINT i = 0; i < 4; ++i)
+	{
+		if(i == largest)
+			continue;
+
+		float v = (float)((bits >> shift) & 0x7fff) / QuantizeMax;
+		c[i] = (v - 0.5f) * Sqrt2;
+		sumSq += c[i]*c[i];
+		shift -= 15;
+	}
+	c[largest] = sqrtf(MathHelper::Max(0.0f, 1.0f - sumSq));
+
+	return XMFLOAT4(c[0], c[1], c[2], c[3]);
+}
+
+float CompressedClip::DecodeKeys(UINT bone, float t, UINT& cursor, Keyframe& key0, Keyframe& key1)const
+{
+	const BoneTrack& track = Tracks[bone];
+	const float* times = &Times[track.FirstKey];
+
+	UINT k0, k1;
+	float alpha = AnimationSampler::LocateKey(times, track.KeyCount, t, cursor, k0, k1);
+
+	key0.TimePos = times[k0];
+	key1.TimePos = times[k1];
+
+	// Constant channels always read their single value.
+	UINT t0 = 0, t1 = 0, r0 = 0, r1 = 0, s0 = 0, s1 = 0;
+	if(track.AnimatedChannels & AnimatedTranslation) { t0 = k0; t1 = k1; }
+	if(track.AnimatedChannels & AnimatedRotation)    { r0 = k0; r1 = k1; }
+	if(track.AnimatedChannels & AnimatedScale)       { s0 = k0; s1 = k1; }
+
+	key0.Translation = Translations[track.Translation + t0];
+	key1.Translation = Translations[track.Translation + t1];
+	key0.RotationQuat = UnpackQuaternion(Rotations[track.Rotation + r0]);
+	key1.RotationQuat = r1 == r0 ? key0.RotationQuat : UnpackQuaternion(Rotations[track.Rotation + r1]);
+	key0.Scale = Scales[track.Scale + s0];
+	key1.Scale = Scales[track.Scale + s1];
+
+	return alpha;
+}
+
+void CompressedClip::Interpolate(float t, std::vector<XMFLOAT4X4>& boneTransforms)const
+{
+	XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for(UINT i = 0; i < (UINT)Tracks.size(); ++i)
+	{
+		Keyframe key0, key1;
+		UINT cursor = 0;
+		float lerpPercent = DecodeKeys(i, t, cursor, key0, key1);
+
+		XMVECTOR S = XMVectorLerp(XMLoadFloat3(&key0.Scale), XMLoadFloat3(&key1.Scale), lerpPercent);
+		XMVECTOR P = XMVectorLerp(XMLoadFloat3(&key0.Translation), XMLoadFloat3(&key1.Translation), lerpPercent);
+		XMVECTOR Q = XMQuaternionSlerp(XMLoadFloat4(&key0.RotationQuat), XMLoadFloat4(&key1.RotationQuat), lerpPercent);
+
+		XMStoreFloat4x4(&boneTransforms[i], XMMatrixAffineTransformation(S, zero, Q, P));
+	}
+}
+
+bool CompressedClip::IsValid(UINT numBones)const
+{
+	if(Tracks.size() != numBones)
+		return false;
+
+	for(const BoneTrack& track : Tracks)
+	{
+		const std::uint64_t count = track.KeyCount;
+		if(count == 0 || track.FirstKey + count > Times.size())
+			return false;
+
+		auto fits = [&track, count](std::uint32_t channel, std::uint32_t first, size_t size)
+		{
+			std::uint64_t values = (track.AnimatedChannels & channel) ? count : 1;
+			return first + values <= size;
+		};
+
+		if(!fits(AnimatedTranslation, track.Translation, Translations.size()) ||
+		   !fits(AnimatedRotation, track.Rotation, Rotations.size()) ||
+		   !fits(AnimatedScale, track.Scale, Scales.size()))
+			return false;
+
+		for(UINT k = 1; k < track.KeyCount; ++k)
+		{
+			if(Times[track.FirstKey + k] < Times[track.FirstKey + k - 1])
+				return false;
+		}
+	}
+
+	return true;
+}
+
+size_t CompressedClip::ByteSize()const
+{
+	return sizeof(CompressedClip) +
+		Tracks.size()*sizeof(BoneTrack) +
+		Times.size()*sizeof(float) +
+		Translations.size()*sizeof(XMFLOAT3) +
+		Rotations.size()*sizeof(PackedQuaternion) +
+		Scales.size()*sizeof(XMFLOAT3);
+}
+
+std::shared_ptr<const CompressedClip> CompressAnimationClip(
+	const AnimationClip& clip, const AnimationCompressionSettings& settings,
+	const std::vector<int>* boneHierarchy)
+{
+	// Farthest any joint below each bone gets from it during the clip.  Parents come
+	// before their children, so one pass from the leaves up covers every chain.
+	std::vector<float> reach;
+	if(boneHierarchy && boneHierarchy->size() == clip.BoneAnimations.size())
+	{
+		reach.assign(boneHierarchy->size(), 0.0f);
+		for(UINT b = (UINT)reach.size(); b-- > 1; )
+		{
+			int parent = (*boneHierarchy)[b];
+			if(parent < 0)
+				continue;
+
+			float length = 0.0f;
+			for(const Keyframe& key : clip.BoneAnimations[b].Keyframes)
+				length = MathHelper::Max(length, XMVectorGetX(XMVector3Length(XMLoadFloat3(&key.Translation))));
+
+			reach[parent] = MathHelper::Max(reach[parent], length + reach[b]);
+		}
+	}
+
+	auto compressed = std::make_shared<CompressedClip>();
+	compressed->StartTime = clip.GetClipStartTime();
+	compressed->EndTime = clip.GetClipEndTime();
+	compressed->Tracks.resize(clip.BoneAnimations.size());
+
+	for(UINT b = 0; b < (UINT)clip.BoneAnimations.size(); ++b)
+	{
+		const std::vector<Keyframe>& keys = clip.BoneAnimations[b].Keyframes;
+		CompressedClip::BoneTrack& track = compressed->Tracks[b];
+
+		if(keys.empty())
+		{
+			Keyframe identity;
+			track.FirstKey = (std::uint32_t)compressed->Times.size();
+			track.KeyCount = 1;
+			track.Translation = (std::uint32_t)compressed->Translations.size();
+			track.Rotation = (std::uint32_t)compressed->Rotations.size();
+			track.Scale = (std::uint32_t)compressed->Scales.size();
+			compressed->Times.push_back(identity.TimePos);
+			compressed->Translations.push_back(identity.Translation);
+			compressed->Rotations.push_back(PackQuaternion(identity.RotationQuat));
+			compressed->Scales.push_back(identity.Scale);
+			continue;
+		}
+
+		const UINT n = (UINT)keys.size();
+
+		BoneSource source;
+		source.Keys = &keys;
+		source.Rotations.resize(n);
+		source.Animated = 0;
+		source.MaxRotationError = settings.MaxRotationError;
+
+		// An angle error moves every joint below the bone by up to angle*distance, so
+		// bones with long chains below them need a tighter angle.
+		if(b < reach.size() && reach[b] > 0.0f)
+			source.MaxRotationError = MathHelper::Min(source.MaxRotationError, settings.MaxTranslationError / reach[b]);
+
+		for(UINT k = 0; k < n; ++k)
+		{
+			source.Rotations[k] = UnpackQuaternion(PackQuaternion(keys[k].RotationQuat));
+
+			// A channel is constant if the first key stands in for every other one.
+			if(Distance(keys[k].Translation, keys[0].Translation) > settings.MaxTranslationError)
+				source.Animated |= CompressedClip::AnimatedTranslation;
+			if(AngleBetween(XMLoadFloat4(&keys[k].RotationQuat), XMLoadFloat4(&source.Rotations[0])) > source.MaxRotationError)
+				source.Animated |= CompressedClip::AnimatedRotation;
+			if(MaxDifference(keys[k].Scale, keys[0].Scale) > settings.MaxScaleError)
+				source.Animated |= CompressedClip::AnimatedScale;
+		}
+
+		// Greedy key reduction: from each kept key, reach as far as the animated channels
+		// can be interpolated within the error bounds, and keep the key where that stops.
+		std::vector<UINT> kept(1, 0);
+		if(source.Animated != 0 && n > 1)
+		{
+			UINT anchor = 0;
+			for(UINT k = 2; k < n; ++k)
+			{
+				if(!SegmentFits(source, anchor, k, settings))
+				{
+					anchor = k - 1;
+					kept.push_back(anchor);
+				}
+			}
+			kept.push_back(n - 1);
+		}
+
+		track.FirstKey = (std::uint32_t)compressed->Times.size();
+		track.KeyCount = (std::uint32_t)kept.size();
+		track.AnimatedChannels = source.Animated;
+		track.Translation = (std::uint32_t)compressed->Translations.size();
+		track.Rotation = (std::uint32_t)compressed->Rotations.size();
+		track.Scale = (std::uint32_t)compressed->Scales.size();
+
+		for(UINT k : kept)
+			compressed->Times.push_back(keys[k].TimePos);
+
+		for(UINT i = 0; i < (UINT)kept.size(); ++i)
+		{
+			const Keyframe& key = keys[kept[i]];
+
+			if(i == 0 || (source.Animated & CompressedClip::AnimatedTranslation))
+				compressed->Translations.push_back(key.Translation);
+			if(i == 0 || (source.Animated & CompressedClip::AnimatedRotation))
+				compressed->Rotations.push_back(PackQuaternion(key.RotationQuat));
+			if(i == 0 || (source.Animated & CompressedClip::AnimatedScale))
+				compressed->Scales.push_back(key.Scale);
+		}
+	}
+
+	return compressed;
+}
+
+void CompressAnimations(SkinnedData& skinInfo, const AnimationCompressionSettings& settings)
+{
+	std::vector<int> boneHierarchy = skinInfo.BoneHierarchy();
+	std::vector<XMFLOAT4X4> boneOffsets = skinInfo.BoneOffsets();
+	std::unordered_map<std::string, AnimationClip> animations = skinInfo.Animations();
+
+	for(auto& entry : animations)
+	{
+		AnimationClip& clip = entry.second;
+		if(clip.Compressed)
+			continue;
+
+		clip.Compressed = CompressAnimationClip(clip, settings, &boneHierarchy);
+
+		// Release the raw keys rather than just clearing them.
+		std::vector<BoneAnimation>().swap(clip.BoneAnimations);
+	}
+
+	skinInfo.Set(boneHierarchy, boneOffsets, animations);
+}
+
+size_t AnimationClipByteSize(const AnimationClip& clip)
+{
+	if(clip.Compressed)
+		return clip.Compressed->ByteSize();
+
+	size_t bytes = sizeof(AnimationClip) + clip.BoneAnimations.size()*sizeof(BoneAnimation);
+	for(const BoneAnimation& bone : clip.BoneAnimations)
+		bytes += bone.Keyframes.size()*sizeof(Keyframe);
+
+	return bytes;
+}
@@ -0,0 +1,97 @@
+//***************************************************************************************
+// AnimationCompression.h
+//
+// Lossy compression of AnimationClip keyframes:
+//   - channels (translation, rotation, scale) that never change beyond the error bound
+//     are stored as a single value instead of one per key,
+//   - keys that the remaining channels can reproduce by interpolating their neighbours
+//     within the error bound are removed,
+//   - rotations are quantized to 48 bits ("smallest three": the largest component is
+//     dropped and rebuilt from the unit length, the other three get 15 bits each).
+// A compressed clip replaces the raw keyframes of its AnimationClip; AnimationClip::
+// Interpolate and AnimationSampler decode it on the fly.
+//***************************************************************************************
+
+#pragma once
+
+#include "SkinnedData.h"
+
+struct AnimationCompressionSettings
+{
+	// Largest error allowed at any source key, in model units for translation and
+	// scale and in radians for rotation.  When the bone hierarchy is known, a bone's
+	// rotation is also held to moving the joints below it by at most MaxTranslationError.
+	float MaxTranslationError = 0.0005f;
+	float MaxRotationError = 0.001f;
+	float MaxScaleError = 0.0001f;
+};
+
+struct PackedQuaternion
+{
+	// Bits 45-46: index of the dropped component.  Bits 0-44: the other three
+	// components, 15 bits each, in [-1/sqrt(2), 1/sqrt(2)].
+	std::uint16_t Bits[3];
+};
+
+PackedQuaternion PackQuaternion(const DirectX::XMFLOAT4& q);
+DirectX::XMFLOAT4 UnpackQuaternion(const PackedQuaternion& p);
+
+struct CompressedClip
+{
+	enum AnimatedChannel : std::uint32_t
+	{
+		AnimatedTranslation = 1,
+		AnimatedRotation = 2,
+		AnimatedScale = 4
+	};
+
+	struct BoneTrack
+	{
+		// Keys of this bone are Times[FirstKey, FirstKey + KeyCount).
+		std::uint32_t FirstKey = 0;
+		std::uint32_t KeyCount = 0;
+
+		// First value of each channel.  An animated channel has KeyCount values from
+		// there, a constant channel just one.
+		std::uint32_t Translation = 0;
+		std::uint32_t Rotation = 0;
+		std::uint32_t Scale = 0;
+
+		std::uint32_t AnimatedChannels = 0;
+	};
+
+	float StartTime = 0.0f;
+	float EndTime = 0.0f;
+
+	std::vector<BoneTrack> Tracks;
+	std::vector<float> Times;
+	std::vector<DirectX::XMFLOAT3> Translations;
+	std::vector<PackedQuaternion> Rotations;
+	std::vector<DirectX::XMFLOAT3> Scales;
+
+	// Decodes the two keys of bone that bracket t and returns the blend factor between
+	// them.  cursor caches the key interval between calls, as in AnimationSampler.
+	float DecodeKeys(UINT bone, float t, UINT& cursor, Keyframe& key0, Keyframe& key1)const;
+
+	// Same result as AnimationClip::Interpolate on the source clip, within the error bound.
+	void Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& boneTransforms)const;
+
+	// Checks that every track indexes inside the arrays and that key times do not go
+	// backwards.  Used on data read from disk.
+	bool IsValid(UINT numBones)const;
+
+	size_t ByteSize()const;
+};
+
+// Compresses one clip.  The source clip is not modified.  boneHierarchy, if given,
+// scales each bone's rotation error by the length of the chains below it.
+std::shared_ptr<const CompressedClip> CompressAnimationClip(
+	const AnimationClip& clip, const AnimationCompressionSettings& settings,
+	const std::vector<int>* boneHierarchy = nullptr);
+
+// Replaces every uncompressed clip of skinInfo with its compressed form and frees the
+// raw keyframes.
+void CompressAnimations(SkinnedData& skinInfo, const AnimationCompressionSettings& settings);
+
+// Bytes taken by the keyframes of clip, whichever form it is in.
+size_t AnimationClipByteSize(const AnimationClip& clip);
@@ -0,0 +1,279 @@
+//***************************************************************************************
+// AnimationSampler.cpp
+//***************************************************************************************
+
+#include "AnimationSampler.h"
+#include "AnimationCompression.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Lane layout of the gathered keys: translation xyz, rotation xyzw, scale xyz.
+	enum KeyChannel
+	{
+		ChTx = 0, ChTy, ChTz,
+		ChQx, ChQy, ChQz, ChQw,
+		ChSx, ChSy, ChSz,
+		ChCount
+	};
+
+	inline void StoreKey(float (&keys)[ChCount][4], UINT lane,
+		const XMFLOAT3& translation, const XMFLOAT4& rotation, const XMFLOAT3& scale)
+	{
+		keys[ChTx][lane] = translation.x;
+		keys[ChTy][lane] = translation.y;
+		keys[ChTz][lane] = translation.z;
+		keys[ChQx][lane] = rotation.x;
+		keys[ChQy][lane] = rotation.y;
+		keys[ChQz][lane] = rotation.z;
+		keys[ChQw][lane] = rotation.w;
+		keys[ChSx][lane] = scale.x;
+		keys[ChSy][lane] = scale.y;
+		keys[ChSz][lane] = scale.z;
+	}
+
+	inline XMVECTOR LoadLanes(const float* lanes)
+	{
+		return XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(lanes));
+	}
+}
+
+void AnimationSampler::Build(const SkinnedData& skinInfo)
+{
+	mBoneHierarchy = skinInfo.BoneHierarchy();
+	mBoneOffsets = skinInfo.BoneOffsets();
+	mClips.clear();
+
+	const UINT numBones = BoneCount();
+
+	for(const auto& entry : skinInfo.Animations())
+	{
+		const AnimationClip& clip = entry.second;
+
+		CompiledClip compiled;
+		compiled.Name = entry.first;
+		compiled.StartTime = clip.GetClipStartTime();
+		compiled.EndTime = clip.GetClipEndTime();
+
+		if(clip.Compressed)
+		{
+			compiled.Compressed = clip.Compressed;
+			mClips.push_back(std::move(compiled));
+			continue;
+		}
+
+		compiled.KeyOffsets.resize(numBones + 1);
+
+		for(UINT i = 0; i < numBones; ++i)
+		{
+			compiled.KeyOffsets[i] = (UINT)compiled.Times.size();
+
+			if(i >= clip.BoneAnimations.size() || clip.BoneAnimations[i].Keyframes.empty())
+			{
+				Keyframe identity;
+				compiled.Times.push_back(identity.TimePos);
+				compiled.Translations.push_back(identity.Translation);
+				compiled.Rotations.push_back(identity.RotationQuat);
+				compiled.Scales.push_back(identity.Scale);
+				continue;
+			}
+
+			for(const Keyframe& key : clip.BoneAnimations[i].Keyframes)
+			{
+				compiled.Times.push_back(key.TimePos);
+				compiled.Translations.push_back(key.Translation);
+				compiled.Rotations.push_back(key.RotationQuat);
+				compiled.Scales.push_back(key.Scale);
+			}
+		}
+		compiled.KeyOffsets[numBones] = (UINT)compiled.Times.size();
+
+		mClips.push_back(std::move(compiled));
+	}
+
+	// Give handles a stable order rather than the hash map's.
+	std::sort(mClips.begin(), mClips.end(),
+		[](const CompiledClip& a, const CompiledClip& b) { return a.Name < b.Name; });
+}
+
+UINT AnimationSampler::FindClip(const std::string& clipName)const
+{
+	for(UINT i = 0; i < (UINT)mClips.size(); ++i)
+	{
+		if(mClips[i].Name == clipName)
+			return i;
+	}
+
+	return InvalidClip;
+}
+
+void AnimationSampler::SampleLocalPose(UINT clip, float timePos, UINT* keyCursors, XMFLOAT4X4* toParent)const
+{
+	const CompiledClip& c = mClips[clip];
+	const UINT numBones = BoneCount();
+
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR two = XMVectorReplicate(2.0f);
+	const XMVECTOR oneMinusEpsilon = XMVectorReplicate(1.0f - 0.00001f);
+
+	// Bones are processed four at a time: lane j of every vector below belongs to bone
+	// first+j, so the lerps, the slerp and the matrix build each run once per group.
+	for(UINT first = 0; first < numBones; first += 4)
+	{
+		const UINT lanes = MathHelper::Min(4u, numBones - first);
+
+		alignas(16) float keys0[ChCount][4];
+		alignas(16) float keys1[ChCount][4];
+		alignas(16) float alpha[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+		if(c.Compressed)
+		{
+			for(UINT j = 0; j < lanes; ++j)
+			{
+				Keyframe key0, key1;
+				alpha[j] = c.Compressed->DecodeKeys(first + j, timePos, keyCursors[first + j], key0, key1);
+
+				StoreKey(keys0, j, key0.Translation, key0.RotationQuat, key0.Scale);
+				StoreKey(keys1, j, key1.Translation, key1.RotationQuat, key1.Scale);
+			}
+		}
+		else
+		{
+			for(UINT j = 0; j < lanes; ++j)
+			{
+				const UINT bone = first + j;
+				const UINT offset = c.KeyOffsets[bone];
+				const UINT count = c.KeyOffsets[bone+1] - offset;
+
+				UINT k0, k1;
+				alpha[j] = LocateKey(&c.Times[offset], count, timePos, keyCursors[bone], k0, k1);
+
+				StoreKey(keys0, j, c.Translations[offset+k0], c.Rotations[offset+k0], c.Scales[offset+k0]);
+				StoreKey(keys1, j, c.Translations[offset+k1], c.Rotations[offset+k1], c.Scales[offset+k1]);
+			}
+		}
+
+		// Unused lanes of the last group hold identity keys.
+		for(UINT j = lanes; j < 4; ++j)
+		{
+			Keyframe identity;
+			StoreKey(keys0, j, identity.Translation, identity.RotationQuat, identity.Scale);
+			StoreKey(keys1, j, identity.Translation, identity.RotationQuat, identity.Scale);
+		}
+
+		XMVECTOR t = LoadLanes(alpha);
+
+		XMVECTOR tx = XMVectorLerpV(LoadLanes(keys0[ChTx]), LoadLanes(keys1[ChTx]), t);
+		XMVECTOR ty = XMVectorLerpV(LoadLanes(keys0[ChTy]), LoadLanes(keys1[ChTy]), t);
+		XMVECTOR tz = XMVectorLerpV(LoadLanes(keys0[ChTz]), LoadLanes(keys1[ChTz]), t);
+
+		XMVECTOR sx = XMVectorLerpV(LoadLanes(keys0[ChSx]), LoadLanes(keys1[ChSx]), t);
+		XMVECTOR sy = XMVectorLerpV(LoadLanes(keys0[ChSy]), LoadLanes(keys1[ChSy]), t);
+		XMVECTOR sz = XMVectorLerpV(LoadLanes(keys0[ChSz]), LoadLanes(keys1[ChSz]), t);
+
+		//
+		// Slerp, written out per component so it runs on four quaternions at once.  Same
+		// steps as XMQuaternionSlerpV: take the shorter arc and fall back to a lerp when
+		// the quaternions are nearly equal.
+		//
+
+		XMVECTOR q0x = LoadLanes(keys0[ChQx]);
+		XMVECTOR q0y = LoadLanes(keys0[ChQy]);
+		XMVECTOR q0z = LoadLanes(keys0[ChQz]);
+		XMVECTOR q0w = LoadLanes(keys0[ChQw]);
+		XMVECTOR q1x = LoadLanes(keys1[ChQx]);
+		XMVECTOR q1y = LoadLanes(keys1[ChQy]);
+		XMVECTOR q1z = LoadLanes(keys1[ChQz]);
+		XMVECTOR q1w = LoadLanes(keys1[ChQw]);
+
+		XMVECTOR cosOmega = XMVectorMultiply(q0x, q1x);
+		cosOmega = XMVectorMultiplyAdd(q0y, q1y, cosOmega);
+		cosOmega = XMVectorMultiplyAdd(q0z, q1z, cosOmega);
+		cosOmega = XMVectorMultiplyAdd(q0w, q1w, cosOmega);
+
+		XMVECTOR sign = XMVectorSelect(one, XMVectorNegate(one), XMVectorLess(cosOmega, zero));
+		cosOmega = XMVectorMultiply(cosOmega, sign);
+
+		XMVECTOR useSlerp = XMVectorLess(cosOmega, oneMinusEpsilon);
+
+		XMVECTOR sinOmega = XMVectorSqrt(XMVectorNegativeMultiplySubtract(cosOmega, cosOmega, one));
+		XMVECTOR omega = XMVectorATan2(sinOmega, cosOmega);
+		XMVECTOR invSinOmega = XMVectorReciprocal(sinOmega);
+
+		XMVECTOR oneMinusT = XMVectorSubtract(one, t);
+		XMVECTOR w0 = XMVectorSelect(oneMinusT, XMVectorMultiply(XMVectorSin(XMVectorMultiply(oneMinusT, omega)), invSinOmega), useSlerp);
+		XMVECTOR w1 = XMVectorSelect(t, XMVectorMultiply(XMVectorSin(XMVectorMultiply(t, omega)), invSinOmega), useSlerp);
+		w1 = XMVectorMultiply(w1, sign);
+
+		XMVECTOR qx = XMVectorMultiplyAdd(q1x, w1, XMVectorMultiply(q0x, w0));
+		XMVECTOR qy = XMVectorMultiplyAdd(q1y, w1, XMVectorMultiply(q0y, w0));
+		XMVECTOR qz = XMVectorMultiplyAdd(q1z, w1, XMVectorMultiply(q0z, w0));
+		XMVECTOR qw = XMVectorMultiplyAdd(q1w, w1, XMVectorMultiply(q0w, w0));
+
+		//
+		// Scale * RotationQuaternion * Translation, as XMMatrixAffineTransformation builds
+		// it with a zero rotation origin.
+		//
+
+		XMVECTOR xx = XMVectorMultiply(qx, qx), yy = XMVectorMultiply(qy, qy), zz = XMVectorMultiply(qz, qz);
+		XMVECTOR xy = XMVectorMultiply(qx, qy), xz = XMVectorMultiply(qx, qz), yz = XMVectorMultiply(qy, qz);
+		XMVECTOR xw = XMVectorMultiply(qx, qw), yw = XMVectorMultiply(qy, qw), zw = XMVectorMultiply(qz, qw);
+
+		alignas(16) float m[12][4];
+		XMStoreFloat4A((XMFLOAT4A*)m[0], XMVectorMultiply(sx, XMVectorNegativeMultiplySubtract(two, XMVectorAdd(yy, zz), one)));
+		XMStoreFloat4A((XMFLOAT4A*)m[1], XMVectorMultiply(sx, XMVectorMultiply(two, XMVectorAdd(xy, zw))));
+		XMStoreFloat4A((XMFLOAT4A*)m[2], XMVectorMultiply(sx, XMVectorMultiply(two, XMVectorSubtract(xz, yw))));
+		XMStoreFloat4A((XMFLOAT4A*)m[3], XMVectorMultiply(sy, XMVectorMultiply(two, XMVectorSubtract(xy, zw))));
+		XMStoreFloat4A((XMFLOAT4A*)m[4], XMVectorMultiply(sy, XMVectorNegativeMultiplySubtract(two, XMVectorAdd(xx, zz), one)));
+		XMStoreFloat4A((XMFLOAT4A*)m[5], XMVectorMultiply(sy, XMVectorMultiply(two, XMVectorAdd(yz, xw))));
+		XMStoreFloat4A((XMFLOAT4A*)m[6], XMVectorMultiply(sz, XMVectorMultiply(two, XMVectorAdd(xz, yw))));
+		XMStoreFloat4A((XMFLOAT4A*)m[7], XMVectorMultiply(sz, XMVectorMultiply(two, XMVectorSubtract(yz, xw))));
+		XMStoreFloat4A((XMFLOAT4A*)m[8], XMVectorMultiply(sz, XMVectorNegativeMultiplySubtract(two, XMVectorAdd(xx, yy), one)));
+		XMStoreFloat4A((XMFLOAT4A*)m[9], tx);
+		XMStoreFloat4A((XMFLOAT4A*)m[10], ty);
+		XMStoreFloat4A((XMFLOAT4A*)m[11], tz);
+
+		for(UINT j = 0; j < lanes; ++j)
+		{
+			toParent[first + j] = XMFLOAT4X4(
+				m[0][j], m[1][j],  m[2][j],  0.0f,
+				m[3][j], m[4][j],  m[5][j],  0.0f,
+				m[6][j], m[7][j],  m[8][j],  0.0f,
+				m[9][j], m[10][j], m[11][j], 1.0f);
+		}
+	}
+}
+
+void AnimationSampler::Sample(const SampleRequest& request, XMFLOAT4X4* toRootScratch)const
+{
+	const UINT numBones = BoneCount();
+	if(numBones == 0)
+		return;
+
+	// The local transforms are written straight into the scratch and turned into to-root
+	// transforms in place: parents always precede their children, so toRootScratch[parent]
+	// is final by the time bone i reads it.
+	SampleLocalPose(request.Clip, request.TimePos, request.KeyCursors, toRootScratch);
+
+	for(UINT i = 1; i < numBones; ++i)
+	{
+		XMMATRIX toParent = XMLoadFloat4x4(&toRootScratch[i]);
+		XMMATRIX parentToRoot = XMLoadFloat4x4(&toRootScratch[mBoneHierarchy[i]]);
+		XMStoreFloat4x4(&toRootScratch[i], XMMatrixMultiply(toParent, parentToRoot));
+	}
+
+	for(UINT i = 0; i < numBones; ++i)
+	{
+		XMMATRIX offset = XMLoadFloat4x4(&mBoneOffsets[i]);
+		XMMATRIX toRoot = XMLoadFloat4x4(&toRootScratch[i]);
+		XMStoreFloat4x4(&request.FinalTransforms[i], XMMatrixTranspose(XMMatrixMultiply(offset, toRoot)));
+	}
+}
+
+void AnimationSampler::SampleBatch(const SampleRequest* requests, UINT count, XMFLOAT4X4* toRootScratch)const
+{
+	for(UINT i = 0; i < count; ++i)
+		Sample(requests[i], toRootScratch);
+}
@@ -0,0 +1,117 @@
+//***************************************************************************************
+// AnimationSampler.h
+//
+// Batched replacement for SkinnedData::GetFinalTransforms.  Build() compiles the clips of
+// a SkinnedData once into per-channel key arrays (times, translations, rotations, scales
+// stored separately).  Sampling then works on clip handles resolved ahead of time, keeps a
+// per-bone key cursor for each instance, interpolates four bones at a time, and writes into
+// buffers owned by the caller, so the per-frame path never allocates.
+//***************************************************************************************
+
+#pragma once
+
+#include "SkinnedData.h"
+
+class AnimationSampler
+{
+public:
+	static const UINT InvalidClip = 0xffffffff;
+
+	struct SampleRequest
+	{
+		// Handle returned by FindClip.
+		UINT Clip = InvalidClip;
+		float TimePos = 0.0f;
+
+		// BoneCount() entries owned by the instance.  Remembers the key interval each bone
+		// used last time, so playback that moves forward rarely needs a search.  Zero them
+		// when the instance is created or switches clips.
+		UINT* KeyCursors = nullptr;
+
+		// BoneCount() transposed matrices, laid out as SkinnedConstants::BoneTransforms.
+		DirectX::XMFLOAT4X4* FinalTransforms = nullptr;
+	};
+
+	// Compiles every clip of skinInfo.  Call again if skinInfo changes.
+	void Build(const SkinnedData& skinInfo);
+
+	UINT BoneCount()const { return (UINT)mBoneHierarchy.size(); }
+	UINT ClipCount()const { return (UINT)mClips.size(); }
+
+	// Returns InvalidClip if there is no clip with this name.
+	UINT FindClip(const std::string& clipName)const;
+
+	const std::string& GetClipName(UINT clip)const { return mClips[clip].Name; }
+	float GetClipStartTime(UINT clip)const { return mClips[clip].StartTime; }
+	float GetClipEndTime(UINT clip)const { return mClips[clip].EndTime; }
+
+	// toRootScratch holds BoneCount() matrices and may be reused between calls.  The
+	// same scratch cannot be shared by two threads at once.
+	void Sample(const SampleRequest& request, DirectX::XMFLOAT4X4* toRootScratch)const;
+	void SampleBatch(const SampleRequest* requests, UINT count, DirectX::XMFLOAT4X4* toRootScratch)const;
+
+	// Writes the to-parent transform of every bone at timePos.  Sample is this followed by
+	// the hierarchy walk; it is exposed for callers that blend or post-process local poses.
+	void SampleLocalPose(UINT clip, float timePos, UINT* keyCursors, DirectX::XMFLOAT4X4* toParent)const;
+
+	// Finds the keys in times[0, count) bracketing t, starting from the interval cached
+	// in cursor, and returns the blend factor between keys k0 and k1.  Matches
+	// BoneAnimation::Interpolate: times outside the keys clamp to the first or last key.
+	static float LocateKey(const float* times, UINT count, float t, UINT& cursor, UINT& k0, UINT& k1)
+	{
+		if(count == 1 || t <= times[0])
+		{
+			cursor = 0;
+			k0 = k1 = 0;
+			return 0.0f;
+		}
+
+		if(t >= times[count-1])
+		{
+			cursor = count - 2;
+			k0 = k1 = count - 1;
+			return 0.0f;
+		}
+
+		// Here times[0] < t < times[count-1], so there is an interval with
+		// times[c] <= t < times[c+1] and c+1 < count.
+		UINT c = cursor;
+		if(c + 1 >= count || t < times[c] || t >= times[c+1])
+		{
+			// Playback usually moves forward by less than one key per frame.
+			if(c + 2 < count && t >= times[c+1] && t < times[c+2])
+				++c;
+			else
+				c = (UINT)(std::upper_bound(times, times + count, t) - times) - 1;
+		}
+
+		cursor = c;
+		k0 = c;
+		k1 = c + 1;
+		return (t - times[c]) / (times[c+1] - times[c]);
+	}
+
+private:
+	struct CompiledClip
+	{
+		std::string Name;
+		float StartTime = 0.0f;
+		float EndTime = 0.0f;
+
+		// Keys of bone i are [KeyOffsets[i], KeyOffsets[i+1]).  Bones without keys get
+		// one identity key so sampling never has to special-case them.
+		std::vector<UINT> KeyOffsets;
+		std::vector<float> Times;
+		std::vector<DirectX::XMFLOAT3> Translations;
+		std::vector<DirectX::XMFLOAT4> Rotations;
+		std::vector<DirectX::XMFLOAT3> Scales;
+
+		// Set for compressed clips, which are decoded while sampling instead of being
+		// expanded into the arrays above.
+		std::shared_ptr<const CompressedClip> Compressed;
+	};
+
+	std::vector<int> mBoneHierarchy;
+	std::vector<DirectX::XMFLOAT4X4> mBoneOffsets;
+	std::vector<CompiledClip> mClips;
+};
@@ -0,0 +1,122 @@
+//***************************************************************************************
+// CrowdAnimator.cpp
+//***************************************************************************************
+
+#include "CrowdAnimator.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT MaxPaletteBones = sizeof(SkinnedConstants::BoneTransforms) / sizeof(XMFLOAT4X4);
+}
+
+CrowdAnimator::CrowdAnimator(const AnimationSampler& sampler, ThreadPool* pool)
+	: mSampler(sampler), mPool(pool)
+{
+}
+
+UINT CrowdAnimator::AddInstance(UINT clip, float timePos)
+{
+	mClips.push_back(clip);
+	mTimePos.push_back(timePos);
+	mKeyCursors.resize(mKeyCursors.size() + mSampler.BoneCount(), 0);
+
+	return InstanceCount() - 1;
+}
+
+void CrowdAnimator::Clear()
+{
+	mClips.clear();
+	mTimePos.clear();
+	mKeyCursors.clear();
+}
+
+void CrowdAnimator::SetClip(UINT instance, UINT clip, float timePos)
+{
+	mClips[instance] = clip;
+	mTimePos[instance] = timePos;
+
+	// Cursors from the old clip point at unrelated keys.
+	const UINT numBones = mSampler.BoneCount();
+	std::fill_n(&mKeyCursors[instance*numBones], numBones, 0);
+}
+
+void CrowdAnimator::ReserveArenas()
+{
+	const UINT threadCount = mPool ? mPool->ConcurrencyLevel() : 1;
+	const UINT instanceCount = InstanceCount();
+	const size_t rangeCount = instanceCount / MathHelper::Max(mGrainSize, 1) + 1;
+
+	// Worst case for one thread: its to-root scratch plus the requests of every range,
+	// each with alignment padding.
+	size_t capacity = mSampler.BoneCount()*sizeof(XMFLOAT4X4) + alignof(XMFLOAT4X4) +
+		instanceCount*sizeof(AnimationSampler::SampleRequest) +
+		rangeCount*alignof(AnimationSampler::SampleRequest);
+
+	mArenas.resize(threadCount);
+	for(LinearArena& arena : mArenas)
+		arena.Reserve(capacity);
+
+	mToRoot.assign(threadCount, nullptr);
+	mArenaInstanceCount = instanceCount;
+}
+
+void CrowdAnimator::Update(float dt, BYTE* palettes, UINT paletteStride)
+{
+	const UINT instanceCount = InstanceCount();
+	const UINT numBones = mSampler.BoneCount();
+	if(instanceCount == 0 || numBones == 0)
+		return;
+
+	assert(numBones <= MaxPaletteBones);
+
+	if(mArenaInstanceCount != instanceCount || mArenas.size() != (mPool ? mPool->ConcurrencyLevel() : 1))
+		ReserveArenas();
+
+	for(size_t i = 0; i < mArenas.size(); ++i)
+	{
+		mArenas[i].Reset();
+		mToRoot[i] = nullptr;
+	}
+
+	auto updateRange = [&](int begin, int end)
+	{
+		// Indices come from mPool, whose threads mArenas is sized for, whichever pool the
+		// calling thread belongs to.
+		const UINT thread = mPool ? mPool->CurrentThreadIndex() : 0;
+		assert(thread < mArenas.size());
+		LinearArena& arena = mArenas[thread];
+
+		XMFLOAT4X4*& toRoot = mToRoot[thread];
+		if(toRoot == nullptr)
+			toRoot = arena.Allocate<XMFLOAT4X4>(numBones);
+
+		AnimationSampler::SampleRequest* requests = arena.Allocate<AnimationSampler::SampleRequest>(end - begin);
+		assert(toRoot != nullptr && requests != nullptr);
+
+		for(int i = begin; i < end; ++i)
+		{
+			UINT clip = mClips[i];
+
+			// Loop animation
+			float t = mTimePos[i] + dt;
+			if(t > mSampler.GetClipEndTime(clip))
+				t = 0.0f;
+			mTimePos[i] = t;
+
+			AnimationSampler::SampleRequest& request = requests[i - begin];
+			request.Clip = clip;
+			request.TimePos = t;
+			request.KeyCursors = &mKeyCursors[(size_t)i*numBones];
+			request.FinalTransforms = reinterpret_cast<SkinnedConstants*>(palettes + (size_t)i*paletteStride)->BoneTransforms;
+		}
+
+		mSampler.SampleBatch(requests, (UINT)(end - begin), toRoot);
+	};
+
+	if(mPool)
+		mPool->ParallelForRange(0, (int)instanceCount, mGrainSize, updateRange);
+	else
+		updateRange(0, (int)instanceCount);
+}
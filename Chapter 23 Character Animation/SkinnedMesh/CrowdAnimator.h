@@ -0,0 +1,68 @@
+//***************************************************************************************
+// CrowdAnimator.h
+//
+// Per-frame animation update for many instances of one skinned model.  Instances are split
+// into contiguous ranges across a ThreadPool.  Each thread samples its ranges with the
+// AnimationSampler using scratch from its own LinearArena, which is reset every frame, and
+// writes the bone palettes straight into caller-provided SkinnedConstants, such as the
+// mapped skinned constant buffer.
+//***************************************************************************************
+
+#pragma once
+
+#include "AnimationSampler.h"
+#include "FrameResource.h"
+#include "../../Common/LinearArena.h"
+#include "../../Common/ThreadPool.h"
+
+class CrowdAnimator
+{
+public:
+	// pool may be null, in which case Update runs on the calling thread only.
+	CrowdAnimator(const AnimationSampler& sampler, ThreadPool* pool);
+	CrowdAnimator(const CrowdAnimator& rhs) = delete;
+	CrowdAnimator& operator=(const CrowdAnimator& rhs) = delete;
+
+	// Returns the instance index, which is also its slot in the palette array.
+	UINT AddInstance(UINT clip, float timePos);
+	void Clear();
+
+	UINT InstanceCount()const { return (UINT)mClips.size(); }
+
+	UINT GetClip(UINT instance)const { return mClips[instance]; }
+	void SetClip(UINT instance, UINT clip, float timePos);
+	float GetTimePos(UINT instance)const { return mTimePos[instance]; }
+
+	// Instances per task.  Small enough to balance, large enough to amortize scheduling.
+	void SetGrainSize(int grainSize) { mGrainSize = grainSize; }
+
+	// Advances every instance by dt, looping at the end of its clip, and writes the final
+	// transforms of instance i as the SkinnedConstants at palettes + i*paletteStride.
+	// palettes must hold InstanceCount() of them, and can be a mapped upload buffer: each
+	// matrix is written once, in order, and never read back.  Must not be called from two
+	// threads at once.
+	void Update(float dt, BYTE* palettes, UINT paletteStride);
+	void Update(float dt, SkinnedConstants* palettes)
+	{
+		Update(dt, reinterpret_cast<BYTE*>(palettes), sizeof(SkinnedConstants));
+	}
+
+private:
+	void ReserveArenas();
+
+private:
+	const AnimationSampler& mSampler;
+	ThreadPool* mPool = nullptr;
+	int mGrainSize = 16;
+
+	// Per instance.  Key cursors are BoneCount() entries per instance, back to back.
+	std::vector<UINT> mClips;
+	std::vector<float> mTimePos;
+	std::vector<UINT> mKeyCursors;
+
+	// Per thread, indexed by mPool->CurrentThreadIndex().  mToRoot[i] is taken from
+	// mArenas[i] by the first range a thread runs in a frame.
+	std::vector<LinearArena> mArenas;
+	std::vector<DirectX::XMFLOAT4X4*> mToRoot;
+	UINT mArenaInstanceCount = 0;
+};
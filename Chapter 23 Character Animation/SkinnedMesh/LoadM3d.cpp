@@ -1,7 +1,154 @@
 #include "LoadM3d.h"
+#include "AnimationCompression.h"
+#include <sys/stat.h>
  
 using namespace DirectX;
 
+namespace
+{
+	const std::uint32_t M3dbMagic = 0x4244334D; // "M3DB"
+	const std::uint32_t M3dbVersion = 2;
+
+	enum M3dbSectionId
+	{
+		M3dbMaterials = 0,
+		M3dbSubsets,
+		M3dbVertices,
+		M3dbIndices,
+		M3dbBoneOffsets,
+		M3dbBoneHierarchy,
+		M3dbAnimationClips,
+		M3dbSectionCount
+	};
+
+	// How the keyframes of one clip are stored in the clips section.
+	enum M3dbClipEncoding
+	{
+		M3dbClipRaw = 0,
+		M3dbClipCompressed = 1
+	};
+
+	struct M3dbSection
+	{
+		std::uint64_t Offset;
+		std::uint64_t Size;
+	};
+
+	struct M3dbHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Version;
+		std::uint32_t NumMaterials;
+		std::uint32_t NumVertices;
+		std::uint32_t NumIndices;
+		std::uint32_t NumBones;
+		std::uint32_t NumAnimationClips;
+		std::uint32_t NumSections;
+		M3dbSection Sections[M3dbSectionCount];
+	};
+
+	// The fixed-size sections are the in-memory arrays written as-is.
+	static_assert(sizeof(M3DLoader::SkinnedVertex) == 60, "SkinnedVertex layout changed; bump M3dbVersion.");
+	static_assert(sizeof(M3DLoader::Subset) == 5*sizeof(UINT), "Subset layout changed; bump M3dbVersion.");
+	static_assert(sizeof(Keyframe) == 11*sizeof(float), "Keyframe layout changed; bump M3dbVersion.");
+	static_assert(sizeof(PackedQuaternion) == 6, "PackedQuaternion layout changed; bump M3dbVersion.");
+	static_assert(sizeof(CompressedClip::BoneTrack) == 6*sizeof(std::uint32_t), "BoneTrack layout changed; bump M3dbVersion.");
+
+	// Appends the variable-length sections (materials, clips) to a byte buffer.
+	struct M3dbWriter
+	{
+		std::vector<char> Bytes;
+
+		void Write(const void* data, size_t size)
+		{
+			const char* p = (const char*)data;
+			Bytes.insert(Bytes.end(), p, p + size);
+		}
+
+		void WriteU32(std::uint32_t x) { Write(&x, sizeof(x)); }
+
+		void WriteString(const std::string& str)
+		{
+			WriteU32((std::uint32_t)str.size());
+			Write(str.data(), str.size());
+		}
+
+		template<typename T>
+		void WriteArray(const std::vector<T>& v)
+		{
+			WriteU32((std::uint32_t)v.size());
+			Write(v.data(), v.size()*sizeof(T));
+		}
+	};
+
+	// Bounds-checked cursor over a variable-length section.  Every read past the end
+	// sets Failed and yields zeros, so callers check once at the end.
+	struct M3dbReader
+	{
+		const char* P = nullptr;
+		const char* End = nullptr;
+		bool Failed = false;
+
+		bool Read(void* dst, size_t size)
+		{
+			if(Failed || (size_t)(End - P) < size)
+			{
+				Failed = true;
+				std::memset(dst, 0, size);
+				return false;
+			}
+			std::memcpy(dst, P, size);
+			P += size;
+			return true;
+		}
+
+		std::uint32_t ReadU32()
+		{
+			std::uint32_t x = 0;
+			Read(&x, sizeof(x));
+			return x;
+		}
+
+		void ReadString(std::string& str)
+		{
+			std::uint32_t length = ReadU32();
+			if(Failed || (size_t)(End - P) < length)
+			{
+				Failed = true;
+				str.clear();
+				return;
+			}
+			str.assign(P, length);
+			P += length;
+		}
+
+		template<typename T>
+		bool ReadArray(std::vector<T>& v)
+		{
+			// Reject counts larger than what is left before allocating.
+			std::uint32_t count = ReadU32();
+			if(Failed || count > (size_t)(End - P) / sizeof(T))
+			{
+				Failed = true;
+				v.clear();
+				return false;
+			}
+			v.resize(count);
+			return Read(v.data(), count*sizeof(T));
+		}
+	};
+
+	bool GetModifiedTime(const std::string& filename, std::int64_t& time)
+	{
+		struct stat st;
+		if(stat(filename.c_str(), &st) != 0)
+			return false;
+
+		time = (std::int64_t)st.st_mtime;
+		return true;
+	}
+}
+
 bool M3DLoader::LoadM3d(const std::string& filename, 
 						std::vector<Vertex>& vertices,
 						std::vector<USHORT>& indices,
@@ -43,6 +190,27 @@ bool M3DLoader::LoadM3d(const std::string& filename,
 						std::vector<Subset>& subsets,
 						std::vector<M3dMaterial>& mats,
 						SkinnedData& skinInfo)
+{
+	return LoadSkinnedM3d(filename, vertices, indices, subsets, mats, skinInfo);
+}
+
+bool M3DLoader::LoadM3d(const std::string& filename, 
+						std::vector<SkinnedVertex>& vertices,
+						std::vector<std::uint32_t>& indices,
+						std::vector<Subset>& subsets,
+						std::vector<M3dMaterial>& mats,
+						SkinnedData& skinInfo)
+{
+	return LoadSkinnedM3d(filename, vertices, indices, subsets, mats, skinInfo);
+}
+
+template<typename IndexType>
+bool M3DLoader::LoadSkinnedM3d(const std::string& filename, 
+						std::vector<SkinnedVertex>& vertices,
+						std::vector<IndexType>& indices,
+						std::vector<Subset>& subsets,
+						std::vector<M3dMaterial>& mats,
+						SkinnedData& skinInfo)
 {
     std::ifstream fin(filename);
 
@@ -164,7 +332,8 @@ void M3DLoader::ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::v
     }
 }
 
-void M3DLoader::ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<USHORT>& indices)
+template<typename IndexType>
+void M3DLoader::ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<IndexType>& indices)
 {
 	std::string ignore;
     indices.resize(numTriangles*3);
@@ -254,4 +423,374 @@ void M3DLoader::ReadBoneKeyframes(std::ifstream& fin, UINT numBones, BoneAnimati
     }
 
     fin >> ignore; // }
-}
\ No newline at end of file
+}
+
+bool M3DLoader::LoadM3db(const std::string& filename, 
+						 std::vector<SkinnedVertex>& vertices,
+						 std::vector<std::uint32_t>& indices,
+						 std::vector<Subset>& subsets,
+						 std::vector<M3dMaterial>& mats,
+						 SkinnedData& skinInfo)
+{
+	std::ifstream fin(filename, std::ios::binary);
+	if(!fin)
+		return false;
+
+	fin.seekg(0, std::ios::end);
+	const std::uint64_t fileSize = (std::uint64_t)fin.tellg();
+	fin.seekg(0, std::ios::beg);
+
+	M3dbHeader header;
+	if(fileSize < sizeof(header) || !fin.read((char*)&header, sizeof(header)))
+		return false;
+
+	if(header.Magic != M3dbMagic || header.Version != M3dbVersion ||
+	   header.NumSections != M3dbSectionCount || header.NumIndices % 3 != 0)
+		return false;
+
+	for(UINT i = 0; i < M3dbSectionCount; ++i)
+	{
+		const M3dbSection& sec = header.Sections[i];
+		if(sec.Offset > fileSize || sec.Size > fileSize - sec.Offset)
+			return false;
+	}
+
+	// Fixed-size sections must match the counts in the header exactly.
+	auto sizeMatches = [&header](M3dbSectionId id, std::uint64_t count, std::uint64_t stride)
+	{
+		return header.Sections[id].Size == count*stride;
+	};
+
+	if(!sizeMatches(M3dbSubsets, header.NumMaterials, sizeof(Subset)) ||
+	   !sizeMatches(M3dbVertices, header.NumVertices, sizeof(SkinnedVertex)) ||
+	   !sizeMatches(M3dbIndices, header.NumIndices, sizeof(std::uint32_t)) ||
+	   !sizeMatches(M3dbBoneOffsets, header.NumBones, sizeof(XMFLOAT4X4)) ||
+	   !sizeMatches(M3dbBoneHierarchy, header.NumBones, sizeof(std::int32_t)))
+		return false;
+
+	auto readSection = [&fin, &header](M3dbSectionId id, void* dst)
+	{
+		const M3dbSection& sec = header.Sections[id];
+		if(sec.Size == 0)
+			return true;
+
+		fin.seekg((std::streamoff)sec.Offset, std::ios::beg);
+		return (bool)fin.read((char*)dst, (std::streamsize)sec.Size);
+	};
+
+	std::vector<XMFLOAT4X4> boneOffsets(header.NumBones);
+	std::vector<int> boneIndexToParentIndex(header.NumBones);
+
+	subsets.resize(header.NumMaterials);
+	vertices.resize(header.NumVertices);
+	indices.resize(header.NumIndices);
+
+	if(!readSection(M3dbSubsets, subsets.data()) ||
+	   !readSection(M3dbVertices, vertices.data()) ||
+	   !readSection(M3dbIndices, indices.data()) ||
+	   !readSection(M3dbBoneOffsets, boneOffsets.data()) ||
+	   !readSection(M3dbBoneHierarchy, boneIndexToParentIndex.data()))
+		return false;
+
+	//
+	// Validate the fixed sections against each other so a corrupt file fails here
+	// rather than as an out-of-range read while drawing or animating.
+	//
+
+	for(UINT i = 0; i < header.NumIndices; ++i)
+	{
+		if(indices[i] >= header.NumVertices)
+			return false;
+	}
+
+	for(const Subset& subset : subsets)
+	{
+		if((std::uint64_t)subset.VertexStart + subset.VertexCount > header.NumVertices ||
+		   ((std::uint64_t)subset.FaceStart + subset.FaceCount)*3 > header.NumIndices)
+			return false;
+	}
+
+	for(UINT i = 0; i < header.NumVertices; ++i)
+	{
+		for(int j = 0; j < 4; ++j)
+		{
+			if(vertices[i].BoneIndices[j] >= header.NumBones && header.NumBones > 0)
+				return false;
+		}
+	}
+
+	// GetFinalTransforms walks the hierarchy in index order, so every parent must
+	// come before its children.
+	for(UINT i = 0; i < header.NumBones; ++i)
+	{
+		int parent = boneIndexToParentIndex[i];
+		if(i == 0 ? parent != -1 : (parent < 0 || parent >= (int)i))
+			return false;
+	}
+
+	//
+	// Variable-length sections.
+	//
+
+	std::vector<char> bytes;
+
+	auto readBlob = [&](M3dbSectionId id, M3dbReader& reader)
+	{
+		bytes.resize((size_t)header.Sections[id].Size);
+		if(!readSection(id, bytes.data()))
+			return false;
+
+		reader.P = bytes.data();
+		reader.End = bytes.data() + bytes.size();
+		return true;
+	};
+
+	M3dbReader matReader;
+	if(!readBlob(M3dbMaterials, matReader))
+		return false;
+
+	mats.resize(header.NumMaterials);
+	for(UINT i = 0; i < header.NumMaterials; ++i)
+	{
+		matReader.ReadString(mats[i].Name);
+		matReader.Read(&mats[i].DiffuseAlbedo, sizeof(XMFLOAT4));
+		matReader.Read(&mats[i].FresnelR0, sizeof(XMFLOAT3));
+		matReader.Read(&mats[i].Roughness, sizeof(float));
+		mats[i].AlphaClip = matReader.ReadU32() != 0;
+		matReader.ReadString(mats[i].MaterialTypeName);
+		matReader.ReadString(mats[i].DiffuseMapName);
+		matReader.ReadString(mats[i].NormalMapName);
+	}
+
+	if(matReader.Failed)
+		return false;
+
+	M3dbReader clipReader;
+	if(!readBlob(M3dbAnimationClips, clipReader))
+		return false;
+
+	std::unordered_map<std::string, AnimationClip> animations;
+	for(UINT clipIndex = 0; clipIndex < header.NumAnimationClips; ++clipIndex)
+	{
+		std::string clipName;
+		clipReader.ReadString(clipName);
+
+		AnimationClip& clip = animations[clipName];
+
+		std::uint32_t encoding = clipReader.ReadU32();
+		if(encoding == M3dbClipCompressed)
+		{
+			auto compressed = std::make_shared<CompressedClip>();
+			clipReader.Read(&compressed->StartTime, sizeof(float));
+			clipReader.Read(&compressed->EndTime, sizeof(float));
+			clipReader.ReadArray(compressed->Tracks);
+			clipReader.ReadArray(compressed->Times);
+			clipReader.ReadArray(compressed->Translations);
+			clipReader.ReadArray(compressed->Rotations);
+			clipReader.ReadArray(compressed->Scales);
+
+			if(clipReader.Failed || !compressed->IsValid(header.NumBones))
+				return false;
+
+			clip.Compressed = compressed;
+			continue;
+		}
+		else if(encoding != M3dbClipRaw)
+			return false;
+
+		clip.BoneAnimations.resize(header.NumBones);
+
+		for(UINT boneIndex = 0; boneIndex < header.NumBones; ++boneIndex)
+		{
+			std::uint32_t numKeyframes = clipReader.ReadU32();
+
+			// Every keyframe takes 44 bytes, so a count larger than what is left in the
+			// section is corrupt; checking first avoids a huge allocation.
+			if(clipReader.Failed || numKeyframes == 0 ||
+			   numKeyframes > (size_t)(clipReader.End - clipReader.P) / sizeof(Keyframe))
+				return false;
+
+			std::vector<Keyframe>& keys = clip.BoneAnimations[boneIndex].Keyframes;
+			keys.resize(numKeyframes);
+			clipReader.Read(keys.data(), numKeyframes*sizeof(Keyframe));
+
+			for(UINT k = 1; k < numKeyframes; ++k)
+			{
+				if(keys[k].TimePos < keys[k-1].TimePos)
+					return false;
+			}
+		}
+	}
+
+	if(clipReader.Failed)
+		return false;
+
+	skinInfo.Set(boneIndexToParentIndex, boneOffsets, animations);
+
+	return true;
+}
+
+bool M3DLoader::SaveM3db(const std::string& filename, 
+						 const std::vector<SkinnedVertex>& vertices,
+						 const std::vector<std::uint32_t>& indices,
+						 const std::vector<Subset>& subsets,
+						 const std::vector<M3dMaterial>& mats,
+						 const SkinnedData& skinInfo)
+{
+	const std::vector<int>& boneHierarchy = skinInfo.BoneHierarchy();
+	const std::vector<XMFLOAT4X4>& boneOffsets = skinInfo.BoneOffsets();
+	const auto& animations = skinInfo.Animations();
+
+	if(subsets.size() != mats.size())
+		return false;
+
+	M3dbWriter matWriter;
+	for(const M3dMaterial& mat : mats)
+	{
+		matWriter.WriteString(mat.Name);
+		matWriter.Write(&mat.DiffuseAlbedo, sizeof(XMFLOAT4));
+		matWriter.Write(&mat.FresnelR0, sizeof(XMFLOAT3));
+		matWriter.Write(&mat.Roughness, sizeof(float));
+		matWriter.WriteU32(mat.AlphaClip ? 1 : 0);
+		matWriter.WriteString(mat.MaterialTypeName);
+		matWriter.WriteString(mat.DiffuseMapName);
+		matWriter.WriteString(mat.NormalMapName);
+	}
+
+	M3dbWriter clipWriter;
+	for(const auto& clip : animations)
+	{
+		clipWriter.WriteString(clip.first);
+
+		if(clip.second.Compressed)
+		{
+			const CompressedClip& compressed = *clip.second.Compressed;
+			clipWriter.WriteU32(M3dbClipCompressed);
+			clipWriter.Write(&compressed.StartTime, sizeof(float));
+			clipWriter.Write(&compressed.EndTime, sizeof(float));
+			clipWriter.WriteArray(compressed.Tracks);
+			clipWriter.WriteArray(compressed.Times);
+			clipWriter.WriteArray(compressed.Translations);
+			clipWriter.WriteArray(compressed.Rotations);
+			clipWriter.WriteArray(compressed.Scales);
+			continue;
+		}
+
+		clipWriter.WriteU32(M3dbClipRaw);
+		for(const BoneAnimation& bone : clip.second.BoneAnimations)
+		{
+			clipWriter.WriteU32((std::uint32_t)bone.Keyframes.size());
+			clipWriter.Write(bone.Keyframes.data(), bone.Keyframes.size()*sizeof(Keyframe));
+		}
+	}
+
+	std::vector<std::int32_t> hierarchy(boneHierarchy.begin(), boneHierarchy.end());
+
+	const void* sectionData[M3dbSectionCount] =
+	{
+		matWriter.Bytes.data(),
+		subsets.data(),
+		vertices.data(),
+		indices.data(),
+		boneOffsets.data(),
+		hierarchy.data(),
+		clipWriter.Bytes.data()
+	};
+
+	M3dbHeader header = {};
+	header.Magic = M3dbMagic;
+	header.Version = M3dbVersion;
+	header.NumMaterials = (std::uint32_t)mats.size();
+	header.NumVertices = (std::uint32_t)vertices.size();
+	header.NumIndices = (std::uint32_t)indices.size();
+	header.NumBones = (std::uint32_t)boneHierarchy.size();
+	header.NumAnimationClips = (std::uint32_t)animations.size();
+	header.NumSections = M3dbSectionCount;
+	header.Sections[M3dbMaterials].Size = matWriter.Bytes.size();
+	header.Sections[M3dbSubsets].Size = subsets.size()*sizeof(Subset);
+	header.Sections[M3dbVertices].Size = vertices.size()*sizeof(SkinnedVertex);
+	header.Sections[M3dbIndices].Size = indices.size()*sizeof(std::uint32_t);
+	header.Sections[M3dbBoneOffsets].Size = boneOffsets.size()*sizeof(XMFLOAT4X4);
+	header.Sections[M3dbBoneHierarchy].Size = hierarchy.size()*sizeof(std::int32_t);
+	header.Sections[M3dbAnimationClips].Size = clipWriter.Bytes.size();
+
+	// Sections follow the header back to back, each starting on a 16-byte boundary.
+	std::uint64_t offset = sizeof(M3dbHeader);
+	for(UINT i = 0; i < M3dbSectionCount; ++i)
+	{
+		offset = (offset + 15) & ~15ull;
+		header.Sections[i].Offset = offset;
+		offset += header.Sections[i].Size;
+	}
+
+	std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+	if(!fout)
+		return false;
+
+	fout.write((const char*)&header, sizeof(header));
+
+	std::uint64_t written = sizeof(header);
+	for(UINT i = 0; i < M3dbSectionCount; ++i)
+	{
+		static const char zeros[16] = {};
+		fout.write(zeros, (std::streamsize)(header.Sections[i].Offset - written));
+		fout.write((const char*)sectionData[i], (std::streamsize)header.Sections[i].Size);
+		written = header.Sections[i].Offset + header.Sections[i].Size;
+	}
+
+	return (bool)fout;
+}
+
+bool M3DLoader::ConvertM3dToM3db(const std::string& m3dFilename, const std::string& m3dbFilename,
+								 const AnimationCompressionSettings* compression)
+{
+	std::vector<SkinnedVertex> vertices;
+	std::vector<std::uint32_t> indices;
+	std::vector<Subset> subsets;
+	std::vector<M3dMaterial> mats;
+	SkinnedData skinInfo;
+
+	if(!LoadM3d(m3dFilename, vertices, indices, subsets, mats, skinInfo))
+		return false;
+
+	if(compression)
+		CompressAnimations(skinInfo, *compression);
+
+	return SaveM3db(m3dbFilename, vertices, indices, subsets, mats, skinInfo);
+}
+
+bool M3DLoader::LoadM3dCached(const std::string& filename, 
+							  std::vector<SkinnedVertex>& vertices,
+							  std::vector<std::uint32_t>& indices,
+							  std::vector<Subset>& subsets,
+							  std::vector<M3dMaterial>& mats,
+							  SkinnedData& skinInfo,
+							  const AnimationCompressionSettings* compression)
+{
+	const std::string binFilename = filename + "b";
+
+	std::int64_t textTime = 0;
+	std::int64_t binTime = 0;
+	bool haveText = GetModifiedTime(filename, textTime);
+	bool haveBin = GetModifiedTime(binFilename, binTime);
+
+	if(haveBin && (!haveText || binTime >= textTime) &&
+	   LoadM3db(binFilename, vertices, indices, subsets, mats, skinInfo))
+	{
+		// Clips already compressed in the cache are left alone.
+		if(compression)
+			CompressAnimations(skinInfo, *compression);
+		return true;
+	}
+
+	if(!LoadM3d(filename, vertices, indices, subsets, mats, skinInfo))
+		return false;
+
+	// Compress before writing the cache so later loads skip the work.
+	if(compression)
+		CompressAnimations(skinInfo, *compression);
+
+	// A failed write only means the next load parses the text again.
+	SaveM3db(binFilename, vertices, indices, subsets, mats, skinInfo);
+	return true;
+}
@@ -3,6 +3,7 @@
 
 #include "SkinnedData.h"
 
+struct AnimationCompressionSettings;
 
 
 class M3DLoader
@@ -60,13 +61,64 @@ public:
 		std::vector<Subset>& subsets,
 		std::vector<M3dMaterial>& mats,
 		SkinnedData& skinInfo);
+	bool LoadM3d(const std::string& filename, 
+		std::vector<SkinnedVertex>& vertices,
+		std::vector<std::uint32_t>& indices,
+		std::vector<Subset>& subsets,
+		std::vector<M3dMaterial>& mats,
+		SkinnedData& skinInfo);
+
+	//
+	// Binary M3D (".m3db").  A fixed header with a section table is followed by the
+	// sections as raw little-endian arrays, so loading is a handful of block reads
+	// instead of one formatted extraction per token.  Indices are always 32-bit.
+	//
+
+	bool LoadM3db(const std::string& filename, 
+		std::vector<SkinnedVertex>& vertices,
+		std::vector<std::uint32_t>& indices,
+		std::vector<Subset>& subsets,
+		std::vector<M3dMaterial>& mats,
+		SkinnedData& skinInfo);
+	bool SaveM3db(const std::string& filename, 
+		const std::vector<SkinnedVertex>& vertices,
+		const std::vector<std::uint32_t>& indices,
+		const std::vector<Subset>& subsets,
+		const std::vector<M3dMaterial>& mats,
+		const SkinnedData& skinInfo);
+
+	// Reads a text .m3d file and writes it back out as .m3db.  With compression set, the
+	// animation clips are stored compressed (see AnimationCompression.h).
+	bool ConvertM3dToM3db(const std::string& m3dFilename, const std::string& m3dbFilename,
+		const AnimationCompressionSettings* compression = nullptr);
+
+	// Loads filename's binary twin (filename + "b") when it exists and is at least as
+	// new as the text file; otherwise loads the text file and regenerates the twin.
+	// With compression set, clips that are not compressed yet get compressed, before
+	// the twin is written when it is regenerated.
+	bool LoadM3dCached(const std::string& filename, 
+		std::vector<SkinnedVertex>& vertices,
+		std::vector<std::uint32_t>& indices,
+		std::vector<Subset>& subsets,
+		std::vector<M3dMaterial>& mats,
+		SkinnedData& skinInfo,
+		const AnimationCompressionSettings* compression = nullptr);
 
 private:
+	template<typename IndexType>
+	bool LoadSkinnedM3d(const std::string& filename, 
+		std::vector<SkinnedVertex>& vertices,
+		std::vector<IndexType>& indices,
+		std::vector<Subset>& subsets,
+		std::vector<M3dMaterial>& mats,
+		SkinnedData& skinInfo);
+
 	void ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector<M3dMaterial>& mats);
 	void ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector<Subset>& subsets);
 	void ReadVertices(std::ifstream& fin, UINT numVertices, std::vector<Vertex>& vertices);
 	void ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices);
-	void ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<USHORT>& indices);
+	template<typename IndexType>
+	void ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<IndexType>& indices);
 	void ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<DirectX::XMFLOAT4X4>& boneOffsets);
 	void ReadBoneHierarchy(std::ifstream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex);
 	void ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAnimationClips, std::unordered_map<std::string, AnimationClip>& animations);
@@ -1,4 +1,5 @@
 #include "SkinnedData.h"
+#include "AnimationCompression.h"
 
 using namespace DirectX;
 
@@ -80,6 +81,9 @@ void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M)const
 
 float AnimationClip::GetClipStartTime()const
 {
+	if(Compressed)
+		return Compressed->StartTime;
+
 	// Find smallest start time over all bones in this clip.
 	float t = MathHelper::Infinity;
 	for(UINT i = 0; i < BoneAnimations.size(); ++i)
@@ -92,6 +96,9 @@ float AnimationClip::GetClipStartTime()const
 
 float AnimationClip::GetClipEndTime()const
 {
+	if(Compressed)
+		return Compressed->EndTime;
+
 	// Find largest end time over all bones in this clip.
 	float t = 0.0f;
 	for(UINT i = 0; i < BoneAnimations.size(); ++i)
@@ -104,6 +111,12 @@ float AnimationClip::GetClipEndTime()const
 
 void AnimationClip::Interpolate(float t, std::vector<XMFLOAT4X4>& boneTransforms)const
 {
+	if(Compressed)
+	{
+		Compressed->Interpolate(t, boneTransforms);
+		return;
+	}
+
 	for(UINT i = 0; i < BoneAnimations.size(); ++i)
 	{
 		BoneAnimations[i].Interpolate(t, boneTransforms[i]);
@@ -35,6 +35,8 @@ struct BoneAnimation
 	std::vector<Keyframe> Keyframes; 	
 };
 
+struct CompressedClip;
+
 ///<summary>
 /// Examples of AnimationClips are "Walk", "Run", "Attack", "Defend".
 /// An AnimationClip requires a BoneAnimation for every bone to form
@@ -48,6 +50,10 @@ struct AnimationClip
     void Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& boneTransforms)const;
 
     std::vector<BoneAnimation> BoneAnimations; 	
+
+	// Set when the clip has been compressed (see AnimationCompression.h).  The
+	// compressed keys then replace BoneAnimations, which is left empty.
+	std::shared_ptr<const CompressedClip> Compressed;
 };
 
 class SkinnedData
@@ -64,6 +70,10 @@ public:
 		std::vector<DirectX::XMFLOAT4X4>& boneOffsets,
 		std::unordered_map<std::string, AnimationClip>& animations);
 
+	const std::vector<int>& BoneHierarchy()const { return mBoneHierarchy; }
+	const std::vector<DirectX::XMFLOAT4X4>& BoneOffsets()const { return mBoneOffsets; }
+	const std::unordered_map<std::string, AnimationClip>& Animations()const { return mAnimations; }
+
 	 // In a real project, you'd want to cache the result if there was a chance
 	 // that you were calling this several times with the same clipName at 
 	 // the same timePos.
@@ -12,6 +12,9 @@
 #include "Ssao.h"
 #include "SkinnedData.h"
 #include "LoadM3d.h"
+#include "AnimationSampler.h"
+#include "AnimationCompression.h"
+#include "CrowdAnimator.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -22,25 +25,12 @@ const int gNumFrameResources = 3;
 struct SkinnedModelInstance
 {
     SkinnedData* SkinnedInfo = nullptr;
-    std::vector<DirectX::XMFLOAT4X4> FinalTransforms;
     std::string ClipName;
-    float TimePos = 0.0f;
 
-    // Called every frame and increments the time position, interpolates the 
-    // animations for each bone based on the current animation clip, and 
-    // generates the final transforms which are ultimately set to the effect
-    // for processing in the vertex shader.
-    void UpdateSkinnedAnimation(float dt)
-    {
-        TimePos += dt;
-
-        // Loop animation
-        if(TimePos > SkinnedInfo->GetClipEndTime(ClipName))
-            TimePos = 0.0f;
-
-        // Compute the final transforms for this time position.
-        SkinnedInfo->GetFinalTransforms(ClipName, TimePos, FinalTransforms);
-    }
+    // Slot of this instance in the CrowdAnimator, which advances its time position and
+    // generates its final transforms every frame.  Also its index in the skinned
+    // constant buffer.
+    UINT CrowdIndex = 0;
 };
 
 // Lightweight structure stores parameters to draw a shape.  This will
@@ -189,6 +179,8 @@ private:
     std::string mSkinnedModelFilename = "Models\\soldier.m3d";
     std::unique_ptr<SkinnedModelInstance> mSkinnedModelInst; 
     SkinnedData mSkinnedInfo;
+    AnimationSampler mAnimationSampler;
+    std::unique_ptr<CrowdAnimator> mCrowdAnimator;
     std::vector<M3DLoader::Subset> mSkinnedSubsets;
     std::vector<M3DLoader::M3dMaterial> mSkinnedMats;
     std::vector<std::string> mSkinnedTextureNames;
@@ -565,6 +557,7 @@ void SkinnedMeshApp::AnimateMaterials(const GameTimer& gt)
 
 void SkinnedMeshApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -590,22 +583,17 @@ void SkinnedMeshApp::UpdateObjectCBs(const GameTimer& gt)
 
 void SkinnedMeshApp::UpdateSkinnedCBs(const GameTimer& gt)
 {
+    PROFILE_FUNCTION();
     auto currSkinnedCB = mCurrFrameResource->SkinnedCB.get();
    
-    // We only have one skinned model being animated.
-    mSkinnedModelInst->UpdateSkinnedAnimation(gt.DeltaTime());
-        
-    SkinnedConstants skinnedConstants;
-    std::copy(
-        std::begin(mSkinnedModelInst->FinalTransforms),
-        std::end(mSkinnedModelInst->FinalTransforms),
-        &skinnedConstants.BoneTransforms[0]);
-
-    currSkinnedCB->CopyData(0, skinnedConstants);
+    // Animate every skinned instance, sampling palette i straight into skinned constant
+    // buffer slot i.
+    mCrowdAnimator->Update(gt.DeltaTime(), currSkinnedCB->MappedData(), currSkinnedCB->ElementByteSize());
 }
  
 void SkinnedMeshApp::UpdateMaterialBuffer(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialBuffer = mCurrFrameResource->MaterialBuffer.get();
 	for(auto& e : mMaterials)
 	{
@@ -634,6 +622,7 @@ void SkinnedMeshApp::UpdateMaterialBuffer(const GameTimer& gt)
 
 void SkinnedMeshApp::UpdateShadowTransform(const GameTimer& gt)
 {
+    PROFILE_FUNCTION();
     // Only the first "main" light casts a shadow.
     XMVECTOR lightDir = XMLoadFloat3(&mRotatedLightDirections[0]);
     XMVECTOR lightPos = -2.0f*mSceneBounds.Radius*lightDir;
@@ -674,6 +663,7 @@ void SkinnedMeshApp::UpdateShadowTransform(const GameTimer& gt)
 
 void SkinnedMeshApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = mCamera.GetView();
 	XMMATRIX proj = mCamera.GetProj();
 
@@ -721,6 +711,7 @@ void SkinnedMeshApp::UpdateMainPassCB(const GameTimer& gt)
 
 void SkinnedMeshApp::UpdateShadowPassCB(const GameTimer& gt)
 {
+    PROFILE_FUNCTION();
     XMMATRIX view = XMLoadFloat4x4(&mLightView);
     XMMATRIX proj = XMLoadFloat4x4(&mLightProj);
 
@@ -750,6 +741,7 @@ void SkinnedMeshApp::UpdateShadowPassCB(const GameTimer& gt)
 
 void SkinnedMeshApp::UpdateSsaoCB(const GameTimer& gt)
 {
+    PROFILE_FUNCTION();
     SsaoConstants ssaoCB;
 
     XMMATRIX P = mCamera.GetProj();
@@ -1277,20 +1269,26 @@ void SkinnedMeshApp::BuildShapeGeometry()
 void SkinnedMeshApp::LoadSkinnedModel()
 {
 	std::vector<M3DLoader::SkinnedVertex> vertices;
-	std::vector<std::uint16_t> indices;	
+	std::vector<std::uint32_t> indices;
  
+	// Goes through Models/soldier.m3db, which is written on the first run with the
+	// animation already compressed.
+	AnimationCompressionSettings compression;
 	M3DLoader m3dLoader;
-	m3dLoader.LoadM3d(mSkinnedModelFilename, vertices, indices, 
-        mSkinnedSubsets, mSkinnedMats, mSkinnedInfo);
+	m3dLoader.LoadM3dCached(mSkinnedModelFilename, vertices, indices, 
+        mSkinnedSubsets, mSkinnedMats, mSkinnedInfo, &compression);
+
+    mAnimationSampler.Build(mSkinnedInfo);
+    mCrowdAnimator = std::make_unique<CrowdAnimator>(mAnimationSampler, &ThreadPool::Default());
 
     mSkinnedModelInst = std::make_unique<SkinnedModelInstance>();
     mSkinnedModelInst->SkinnedInfo = &mSkinnedInfo;
-    mSkinnedModelInst->FinalTransforms.resize(mSkinnedInfo.BoneCount());
     mSkinnedModelInst->ClipName = "Take1";
-    mSkinnedModelInst->TimePos = 0.0f;
+    mSkinnedModelInst->CrowdIndex = mCrowdAnimator->AddInstance(
+        mAnimationSampler.FindClip(mSkinnedModelInst->ClipName), 0.0f);
  
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(SkinnedVertex);
-    const UINT ibByteSize = (UINT)indices.size()  * sizeof(std::uint16_t);
+    const UINT ibByteSize = (UINT)indices.size()  * sizeof(std::uint32_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = mSkinnedModelFilename;
@@ -1309,7 +1307,7 @@ void SkinnedMeshApp::LoadSkinnedModel()
 
 	geo->VertexByteStride = sizeof(SkinnedVertex);
 	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = DXGI_FORMAT_R32_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
 
 	for(UINT i = 0; i < (UINT)mSkinnedSubsets.size(); ++i)
@@ -1540,7 +1538,7 @@ void SkinnedMeshApp::BuildFrameResources()
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
             2, (UINT)mAllRitems.size(), 
-            1,
+            mCrowdAnimator->InstanceCount(),
             (UINT)mMaterials.size()));
     }
 }
@@ -1752,7 +1750,7 @@ void SkinnedMeshApp::BuildRenderItems()
 
         // All render items for this solider.m3d instance share
         // the same skinned model instance.
-        ritem->SkinnedCBIndex = 0;
+        ritem->SkinnedCBIndex = mSkinnedModelInst->CrowdIndex;
         ritem->SkinnedModelInst = mSkinnedModelInst.get();
 
         mRitemLayer[(int)RenderLayer::SkinnedOpaque].push_back(ritem.get());
@@ -1762,6 +1760,7 @@ void SkinnedMeshApp::BuildRenderItems()
 
 void SkinnedMeshApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+    PROFILE_FUNCTION();
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
     UINT skinnedCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(SkinnedConstants));
 
@@ -1797,6 +1796,7 @@ void SkinnedMeshApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const s
 
 void SkinnedMeshApp::DrawSceneToShadowMap()
 {
+    PROFILE_FUNCTION();
     mCommandList->RSSetViewports(1, &mShadowMap->Viewport());
     mCommandList->RSSetScissorRects(1, &mShadowMap->ScissorRect());
 
@@ -1830,6 +1830,7 @@ void SkinnedMeshApp::DrawSceneToShadowMap()
  
 void SkinnedMeshApp::DrawNormalsAndDepth()
 {
+	PROFILE_FUNCTION();
 	mCommandList->RSSetViewports(1, &mScreenViewport);
     mCommandList->RSSetScissorRects(1, &mScissorRect);
 
@@ -0,0 +1,127 @@
+//***************************************************************************************
+// main.cpp
+//
+// Vertex compression report.  Packs the SkinnedMesh demo's shapes and the soldier with
+// VertexCompression and prints, per mesh, the vertex buffer size before and after and
+// the largest round trip error of every attribute.  For the soldier it also skins the
+// raw and the packed vertices through every clip and reports the largest distance
+// between the two, which folds the position and weight errors together.
+//
+// Usage: VertexBench [model.m3d]
+//***************************************************************************************
+
+#include "../SkinnedMesh/LoadM3d.h"
+#include "../../Common/VertexCompression.h"
+#include <cstddef>
+#include <cstdio>
+
+using namespace DirectX;
+
+void PrintReport(const char* name, std::uint32_t vertexCount, const VertexCompressionReport& report)
+{
+	std::printf("%-10s %9u %9.1f %9.1f %6.2fx %11.6f %9.5f %9.5f %9.6f %9.5f\n", name, vertexCount,
+		report.RawBytes / 1024.0, report.PackedBytes / 1024.0,
+		report.PackedBytes > 0 ? (double)report.RawBytes / report.PackedBytes : 0.0,
+		report.MaxPositionError, report.MaxNormalError, report.MaxTangentError,
+		report.MaxTexCoordError, report.MaxBoneWeightError);
+}
+
+// Skins a position the way the vertex shader does.  finalTransforms are transposed, as
+// GetFinalTransforms writes them for the constant buffer.
+XMVECTOR SkinPosition(const XMFLOAT3& pos, const float weights[4], const BYTE boneIndices[4],
+	const std::vector<XMFLOAT4X4>& finalTransforms)
+{
+	XMVECTOR skinned = XMVectorZero();
+	for(int i = 0; i < 4; ++i)
+	{
+		XMMATRIX M = XMMatrixTranspose(XMLoadFloat4x4(&finalTransforms[boneIndices[i]]));
+		skinned = XMVectorAdd(skinned, XMVectorScale(XMVector3TransformCoord(XMLoadFloat3(&pos), M), weights[i]));
+	}
+	return skinned;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string m3dFilename = argc > 1 ? argv[1] : "../SkinnedMesh/Models/soldier.m3d";
+
+	std::printf("%-10s %9s %9s %9s %7s %11s %9s %9s %9s %9s\n", "mesh", "vertices", "raw KB", "packed KB",
+		"ratio", "position", "normal", "tangent", "texcoord", "weight");
+
+	// SkinnedMeshApp::BuildShapeGeometry.
+	GeometryGenerator geoGen;
+	const std::pair<const char*, GeometryGenerator::MeshData> shapes[] =
+	{
+		{ "box", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3) },
+		{ "grid", geoGen.CreateGrid(20.0f, 30.0f, 60, 40) },
+		{ "sphere", geoGen.CreateSphere(0.5f, 20, 20) },
+		{ "cylinder", geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20) }
+	};
+
+	std::vector<PackedVertex> packed;
+	PositionQuantization quantization;
+	VertexCompressionReport report;
+	for(const auto& shape : shapes)
+	{
+		PackVertices(GetVertexStreams(shape.second), packed, quantization, &report);
+		PrintReport(shape.first, (std::uint32_t)packed.size(), report);
+	}
+
+	M3DLoader loader;
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<std::uint32_t> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3dMaterial> mats;
+	SkinnedData skinInfo;
+	if(!loader.LoadM3d(m3dFilename, vertices, indices, subsets, mats, skinInfo) || vertices.empty())
+	{
+		std::printf("Could not load %s.\n", m3dFilename.c_str());
+		return 1;
+	}
+
+	VertexStreams streams;
+	streams.Count = (std::uint32_t)vertices.size();
+	streams.Stride = sizeof(M3DLoader::SkinnedVertex);
+	streams.Positions = &vertices[0].Pos;
+	streams.Normals = &vertices[0].Normal;
+	streams.Tangents = &vertices[0].TangentU;
+	streams.TexCoords = &vertices[0].TexC;
+	streams.BoneWeights = &vertices[0].BoneWeights;
+	streams.BoneIndices = vertices[0].BoneIndices;
+
+	std::vector<PackedSkinnedVertex> packedSkinned;
+	PackSkinnedVertices(streams, packedSkinned, quantization, &report);
+	PrintReport("soldier", streams.Count, report);
+
+	std::vector<XMFLOAT4X4> finalTransforms(skinInfo.BoneCount());
+	for(const auto& clip : skinInfo.Animations())
+	{
+		float startTime = skinInfo.GetClipStartTime(clip.first);
+		float endTime = skinInfo.GetClipEndTime(clip.first);
+
+		float maxError = 0.0f;
+		const int sampleCount = 60;
+		for(int s = 0; s <= sampleCount; ++s)
+		{
+			skinInfo.GetFinalTransforms(clip.first, startTime + (endTime - startTime)*s / sampleCount, finalTransforms);
+
+			for(std::uint32_t i = 0; i < streams.Count; ++i)
+			{
+				const M3DLoader::SkinnedVertex& v = vertices[i];
+				const PackedSkinnedVertex& p = packedSkinned[i];
+
+				float weights[4] = { v.BoneWeights.x, v.BoneWeights.y, v.BoneWeights.z,
+					1.0f - v.BoneWeights.x - v.BoneWeights.y - v.BoneWeights.z };
+				XMFLOAT4 packedWeights = UnpackBoneWeights(p.BoneWeights);
+				float unpackedWeights[4] = { packedWeights.x, packedWeights.y, packedWeights.z, packedWeights.w };
+
+				XMVECTOR raw = SkinPosition(v.Pos, weights, v.BoneIndices, finalTransforms);
+				XMVECTOR unpacked = SkinPosition(UnpackPosition(p.Position, quantization), unpackedWeights, p.BoneIndices, finalTransforms);
+				maxError = MathHelper::Max(maxError, XMVectorGetX(XMVector3Length(XMVectorSubtract(raw, unpacked))));
+			}
+		}
+
+		std::printf("clip \"%s\": max skinned vertex error %g\n", clip.first.c_str(), maxError);
+	}
+
+	return 0;
+}
@@ -74,12 +74,13 @@ void InitDirect3DApp::OnResize()
 
 void InitDirect3DApp::Update(const GameTimer& gt) //  ߻ ޼   ȣȴ. ð 帧   α׷ (̸׸ 
 {												  // ִϸ̼ , ī޶ ̵, 浹 ,  Է ó )  ޼ ؾѴ.
-
+    PROFILE_FUNCTION();
 }
 
 void InitDirect3DApp::Draw(const GameTimer& gt) //  ߻ ޼嵵   ȣȴ.  ޼忡   ĸ ۿ  ׸ 
 {												//  ɵ ϴ ۾ .   ׸ Ŀ IDXGISwapChain::Present ޼带 ȣؼ
 												// ĸ ۸ ȭ鿡 ؾѴ.
+    PROFILE_FUNCTION();
     // Reuse the memory associated with command recording.
     // We can only reset when the associated command lists have finished execution on the GPU.
 	//  Ͽ õ ޸ Ȱ   Ҵڸ 缳Ѵ.
@@ -153,6 +153,7 @@ void BoxApp::OnResize()
 
 void BoxApp::Update(const GameTimer& gt)
 {
+    PROFILE_FUNCTION();
     // Convert Spherical to Cartesian coordinates.
     //  ǥ īƮ ǥ( ǥ) ȯѴ.
     float x = mRadius*sinf(mPhi)*cosf(mTheta);
@@ -181,6 +182,7 @@ void BoxApp::Update(const GameTimer& gt)
 
 void BoxApp::Draw(const GameTimer& gt)
 {
+    PROFILE_FUNCTION();
     // Reuse the memory associated with command recording.
     // We can only reset when the associated command lists have finished execution on the GPU.
     //  Ͽ õ ޸ Ȱ   Ҵڸ 缳Ѵ.
@@ -0,0 +1,290 @@
+//***************************************************************************************
+// main.cpp
+//
+// Runs the LandAndWaves wave update headless, through the FrameLoop D3DApp uses, with
+// no window or device:
+//   - fixed 60 Hz updates that ignore the clock, as fast as they go, twice from the same
+//     seed, which must end in the same water,
+//   - a variable timestep paced to 60 frames per second, reporting how evenly the frames
+//     land,
+//   - fixed 120 Hz updates at a 60 frames per second pace, which should average two
+//     updates per frame and keep simulation time with real time.
+// The unpaced runs are timed with FrameTelemetry, which can write them out and check
+// them against budgets, exiting with 1 if one is exceeded, so CI can catch a regression
+// in the tail as well as the average.
+//
+// Usage: HeadlessWaves [frames] [-csv file] [-json file] [-budget scope:percentile:ms]...
+//   e.g. HeadlessWaves 600 -json waves.json -budget Update:99:0.5 -budget CPU:100:2
+//
+// Nothing here needs Windows, so a CI machine without Visual Studio can build it from
+// this directory with any C++14 compiler and DirectXMath (github.com/microsoft/DirectXMath;
+// its README covers the sal.h it wants outside Windows):
+//   g++ -std=c++14 -O2 -pthread -I<DirectXMath>/Inc -o HeadlessWaves main.cpp
+//       ../LandAndWaves/Waves.cpp ../../Common/FrameLoop.cpp ../../Common/FrameTelemetry.cpp
+//       ../../Common/GameTimer.cpp ../../Common/ThreadPool.cpp
+//***************************************************************************************
+
+#include "../LandAndWaves/Waves.h"
+#include "../../Common/FrameLoop.h"
+#include "../../Common/FrameTelemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// MathHelper::Rand and RandF, without the <Windows.h> that MathHelper.h brings in.  Same
+// expressions, so a seed gives the same waves as LandAndWavesApp.
+int Rand(int a, int b)
+{
+	return a + std::rand() % ((b - a) + 1);
+}
+
+float RandF(float a, float b)
+{
+	return a + ((float)std::rand() / (float)RAND_MAX)*(b - a);
+}
+
+// LandAndWavesApp's waves and UpdateWaves, minus the vertex buffer copy.
+class WaveSimulation
+{
+public:
+	WaveSimulation() : mWaves(128, 128, 1.0f, 0.03f, 4.0f, 0.2f) {}
+
+	void Update(const GameTimer& gt)
+	{
+		// Every quarter second, generate a random wave.
+		if((gt.TotalTime() - mBaseTime) >= 0.25f)
+		{
+			mBaseTime += 0.25f;
+
+			int i = Rand(4, mWaves.RowCount() - 5);
+			int j = Rand(4, mWaves.ColumnCount() - 5);
+
+			float r = RandF(0.2f, 0.5f);
+
+			mWaves.Disturb(i, j, r);
+		}
+
+		mWaves.Update(gt.DeltaTime());
+	}
+
+	double Checksum()const
+	{
+		double sum = 0.0;
+		for(int i = 0; i < mWaves.VertexCount(); ++i)
+			sum += std::fabs(mWaves.Position(i).y)*(1 + i % 7);
+		return sum;
+	}
+
+private:
+	Waves mWaves;
+	float mBaseTime = 0.0f;
+};
+
+struct PacingStats
+{
+	double MeanMs = 0.0;
+	double MinMs = 1e30;
+	double MaxMs = 0.0;
+	double StdDevMs = 0.0;
+};
+
+// Frame to frame intervals, in milliseconds.
+PacingStats MeasurePacing(const std::vector<Clock::time_point>& frameTimes)
+{
+	PacingStats stats;
+	std::vector<double> intervals;
+	for(size_t i = 1; i < frameTimes.size(); ++i)
+		intervals.push_back(std::chrono::duration<double, std::milli>(frameTimes[i] - frameTimes[i - 1]).count());
+	if(intervals.empty())
+		return stats;
+
+	for(double ms : intervals)
+	{
+		stats.MeanMs += ms;
+		stats.MinMs = std::min(stats.MinMs, ms);
+		stats.MaxMs = std::max(stats.MaxMs, ms);
+	}
+	stats.MeanMs /= intervals.size();
+
+	for(double ms : intervals)
+		stats.StdDevMs += (ms - stats.MeanMs)*(ms - stats.MeanMs);
+	stats.StdDevMs = std::sqrt(stats.StdDevMs / intervals.size());
+	return stats;
+}
+
+// Parses scope:percentile:ms.
+bool ParseBudget(const char* text, FrameTimeBudget& budget)
+{
+	const char* colon = std::strchr(text, ':');
+	if(colon == nullptr || colon == text)
+		return false;
+
+	char* end = nullptr;
+	budget.Scope.assign(text, colon);
+	budget.Percentile = std::strtod(colon + 1, &end);
+	if(*end != ':')
+		return false;
+	budget.MaxMs = std::strtod(end + 1, &end);
+	return *end == '\0';
+}
+
+void PrintStats(const char* name, const FrameStats& stats)
+{
+	std::printf("  %-8s %6llu frames: %8.3f ms mean, %8.3f p50, %8.3f p95, %8.3f p99, %8.3f max\n", name,
+		(unsigned long long)stats.Count, stats.MeanMs, stats.P50Ms, stats.P95Ms, stats.P99Ms, stats.MaxMs);
+}
+
+int main(int argc, char* argv[])
+{
+	int frameCount = 240;
+	std::string csvFilename;
+	std::string jsonFilename;
+	std::vector<FrameTimeBudget> budgets;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "-csv") == 0 && i + 1 < argc)
+			csvFilename = argv[++i];
+		else if(std::strcmp(argv[i], "-json") == 0 && i + 1 < argc)
+			jsonFilename = argv[++i];
+		else if(std::strcmp(argv[i], "-budget") == 0 && i + 1 < argc)
+		{
+			FrameTimeBudget budget;
+			if(!ParseBudget(argv[++i], budget))
+			{
+				std::printf("Bad budget %s; expected scope:percentile:ms.\n", argv[i]);
+				return 2;
+			}
+			budgets.push_back(budget);
+		}
+		else
+			frameCount = std::max(2, std::atoi(argv[i]));
+	}
+
+	GameTimer clock;
+
+	FrameTelemetry telemetry;
+	const std::uint32_t updateScope = telemetry.RegisterScope("Update");
+	telemetry.SetHistoryCapacity(2*frameCount);
+
+	//
+	// Fixed timestep, unpaced and off the clock.
+	//
+
+	double checksums[2];
+	for(int run = 0; run < 2; ++run)
+	{
+		std::srand(1);
+		auto simulation = std::make_unique<WaveSimulation>();
+
+		FrameLoopSettings settings;
+		settings.Timestep = FrameTimestep::Fixed;
+		settings.FixedDeltaTime = 1.0 / 60.0;
+		settings.IgnoreClock = true;
+
+		FrameLoop loop(clock, settings);
+		loop.Reset();
+
+		auto update = [&](const GameTimer& gt)
+		{
+			FrameTelemetry::ScopeTimer scope(telemetry, updateScope);
+			simulation->Update(gt);
+		};
+
+		auto start = Clock::now();
+		for(int f = 0; f < frameCount; ++f)
+		{
+			telemetry.BeginFrame();
+			loop.RunFrame(update, nullptr);
+			telemetry.EndFrame();
+
+			// The ring holds 1024 frames; drain well before it fills.
+			if(f % 256 == 255)
+				telemetry.Drain();
+		}
+		double wallMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		checksums[run] = simulation->Checksum();
+		if(run == 0)
+		{
+			double simMs = 1000.0*loop.SimulationTimer().TotalTime();
+			std::printf("fixed 60 Hz, off the clock: %d updates, %.0f ms simulated in %.1f ms (%.0fx real time), %.1f us per update\n",
+				frameCount, simMs, wallMs, simMs / wallMs, 1000.0*wallMs / frameCount);
+		}
+	}
+
+	if(checksums[0] != checksums[1])
+	{
+		std::printf("Two runs from the same seed ended in different water: %.9g and %.9g.\n", checksums[0], checksums[1]);
+		return 1;
+	}
+	std::printf("  two runs from the same seed match (checksum %.6g)\n", checksums[0]);
+
+	telemetry.Drain();
+	for(std::uint32_t scope = 0; scope < telemetry.ScopeCount(); ++scope)
+		PrintStats(telemetry.ScopeName(scope).c_str(), telemetry.Stats(scope));
+
+	//
+	// Paced to 60 frames per second, with a variable and a fixed 120 Hz timestep.
+	//
+
+	const FrameTimestep timesteps[] = { FrameTimestep::Variable, FrameTimestep::Fixed };
+	for(FrameTimestep timestep : timesteps)
+	{
+		std::srand(1);
+		auto simulation = std::make_unique<WaveSimulation>();
+
+		FrameLoopSettings settings;
+		settings.Timestep = timestep;
+		settings.FixedDeltaTime = 1.0 / 120.0;
+		settings.TargetFrameRate = 60.0;
+
+		FrameLoop loop(clock, settings);
+		loop.Reset();
+
+		std::vector<Clock::time_point> frameTimes;
+		frameTimes.reserve(frameCount);
+		std::uint64_t updates = 0;
+		for(int f = 0; f < frameCount; ++f)
+		{
+			updates += loop.RunFrame([&](const GameTimer& gt) { simulation->Update(gt); }, nullptr);
+			frameTimes.push_back(Clock::now());
+		}
+
+		PacingStats pacing = MeasurePacing(frameTimes);
+		std::printf("%s, paced to 60 fps: frame %.3f ms mean, %.3f min, %.3f max, %.3f std dev; %.2f updates per frame; simulated %.3f s of %.3f s\n",
+			timestep == FrameTimestep::Variable ? "variable" : "fixed 120 Hz",
+			pacing.MeanMs, pacing.MinMs, pacing.MaxMs, pacing.StdDevMs, (double)updates / frameCount,
+			loop.SimulationTimer().TotalTime(), clock.TotalTime());
+	}
+
+	if(!csvFilename.empty() && !telemetry.WriteCsv(csvFilename))
+	{
+		std::printf("Could not write %s.\n", csvFilename.c_str());
+		return 2;
+	}
+	if(!jsonFilename.empty() && !telemetry.WriteJson(jsonFilename))
+	{
+		std::printf("Could not write %s.\n", jsonFilename.c_str());
+		return 2;
+	}
+
+	std::vector<std::string> failures;
+	if(!telemetry.CheckBudgets(budgets, &failures))
+	{
+		for(const auto& failure : failures)
+			std::printf("over budget: %s\n", failure.c_str());
+		return 1;
+	}
+	if(!budgets.empty())
+		std::printf("%d budgets met\n", (int)budgets.size());
+
+	return 0;
+}
@@ -8,6 +8,7 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/MeshletBuilder.h"
 #include "FrameResource.h"
 #include "Waves.h"
 
@@ -78,6 +79,7 @@ private:
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 	void UpdateWaves(const GameTimer& gt);
+	void UpdateLandIndices(const GameTimer& gt);
 
     void BuildRootSignature();
     void BuildShadersAndInputLayout();
@@ -108,6 +110,13 @@ private:
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
 	RenderItem* mWavesRitem = nullptr;
+	RenderItem* mLandRitem = nullptr;
+
+	// The land is drawn from an index buffer rebuilt every frame from the meshlets that
+	// pass frustum and backface culling.
+	MeshletSet mLandMeshlets;
+	std::vector<std::uint32_t> mVisibleLandMeshlets;
+	std::vector<std::uint16_t> mVisibleLandIndices;
 
 	// List of all the render items.
 	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
@@ -184,7 +193,6 @@ bool LandAndWavesApp::Initialize()
 	BuildLandGeometry();
     BuildWavesGeometryBuffers();
     BuildRenderItems();
-	BuildRenderItems();
     BuildFrameResources();
 	BuildPSOs();
 
@@ -230,6 +238,7 @@ void LandAndWavesApp::Update(const GameTimer& gt)
 	UpdateObjectCBs(gt);
 	UpdateMainPassCB(gt);
 	UpdateWaves(gt);
+	UpdateLandIndices(gt);
 }
 
 void LandAndWavesApp::Draw(const GameTimer& gt)
@@ -352,6 +361,7 @@ void LandAndWavesApp::OnKeyboardInput(const GameTimer& gt)
 
 void LandAndWavesApp::UpdateCamera(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Convert Spherical to Cartesian coordinates.
 	mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
 	mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
@@ -368,6 +378,7 @@ void LandAndWavesApp::UpdateCamera(const GameTimer& gt)
 
 void LandAndWavesApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -390,6 +401,7 @@ void LandAndWavesApp::UpdateObjectCBs(const GameTimer& gt)
 
 void LandAndWavesApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = XMLoadFloat4x4(&mView);
 	XMMATRIX proj = XMLoadFloat4x4(&mProj);
 
@@ -418,6 +430,7 @@ void LandAndWavesApp::UpdateMainPassCB(const GameTimer& gt)
 
 void LandAndWavesApp::UpdateWaves(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Every quarter second, generate a random wave.
 	static float t_base = 0.0f;
 	if((mTimer.TotalTime() - t_base) >= 0.25f)
@@ -451,6 +464,30 @@ void LandAndWavesApp::UpdateWaves(const GameTimer& gt)
 	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
 }
 
+void LandAndWavesApp::UpdateLandIndices(const GameTimer& gt)
+{
+	PROFILE_FUNCTION();
+	// The land's world matrix is the identity, so its local space is world space.
+	XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&mView), XMLoadFloat4x4(&mProj));
+	CullingFrustum frustum = CullingFrustum::FromViewProj(viewProj);
+	XMVECTOR eyePos = XMVectorSet(mEyePos.x, mEyePos.y, mEyePos.z, 1.0f);
+
+	mVisibleLandMeshlets.clear();
+	CullMeshlets(mLandMeshlets, frustum, eyePos, mVisibleLandMeshlets);
+
+	mVisibleLandIndices.clear();
+	for(std::uint32_t i : mVisibleLandMeshlets)
+		AppendMeshletIndices(mLandMeshlets, i, mVisibleLandIndices);
+
+	auto currLandIB = mCurrFrameResource->LandIB.get();
+	if(!mVisibleLandIndices.empty())
+		CopyMemory(currLandIB->MappedData(), mVisibleLandIndices.data(), mVisibleLandIndices.size()*sizeof(std::uint16_t));
+
+	// Set the dynamic IB of the land renderitem to the current frame IB.
+	mLandRitem->Geo->IndexBufferGPU = currLandIB->Resource();
+	mLandRitem->IndexCount = (UINT)mVisibleLandIndices.size();
+}
+
 void LandAndWavesApp::BuildRootSignature()
 {
     // Root parameter can be a table, root descriptor or root constants.
@@ -509,8 +546,8 @@ void LandAndWavesApp::BuildLandGeometry()
 	for(size_t i = 0; i < grid.Vertices.size(); ++i)
 	{
 		auto& p = grid.Vertices[i].Position;
+		p.y = GetHillsHeight(p.x, p.z);
 		vertices[i].Pos = p;
-		vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
 
         // Color the vertex based on its height.
         if(vertices[i].Pos.y < -10.0f)
@@ -557,8 +594,8 @@ void LandAndWavesApp::BuildLandGeometry()
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
 		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	// Set dynamically.
+	geo->IndexBufferGPU = nullptr;
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -573,6 +610,8 @@ void LandAndWavesApp::BuildLandGeometry()
 	geo->DrawArgs["grid"] = submesh;
 
 	mGeometries["landGeo"] = std::move(geo);
+
+	BuildMeshlets(grid, mLandMeshlets);
 }
 
 void LandAndWavesApp::BuildWavesGeometryBuffers()
@@ -677,7 +716,7 @@ void LandAndWavesApp::BuildFrameResources()
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            1, (UINT)mAllRitems.size(), mWaves->VertexCount()));
+            1, (UINT)mAllRitems.size(), mWaves->VertexCount(), mGeometries["landGeo"]->DrawArgs["grid"].IndexCount));
     }
 }
 
@@ -705,6 +744,8 @@ void LandAndWavesApp::BuildRenderItems()
 	gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
 	gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
 
+	mLandRitem = gridRitem.get();
+
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(gridRitem.get());
 
 	mAllRitems.push_back(std::move(wavesRitem));
@@ -713,6 +754,7 @@ void LandAndWavesApp::BuildRenderItems()
 
 void LandAndWavesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+	PROFILE_FUNCTION();
 	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
 
 	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
@@ -3,13 +3,47 @@
 //***************************************************************************************
 
 #include "Waves.h"
-#include <ppl.h>
+#include "../../Common/SimdFloat.h"
+#include "../../Common/ThreadPool.h"
 #include <algorithm>
 #include <vector>
 #include <cassert>
+#include <cmath>
 
 using namespace DirectX;
 
+namespace
+{
+	// Rows handed to a thread at a time.  Large enough that a 512 wide grid gives each
+	// chunk a few hundred KB of work, small enough to balance across cores.
+	const int RowsPerTask = 16;
+
+	// One grid point of the height update.  The vector kernel evaluates the same
+	// expression in the same order.
+	inline float StepHeight(float k1, float k2, float k3, float prev, float curr,
+		float down, float up, float right, float left)
+	{
+		return k1*prev + k2*curr + k3*(down + up + right + left);
+	}
+
+	// One grid point of the normal/tangent pass.
+	inline void NormalAndTangent(float l, float r, float t, float b, float twoDx,
+		float& nx, float& ny, float& nz, float& tx, float& ty)
+	{
+		float x = l - r;
+		float z = b - t;
+		float invLen = 1.0f / std::sqrt(x*x + twoDx*twoDx + z*z);
+		nx = x*invLen;
+		ny = twoDx*invLen;
+		nz = z*invLen;
+
+		float y = r - l;
+		float invLenT = 1.0f / std::sqrt(twoDx*twoDx + y*y);
+		tx = twoDx*invLenT;
+		ty = y*invLenT;
+	}
+}
+
 Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
 {
     mNumRows = m;
@@ -27,28 +61,26 @@ Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
     mK2 = (4.0f - 8.0f*e) / d;
     mK3 = (2.0f*e) / d;
 
-    mPrevSolution.resize(m*n);
-    mCurrSolution.resize(m*n);
-    mNormals.resize(m*n);
-    mTangentX.resize(m*n);
+    mPrevHeights.assign(m*n, 0.0f);
+    mCurrHeights.assign(m*n, 0.0f);
+    mNormalX.assign(m*n, 0.0f);
+    mNormalY.assign(m*n, 1.0f);
+    mNormalZ.assign(m*n, 0.0f);
+    mTangentX.assign(m*n, 1.0f);
+    mTangentY.assign(m*n, 0.0f);
 
-    // Generate grid vertices in system memory.
+    // Generate grid coordinates in system memory.
 
     float halfWidth = (n - 1)*dx*0.5f;
     float halfDepth = (m - 1)*dx*0.5f;
+
+    mRowZ.resize(m);
     for(int i = 0; i < m; ++i)
-    {
-        float z = halfDepth - i*dx;
-        for(int j = 0; j < n; ++j)
-        {
-            float x = -halfWidth + j*dx;
-
-            mPrevSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
-            mCurrSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
-            mNormals[i*n + j] = XMFLOAT3(0.0f, 1.0f, 0.0f);
-            mTangentX[i*n + j] = XMFLOAT3(1.0f, 0.0f, 0.0f);
-        }
-    }
+        mRowZ[i] = halfDepth - i*dx;
+
+    mColumnX.resize(n);
+    for(int j = 0; j < n; ++j)
+        mColumnX[j] = -halfWidth + j*dx;
 }
 
 Waves::~Waves()
@@ -87,73 +119,185 @@ float Waves::Depth()const
 
 void Waves::Update(float dt)
 {
-	static float t = 0;
-
-	// Accumulate time.
-	t += dt;
+	// Accumulate time.  This is per instance so two solvers (e.g. a Scalar and a Simd
+	// one being compared) step independently.
+	mAccumTime += dt;
 
 	// Only update the simulation at the specified time step.
-	if( t >= mTimeStep )
+	if( mAccumTime >= mTimeStep )
 	{
+		ThreadPool& pool = ThreadPool::Default();
+		const bool simd = mSolverMode == SolverMode::Simd;
+
 		// Only update interior points; we use zero boundary conditions.
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
-		//for(int i = 1; i < mNumRows-1; ++i)
+		pool.ParallelForRange(1, mNumRows - 1, RowsPerTask, [this, simd](int first, int last)
 		{
-			for(int j = 1; j < mNumCols-1; ++j)
-			{
-				// After this update we will be discarding the old previous
-				// buffer, so overwrite that buffer with the new update.
-				// Note how we can do this inplace (read/write to same element) 
-				// because we won't need prev_ij again and the assignment happens last.
-
-				// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
-				// Moreover, our +z axis goes "down"; this is just to 
-				// keep consistent with our row indices going down.
-
-				mPrevSolution[i*mNumCols+j].y = 
-					mK1*mPrevSolution[i*mNumCols+j].y +
-					mK2*mCurrSolution[i*mNumCols+j].y +
-					mK3*(mCurrSolution[(i+1)*mNumCols+j].y + 
-					     mCurrSolution[(i-1)*mNumCols+j].y + 
-					     mCurrSolution[i*mNumCols+j+1].y + 
-						 mCurrSolution[i*mNumCols+j-1].y);
-			}
+			if(simd)
+				UpdateHeightsSimd(first, last);
+			else
+				UpdateHeightsScalar(first, last);
 		});
 
 		// We just overwrote the previous buffer with the new data, so
 		// this data needs to become the current solution and the old
 		// current solution becomes the new previous solution.
-		std::swap(mPrevSolution, mCurrSolution);
+		std::swap(mPrevHeights, mCurrHeights);
 
-		t = 0.0f; // reset time
+		mAccumTime = 0.0f; // reset time
 
 		//
 		// Compute normals using finite difference scheme.
 		//
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
-		//for(int i = 1; i < mNumRows - 1; ++i)
+		pool.ParallelForRange(1, mNumRows - 1, RowsPerTask, [this, simd](int first, int last)
 		{
-			for(int j = 1; j < mNumCols-1; ++j)
-			{
-				float l = mCurrSolution[i*mNumCols+j-1].y;
-				float r = mCurrSolution[i*mNumCols+j+1].y;
-				float t = mCurrSolution[(i-1)*mNumCols+j].y;
-				float b = mCurrSolution[(i+1)*mNumCols+j].y;
-				mNormals[i*mNumCols+j].x = -r+l;
-				mNormals[i*mNumCols+j].y = 2.0f*mSpatialStep;
-				mNormals[i*mNumCols+j].z = b-t;
-
-				XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&mNormals[i*mNumCols+j]));
-				XMStoreFloat3(&mNormals[i*mNumCols+j], n);
-
-				mTangentX[i*mNumCols+j] = XMFLOAT3(2.0f*mSpatialStep, r-l, 0.0f);
-				XMVECTOR T = XMVector3Normalize(XMLoadFloat3(&mTangentX[i*mNumCols+j]));
-				XMStoreFloat3(&mTangentX[i*mNumCols+j], T);
-			}
+			if(simd)
+				UpdateNormalsSimd(first, last);
+			else
+				UpdateNormalsScalar(first, last);
 		});
 	}
 }
 
+void Waves::UpdateHeightsScalar(int firstRow, int lastRow)
+{
+	const int n = mNumCols;
+
+	for(int i = firstRow; i < lastRow; ++i)
+	{
+		// After this update we will be discarding the old previous
+		// buffer, so overwrite that buffer with the new update.
+		// Note how we can do this inplace (read/write to same element)
+		// because we won't need prev_ij again and the assignment happens last.
+
+		// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
+		// Moreover, our +z axis goes "down"; this is just to
+		// keep consistent with our row indices going down.
+		float* prev = &mPrevHeights[i*n];
+		const float* curr = &mCurrHeights[i*n];
+		const float* down = curr + n;
+		const float* up = curr - n;
+
+		for(int j = 1; j < n - 1; ++j)
+		{
+			prev[j] = StepHeight(mK1, mK2, mK3, prev[j], curr[j],
+				down[j], up[j], curr[j+1], curr[j-1]);
+		}
+	}
+}
+
+void Waves::UpdateHeightsSimd(int firstRow, int lastRow)
+{
+#if defined(SIMD_FLOAT_AVX) || defined(SIMD_FLOAT_SSE) || defined(SIMD_FLOAT_NEON)
+	const int n = mNumCols;
+	const FloatV k1 = SplatV(mK1);
+	const FloatV k2 = SplatV(mK2);
+	const FloatV k3 = SplatV(mK3);
+
+	for(int i = firstRow; i < lastRow; ++i)
+	{
+		float* prev = &mPrevHeights[i*n];
+		const float* curr = &mCurrHeights[i*n];
+		const float* down = curr + n;
+		const float* up = curr - n;
+
+		int j = 1;
+		for(; j + (int)FloatVWidth <= n - 1; j += FloatVWidth)
+		{
+			FloatV sum = AddV(AddV(AddV(LoadV(down + j), LoadV(up + j)),
+				LoadV(curr + j + 1)), LoadV(curr + j - 1));
+
+			FloatV h = AddV(AddV(MulV(k1, LoadV(prev + j)), MulV(k2, LoadV(curr + j))),
+				MulV(k3, sum));
+
+			StoreV(prev + j, h);
+		}
+
+		// Remainder columns that do not fill a whole vector.
+		for(; j < n - 1; ++j)
+		{
+			prev[j] = StepHeight(mK1, mK2, mK3, prev[j], curr[j],
+				down[j], up[j], curr[j+1], curr[j-1]);
+		}
+	}
+#else
+	UpdateHeightsScalar(firstRow, lastRow);
+#endif
+}
+
+void Waves::UpdateNormalsScalar(int firstRow, int lastRow)
+{
+	const int n = mNumCols;
+	const float twoDx = 2.0f*mSpatialStep;
+
+	for(int i = firstRow; i < lastRow; ++i)
+	{
+		const float* h = &mCurrHeights[i*n];
+		const float* top = h - n;
+		const float* bottom = h + n;
+
+		for(int j = 1; j < n - 1; ++j)
+		{
+			int k = i*n + j;
+			NormalAndTangent(h[j-1], h[j+1], top[j], bottom[j], twoDx,
+				mNormalX[k], mNormalY[k], mNormalZ[k], mTangentX[k], mTangentY[k]);
+		}
+	}
+}
+
+void Waves::UpdateNormalsSimd(int firstRow, int lastRow)
+{
+#if defined(SIMD_FLOAT_AVX) || defined(SIMD_FLOAT_SSE) || defined(SIMD_FLOAT_NEON)
+	const int n = mNumCols;
+	const float twoDx = 2.0f*mSpatialStep;
+	const FloatV twoDxV = SplatV(twoDx);
+	const FloatV twoDxSqV = MulV(twoDxV, twoDxV);
+	const FloatV one = SplatV(1.0f);
+
+	for(int i = firstRow; i < lastRow; ++i)
+	{
+		const float* h = &mCurrHeights[i*n];
+		const float* top = h - n;
+		const float* bottom = h + n;
+
+		float* nx = &mNormalX[i*n];
+		float* ny = &mNormalY[i*n];
+		float* nz = &mNormalZ[i*n];
+		float* tx = &mTangentX[i*n];
+		float* ty = &mTangentY[i*n];
+
+		int j = 1;
+		for(; j + (int)FloatVWidth <= n - 1; j += FloatVWidth)
+		{
+			FloatV l = LoadV(h + j - 1);
+			FloatV r = LoadV(h + j + 1);
+			FloatV t = LoadV(top + j);
+			FloatV b = LoadV(bottom + j);
+
+			FloatV x = SubV(l, r);
+			FloatV z = SubV(b, t);
+			FloatV lenSq = AddV(AddV(MulV(x, x), twoDxSqV), MulV(z, z));
+			FloatV invLen = DivV(one, SqrtV(lenSq));
+			StoreV(nx + j, MulV(x, invLen));
+			StoreV(ny + j, MulV(twoDxV, invLen));
+			StoreV(nz + j, MulV(z, invLen));
+
+			FloatV y = SubV(r, l);
+			FloatV invLenT = DivV(one, SqrtV(AddV(twoDxSqV, MulV(y, y))));
+			StoreV(tx + j, MulV(twoDxV, invLenT));
+			StoreV(ty + j, MulV(y, invLenT));
+		}
+
+		for(; j < n - 1; ++j)
+		{
+			NormalAndTangent(h[j-1], h[j+1], top[j], bottom[j], twoDx,
+				nx[j], ny[j], nz[j], tx[j], ty[j]);
+		}
+	}
+#else
+	UpdateNormalsScalar(firstRow, lastRow);
+#endif
+}
+
 void Waves::Disturb(int i, int j, float magnitude)
 {
 	// Don't disturb boundaries.
@@ -163,10 +307,9 @@ void Waves::Disturb(int i, int j, float magnitude)
 	float halfMag = 0.5f*magnitude;
 
 	// Disturb the ijth vertex height and its neighbors.
-	mCurrSolution[i*mNumCols+j].y     += magnitude;
-	mCurrSolution[i*mNumCols+j+1].y   += halfMag;
-	mCurrSolution[i*mNumCols+j-1].y   += halfMag;
-	mCurrSolution[(i+1)*mNumCols+j].y += halfMag;
-	mCurrSolution[(i-1)*mNumCols+j].y += halfMag;
+	mCurrHeights[i*mNumCols+j]     += magnitude;
+	mCurrHeights[i*mNumCols+j+1]   += halfMag;
+	mCurrHeights[i*mNumCols+j-1]   += halfMag;
+	mCurrHeights[(i+1)*mNumCols+j] += halfMag;
+	mCurrHeights[(i-1)*mNumCols+j] += halfMag;
 }
-	
@@ -0,0 +1,104 @@
+//***************************************************************************************
+// main.cpp
+//
+// Reports the post-transform vertex cache efficiency of every GeometryGenerator shape
+// and the text models, as generated and after MeshOptimizer: ACMR and ATVR for a FIFO
+// cache of 16 and 32 entries.  "cache" is after OptimizeVertexCache alone, "full" after
+// the overdraw sort and vertex fetch pass as well, which is what OptimizeMesh and
+// MeshCache produce.
+//
+// Usage: MeshOptBench [model.txt ...]
+//***************************************************************************************
+
+#include "../../Common/GeometryGenerator.h"
+#include "../../Common/MeshOptimizer.h"
+#include "../../Common/MeshCache.h"
+#include <cstdio>
+#include <string>
+
+struct NamedMesh
+{
+	std::string Name;
+	std::vector<DirectX::XMFLOAT3> Positions;
+	std::vector<std::uint32_t> Indices;
+};
+
+NamedMesh FromMeshData(const std::string& name, const GeometryGenerator::MeshData& meshData)
+{
+	NamedMesh mesh;
+	mesh.Name = name;
+	for(const auto& v : meshData.Vertices)
+		mesh.Positions.push_back(v.Position);
+	mesh.Indices = meshData.Indices32;
+	return mesh;
+}
+
+void Report(const char* stage, const NamedMesh& mesh, const std::vector<std::uint32_t>& indices)
+{
+	const std::uint32_t vertexCount = (std::uint32_t)mesh.Positions.size();
+	VertexCacheStats s16 = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, 16);
+	VertexCacheStats s32 = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, 32);
+	std::printf("%-22s %-8s %9u %9u %8.3f %8.3f %8.3f %8.3f\n", mesh.Name.c_str(), stage,
+		(std::uint32_t)(indices.size() / 3), vertexCount, s16.Acmr, s16.Atvr, s32.Acmr, s32.Atvr);
+}
+
+int main(int argc, char* argv[])
+{
+	// Unoptimized, to measure the shapes as generated.
+	GeometryGenerator geoGen(false);
+
+	// The shapes and sizes the demos build.
+	std::vector<NamedMesh> meshes;
+	meshes.push_back(FromMeshData("box", geoGen.CreateBox(1.5f, 0.5f, 1.5f, 3)));
+	meshes.push_back(FromMeshData("sphere", geoGen.CreateSphere(0.5f, 20, 20)));
+	meshes.push_back(FromMeshData("geosphere", geoGen.CreateGeosphere(0.5f, 3)));
+	meshes.push_back(FromMeshData("cylinder", geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20)));
+	meshes.push_back(FromMeshData("grid 160x160", geoGen.CreateGrid(160.0f, 160.0f, 160, 160)));
+
+	std::vector<std::string> models;
+	for(int i = 1; i < argc; ++i)
+		models.push_back(argv[i]);
+	if(models.empty())
+	{
+		models.push_back("../../Chapter 16 Instancing and Frustum Culling/InstancingAndCulling/Models/skull.txt");
+		models.push_back("../../Chapter 17 Picking/Picking/Models/car.txt");
+	}
+
+	// Parse without optimizing to see the models in authoring order.
+	for(const std::string& filename : models)
+	{
+		MeshCache model;
+		if(!model.LoadText(filename, false))
+		{
+			std::printf("Could not load %s.\n", filename.c_str());
+			return 1;
+		}
+
+		NamedMesh mesh;
+		mesh.Name = filename.substr(filename.find_last_of("/\\") + 1);
+		mesh.Positions.assign(model.Positions(), model.Positions() + model.VertexCount());
+		mesh.Indices.assign(model.Indices(), model.Indices() + model.IndexCount());
+		meshes.push_back(mesh);
+	}
+
+	std::printf("%-22s %-8s %9s %9s %8s %8s %8s %8s\n", "mesh", "order", "triangles", "vertices",
+		"acmr16", "atvr16", "acmr32", "atvr32");
+
+	for(const NamedMesh& mesh : meshes)
+	{
+		const std::uint32_t vertexCount = (std::uint32_t)mesh.Positions.size();
+		Report("input", mesh, mesh.Indices);
+
+		std::vector<std::uint32_t> indices = mesh.Indices;
+		std::vector<std::uint32_t> clusterStarts;
+		OptimizeVertexCache(indices.data(), indices.size(), vertexCount, 16, &clusterStarts);
+		Report("cache", mesh, indices);
+
+		OptimizeOverdraw(indices.data(), indices.size(), mesh.Positions.data(), sizeof(DirectX::XMFLOAT3), clusterStarts);
+		std::vector<std::uint32_t> remap;
+		OptimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+		Report("full", mesh, indices);
+	}
+
+	return 0;
+}
@@ -0,0 +1,100 @@
+//***************************************************************************************
+// main.cpp
+//
+// Steps a Scalar and a Simd Waves side by side on a 512x512 grid, disturbing both at
+// the same points, and checks that heights, normals and tangents stay within a
+// tolerance of each other.  The kernels evaluate the same expressions in the same
+// order, so they match exactly unless the compiler fuses multiply-adds differently in
+// each; the tolerances leave room for that rounding.  Then it times both solvers.
+// Exits with 1 if a check fails.
+//***************************************************************************************
+
+#include "../LandAndWaves/Waves.h"
+#include "../../Common/ThreadPool.h"
+#include "../../Common/CheckUtil.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Differences
+{
+	float Height = 0.0f;
+	float Normal = 0.0f;
+	float Tangent = 0.0f;
+};
+
+Differences Compare(const Waves& a, const Waves& b)
+{
+	Differences d;
+	for(int i = 0; i < a.VertexCount(); ++i)
+	{
+		d.Height = std::max(d.Height, std::fabs(a.Position(i).y - b.Position(i).y));
+
+		DirectX::XMFLOAT3 na = a.Normal(i), nb = b.Normal(i);
+		d.Normal = std::max(d.Normal, std::max(std::fabs(na.x - nb.x), std::max(std::fabs(na.y - nb.y), std::fabs(na.z - nb.z))));
+
+		DirectX::XMFLOAT3 ta = a.TangentX(i), tb = b.TangentX(i);
+		d.Tangent = std::max(d.Tangent, std::max(std::fabs(ta.x - tb.x), std::fabs(ta.y - tb.y)));
+	}
+	return d;
+}
+
+int main()
+{
+	const int size = 512;
+	const float timeStep = 0.03f;
+	const int steps = 600;
+
+	// LandAndWavesApp's waves, on a larger grid.
+	Waves scalar(size, size, 1.0f, timeStep, 4.0f, 0.2f);
+	Waves simd(size, size, 1.0f, timeStep, 4.0f, 0.2f);
+	scalar.SetSolverMode(Waves::SolverMode::Scalar);
+	simd.SetSolverMode(Waves::SolverMode::Simd);
+
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<int> point(4, size - 5);
+	std::uniform_real_distribution<float> magnitude(0.2f, 0.5f);
+
+	Differences worst;
+	double scalarMs = 0.0, simdMs = 0.0;
+	for(int step = 0; step < steps; ++step)
+	{
+		// A new wave every quarter second of simulation, as the app makes them.
+		if(step % 8 == 0)
+		{
+			int i = point(rng), j = point(rng);
+			float r = magnitude(rng);
+			scalar.Disturb(i, j, r);
+			simd.Disturb(i, j, r);
+		}
+
+		auto start = Clock::now();
+		scalar.Update(timeStep);
+		auto middle = Clock::now();
+		simd.Update(timeStep);
+		auto end = Clock::now();
+		scalarMs += std::chrono::duration<double, std::milli>(middle - start).count();
+		simdMs += std::chrono::duration<double, std::milli>(end - middle).count();
+
+		Differences d = Compare(scalar, simd);
+		worst.Height = std::max(worst.Height, d.Height);
+		worst.Normal = std::max(worst.Normal, d.Normal);
+		worst.Tangent = std::max(worst.Tangent, d.Tangent);
+	}
+
+	std::printf("%dx%d, %d steps: max |difference| height %g, normal %g, tangent %g\n",
+		size, size, steps, worst.Height, worst.Normal, worst.Tangent);
+	Check(worst.Height <= 1e-4f, "Simd heights are within 1e-4 of Scalar");
+	Check(worst.Normal <= 1e-4f, "Simd normals are within 1e-4 of Scalar");
+	Check(worst.Tangent <= 1e-4f, "Simd tangents are within 1e-4 of Scalar");
+
+	std::printf("update: scalar %.3f ms, simd %.3f ms on %u threads\n",
+		scalarMs / steps, simdMs / steps, ThreadPool::Default().ConcurrencyLevel());
+
+	return CheckExitCode();
+}
@@ -370,6 +370,7 @@ void LitWavesApp::OnKeyboardInput(const GameTimer& gt)
 
 void LitWavesApp::UpdateCamera(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Convert Spherical to Cartesian coordinates.
 	mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
 	mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
@@ -386,6 +387,7 @@ void LitWavesApp::UpdateCamera(const GameTimer& gt)
 
 void LitWavesApp::UpdateObjectCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
 	for(auto& e : mAllRitems)
 	{
@@ -409,6 +411,7 @@ void LitWavesApp::UpdateObjectCBs(const GameTimer& gt)
 
 void LitWavesApp::UpdateMaterialCBs(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
 	for(auto& e : mMaterials)
 	{
@@ -434,6 +437,7 @@ void LitWavesApp::UpdateMaterialCBs(const GameTimer& gt)
 
 void LitWavesApp::UpdateMainPassCB(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	XMMATRIX view = XMLoadFloat4x4(&mView);
 	XMMATRIX proj = XMLoadFloat4x4(&mProj);
 
@@ -468,6 +472,7 @@ void LitWavesApp::UpdateMainPassCB(const GameTimer& gt)
 
 void LitWavesApp::UpdateWaves(const GameTimer& gt)
 {
+	PROFILE_FUNCTION();
 	// Every quarter second, generate a random wave.
 	static float t_base = 0.0f;
 	if((mTimer.TotalTime() - t_base) >= 0.25f)
@@ -754,6 +759,7 @@ void LitWavesApp::BuildRenderItems()
 
 void LitWavesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
 {
+	PROFILE_FUNCTION();
 	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
 	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
@@ -0,0 +1,338 @@
+//***************************************************************************************
+// main.cpp
+//
+// Checks DdsFile against every DDS file in a directory, with no window or device:
+//   - each file must parse, and its subresources must follow one another from the end of
+//     the header to within the end of the file,
+//   - each file is then corrupted many times over, by flipping header bits, writing
+//     extreme values into header fields and truncating it, and ParseDds must either
+//     reject the result or return subresources that lie inside it.  Build with a
+//     sanitizer to have any read past the data caught as well,
+//   - mapping and parsing every file is timed against reading it with an ifstream.
+// Exits with 1 if a check fails.
+//
+// Usage: DdsFuzz [directory] [-iterations n] [-seed n]
+//   e.g. DdsFuzz ../../Textures -iterations 20000
+//***************************************************************************************
+
+#include "../../Common/DdsFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <dirent.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+// Where CheckTexture reads to, so the reads are not optimized away.
+volatile std::uint8_t gSink;
+
+// The .dds files in directory, sorted.
+std::vector<std::string> ListDdsFiles(const std::string& directory)
+{
+	std::vector<std::string> names;
+
+#if defined(_WIN32)
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((directory + "\\*.dds").c_str(), &data);
+	if(find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			names.push_back(data.cFileName);
+		} while(FindNextFileA(find, &data));
+		FindClose(find);
+	}
+#else
+	DIR* dir = opendir(directory.c_str());
+	if(dir != nullptr)
+	{
+		while(dirent* entry = readdir(dir))
+		{
+			std::string name = entry->d_name;
+			if(name.size() > 4 && name.compare(name.size() - 4, 4, ".dds") == 0)
+				names.push_back(name);
+		}
+		closedir(dir);
+	}
+#endif
+
+	std::sort(names.begin(), names.end());
+
+	std::vector<std::string> paths;
+	for(const auto& name : names)
+		paths.push_back(directory + "/" + name);
+	return paths;
+}
+
+// Checks that texture describes size bytes consistently, and reads the first and last
+// byte of every subresource so a sanitizer sees any that lie outside the data.
+bool CheckTexture(const DdsTexture& texture, const std::uint8_t* data, std::uint64_t size, std::string& problem)
+{
+	if(texture.Width == 0 || texture.Height == 0 || texture.Depth == 0 || texture.MipCount == 0 || texture.ArraySize == 0)
+	{
+		problem = "zero dimension";
+		return false;
+	}
+	if(texture.Subresources.size() != (size_t)texture.MipCount*texture.ArraySize)
+	{
+		problem = "wrong subresource count";
+		return false;
+	}
+
+	std::uint64_t end = texture.Subresources[0].Offset;
+	if(end != 128 && end != 148)
+	{
+		problem = "data does not start after the header";
+		return false;
+	}
+
+	for(size_t i = 0; i < texture.Subresources.size(); ++i)
+	{
+		const DdsSubresource& sub = texture.Subresources[i];
+		if(sub.Offset != end)
+		{
+			problem = "subresource " + std::to_string(i) + " does not follow the one before";
+			return false;
+		}
+		if(sub.Size == 0 || sub.Size != sub.SlicePitch*sub.Depth || sub.RowPitch*sub.RowCount > sub.SlicePitch)
+		{
+			problem = "subresource " + std::to_string(i) + " has inconsistent pitches";
+			return false;
+		}
+		if(sub.MipLevel != i % texture.MipCount || sub.ArraySlice != i / texture.MipCount)
+		{
+			problem = "subresource " + std::to_string(i) + " is out of order";
+			return false;
+		}
+		if(sub.Size > size || sub.Offset > size - sub.Size)
+		{
+			problem = "subresource " + std::to_string(i) + " runs past the data";
+			return false;
+		}
+
+		gSink = data[sub.Offset];
+		gSink = data[sub.Offset + sub.Size - 1];
+		end = sub.Offset + sub.Size;
+	}
+
+	return true;
+}
+
+// Parses a corrupted copy of file; true unless the parse returned a bad table.
+bool ParseMutant(const std::vector<std::uint8_t>& mutant, std::uint64_t& accepted, std::string& problem)
+{
+	DdsTexture texture;
+	if(!ParseDds(mutant.empty() ? nullptr : mutant.data(), mutant.size(), texture))
+		return true;
+
+	++accepted;
+	return CheckTexture(texture, mutant.data(), mutant.size(), problem);
+}
+
+int main(int argc, char* argv[])
+{
+	std::string directory = "../../Textures";
+	int iterations = 5000;
+	unsigned seed = 1;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+			iterations = std::max(0, std::atoi(argv[++i]));
+		else if(std::strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+			seed = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+		else
+			directory = argv[i];
+	}
+
+	std::vector<std::string> paths = ListDdsFiles(directory);
+	if(paths.empty())
+	{
+		std::printf("No .dds files in %s.\n", directory.c_str());
+		return 1;
+	}
+
+	//
+	// Every file parses and tiles.
+	//
+
+	int failures = 0;
+	std::uint64_t totalBytes = 0;
+	for(const auto& path : paths)
+	{
+		DdsFile file;
+		DdsError error;
+		if(!file.Open(path, &error))
+		{
+			std::printf("FAIL %s: %s\n", path.c_str(), DdsErrorString(error));
+			++failures;
+			continue;
+		}
+
+		const DdsTexture& texture = file.Texture();
+		std::string problem;
+		if(!CheckTexture(texture, file.File().Data(), file.File().Size(), problem))
+		{
+			std::printf("FAIL %s: %s\n", path.c_str(), problem.c_str());
+			++failures;
+			continue;
+		}
+
+		const DdsSubresource& last = texture.Subresources.back();
+		std::printf("  %-40s format %3u, %5ux%-5u x%-3u %2u mips, %4u slices%s, %8llu bytes, %llu unused\n",
+			path.c_str(), (unsigned)texture.Format, texture.Width, texture.Height, texture.Depth,
+			texture.MipCount, texture.ArraySize, texture.IsCubeMap ? " (cube)" : "",
+			(unsigned long long)file.File().Size(), (unsigned long long)(file.File().Size() - last.Offset - last.Size));
+		totalBytes += file.File().Size();
+	}
+	std::printf("%d of %d files parse\n", (int)paths.size() - failures, (int)paths.size());
+
+	//
+	// Corrupted files.
+	//
+
+	// Values that sit on the edges of the checks.
+	const std::uint32_t extremes[] =
+	{
+		0, 1, 2, 3, 4, 5, 6, 7, 15, 16, 17, 124, 2048, 2049, 16384, 16385, 0x7fffffff, 0x80000000, 0xfffffffe, 0xffffffff
+	};
+
+	std::mt19937 rng(seed);
+	std::uint64_t mutants = 0;
+	std::uint64_t accepted = 0;
+	auto fuzzStart = Clock::now();
+	for(const auto& path : paths)
+	{
+		MappedFile mapping;
+		if(!mapping.Open(path) || mapping.Size() == 0)
+			continue;
+		std::vector<std::uint8_t> original(mapping.Data(), mapping.Data() + mapping.Size());
+
+		// The header and the DX10 extension: the only bytes ParseDds interprets.
+		const size_t headerBytes = std::min<size_t>(original.size(), 148);
+
+		std::vector<std::uint8_t> mutant = original;
+		for(int n = 0; n < iterations; ++n)
+		{
+			std::string problem;
+			switch(rng() % 4)
+			{
+			case 0:
+				// Flip a few header bits.
+				for(int flips = 1 + rng() % 4; flips > 0; --flips)
+					mutant[rng() % headerBytes] ^= (std::uint8_t)(1 << (rng() % 8));
+				break;
+
+			case 1:
+			{
+				// Write an extreme value into an aligned header field.
+				std::uint32_t value = extremes[rng() % (sizeof(extremes) / sizeof(extremes[0]))];
+				size_t field = (rng() % (headerBytes / 4))*4;
+				std::memcpy(&mutant[field], &value, sizeof(value));
+				break;
+			}
+
+			case 2:
+			{
+				// Write random values into the size fields: height, width, depth, mip count
+				// and the DX10 array size.
+				const size_t fields[] = { 12, 16, 24, 28, 140 };
+				size_t field = fields[rng() % 5];
+				if(field + 4 <= headerBytes)
+				{
+					std::uint32_t value = rng() >> (rng() % 32);
+					std::memcpy(&mutant[field], &value, sizeof(value));
+				}
+				break;
+			}
+
+			case 3:
+			{
+				// Truncate, usually within the header or the first subresources.
+				size_t length = rng() % 2 ? rng() % std::min<size_t>(original.size(), 4096) : rng() % original.size();
+				std::vector<std::uint8_t> truncated(original.begin(), original.begin() + length);
+				if(!ParseMutant(truncated, accepted, problem))
+				{
+					std::printf("FAIL %s truncated to %llu bytes: %s\n", path.c_str(), (unsigned long long)length, problem.c_str());
+					++failures;
+				}
+				++mutants;
+				continue;
+			}
+			}
+
+			if(!ParseMutant(mutant, accepted, problem))
+			{
+				std::printf("FAIL %s, mutant %d: %s\n", path.c_str(), n, problem.c_str());
+				++failures;
+			}
+			++mutants;
+
+			// Start over from the original file now and then, so damage does not only pile up.
+			if(rng() % 8 == 0)
+				std::memcpy(mutant.data(), original.data(), headerBytes);
+		}
+	}
+	double fuzzMs = std::chrono::duration<double, std::milli>(Clock::now() - fuzzStart).count();
+	std::printf("%llu corrupted files, %llu accepted and in bounds, %.0f ms\n",
+		(unsigned long long)mutants, (unsigned long long)accepted, fuzzMs);
+
+	//
+	// Mapping against reading.  Both are warm after the checks above.
+	//
+
+	const int repeats = 10;
+	std::uint64_t checksum = 0;
+
+	auto mapStart = Clock::now();
+	for(int r = 0; r < repeats; ++r)
+	{
+		for(const auto& path : paths)
+		{
+			DdsFile file;
+			if(file.Open(path))
+				checksum += file.Texture().Subresources.size();
+		}
+	}
+	double mapMs = std::chrono::duration<double, std::milli>(Clock::now() - mapStart).count() / repeats;
+
+	auto readStart = Clock::now();
+	for(int r = 0; r < repeats; ++r)
+	{
+		for(const auto& path : paths)
+		{
+			std::ifstream fin(path, std::ios::binary | std::ios::ate);
+			std::vector<std::uint8_t> bytes((size_t)fin.tellg());
+			fin.seekg(0);
+			fin.read((char*)bytes.data(), bytes.size());
+
+			DdsTexture texture;
+			if(ParseDds(bytes.data(), bytes.size(), texture))
+				checksum += texture.Subresources.size();
+		}
+	}
+	double readMs = std::chrono::duration<double, std::milli>(Clock::now() - readStart).count() / repeats;
+
+	std::printf("%d files, %.1f MB: map and parse %.3f ms, read and parse %.3f ms (%llu)\n", (int)paths.size(),
+		totalBytes / (1024.0*1024.0), mapMs, readMs, (unsigned long long)checksum);
+
+	if(failures > 0)
+	{
+		std::printf("%d checks failed\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -4,6 +4,10 @@
 // Performs the calculations for the wave simulation.  After the simulation has been
 // updated, the client must copy the current solution into vertex buffers for rendering.
 // This class only does the calculations, it does not do any drawing.
+//
+// The solution is stored as separate float planes (heights, normal components, tangent
+// components) rather than arrays of XMFLOAT3, so the update only touches the data it
+// actually changes and the inner loops can be vectorized.
 //***************************************************************************************
 
 #ifndef WAVES_H
@@ -15,6 +19,17 @@
 class Waves
 {
 public:
+	// Scalar is the straightforward reference implementation.  Simd runs the same
+	// arithmetic on SimdFloat.h's AVX/SSE/NEON vectors (whichever the build targets) and
+	// produces the same results as Scalar up to floating-point rounding: identical bits
+	// unless the compiler fuses multiply-adds, as /fp:fast with /arch:AVX2 may.
+	// WavesCheck holds the two to within 1e-4.
+	enum class SolverMode
+	{
+		Scalar,
+		Simd
+	};
+
     Waves(int m, int n, float dx, float dt, float speed, float damping);
     Waves(const Waves& rhs) = delete;
     Waves& operator=(const Waves& rhs) = delete;
@@ -27,18 +42,39 @@ public:
 	float Width()const;
 	float Depth()const;
 
+	SolverMode GetSolverMode()const { return mSolverMode; }
+	void SetSolverMode(SolverMode mode) { mSolverMode = mode; }
+
 	// Returns the solution at the ith grid point.
-    const DirectX::XMFLOAT3& Position(int i)const { return mCurrSolution[i]; }
+    DirectX::XMFLOAT3 Position(int i)const
+	{
+		return DirectX::XMFLOAT3(mColumnX[i % mNumCols], mCurrHeights[i], mRowZ[i / mNumCols]);
+	}
 
 	// Returns the solution normal at the ith grid point.
-    const DirectX::XMFLOAT3& Normal(int i)const { return mNormals[i]; }
+    DirectX::XMFLOAT3 Normal(int i)const
+	{
+		return DirectX::XMFLOAT3(mNormalX[i], mNormalY[i], mNormalZ[i]);
+	}
 
 	// Returns the unit tangent vector at the ith grid point in the local x-axis direction.
-    const DirectX::XMFLOAT3& TangentX(int i)const { return mTangentX[i]; }
+    DirectX::XMFLOAT3 TangentX(int i)const
+	{
+		return DirectX::XMFLOAT3(mTangentX[i], mTangentY[i], 0.0f);
+	}
+
+	// Row-major height plane of the current solution (RowCount()*ColumnCount() floats).
+	const float* Heights()const { return mCurrHeights.data(); }
 
 	void Update(float dt);
 	void Disturb(int i, int j, float magnitude);
 
+private:
+	void UpdateHeightsScalar(int firstRow, int lastRow);
+	void UpdateHeightsSimd(int firstRow, int lastRow);
+	void UpdateNormalsScalar(int firstRow, int lastRow);
+	void UpdateNormalsSimd(int firstRow, int lastRow);
+
 private:
     int mNumRows = 0;
     int mNumCols = 0;
@@ -53,11 +89,21 @@ private:
 
     float mTimeStep = 0.0f;
     float mSpatialStep = 0.0f;
+    float mAccumTime = 0.0f;
+
+	SolverMode mSolverMode = SolverMode::Simd;
+
+	// The grid x/z coordinates never change, so only one value per column/row is kept.
+	std::vector<float> mColumnX;
+	std::vector<float> mRowZ;
 
-    std::vector<DirectX::XMFLOAT3> mPrevSolution;
-    std::vector<DirectX::XMFLOAT3> mCurrSolution;
-    std::vector<DirectX::XMFLOAT3> mNormals;
-    std::vector<DirectX::XMFLOAT3> mTangentX;
+    std::vector<float> mPrevHeights;
+    std::vector<float> mCurrHeights;
+    std::vector<float> mNormalX;
+    std::vector<float> mNormalY;
+    std::vector<float> mNormalZ;
+    std::vector<float> mTangentX;
+    std::vector<float> mTangentY;
 };
 
-#endif // WAVES_H
\ No newline at end of file
+#endif // WAVES_H
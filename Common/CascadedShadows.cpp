@@ -0,0 +1,112 @@
+//***************************************************************************************
+// CascadedShadows.cpp
+//***************************************************************************************
+
+#include "CascadedShadows.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+void CalcShadowCascadeSplits(float nearZ, float farZ, int cascadeCount, float lambda, float* splits)
+{
+	assert(cascadeCount > 0 && nearZ > 0.0f && farZ > nearZ);
+
+	splits[0] = nearZ;
+	for(int i = 1; i < cascadeCount; ++i)
+	{
+		float t = (float)i / cascadeCount;
+		float logSplit = nearZ*std::pow(farZ / nearZ, t);
+		float uniformSplit = nearZ + (farZ - nearZ)*t;
+		splits[i] = lambda*logSplit + (1.0f - lambda)*uniformSplit;
+	}
+	splits[cascadeCount] = farZ;
+}
+
+BoundingSphere CalcShadowCascadeBounds(const ShadowCascadeCamera& camera, float splitNear, float splitFar)
+{
+	// A corner of the slice at depth z is z*k off the view axis.  The center sits on the
+	// axis where the near and far corners are equally far away, unless that is past the
+	// far plane, in which case the far corners alone decide the radius.
+	float tanHalfFovY = std::tan(0.5f*camera.FovY);
+	float k2 = tanHalfFovY*tanHalfFovY*(1.0f + camera.Aspect*camera.Aspect);
+
+	float centerZ = std::min(splitFar, 0.5f*(splitFar + splitNear)*(1.0f + k2));
+	float farOffset = splitFar - centerZ;
+
+	BoundingSphere sphere;
+	XMVECTOR center = XMVectorAdd(XMLoadFloat3(&camera.Position),
+		XMVectorScale(XMLoadFloat3(&camera.Look), centerZ));
+	XMStoreFloat3(&sphere.Center, center);
+	sphere.Radius = std::sqrt(farOffset*farOffset + splitFar*splitFar*k2);
+	return sphere;
+}
+
+void FitShadowCascade(const BoundingSphere& sphere, FXMVECTOR lightDir,
+	std::uint32_t shadowMapSize, float casterDistance, ShadowCascade& cascade)
+{
+	assert(shadowMapSize > 2);
+
+	// A light view at the world origin, so that its texel grid stays put as the camera
+	// moves.  Any fixed up vector will do as long as it is not along the light.
+	XMVECTOR up = std::fabs(XMVectorGetY(lightDir)) < 0.99f ?
+		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+	XMMATRIX lightView = XMMatrixLookAtLH(XMVectorZero(), lightDir, up);
+
+	XMFLOAT3 centerLS;
+	XMStoreFloat3(&centerLS, XMVector3TransformCoord(XMLoadFloat3(&sphere.Center), lightView));
+
+	// Snapping moves the center by up to a texel, so the projection is a texel wider
+	// than the sphere on each side.
+	float halfWidth = sphere.Radius*shadowMapSize / (shadowMapSize - 2);
+	float texelSize = 2.0f*halfWidth / shadowMapSize;
+	float x = std::floor(centerLS.x / texelSize)*texelSize;
+	float y = std::floor(centerLS.y / texelSize)*texelSize;
+
+	float n = centerLS.z - sphere.Radius - casterDistance;
+	float f = centerLS.z + sphere.Radius;
+	// A centered projection after a translation, rather than an off-center one, so the
+	// scale comes out the same bits wherever the center is.
+	XMMATRIX lightProj = XMMatrixMultiply(XMMatrixTranslation(-x, -y, 0.0f),
+		XMMatrixOrthographicOffCenterLH(-halfWidth, halfWidth, -halfWidth, halfWidth, n, f));
+
+	// Transform NDC space [-1,+1]^2 to texture space [0,1]^2
+	XMMATRIX T(
+		0.5f, 0.0f, 0.0f, 0.0f,
+		0.0f, -0.5f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.5f, 0.5f, 0.0f, 1.0f);
+
+	XMMATRIX viewProj = XMMatrixMultiply(lightView, lightProj);
+
+	cascade.Bounds = sphere;
+	cascade.LightNearZ = n;
+	cascade.LightFarZ = f;
+	XMStoreFloat4x4(&cascade.LightView, lightView);
+	XMStoreFloat4x4(&cascade.LightProj, lightProj);
+	XMStoreFloat4x4(&cascade.LightViewProj, viewProj);
+	XMStoreFloat4x4(&cascade.ShadowTransform, XMMatrixMultiply(viewProj, T));
+	cascade.Frustum = CullingFrustum::FromViewProj(viewProj);
+}
+
+void CalcShadowCascades(const ShadowCascadeCamera& camera, FXMVECTOR lightDir,
+	const ShadowCascadeSettings& settings, std::vector<ShadowCascade>& cascades)
+{
+	assert(settings.CascadeCount > 0 && settings.CascadeCount <= ShadowCascadeSettings::MaxCascadeCount);
+
+	float splits[ShadowCascadeSettings::MaxCascadeCount + 1];
+	float farZ = std::min(camera.FarZ, settings.ShadowDistance);
+	CalcShadowCascadeSplits(camera.NearZ, farZ, settings.CascadeCount, settings.SplitLambda, splits);
+
+	cascades.resize(settings.CascadeCount);
+	for(int i = 0; i < settings.CascadeCount; ++i)
+	{
+		ShadowCascade& cascade = cascades[i];
+		cascade.SplitNear = splits[i];
+		cascade.SplitFar = splits[i + 1];
+
+		BoundingSphere sphere = CalcShadowCascadeBounds(camera, splits[i], splits[i + 1]);
+		FitShadowCascade(sphere, lightDir, settings.ShadowMapSize, settings.CasterDistance, cascade);
+	}
+}
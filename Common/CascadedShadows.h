@@ -0,0 +1,98 @@
+//***************************************************************************************
+// CascadedShadows.h
+//
+// Light projections for cascaded shadow maps of a directional light.  The camera's view
+// range is cut into cascades at the practical split scheme's distances, a blend of
+// uniform and logarithmic splits.  Each cascade gets an orthographic projection fit
+// around the bounding sphere of its slice of the view frustum.
+//
+// The sphere's radius depends only on the lens and the split distances, so the projection's
+// scale does not change as the camera turns.  The projection is also moved only in whole
+// shadow map texels, measured in a light space that does not move with the camera, so
+// world points stay at the same place within their texels as the camera moves.  Together
+// these keep shadow edges from shimmering.
+//
+// Only math: the results are the matrices and culling frustums to render each cascade
+// with, and no device is needed.
+//***************************************************************************************
+
+#pragma once
+
+#include "CullingBvh.h"
+
+// The camera the cascades cover, as Camera reports it.  Look is a unit vector.
+struct ShadowCascadeCamera
+{
+	DirectX::XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 Look = { 0.0f, 0.0f, 1.0f };
+	float FovY = 0.25f*DirectX::XM_PI;
+	float Aspect = 1.0f;
+	float NearZ = 1.0f;
+	float FarZ = 1000.0f;
+};
+
+struct ShadowCascadeSettings
+{
+	static const int MaxCascadeCount = 8;
+
+	int CascadeCount = 4;
+
+	// 0 gives uniform splits, 1 logarithmic ones.
+	float SplitLambda = 0.75f;
+
+	// Shadows end this far from the camera, or at its far plane if that is nearer.
+	float ShadowDistance = 100.0f;
+
+	// Width and height of each cascade's shadow map in texels.
+	std::uint32_t ShadowMapSize = 2048;
+
+	// How far the light projection reaches toward the light beyond a cascade's sphere,
+	// so casters outside the sphere still cast into it.
+	float CasterDistance = 50.0f;
+};
+
+struct ShadowCascade
+{
+	// The view-space depths this cascade covers.
+	float SplitNear = 0.0f;
+	float SplitFar = 0.0f;
+
+	// World-space sphere around the cascade's slice of the view frustum.
+	DirectX::BoundingSphere Bounds;
+
+	DirectX::XMFLOAT4X4 LightView;
+	DirectX::XMFLOAT4X4 LightProj;
+	DirectX::XMFLOAT4X4 LightViewProj;
+
+	// World space to shadow map texture space, [0,1]^2 with depth in z.
+	DirectX::XMFLOAT4X4 ShadowTransform;
+
+	// The light projection's near and far planes, in light view space.
+	float LightNearZ = 0.0f;
+	float LightFarZ = 0.0f;
+
+	// Casters to render into this cascade are the ones not outside this frustum.
+	CullingFrustum Frustum;
+};
+
+// Writes cascadeCount + 1 split depths, from nearZ to farZ, to splits:
+//     lambda*nearZ*(farZ/nearZ)^(i/n) + (1 - lambda)*(nearZ + (farZ - nearZ)*i/n).
+// The first and last are exactly nearZ and farZ.
+void CalcShadowCascadeSplits(float nearZ, float farZ, int cascadeCount, float lambda, float* splits);
+
+// The smallest sphere around the slice of camera's view frustum between view depths
+// splitNear and splitFar.
+DirectX::BoundingSphere CalcShadowCascadeBounds(const ShadowCascadeCamera& camera, float splitNear, float splitFar);
+
+// Fits a light projection around sphere for the unit direction the light travels,
+// snapped to whole texels of a shadowMapSize map.  The light space shares the world's
+// origin, so the snapping is the same from frame to frame.  The projection reaches
+// casterDistance further toward the light than the sphere.  Fills everything but the
+// split depths.
+void FitShadowCascade(const DirectX::BoundingSphere& sphere, DirectX::FXMVECTOR lightDir,
+	std::uint32_t shadowMapSize, float casterDistance, ShadowCascade& cascade);
+
+// Splits camera's view range per settings and fits a cascade to each slice.
+// cascades gets settings.CascadeCount entries, nearest first.
+void CalcShadowCascades(const ShadowCascadeCamera& camera, DirectX::FXMVECTOR lightDir,
+	const ShadowCascadeSettings& settings, std::vector<ShadowCascade>& cascades);
@@ -0,0 +1,38 @@
+//***************************************************************************************
+// CheckUtil.h
+//
+// The failure count shared by the console check programs.  Check prints every failed
+// condition and counts it; main returns CheckExitCode() once all checks have run.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+inline int& CheckFailureCount()
+{
+	static int failures = 0;
+	return failures;
+}
+
+inline void Check(bool condition, const std::string& what)
+{
+	if(!condition)
+	{
+		std::printf("FAIL %s\n", what.c_str());
+		++CheckFailureCount();
+	}
+}
+
+// Prints the outcome and returns the exit code: 0 if every check passed, 1 otherwise.
+inline int CheckExitCode()
+{
+	if(CheckFailureCount() > 0)
+	{
+		std::printf("%d checks failed\n", CheckFailureCount());
+		return 1;
+	}
+	std::printf("all checks passed\n");
+	return 0;
+}
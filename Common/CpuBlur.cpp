@@ -0,0 +1,182 @@
+//***************************************************************************************
+// CpuBlur.cpp
+//***************************************************************************************
+
+#include "CpuBlur.h"
+#include "SimdFloat.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Rows per band: per task, and per block of the transposes.
+	const std::uint32_t BandRows = 16;
+
+	std::size_t AlignUp(std::size_t x)
+	{
+		return (x + FloatVWidth - 1) / FloatVWidth * FloatVWidth;
+	}
+
+	// out[j] = sum over taps i of weights[i]*padded[j + i*channels], for count floats
+	// rounded up to whole vectors.  The texel under tap i of output texel x is padded
+	// texel x + i, so with radius texels of padding at the front this is the shader's
+	// loop from -radius to radius.
+	void ConvolveRow(const float* padded, std::size_t count, std::uint32_t channels,
+		const FloatV* weights, int taps, float* out)
+	{
+		for(std::size_t j = 0; j < count; j += FloatVWidth)
+		{
+			FloatV sum = SplatV(0.0f);
+			for(int i = 0; i < taps; ++i)
+				sum = AddV(sum, MulV(weights[i], LoadV(padded + j + i*channels)));
+			StoreV(out + j, sum);
+		}
+	}
+}
+
+std::vector<float> CalcGaussBlurWeights(float sigma)
+{
+	float twoSigma2 = 2.0f*sigma*sigma;
+
+	// Estimate the blur radius based on sigma since sigma controls the "width" of the bell curve.
+	int blurRadius = (int)ceil(2.0f * sigma);
+
+	std::vector<float> weights;
+	weights.resize(2 * blurRadius + 1);
+
+	float weightSum = 0.0f;
+
+	for(int i = -blurRadius; i <= blurRadius; ++i)
+	{
+		float x = (float)i;
+
+		weights[i+blurRadius] = expf(-x*x / twoSigma2);
+
+		weightSum += weights[i+blurRadius];
+	}
+
+	// Divide by the sum so all the weights add up to 1.0.
+	for(size_t i = 0; i < weights.size(); ++i)
+	{
+		weights[i] /= weightSum;
+	}
+
+	return weights;
+}
+
+CpuBlurFilter::CpuBlurFilter(float sigma)
+	: mWeights(CalcGaussBlurWeights(sigma))
+{
+	assert(Radius() <= MaxBlurRadius);
+}
+
+CpuBlurFilter::CpuBlurFilter(const std::vector<float>& weights)
+	: mWeights(weights)
+{
+	assert(weights.size() % 2 == 1 && Radius() <= MaxBlurRadius);
+}
+
+void CpuBlurFilter::Execute(CpuImage& image, int blurCount, ThreadPool& pool)
+{
+	const std::uint32_t width = image.Width;
+	const std::uint32_t height = image.Height;
+	const std::uint32_t channels = CpuImageChannelCount(image.Format);
+	if(width == 0 || height == 0)
+		return;
+
+	const std::size_t columnStride = (std::size_t)height*channels;
+	mTransposed.resize((std::size_t)width*columnStride);
+	float* transposed = mTransposed.data();
+
+	for(int i = 0; i < blurCount; ++i)
+	{
+		//
+		// Horizontal pass.  Rounded to the format, as the shader's store to the
+		// intermediate texture is, then written out a band of rows at a time as columns.
+		//
+
+		BlurPass(height, width, channels, pool,
+			[&](std::uint32_t y, float* values)
+			{
+				DecodeCpuImageRow(image, y, 0, width, values);
+			},
+			[&](std::uint32_t y0, std::uint32_t rowCount, float* band, std::size_t rowStride)
+			{
+				for(std::uint32_t b = 0; b < rowCount; ++b)
+					QuantizeCpuImageValues(image.Format, band + b*rowStride, (std::size_t)width*channels);
+
+				for(std::uint32_t x = 0; x < width; ++x)
+				{
+					float* column = transposed + x*columnStride + (std::size_t)y0*channels;
+					for(std::uint32_t b = 0; b < rowCount; ++b)
+						std::memcpy(column + b*channels, band + b*rowStride + x*channels, channels*sizeof(float));
+				}
+			});
+
+		//
+		// Vertical pass along the transposed rows, transposed back as it is stored.
+		//
+
+		BlurPass(width, height, channels, pool,
+			[&](std::uint32_t x, float* values)
+			{
+				std::memcpy(values, transposed + x*columnStride, columnStride*sizeof(float));
+			},
+			[&](std::uint32_t x0, std::uint32_t columnCount, float* band, std::size_t rowStride)
+			{
+				float texels[BandRows*4];
+				for(std::uint32_t y = 0; y < height; ++y)
+				{
+					for(std::uint32_t b = 0; b < columnCount; ++b)
+						std::memcpy(texels + b*channels, band + b*rowStride + (std::size_t)y*channels, channels*sizeof(float));
+					EncodeCpuImageRow(image, y, x0, columnCount, texels);
+				}
+			});
+	}
+}
+
+void CpuBlurFilter::BlurPass(std::uint32_t rowCount, std::uint32_t rowLength, std::uint32_t channels, ThreadPool& pool,
+	const std::function<void(std::uint32_t row, float* values)>& readRow,
+	const std::function<void(std::uint32_t firstRow, std::uint32_t rowCount, float* band, std::size_t rowStride)>& writeBand)
+{
+	const int radius = Radius();
+	const int taps = (int)mWeights.size();
+	FloatV weights[2*MaxBlurRadius + 1];
+	for(int i = 0; i < taps; ++i)
+		weights[i] = SplatV(mWeights[i]);
+
+	// Output rows run to whole vectors, and the padded row has radius texels each side
+	// plus room for the last vector's reads past the end.
+	const std::size_t rowFloats = (std::size_t)rowLength*channels;
+	const std::size_t rowStride = AlignUp(rowFloats);
+	const std::size_t padFloats = (std::size_t)radius*channels;
+	const std::size_t paddedSize = rowStride + 2*padFloats;
+
+	const int bandCount = (int)((rowCount + BandRows - 1) / BandRows);
+	pool.ParallelForRange(0, bandCount, 1, [&](int bandBegin, int bandEnd)
+	{
+		std::vector<float> padded(paddedSize, 0.0f);
+		std::vector<float> band(BandRows*rowStride);
+		for(int bandIndex = bandBegin; bandIndex < bandEnd; ++bandIndex)
+		{
+			const std::uint32_t first = (std::uint32_t)bandIndex*BandRows;
+			const std::uint32_t count = rowCount - first < BandRows ? rowCount - first : BandRows;
+			for(std::uint32_t b = 0; b < count; ++b)
+			{
+				float* row = padded.data() + padFloats;
+				readRow(first + b, row);
+
+				// Samples past the border clamp to the edge texel.
+				for(int i = 0; i < radius; ++i)
+				{
+					std::memcpy(row - (i + 1)*channels, row, channels*sizeof(float));
+					std::memcpy(row + rowFloats + i*channels, row + rowFloats - channels, channels*sizeof(float));
+				}
+
+				ConvolveRow(padded.data(), rowFloats, channels, weights, taps, band.data() + b*rowStride);
+			}
+			writeBand(first, count, band.data(), rowStride);
+		}
+	});
+}
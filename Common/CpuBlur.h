@@ -0,0 +1,56 @@
+//***************************************************************************************
+// CpuBlur.h
+//
+// The separable Gaussian blur of Blur.hlsl on the CPU, for checking BlurFilter's output
+// and for blurring where there is no GPU.  Every pass reads the image as the shader's
+// texture load does, clamps samples past the border to the edge texel, sums the weights
+// in the shader's order and stores through the image format, so the horizontal pass's
+// result is rounded to the format before the vertical pass reads it, as it is in
+// BlurFilter's intermediate texture.  Weighted sums are separate multiplies and adds;
+// hardware that fuses them may round the last bit differently before the store.
+//
+// Execute blurs bands of rows on a thread pool.  The horizontal pass writes its rows
+// transposed, a band at a time, so the vertical pass also runs along contiguous rows and
+// transposes back.  The sums run on SIMD vectors of floats along each row, which works
+// for any channel count once the row is padded with copies of its edge texels.
+//***************************************************************************************
+
+#pragma once
+
+#include "CpuImage.h"
+#include "ThreadPool.h"
+#include <vector>
+
+// The normalized weights BlurFilter uses: radius ceil(2 sigma), 2*radius + 1 weights.
+std::vector<float> CalcGaussBlurWeights(float sigma);
+
+class CpuBlurFilter
+{
+public:
+	// Blur.hlsl holds at most 11 weights, which sigma 2.5 fills.
+	static const int MaxBlurRadius = 5;
+
+	explicit CpuBlurFilter(float sigma = 2.5f);
+	explicit CpuBlurFilter(const std::vector<float>& weights);
+	CpuBlurFilter(const CpuBlurFilter& rhs) = delete;
+	CpuBlurFilter& operator=(const CpuBlurFilter& rhs) = delete;
+
+	const std::vector<float>& Weights()const { return mWeights; }
+	int Radius()const { return (int)mWeights.size() / 2; }
+
+	// Blurs image blurCount times in place, horizontally then vertically each time, as
+	// BlurFilter::Execute does.
+	void Execute(CpuImage& image, int blurCount, ThreadPool& pool = ThreadPool::Default());
+
+private:
+	// Blurs rowCount rows of rowLength texels.  readRow decodes a row; writeBand takes
+	// the blurred rows of a band, rowStride floats apart.
+	void BlurPass(std::uint32_t rowCount, std::uint32_t rowLength, std::uint32_t channels, ThreadPool& pool,
+		const std::function<void(std::uint32_t row, float* values)>& readRow,
+		const std::function<void(std::uint32_t firstRow, std::uint32_t rowCount, float* band, std::size_t rowStride)>& writeBand);
+
+	std::vector<float> mWeights;
+
+	// The image after the horizontal pass, transposed: one row per image column.
+	std::vector<float> mTransposed;
+};
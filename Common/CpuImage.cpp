@@ -0,0 +1,241 @@
+//***************************************************************************************
+// CpuImage.cpp
+//***************************************************************************************
+
+#include "CpuImage.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define CPU_IMAGE_SIMD_SSE
+#endif
+
+namespace
+{
+	std::uint32_t FloatBits(float f)
+	{
+		std::uint32_t u;
+		std::memcpy(&u, &f, sizeof(u));
+		return u;
+	}
+
+	float BitsFloat(std::uint32_t u)
+	{
+		float f;
+		std::memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+
+	// Saturates (NaN to 0), scales and rounds to nearest even, which is what
+	// _mm_cvtps_epi32 does in the default rounding mode.
+	inline std::uint32_t EncodeUnorm(float v, float scale)
+	{
+		v = v > 0.0f ? (v < 1.0f ? v : 1.0f) : 0.0f;
+		return (std::uint32_t)std::nearbyint(v*scale);
+	}
+
+	void DecodeRgba8(const std::uint8_t* texels, std::uint32_t count, float* values)
+	{
+		std::uint32_t i = 0;
+#if defined(CPU_IMAGE_SIMD_SSE)
+		const __m128 scale = _mm_set1_ps(255.0f);
+		const __m128i zero = _mm_setzero_si128();
+		for(; i < 4*count; i += 4)
+		{
+			int texel;
+			std::memcpy(&texel, texels + i, sizeof(texel));
+			__m128i t = _mm_cvtsi32_si128(texel);
+			t = _mm_unpacklo_epi16(_mm_unpacklo_epi8(t, zero), zero);
+			_mm_storeu_ps(values + i, _mm_div_ps(_mm_cvtepi32_ps(t), scale));
+		}
+#endif
+		for(; i < 4*count; ++i)
+			values[i] = texels[i] / 255.0f;
+	}
+
+	void EncodeRgba8(const float* values, std::uint32_t count, std::uint8_t* texels)
+	{
+		std::uint32_t i = 0;
+#if defined(CPU_IMAGE_SIMD_SSE)
+		// maxps/minps return the second operand for NaN, so NaN saturates to 0 as in
+		// EncodeUnorm.
+		const __m128 scale = _mm_set1_ps(255.0f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		for(; i < 4*count; i += 4)
+		{
+			__m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i), zero), one);
+			__m128i t = _mm_cvtps_epi32(_mm_mul_ps(v, scale));
+			t = _mm_packs_epi32(t, t);
+			t = _mm_packus_epi16(t, t);
+			int texel = _mm_cvtsi128_si32(t);
+			std::memcpy(texels + i, &texel, sizeof(texel));
+		}
+#endif
+		for(; i < 4*count; ++i)
+			texels[i] = (std::uint8_t)EncodeUnorm(values[i], 255.0f);
+	}
+}
+
+float CpuHalfToFloat(std::uint16_t h)
+{
+	std::uint32_t sign = (std::uint32_t)(h & 0x8000) << 16;
+	std::uint32_t exponent = (h >> 10) & 0x1f;
+	std::uint32_t mantissa = h & 0x3ff;
+
+	if(exponent == 0)
+	{
+		// Zero or denormal: mantissa * 2^-24, exact in a float.
+		return BitsFloat(FloatBits(mantissa*5.9604644775390625e-8f) | sign);
+	}
+	if(exponent == 31)
+		return BitsFloat(sign | 0x7f800000 | (mantissa << 13));
+	return BitsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+std::uint16_t CpuFloatToHalf(float f)
+{
+	std::uint32_t u = FloatBits(f);
+	std::uint32_t sign = (u >> 16) & 0x8000;
+	u &= 0x7fffffff;
+
+	std::uint32_t h;
+	if(u >= 0x47800000)
+	{
+		// 2^16 and up, infinity and NaN.  Finite values from 65520 up round to infinity
+		// below, through the mantissa carrying into the exponent.
+		h = u > 0x7f800000 ? 0x7e00 : 0x7c00;
+	}
+	else if(u < 0x38800000)
+	{
+		// Below the smallest normal half.  Adding 0.5 lines the half's denormal bits up
+		// with the bottom of the float's mantissa, and the float add rounds to nearest
+		// even.
+		h = FloatBits(BitsFloat(u) + 0.5f) - 0x3f000000;
+	}
+	else
+	{
+		// Rebias the exponent and round the 13 dropped mantissa bits to nearest even.
+		std::uint32_t odd = (u >> 13) & 1;
+		u += 0xc8000fff + odd;
+		h = u >> 13;
+	}
+	return (std::uint16_t)(h | sign);
+}
+
+std::uint32_t CpuImageTexelSize(CpuImageFormat format)
+{
+	switch(format)
+	{
+	case CpuImageFormat::R32G32B32A32_FLOAT: return 16;
+	case CpuImageFormat::R16G16B16A16_FLOAT: return 8;
+	case CpuImageFormat::R8G8B8A8_UNORM: return 4;
+	case CpuImageFormat::R32_FLOAT: return 4;
+	case CpuImageFormat::R16_UNORM: return 2;
+	}
+	assert(false);
+	return 0;
+}
+
+std::uint32_t CpuImageChannelCount(CpuImageFormat format)
+{
+	return format == CpuImageFormat::R32_FLOAT || format == CpuImageFormat::R16_UNORM ? 1 : 4;
+}
+
+CpuImage::CpuImage(CpuImageFormat format, std::uint32_t width, std::uint32_t height)
+	: Format(format), Width(width), Height(height)
+{
+	Texels.resize(RowPitch()*height);
+}
+
+void DecodeCpuImageRow(const CpuImage& image, std::uint32_t y, std::uint32_t x, std::uint32_t count, float* values)
+{
+	assert(x + count <= image.Width && y < image.Height);
+	const std::uint8_t* texels = image.Row(y) + (std::size_t)x*CpuImageTexelSize(image.Format);
+
+	switch(image.Format)
+	{
+	case CpuImageFormat::R32G32B32A32_FLOAT:
+		std::memcpy(values, texels, (std::size_t)count*16);
+		break;
+	case CpuImageFormat::R16G16B16A16_FLOAT:
+		for(std::uint32_t i = 0; i < 4*count; ++i)
+		{
+			std::uint16_t h;
+			std::memcpy(&h, texels + 2*i, sizeof(h));
+			values[i] = CpuHalfToFloat(h);
+		}
+		break;
+	case CpuImageFormat::R8G8B8A8_UNORM:
+		DecodeRgba8(texels, count, values);
+		break;
+	case CpuImageFormat::R32_FLOAT:
+		std::memcpy(values, texels, (std::size_t)count*4);
+		break;
+	case CpuImageFormat::R16_UNORM:
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			std::uint16_t v;
+			std::memcpy(&v, texels + 2*i, sizeof(v));
+			values[i] = v / 65535.0f;
+		}
+		break;
+	}
+}
+
+void EncodeCpuImageRow(CpuImage& image, std::uint32_t y, std::uint32_t x, std::uint32_t count, const float* values)
+{
+	assert(x + count <= image.Width && y < image.Height);
+	std::uint8_t* texels = image.Row(y) + (std::size_t)x*CpuImageTexelSize(image.Format);
+
+	switch(image.Format)
+	{
+	case CpuImageFormat::R32G32B32A32_FLOAT:
+		std::memcpy(texels, values, (std::size_t)count*16);
+		break;
+	case CpuImageFormat::R16G16B16A16_FLOAT:
+		for(std::uint32_t i = 0; i < 4*count; ++i)
+		{
+			std::uint16_t h = CpuFloatToHalf(values[i]);
+			std::memcpy(texels + 2*i, &h, sizeof(h));
+		}
+		break;
+	case CpuImageFormat::R8G8B8A8_UNORM:
+		EncodeRgba8(values, count, texels);
+		break;
+	case CpuImageFormat::R32_FLOAT:
+		std::memcpy(texels, values, (std::size_t)count*4);
+		break;
+	case CpuImageFormat::R16_UNORM:
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			std::uint16_t v = (std::uint16_t)EncodeUnorm(values[i], 65535.0f);
+			std::memcpy(texels + 2*i, &v, sizeof(v));
+		}
+		break;
+	}
+}
+
+void QuantizeCpuImageValues(CpuImageFormat format, float* values, std::size_t count)
+{
+	switch(format)
+	{
+	case CpuImageFormat::R32G32B32A32_FLOAT:
+	case CpuImageFormat::R32_FLOAT:
+		break;
+	case CpuImageFormat::R16G16B16A16_FLOAT:
+		for(std::size_t i = 0; i < count; ++i)
+			values[i] = CpuHalfToFloat(CpuFloatToHalf(values[i]));
+		break;
+	case CpuImageFormat::R8G8B8A8_UNORM:
+		for(std::size_t i = 0; i < count; ++i)
+			values[i] = EncodeUnorm(values[i], 255.0f) / 255.0f;
+		break;
+	case CpuImageFormat::R16_UNORM:
+		for(std::size_t i = 0; i < count; ++i)
+			values[i] = EncodeUnorm(values[i], 65535.0f) / 65535.0f;
+		break;
+	}
+}
@@ -0,0 +1,62 @@
+//***************************************************************************************
+// CpuImage.h
+//
+// Images in system memory for the CPU versions of the post-processing filters.  Texels
+// convert to floats the way a shader reading the texture sees them, and back the way a
+// shader writing a UAV stores them, so a filter run on the CPU rounds exactly where the
+// GPU does.  Formats are numbered as their DXGI_FORMATs.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class CpuImageFormat : std::uint32_t
+{
+	R32G32B32A32_FLOAT = 2,
+	R16G16B16A16_FLOAT = 10,
+	R8G8B8A8_UNORM = 28,
+	R32_FLOAT = 41,
+	R16_UNORM = 56,
+};
+
+// Bytes per texel.
+std::uint32_t CpuImageTexelSize(CpuImageFormat format);
+
+// Channels stored per texel: 4, or 1 for single-channel formats.  Decoded rows hold this
+// many floats per texel.
+std::uint32_t CpuImageChannelCount(CpuImageFormat format);
+
+struct CpuImage
+{
+	CpuImage() = default;
+	CpuImage(CpuImageFormat format, std::uint32_t width, std::uint32_t height);
+
+	std::size_t RowPitch()const { return (std::size_t)Width*CpuImageTexelSize(Format); }
+	std::uint8_t* Row(std::uint32_t y) { return Texels.data() + y*RowPitch(); }
+	const std::uint8_t* Row(std::uint32_t y)const { return Texels.data() + y*RowPitch(); }
+
+	CpuImageFormat Format = CpuImageFormat::R8G8B8A8_UNORM;
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+
+	// Rows are packed, RowPitch bytes apart.
+	std::vector<std::uint8_t> Texels;
+};
+
+// Decodes count texels of row y, starting at texel x, into CpuImageChannelCount floats
+// per texel.
+void DecodeCpuImageRow(const CpuImage& image, std::uint32_t y, std::uint32_t x, std::uint32_t count, float* values);
+
+// Encodes count texels into row y, starting at texel x.  UNORM channels saturate and
+// round to nearest even; 16-bit FLOAT channels round to the nearest half, ties to even.
+void EncodeCpuImageRow(CpuImage& image, std::uint32_t y, std::uint32_t x, std::uint32_t count, const float* values);
+
+// Rounds count channel values to what encoding and decoding them would give, as a shader
+// writing a texture that the next pass reads.
+void QuantizeCpuImageValues(CpuImageFormat format, float* values, std::size_t count);
+
+float CpuHalfToFloat(std::uint16_t h);
+std::uint16_t CpuFloatToHalf(float f);
@@ -0,0 +1,202 @@
+//***************************************************************************************
+// CpuSobel.cpp
+//***************************************************************************************
+
+#include "CpuSobel.h"
+#include "SimdFloat.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+namespace
+{
+	// Texels per tile.  A tile's three rows of planes stay in L1.
+	const std::uint32_t TileWidth = 256;
+	const std::uint32_t TileHeight = 32;
+
+	std::size_t AlignUp(std::size_t x)
+	{
+		return (x + FloatVWidth - 1) / FloatVWidth * FloatVWidth;
+	}
+
+	// Called for each row of a tile with its edge values and the four planes of its
+	// center row; texel x0 + t is at edges[t] and planes[c][t + 1].
+	typedef std::function<void(std::uint32_t y, std::uint32_t x0, std::uint32_t count,
+		float* edges, float* const planes[4], float* scratch)> SobelRowWriter;
+
+	// Loads texels x0 - 1 through x0 + count of row y into planes[c][0..count + 1], zero
+	// outside the image.
+	void LoadPlanes(const CpuImage& image, int y, int x0, std::uint32_t count, float* const planes[4], float* scratch)
+	{
+		for(int c = 0; c < 4; ++c)
+			std::memset(planes[c], 0, (count + 2)*sizeof(float));
+		if(y < 0 || y >= (int)image.Height)
+			return;
+
+		const int first = x0 > 0 ? x0 - 1 : 0;
+		const int last = x0 + (int)count < (int)image.Width ? x0 + (int)count : (int)image.Width - 1;
+		const std::uint32_t n = (std::uint32_t)(last - first + 1);
+		const std::uint32_t offset = (std::uint32_t)(first - (x0 - 1));
+		DecodeCpuImageRow(image, (std::uint32_t)y, (std::uint32_t)first, n, scratch);
+
+		if(CpuImageChannelCount(image.Format) == 4)
+		{
+			for(std::uint32_t t = 0; t < n; ++t)
+			{
+				for(int c = 0; c < 4; ++c)
+					planes[c][offset + t] = scratch[4*t + c];
+			}
+		}
+		else
+		{
+			for(std::uint32_t t = 0; t < n; ++t)
+			{
+				planes[0][offset + t] = scratch[t];
+				planes[3][offset + t] = 1.0f;
+			}
+		}
+	}
+
+	// Sobel.hlsl for count texels, rounded up to whole vectors.  rows[i][c] is channel c
+	// of row i of the 3x3 neighborhood, starting one texel left of the first output.
+	void EdgeRow(float* const rows[3][4], std::size_t count, float* edges)
+	{
+		const FloatV minusOne = SplatV(-1.0f);
+		const FloatV two = SplatV(2.0f);
+		const FloatV zero = SplatV(0.0f);
+		const FloatV one = SplatV(1.0f);
+		const FloatV luminance[3] = { SplatV(0.299f), SplatV(0.587f), SplatV(0.114f) };
+
+		for(std::size_t j = 0; j < count; j += FloatVWidth)
+		{
+			FloatV mag[3];
+			for(int c = 0; c < 3; ++c)
+			{
+				FloatV c00 = LoadV(rows[0][c] + j);
+				FloatV c01 = LoadV(rows[0][c] + j + 1);
+				FloatV c02 = LoadV(rows[0][c] + j + 2);
+				FloatV c10 = LoadV(rows[1][c] + j);
+				FloatV c12 = LoadV(rows[1][c] + j + 2);
+				FloatV c20 = LoadV(rows[2][c] + j);
+				FloatV c21 = LoadV(rows[2][c] + j + 1);
+				FloatV c22 = LoadV(rows[2][c] + j + 2);
+
+				// The shader's sums, left to right.
+				FloatV gx = SubV(SubV(MulV(minusOne, c00), MulV(two, c10)), c20);
+				gx = AddV(AddV(AddV(gx, c02), MulV(two, c12)), c22);
+				FloatV gy = SubV(SubV(MulV(minusOne, c20), MulV(two, c21)), c21);
+				gy = AddV(AddV(AddV(gy, c00), MulV(two, c01)), c02);
+
+				mag[c] = SqrtV(AddV(MulV(gx, gx), MulV(gy, gy)));
+			}
+
+			FloatV lum = AddV(AddV(MulV(mag[0], luminance[0]), MulV(mag[1], luminance[1])), MulV(mag[2], luminance[2]));
+			StoreV(edges + j, SubV(one, MinV(MaxV(lum, zero), one)));
+		}
+	}
+
+	// Runs EdgeRow over every row of every tile of input, keeping the tile's last three
+	// rows of planes in a ring so each row is decoded once per tile.
+	void SobelTiles(const CpuImage& input, ThreadPool& pool, const SobelRowWriter& writeRow)
+	{
+		const std::uint32_t tilesX = (input.Width + TileWidth - 1) / TileWidth;
+		const std::uint32_t tilesY = (input.Height + TileHeight - 1) / TileHeight;
+
+		// Room for the last vector's reads two texels past its end.
+		const std::size_t planeStride = AlignUp(TileWidth) + 2;
+
+		pool.ParallelForRange(0, (int)(tilesX*tilesY), 1, [&](int tileBegin, int tileEnd)
+		{
+			std::vector<float> planeStorage(3*4*planeStride, 0.0f);
+			std::vector<float> edges(AlignUp(TileWidth));
+			std::vector<float> scratch(4*(TileWidth + 2));
+
+			float* planes[3][4];
+			for(int i = 0; i < 3; ++i)
+			{
+				for(int c = 0; c < 4; ++c)
+					planes[i][c] = planeStorage.data() + (4*i + c)*planeStride;
+			}
+
+			for(int tile = tileBegin; tile < tileEnd; ++tile)
+			{
+				const std::uint32_t x0 = (tile % tilesX)*TileWidth;
+				const std::uint32_t y0 = (tile / tilesX)*TileHeight;
+				const std::uint32_t count = input.Width - x0 < TileWidth ? input.Width - x0 : TileWidth;
+				const std::uint32_t rowCount = input.Height - y0 < TileHeight ? input.Height - y0 : TileHeight;
+
+				LoadPlanes(input, (int)y0 - 1, (int)x0, count, planes[0], scratch.data());
+				LoadPlanes(input, (int)y0, (int)x0, count, planes[1], scratch.data());
+				for(std::uint32_t r = 0; r < rowCount; ++r)
+				{
+					LoadPlanes(input, (int)(y0 + r) + 1, (int)x0, count, planes[(r + 2) % 3], scratch.data());
+
+					float* const rows[3][4] =
+					{
+						{ planes[r % 3][0], planes[r % 3][1], planes[r % 3][2], planes[r % 3][3] },
+						{ planes[(r + 1) % 3][0], planes[(r + 1) % 3][1], planes[(r + 1) % 3][2], planes[(r + 1) % 3][3] },
+						{ planes[(r + 2) % 3][0], planes[(r + 2) % 3][1], planes[(r + 2) % 3][2], planes[(r + 2) % 3][3] },
+					};
+					EdgeRow(rows, count, edges.data());
+					writeRow(y0 + r, x0, count, edges.data(), rows[1], scratch.data());
+				}
+			}
+		});
+	}
+}
+
+void CpuSobelEdgeMap(const CpuImage& input, CpuImage& edgeMap, ThreadPool& pool)
+{
+	assert(edgeMap.Width == input.Width && edgeMap.Height == input.Height && &edgeMap != &input);
+	if(input.Width == 0 || input.Height == 0)
+		return;
+
+	const std::uint32_t channels = CpuImageChannelCount(edgeMap.Format);
+	SobelTiles(input, pool, [&](std::uint32_t y, std::uint32_t x0, std::uint32_t count,
+		float* edges, float* const planes[4], float* scratch)
+	{
+		(void)planes;
+		for(std::uint32_t t = 0; t < count; ++t)
+		{
+			for(std::uint32_t c = 0; c < channels; ++c)
+				scratch[channels*t + c] = edges[t];
+		}
+		EncodeCpuImageRow(edgeMap, y, x0, count, scratch);
+	});
+}
+
+void CpuSobelComposite(const CpuImage& input, CpuImage& output, ThreadPool& pool)
+{
+	assert(output.Width == input.Width && output.Height == input.Height && &output != &input);
+	if(input.Width == 0 || input.Height == 0)
+		return;
+
+	// SobelFilter's edge map has the input's format.  A single-channel one reads back as
+	// (e, 0, 0, 1).
+	const bool singleChannelEdges = CpuImageChannelCount(input.Format) == 1;
+	const std::uint32_t channels = CpuImageChannelCount(output.Format);
+
+	SobelTiles(input, pool, [&](std::uint32_t y, std::uint32_t x0, std::uint32_t count,
+		float* edges, float* const planes[4], float* scratch)
+	{
+		QuantizeCpuImageValues(input.Format, edges, count);
+
+		for(std::uint32_t c = 0; c < channels; ++c)
+		{
+			const float* base = planes[c] + 1;
+			if(c > 0 && singleChannelEdges)
+			{
+				const float e = c == 3 ? 1.0f : 0.0f;
+				for(std::uint32_t t = 0; t < count; ++t)
+					scratch[channels*t + c] = base[t]*e;
+			}
+			else
+			{
+				for(std::uint32_t t = 0; t < count; ++t)
+					scratch[channels*t + c] = base[t]*edges[t];
+			}
+		}
+		EncodeCpuImageRow(output, y, x0, count, scratch);
+	});
+}
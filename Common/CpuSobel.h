@@ -0,0 +1,31 @@
+//***************************************************************************************
+// CpuSobel.h
+//
+// SobelFilter's edge detection and SobelApp's composite on the CPU, for processing
+// captured frames on machines without a GPU.  Results match Sobel.hlsl and
+// Composite.hlsl on the same input:
+//   - loads outside the image read as zero, as out-of-range texture loads do,
+//   - each color channel gets its own Sobel gradient, and the edge value is one minus
+//     the saturated luminance of the gradient magnitudes,
+//   - Gy weights c[2][1] by -3 and never reads c[2][2], as the shader's expression does,
+//   - the edge value is rounded to the input's format, as the shader's store to the edge
+//     map is, before the composite multiplies it in.
+// Single-channel inputs read as (r, 0, 0, 1), as a shader sees them.
+//
+// Both functions run fused 3x3 row kernels on SIMD vectors over tiles of the image on a
+// thread pool.  Each tile deinterleaves its rows into per-channel planes, so the
+// gradients, magnitudes and luminance sum are all lane-wise.
+//***************************************************************************************
+
+#pragma once
+
+#include "CpuImage.h"
+#include "ThreadPool.h"
+
+// Writes the edge map of input to edgeMap, which must have input's size: 1 where the
+// image is flat, falling to 0 across edges.  Every channel of a texel gets the same value.
+void CpuSobelEdgeMap(const CpuImage& input, CpuImage& edgeMap, ThreadPool& pool = ThreadPool::Default());
+
+// Writes input multiplied by its edge map to output, which must have input's size and be
+// a different image, without storing the edge map.
+void CpuSobelComposite(const CpuImage& input, CpuImage& output, ThreadPool& pool = ThreadPool::Default());
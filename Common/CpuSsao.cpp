@@ -0,0 +1,702 @@
+//***************************************************************************************
+// CpuSsao.cpp
+//***************************************************************************************
+
+#include "CpuSsao.h"
+#include "SimdFloat.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// Tiles are TileSize x TileSize ambient texels; one ParallelForRange task takes
+	// TileGrain of them.
+	const std::uint32_t TileSize = 8;
+	const std::uint32_t TileTexels = TileSize*TileSize;
+	const int TileGrain = 8;
+
+	inline float Saturate(float x)
+	{
+		return x > 0.0f ? (x < 1.0f ? x : 1.0f) : 0.0f;
+	}
+
+	inline FloatV SaturateV(FloatV x)
+	{
+		return MinV(MaxV(x, SplatV(0.0f)), SplatV(1.0f));
+	}
+
+	inline float Sign(float x)
+	{
+		return x > 0.0f ? 1.0f : (x < 0.0f ? -1.0f : 0.0f);
+	}
+
+	inline FloatV SignV(FloatV x)
+	{
+		const FloatV zero = SplatV(0.0f);
+		return OrV(AndV(GreaterV(x, zero), SplatV(1.0f)), AndV(LessV(x, zero), SplatV(-1.0f)));
+	}
+
+	// The texture coordinate the rasterizer interpolates at the center of texel x.
+	inline float TexCoord(std::uint32_t x, std::uint32_t size)
+	{
+		return ((float)x + 0.5f) / (float)size;
+	}
+
+	// Index of the texel a point-clamp sample at (u, v) reads.
+	inline std::size_t PointTexel(float u, float v, std::uint32_t width, std::uint32_t height)
+	{
+		float fx = std::floor(u*width);
+		float fy = std::floor(v*height);
+		std::uint32_t x = fx > 0.0f ? (fx < width - 1.0f ? (std::uint32_t)fx : width - 1) : 0;
+		std::uint32_t y = fy > 0.0f ? (fy < height - 1.0f ? (std::uint32_t)fy : height - 1) : 0;
+		return (std::size_t)y*width + x;
+	}
+
+	// The four texels and weights of a bilinear sample at (u, v), in the order t00, t10,
+	// t01, t11.  Border addressing gives index -1 outside the map; far outside, every
+	// texel is border, so the coordinate is clamped first, which also sends NaN there.
+	struct Footprint
+	{
+		std::int32_t Index[4];
+		float Ax;
+		float Ay;
+	};
+
+	inline Footprint BorderFootprint(float u, float v, std::uint32_t width, std::uint32_t height)
+	{
+		float fx = u*width - 0.5f;
+		float fy = v*height - 0.5f;
+		fx = fx > -2.0f ? (fx < width + 1.0f ? fx : width + 1.0f) : -2.0f;
+		fy = fy > -2.0f ? (fy < height + 1.0f ? fy : height + 1.0f) : -2.0f;
+		float x0 = std::floor(fx);
+		float y0 = std::floor(fy);
+
+		Footprint f;
+		f.Ax = fx - x0;
+		f.Ay = fy - y0;
+		for(int i = 0; i < 4; ++i)
+		{
+			int x = (int)x0 + (i & 1);
+			int y = (int)y0 + (i >> 1);
+			bool inside = x >= 0 && y >= 0 && x < (int)width && y < (int)height;
+			f.Index[i] = inside ? y*(int)width + x : -1;
+		}
+		return f;
+	}
+
+	inline Footprint WrapFootprint(float u, float v, std::uint32_t width, std::uint32_t height)
+	{
+		float fx = u*width - 0.5f;
+		float fy = v*height - 0.5f;
+		float x0 = std::floor(fx);
+		float y0 = std::floor(fy);
+
+		Footprint f;
+		f.Ax = fx - x0;
+		f.Ay = fy - y0;
+		for(int i = 0; i < 4; ++i)
+		{
+			int x = ((int)x0 + (i & 1)) % (int)width;
+			int y = ((int)y0 + (i >> 1)) % (int)height;
+			x += x < 0 ? (int)width : 0;
+			y += y < 0 ? (int)height : 0;
+			f.Index[i] = y*(int)width + x;
+		}
+		return f;
+	}
+
+	// The depth sampler's border color is opaque white.
+	inline float FetchDepth(const std::vector<float>& depth, std::int32_t index)
+	{
+		return index >= 0 ? depth[index] : 1.0f;
+	}
+
+	inline float Bilinear(float t00, float t10, float t01, float t11, float ax, float ay)
+	{
+		float top = t00 + ax*(t10 - t00);
+		float bottom = t01 + ax*(t11 - t01);
+		return top + ay*(bottom - top);
+	}
+
+	inline FloatV BilinearV(FloatV t00, FloatV t10, FloatV t01, FloatV t11, FloatV ax, FloatV ay)
+	{
+		FloatV top = AddV(t00, MulV(ax, SubV(t10, t00)));
+		FloatV bottom = AddV(t01, MulV(ax, SubV(t11, t01)));
+		return AddV(top, MulV(ay, SubV(bottom, top)));
+	}
+
+	// Bilinear samples of plane for FloatVWidth lanes of footprints.
+	inline FloatV GatherBilinearV(const std::vector<float>& plane, const Footprint* f)
+	{
+		float t[4][FloatVWidth];
+		float ax[FloatVWidth];
+		float ay[FloatVWidth];
+		for(std::uint32_t l = 0; l < FloatVWidth; ++l)
+		{
+			for(int i = 0; i < 4; ++i)
+				t[i][l] = FetchDepth(plane, f[l].Index[i]);
+			ax[l] = f[l].Ax;
+			ay[l] = f[l].Ay;
+		}
+		return BilinearV(LoadV(t[0]), LoadV(t[1]), LoadV(t[2]), LoadV(t[3]), LoadV(ax), LoadV(ay));
+	}
+
+	// Point (x, y, 0, 1) on the NDC near plane taken back to view space.
+	XMFLOAT3 NearPlanePoint(const XMFLOAT4X4& invProj, float x, float y)
+	{
+		float px = x*invProj._11 + y*invProj._21 + invProj._41;
+		float py = x*invProj._12 + y*invProj._22 + invProj._42;
+		float pz = x*invProj._13 + y*invProj._23 + invProj._43;
+		float pw = x*invProj._14 + y*invProj._24 + invProj._44;
+		return XMFLOAT3(px / pw, py / pw, pz / pw);
+	}
+
+	// Runs body(first, last) over [0, count), on pool when there is one.
+	template<typename Body>
+	void ForRange(ThreadPool* pool, int count, int grainSize, const Body& body)
+	{
+		if(pool != nullptr)
+			pool->ParallelForRange(0, count, grainSize, body);
+		else if(count > 0)
+			body(0, count);
+	}
+}
+
+CpuSsao::CpuSsao(const CpuSsaoConstants& constants)
+	: mConstants(constants)
+{
+	assert(mConstants.BlurWeights.size() % 2 == 1 && mConstants.BlurWeights.size() <= 2*MaxBlurRadius + 1);
+
+	// Transform NDC space [-1,+1]^2 to texture space [0,1]^2, as SsaoApp::UpdateSsaoCB
+	// does, written out per row of Proj.
+	const XMFLOAT4X4& p = mConstants.Proj;
+	for(int r = 0; r < 4; ++r)
+	{
+		mProjTex.m[r][0] = 0.5f*p.m[r][0] + 0.5f*p.m[r][3];
+		mProjTex.m[r][1] = -0.5f*p.m[r][1] + 0.5f*p.m[r][3];
+		mProjTex.m[r][2] = p.m[r][2];
+		mProjTex.m[r][3] = p.m[r][3];
+	}
+
+	XMVECTOR det;
+	XMFLOAT4X4 invProj;
+	XMStoreFloat4x4(&invProj, XMMatrixInverse(&det, XMLoadFloat4x4(&mConstants.Proj)));
+
+	// The vertex shader's quad corners at texture coordinates (0,0), (1,0) and (0,1).
+	mNearTopLeft = NearPlanePoint(invProj, -1.0f, 1.0f);
+	XMFLOAT3 topRight = NearPlanePoint(invProj, 1.0f, 1.0f);
+	XMFLOAT3 bottomLeft = NearPlanePoint(invProj, -1.0f, -1.0f);
+	mNearRight = XMFLOAT3(topRight.x - mNearTopLeft.x, topRight.y - mNearTopLeft.y, topRight.z - mNearTopLeft.z);
+	mNearDown = XMFLOAT3(bottomLeft.x - mNearTopLeft.x, bottomLeft.y - mNearTopLeft.y, bottomLeft.z - mNearTopLeft.z);
+}
+
+void CpuSsao::ComputeSsao(const CpuImage& depthMap, const CpuImage& normalMap, const CpuImage& randomVectorMap,
+	CpuImage& ambientMap, int blurCount, ThreadPool& pool)
+{
+	LoadInputs(depthMap, normalMap, randomVectorMap, ambientMap, &pool);
+	if(mAmbientWidth == 0 || mAmbientHeight == 0)
+		return;
+
+	const std::uint32_t tilesX = (mAmbientWidth + TileSize - 1) / TileSize;
+	const std::uint32_t tilesY = (mAmbientHeight + TileSize - 1) / TileSize;
+	const int tileCount = (int)(tilesX*tilesY);
+
+	pool.ParallelForRange(0, tileCount, TileGrain, [&](int first, int last)
+	{
+		for(int t = first; t < last; ++t)
+			OcclusionTile((t % tilesX)*TileSize, (t / tilesX)*TileSize);
+	});
+
+	if(blurCount > 0)
+	{
+		mBlurMasks.resize((std::size_t)mAmbientWidth*mAmbientHeight);
+		pool.ParallelForRange(0, (int)mAmbientHeight, 8, [&](int first, int last)
+		{
+			for(std::uint32_t y = (std::uint32_t)first; y < (std::uint32_t)last; ++y)
+			{
+				for(std::uint32_t x = 0; x < mAmbientWidth; ++x)
+					mBlurMasks[(std::size_t)y*mAmbientWidth + x] = BlurMask(x, y);
+			}
+		});
+	}
+
+	for(int i = 0; i < blurCount; ++i)
+	{
+		for(int pass = 0; pass < 2; ++pass)
+		{
+			const bool horzBlur = pass == 0;
+			pool.ParallelForRange(0, tileCount, TileGrain, [&](int first, int last)
+			{
+				for(int t = first; t < last; ++t)
+					BlurTile((t % tilesX)*TileSize, (t / tilesX)*TileSize, horzBlur);
+			});
+		}
+	}
+
+	StoreAmbientMap(ambientMap, &pool);
+}
+
+void CpuSsao::ComputeSsaoScalar(const CpuImage& depthMap, const CpuImage& normalMap, const CpuImage& randomVectorMap,
+	CpuImage& ambientMap, int blurCount)
+{
+	LoadInputs(depthMap, normalMap, randomVectorMap, ambientMap, nullptr);
+
+	for(std::uint32_t y = 0; y < mAmbientHeight; ++y)
+	{
+		for(std::uint32_t x = 0; x < mAmbientWidth; ++x)
+			mAmbient[0][(std::size_t)y*mAmbientWidth + x] = OcclusionTexel(x, y);
+	}
+	QuantizeCpuImageValues(mAmbientFormat, mAmbient[0].data(), mAmbient[0].size());
+
+	for(int i = 0; i < blurCount; ++i)
+	{
+		for(int pass = 0; pass < 2; ++pass)
+		{
+			const bool horzBlur = pass == 0;
+			std::vector<float>& output = mAmbient[horzBlur ? 1 : 0];
+			for(std::uint32_t y = 0; y < mAmbientHeight; ++y)
+			{
+				for(std::uint32_t x = 0; x < mAmbientWidth; ++x)
+					output[(std::size_t)y*mAmbientWidth + x] = BlurTexel(x, y, horzBlur);
+			}
+			QuantizeCpuImageValues(mAmbientFormat, output.data(), output.size());
+		}
+	}
+
+	StoreAmbientMap(ambientMap, nullptr);
+}
+
+void CpuSsao::LoadInputs(const CpuImage& depthMap, const CpuImage& normalMap, const CpuImage& randomVectorMap,
+	const CpuImage& ambientMap, ThreadPool* pool)
+{
+	assert(CpuImageChannelCount(depthMap.Format) == 1 && CpuImageChannelCount(ambientMap.Format) == 1);
+	assert(CpuImageChannelCount(normalMap.Format) == 4 && CpuImageChannelCount(randomVectorMap.Format) == 4);
+	assert(normalMap.Width == depthMap.Width && normalMap.Height == depthMap.Height);
+	assert(randomVectorMap.Width > 0 && randomVectorMap.Height > 0);
+
+	mWidth = depthMap.Width;
+	mHeight = depthMap.Height;
+	mAmbientWidth = ambientMap.Width;
+	mAmbientHeight = ambientMap.Height;
+	mRandomWidth = randomVectorMap.Width;
+	mRandomHeight = randomVectorMap.Height;
+	mAmbientFormat = ambientMap.Format;
+
+	const std::size_t texelCount = (std::size_t)mWidth*mHeight;
+	mDepth.resize(texelCount);
+	mNormalX.resize(texelCount);
+	mNormalY.resize(texelCount);
+	mNormalZ.resize(texelCount);
+	mRandomX.resize((std::size_t)mRandomWidth*mRandomHeight);
+	mRandomY.resize(mRandomX.size());
+	mRandomZ.resize(mRandomX.size());
+	mAmbient[0].resize((std::size_t)mAmbientWidth*mAmbientHeight);
+	mAmbient[1].resize(mAmbient[0].size());
+
+	ForRange(pool, (int)mHeight, 16, [&](int first, int last)
+	{
+		std::vector<float> row(4*(std::size_t)mWidth);
+		for(std::uint32_t y = (std::uint32_t)first; y < (std::uint32_t)last; ++y)
+		{
+			const std::size_t base = (std::size_t)y*mWidth;
+			DecodeCpuImageRow(depthMap, y, 0, mWidth, mDepth.data() + base);
+			DecodeCpuImageRow(normalMap, y, 0, mWidth, row.data());
+			for(std::uint32_t x = 0; x < mWidth; ++x)
+			{
+				mNormalX[base + x] = row[4*x + 0];
+				mNormalY[base + x] = row[4*x + 1];
+				mNormalZ[base + x] = row[4*x + 2];
+			}
+		}
+	});
+
+	std::vector<float> row(4*(std::size_t)mRandomWidth);
+	for(std::uint32_t y = 0; y < mRandomHeight; ++y)
+	{
+		const std::size_t base = (std::size_t)y*mRandomWidth;
+		DecodeCpuImageRow(randomVectorMap, y, 0, mRandomWidth, row.data());
+		for(std::uint32_t x = 0; x < mRandomWidth; ++x)
+		{
+			mRandomX[base + x] = row[4*x + 0];
+			mRandomY[base + x] = row[4*x + 1];
+			mRandomZ[base + x] = row[4*x + 2];
+		}
+	}
+}
+
+float CpuSsao::NdcDepthToViewDepth(float zNdc)const
+{
+	// z_ndc = A + B/viewZ, where gProj[2,2]=A and gProj[3,2]=B.
+	return mConstants.Proj._43 / (zNdc - mConstants.Proj._33);
+}
+
+float CpuSsao::SampleDepth(float u, float v)const
+{
+	Footprint f = BorderFootprint(u, v, mWidth, mHeight);
+	return Bilinear(FetchDepth(mDepth, f.Index[0]), FetchDepth(mDepth, f.Index[1]),
+		FetchDepth(mDepth, f.Index[2]), FetchDepth(mDepth, f.Index[3]), f.Ax, f.Ay);
+}
+
+float CpuSsao::OcclusionTexel(std::uint32_t x, std::uint32_t y)const
+{
+	const float u = TexCoord(x, mAmbientWidth);
+	const float v = TexCoord(y, mAmbientHeight);
+
+	// Get viewspace normal and z-coord of this pixel.
+	std::size_t ni = PointTexel(u, v, mWidth, mHeight);
+	float nx = mNormalX[ni];
+	float ny = mNormalY[ni];
+	float nz = mNormalZ[ni];
+	float length = std::sqrt(nx*nx + ny*ny + nz*nz);
+	nx = nx / length;
+	ny = ny / length;
+	nz = nz / length;
+
+	float pz = NdcDepthToViewDepth(SampleDepth(u, v));
+
+	// Reconstruct full view space position p = t*PosV, where p.z = pz.
+	float posVx = mNearTopLeft.x + u*mNearRight.x + v*mNearDown.x;
+	float posVy = mNearTopLeft.y + u*mNearRight.y + v*mNearDown.y;
+	float posVz = mNearTopLeft.z + u*mNearRight.z + v*mNearDown.z;
+	float t = pz / posVz;
+	float px = t*posVx;
+	float py = t*posVy;
+	pz = t*posVz;
+
+	// Extract random vector and map from [0,1] --> [-1, +1].
+	Footprint rf = WrapFootprint(4.0f*u, 4.0f*v, mRandomWidth, mRandomHeight);
+	float rx = 2.0f*Bilinear(mRandomX[rf.Index[0]], mRandomX[rf.Index[1]], mRandomX[rf.Index[2]], mRandomX[rf.Index[3]], rf.Ax, rf.Ay) - 1.0f;
+	float ry = 2.0f*Bilinear(mRandomY[rf.Index[0]], mRandomY[rf.Index[1]], mRandomY[rf.Index[2]], mRandomY[rf.Index[3]], rf.Ax, rf.Ay) - 1.0f;
+	float rz = 2.0f*Bilinear(mRandomZ[rf.Index[0]], mRandomZ[rf.Index[1]], mRandomZ[rf.Index[2]], mRandomZ[rf.Index[3]], rf.Ax, rf.Ay) - 1.0f;
+
+	const XMFLOAT4X4& m = mProjTex;
+	const float fadeLength = mConstants.OcclusionFadeEnd - mConstants.OcclusionFadeStart;
+
+	float occlusionSum = 0.0f;
+	for(int i = 0; i < SampleCount; ++i)
+	{
+		// reflect(offset, randVec).
+		const XMFLOAT4& o = mConstants.OffsetVectors[i];
+		float d = o.x*rx + o.y*ry + o.z*rz;
+		float ox = o.x - 2.0f*d*rx;
+		float oy = o.y - 2.0f*d*ry;
+		float oz = o.z - 2.0f*d*rz;
+
+		// Flip offset vector if it is behind the plane defined by (p, n).
+		float s = Sign(ox*nx + oy*ny + oz*nz)*mConstants.OcclusionRadius;
+		float qx = px + s*ox;
+		float qy = py + s*oy;
+		float qz = pz + s*oz;
+
+		// Project q and generate projective tex-coords.
+		float hx = qx*m._11 + qy*m._21 + qz*m._31 + m._41;
+		float hy = qx*m._12 + qy*m._22 + qz*m._32 + m._42;
+		float hw = qx*m._14 + qy*m._24 + qz*m._34 + m._44;
+
+		// The nearest depth along the ray from the eye to q, and the point r on that ray.
+		float rzv = NdcDepthToViewDepth(SampleDepth(hx / hw, hy / hw));
+		float tr = rzv / qz;
+		float dx = tr*qx - px;
+		float dy = tr*qy - py;
+		float dz = tr*qz - pz;
+
+		float distZ = pz - tr*qz;
+		float dlength = std::sqrt(dx*dx + dy*dy + dz*dz);
+		float dp = nx*(dx / dlength) + ny*(dy / dlength) + nz*(dz / dlength);
+		dp = dp > 0.0f ? dp : 0.0f;
+
+		float occlusion = distZ > mConstants.SurfaceEpsilon ?
+			Saturate((mConstants.OcclusionFadeEnd - distZ) / fadeLength) : 0.0f;
+		occlusionSum = occlusionSum + dp*occlusion;
+	}
+
+	occlusionSum = occlusionSum / (float)SampleCount;
+	float access = 1.0f - occlusionSum;
+
+	// Sharpen the contrast of the SSAO map: pow(access, 6).
+	float access2 = access*access;
+	return Saturate(access2*access2*access2);
+}
+
+void CpuSsao::OcclusionTile(std::uint32_t x0, std::uint32_t y0)
+{
+	const XMFLOAT4X4& m = mProjTex;
+	const FloatV zero = SplatV(0.0f);
+	const FloatV one = SplatV(1.0f);
+	const FloatV two = SplatV(2.0f);
+	const FloatV radius = SplatV(mConstants.OcclusionRadius);
+	const FloatV epsilon = SplatV(mConstants.SurfaceEpsilon);
+	const FloatV fadeEnd = SplatV(mConstants.OcclusionFadeEnd);
+	const FloatV fadeLength = SplatV(mConstants.OcclusionFadeEnd - mConstants.OcclusionFadeStart);
+	const FloatV projA = SplatV(mConstants.Proj._33);
+	const FloatV projB = SplatV(mConstants.Proj._43);
+
+	float results[TileTexels];
+	for(std::uint32_t j = 0; j < TileTexels; j += FloatVWidth)
+	{
+		// Lanes past the map's edge repeat its last texel and are not stored.
+		float u[FloatVWidth], v[FloatVWidth];
+		float n[3][FloatVWidth];
+		Footprint depthTaps[FloatVWidth];
+		Footprint randomTaps[FloatVWidth];
+		float random[3][4][FloatVWidth];
+		float randomAx[FloatVWidth], randomAy[FloatVWidth];
+		for(std::uint32_t l = 0; l < FloatVWidth; ++l)
+		{
+			std::uint32_t x = x0 + (j + l) % TileSize;
+			std::uint32_t y = y0 + (j + l) / TileSize;
+			u[l] = TexCoord(x < mAmbientWidth ? x : mAmbientWidth - 1, mAmbientWidth);
+			v[l] = TexCoord(y < mAmbientHeight ? y : mAmbientHeight - 1, mAmbientHeight);
+
+			std::size_t ni = PointTexel(u[l], v[l], mWidth, mHeight);
+			n[0][l] = mNormalX[ni];
+			n[1][l] = mNormalY[ni];
+			n[2][l] = mNormalZ[ni];
+			depthTaps[l] = BorderFootprint(u[l], v[l], mWidth, mHeight);
+
+			randomTaps[l] = WrapFootprint(4.0f*u[l], 4.0f*v[l], mRandomWidth, mRandomHeight);
+			for(int i = 0; i < 4; ++i)
+			{
+				random[0][i][l] = mRandomX[randomTaps[l].Index[i]];
+				random[1][i][l] = mRandomY[randomTaps[l].Index[i]];
+				random[2][i][l] = mRandomZ[randomTaps[l].Index[i]];
+			}
+			randomAx[l] = randomTaps[l].Ax;
+			randomAy[l] = randomTaps[l].Ay;
+		}
+
+		FloatV uV = LoadV(u);
+		FloatV vV = LoadV(v);
+		FloatV nx = LoadV(n[0]);
+		FloatV ny = LoadV(n[1]);
+		FloatV nz = LoadV(n[2]);
+		FloatV length = SqrtV(AddV(AddV(MulV(nx, nx), MulV(ny, ny)), MulV(nz, nz)));
+		nx = DivV(nx, length);
+		ny = DivV(ny, length);
+		nz = DivV(nz, length);
+
+		FloatV pz = DivV(projB, SubV(GatherBilinearV(mDepth, depthTaps), projA));
+
+		FloatV posVx = AddV(AddV(SplatV(mNearTopLeft.x), MulV(uV, SplatV(mNearRight.x))), MulV(vV, SplatV(mNearDown.x)));
+		FloatV posVy = AddV(AddV(SplatV(mNearTopLeft.y), MulV(uV, SplatV(mNearRight.y))), MulV(vV, SplatV(mNearDown.y)));
+		FloatV posVz = AddV(AddV(SplatV(mNearTopLeft.z), MulV(uV, SplatV(mNearRight.z))), MulV(vV, SplatV(mNearDown.z)));
+		FloatV t = DivV(pz, posVz);
+		FloatV px = MulV(t, posVx);
+		FloatV py = MulV(t, posVy);
+		pz = MulV(t, posVz);
+
+		FloatV rAx = LoadV(randomAx);
+		FloatV rAy = LoadV(randomAy);
+		FloatV r[3];
+		for(int c = 0; c < 3; ++c)
+		{
+			FloatV s = BilinearV(LoadV(random[c][0]), LoadV(random[c][1]), LoadV(random[c][2]), LoadV(random[c][3]), rAx, rAy);
+			r[c] = SubV(MulV(two, s), one);
+		}
+
+		FloatV occlusionSum = zero;
+		for(int i = 0; i < SampleCount; ++i)
+		{
+			const XMFLOAT4& o = mConstants.OffsetVectors[i];
+			FloatV oxS = SplatV(o.x);
+			FloatV oyS = SplatV(o.y);
+			FloatV ozS = SplatV(o.z);
+			FloatV d = AddV(AddV(MulV(oxS, r[0]), MulV(oyS, r[1])), MulV(ozS, r[2]));
+			FloatV twoD = MulV(two, d);
+			FloatV ox = SubV(oxS, MulV(twoD, r[0]));
+			FloatV oy = SubV(oyS, MulV(twoD, r[1]));
+			FloatV oz = SubV(ozS, MulV(twoD, r[2]));
+
+			FloatV s = MulV(SignV(AddV(AddV(MulV(ox, nx), MulV(oy, ny)), MulV(oz, nz))), radius);
+			FloatV qx = AddV(px, MulV(s, ox));
+			FloatV qy = AddV(py, MulV(s, oy));
+			FloatV qz = AddV(pz, MulV(s, oz));
+
+			FloatV hx = AddV(AddV(AddV(MulV(qx, SplatV(m._11)), MulV(qy, SplatV(m._21))), MulV(qz, SplatV(m._31))), SplatV(m._41));
+			FloatV hy = AddV(AddV(AddV(MulV(qx, SplatV(m._12)), MulV(qy, SplatV(m._22))), MulV(qz, SplatV(m._32))), SplatV(m._42));
+			FloatV hw = AddV(AddV(AddV(MulV(qx, SplatV(m._14)), MulV(qy, SplatV(m._24))), MulV(qz, SplatV(m._34))), SplatV(m._44));
+
+			float tu[FloatVWidth], tv[FloatVWidth];
+			StoreV(tu, DivV(hx, hw));
+			StoreV(tv, DivV(hy, hw));
+			Footprint taps[FloatVWidth];
+			for(std::uint32_t l = 0; l < FloatVWidth; ++l)
+				taps[l] = BorderFootprint(tu[l], tv[l], mWidth, mHeight);
+
+			FloatV rzv = DivV(projB, SubV(GatherBilinearV(mDepth, taps), projA));
+			FloatV tr = DivV(rzv, qz);
+			FloatV rx = MulV(tr, qx);
+			FloatV ry = MulV(tr, qy);
+			FloatV rzq = MulV(tr, qz);
+			FloatV dx = SubV(rx, px);
+			FloatV dy = SubV(ry, py);
+			FloatV dz = SubV(rzq, pz);
+
+			FloatV distZ = SubV(pz, rzq);
+			FloatV dlength = SqrtV(AddV(AddV(MulV(dx, dx), MulV(dy, dy)), MulV(dz, dz)));
+			FloatV dp = AddV(AddV(MulV(nx, DivV(dx, dlength)), MulV(ny, DivV(dy, dlength))), MulV(nz, DivV(dz, dlength)));
+			dp = MaxV(dp, zero);
+
+			FloatV occlusion = AndV(GreaterV(distZ, epsilon), SaturateV(DivV(SubV(fadeEnd, distZ), fadeLength)));
+			occlusionSum = AddV(occlusionSum, MulV(dp, occlusion));
+		}
+
+		occlusionSum = DivV(occlusionSum, SplatV((float)SampleCount));
+		FloatV access = SubV(one, occlusionSum);
+		FloatV access2 = MulV(access, access);
+		StoreV(results + j, SaturateV(MulV(MulV(access2, access2), access2)));
+	}
+
+	const std::uint32_t width = mAmbientWidth - x0 < TileSize ? mAmbientWidth - x0 : TileSize;
+	const std::uint32_t height = mAmbientHeight - y0 < TileSize ? mAmbientHeight - y0 : TileSize;
+	for(std::uint32_t y = 0; y < height; ++y)
+	{
+		float* row = mAmbient[0].data() + (std::size_t)(y0 + y)*mAmbientWidth + x0;
+		std::memcpy(row, results + y*TileSize, width*sizeof(float));
+		QuantizeCpuImageValues(mAmbientFormat, row, width);
+	}
+}
+
+std::uint32_t CpuSsao::BlurMask(std::uint32_t x, std::uint32_t y)const
+{
+	const int radius = (int)mConstants.BlurWeights.size() / 2;
+	const float u = TexCoord(x, mAmbientWidth);
+	const float v = TexCoord(y, mAmbientHeight);
+	const float offsets[2] = { 1.0f / mAmbientWidth, 1.0f / mAmbientHeight };
+
+	std::size_t ci = PointTexel(u, v, mWidth, mHeight);
+	float centerDepth = NdcDepthToViewDepth(SampleDepth(u, v));
+
+	std::uint32_t mask = 0;
+	for(int direction = 0; direction < 2; ++direction)
+	{
+		for(int i = -radius; i <= radius; ++i)
+		{
+			if(i == 0)
+				continue;
+
+			float tu = direction == 0 ? u + i*offsets[0] : u + i*0.0f;
+			float tv = direction == 0 ? v + i*0.0f : v + i*offsets[1];
+			std::size_t ni = PointTexel(tu, tv, mWidth, mHeight);
+			float neighborDepth = NdcDepthToViewDepth(SampleDepth(tu, tv));
+
+			float d = mNormalX[ni]*mNormalX[ci] + mNormalY[ni]*mNormalY[ci] + mNormalZ[ni]*mNormalZ[ci];
+			if(d >= 0.8f && std::fabs(neighborDepth - centerDepth) <= 0.2f)
+				mask |= 1u << (16*direction + radius + i);
+		}
+	}
+	return mask;
+}
+
+float CpuSsao::BlurTexel(std::uint32_t x, std::uint32_t y, bool horzBlur)const
+{
+	const std::vector<float>& input = mAmbient[horzBlur ? 0 : 1];
+	const std::vector<float>& weights = mConstants.BlurWeights;
+	const int radius = (int)weights.size() / 2;
+
+	const float u = TexCoord(x, mAmbientWidth);
+	const float v = TexCoord(y, mAmbientHeight);
+	const float offsetU = horzBlur ? 1.0f / mAmbientWidth : 0.0f;
+	const float offsetV = horzBlur ? 0.0f : 1.0f / mAmbientHeight;
+
+	// The center value always contributes to the sum.
+	float color = weights[radius]*input[PointTexel(u, v, mAmbientWidth, mAmbientHeight)];
+	float totalWeight = weights[radius];
+
+	std::size_t ci = PointTexel(u, v, mWidth, mHeight);
+	float centerDepth = NdcDepthToViewDepth(SampleDepth(u, v));
+
+	for(int i = -radius; i <= radius; ++i)
+	{
+		// We already added in the center weight.
+		if(i == 0)
+			continue;
+
+		float tu = u + i*offsetU;
+		float tv = v + i*offsetV;
+		std::size_t ni = PointTexel(tu, tv, mWidth, mHeight);
+		float neighborDepth = NdcDepthToViewDepth(SampleDepth(tu, tv));
+
+		// Skip samples across a discontinuity in normal or depth.
+		float d = mNormalX[ni]*mNormalX[ci] + mNormalY[ni]*mNormalY[ci] + mNormalZ[ni]*mNormalZ[ci];
+		if(d >= 0.8f && std::fabs(neighborDepth - centerDepth) <= 0.2f)
+		{
+			color = color + weights[i + radius]*input[PointTexel(tu, tv, mAmbientWidth, mAmbientHeight)];
+			totalWeight = totalWeight + weights[i + radius];
+		}
+	}
+
+	// Compensate for discarded samples by making total weights sum to 1.
+	return color / totalWeight;
+}
+
+void CpuSsao::BlurTile(std::uint32_t x0, std::uint32_t y0, bool horzBlur)
+{
+	const std::vector<float>& input = mAmbient[horzBlur ? 0 : 1];
+	std::vector<float>& output = mAmbient[horzBlur ? 1 : 0];
+	const std::vector<float>& weights = mConstants.BlurWeights;
+	const int radius = (int)weights.size() / 2;
+	const float offsetU = horzBlur ? 1.0f / mAmbientWidth : 0.0f;
+	const float offsetV = horzBlur ? 0.0f : 1.0f / mAmbientHeight;
+	const int maskShift = horzBlur ? 0 : 16;
+
+	float results[TileTexels];
+	for(std::uint32_t j = 0; j < TileTexels; j += FloatVWidth)
+	{
+		float center[FloatVWidth];
+		float taps[2*MaxBlurRadius + 1][FloatVWidth];
+		float tapWeights[2*MaxBlurRadius + 1][FloatVWidth];
+		for(std::uint32_t l = 0; l < FloatVWidth; ++l)
+		{
+			std::uint32_t x = x0 + (j + l) % TileSize;
+			std::uint32_t y = y0 + (j + l) / TileSize;
+			x = x < mAmbientWidth ? x : mAmbientWidth - 1;
+			y = y < mAmbientHeight ? y : mAmbientHeight - 1;
+			const float u = TexCoord(x, mAmbientWidth);
+			const float v = TexCoord(y, mAmbientHeight);
+			const std::uint32_t mask = mBlurMasks[(std::size_t)y*mAmbientWidth + x] >> maskShift;
+
+			center[l] = input[PointTexel(u, v, mAmbientWidth, mAmbientHeight)];
+			for(int i = -radius; i <= radius; ++i)
+			{
+				// A rejected tap adds zero, which leaves the sums as skipping it does.
+				bool accepted = i != 0 && (mask >> (radius + i) & 1) != 0;
+				taps[radius + i][l] = input[PointTexel(u + i*offsetU, v + i*offsetV, mAmbientWidth, mAmbientHeight)];
+				tapWeights[radius + i][l] = accepted ? weights[radius + i] : 0.0f;
+			}
+		}
+
+		FloatV color = MulV(SplatV(weights[radius]), LoadV(center));
+		FloatV totalWeight = SplatV(weights[radius]);
+		for(int i = -radius; i <= radius; ++i)
+		{
+			if(i == 0)
+				continue;
+			FloatV weight = LoadV(tapWeights[radius + i]);
+			color = AddV(color, MulV(weight, LoadV(taps[radius + i])));
+			totalWeight = AddV(totalWeight, weight);
+		}
+		StoreV(results + j, DivV(color, totalWeight));
+	}
+
+	const std::uint32_t width = mAmbientWidth - x0 < TileSize ? mAmbientWidth - x0 : TileSize;
+	const std::uint32_t height = mAmbientHeight - y0 < TileSize ? mAmbientHeight - y0 : TileSize;
+	for(std::uint32_t y = 0; y < height; ++y)
+	{
+		float* row = output.data() + (std::size_t)(y0 + y)*mAmbientWidth + x0;
+		std::memcpy(row, results + y*TileSize, width*sizeof(float));
+		QuantizeCpuImageValues(mAmbientFormat, row, width);
+	}
+}
+
+void CpuSsao::StoreAmbientMap(CpuImage& ambientMap, ThreadPool* pool)const
+{
+	ForRange(pool, (int)mAmbientHeight, 64, [&](int first, int last)
+	{
+		for(std::uint32_t y = (std::uint32_t)first; y < (std::uint32_t)last; ++y)
+			EncodeCpuImageRow(ambientMap, y, 0, mAmbientWidth, mAmbient[0].data() + (std::size_t)y*mAmbientWidth);
+	});
+}
@@ -0,0 +1,123 @@
+//***************************************************************************************
+// CpuSsao.h
+//
+// Ssao::ComputeSsao on the CPU: Ssao.hlsl's occlusion pass followed by SsaoBlur.hlsl's
+// bilateral blur, from a depth buffer, a view-space normal map and the same offset and
+// random vectors Ssao uploads.  Used to check changes to the shaders and to bake ambient
+// occlusion for static scenes offline.
+//
+// Sampling follows the static samplers the shaders are bound with: point-clamped
+// normals, bilinear depth with a border depth of 1, bilinear random vectors that wrap,
+// and point-clamped ambient values in the blur.  Every pass rounds to the ambient map's
+// format, as the render target does.  Filtering here uses exact float weights and pow
+// becomes three multiplies, so the GPU's result differs in the low bits.
+//
+// ComputeSsaoScalar evaluates one texel at a time, in the shaders' order.  ComputeSsao
+// runs 8x8 tiles on a thread pool with SIMD vectors across each tile's texels, and
+// evaluates the same expressions in the same order with only separate multiplies and
+// adds.  Both give identical bits unless the compiler fuses multiply-adds, as /fp:fast
+// with /arch:AVX2 may; then a few texels can differ by a rounding step.  The blur's
+// depth and normal tests do not change between passes, so ComputeSsao makes them once
+// per call and keeps the accepted taps as bit masks.
+//***************************************************************************************
+
+#pragma once
+
+#include "CpuImage.h"
+#include "ThreadPool.h"
+#include <DirectXMath.h>
+
+// The parts of cbSsao the passes read.  The inverse projection and the projective
+// texture transform are derived from Proj, as SsaoApp::UpdateSsaoCB derives them.
+struct CpuSsaoConstants
+{
+	// View to homogeneous clip space, as Camera::GetProj4x4f returns it.
+	DirectX::XMFLOAT4X4 Proj;
+
+	// Ssao::GetOffsetVectors.
+	DirectX::XMFLOAT4 OffsetVectors[14];
+
+	// Ssao::CalcGaussWeights: an odd number of weights, at most 2*MaxBlurRadius + 1.
+	std::vector<float> BlurWeights;
+
+	// Coordinates given in view space.  These are SsaoApp's values.
+	float OcclusionRadius = 0.5f;
+	float OcclusionFadeStart = 0.2f;
+	float OcclusionFadeEnd = 1.0f;
+	float SurfaceEpsilon = 0.05f;
+};
+
+class CpuSsao
+{
+public:
+	static const int SampleCount = 14;
+	static const int MaxBlurRadius = 5;
+
+	explicit CpuSsao(const CpuSsaoConstants& constants);
+	CpuSsao(const CpuSsao& rhs) = delete;
+	CpuSsao& operator=(const CpuSsao& rhs) = delete;
+
+	// depthMap holds NDC depths in a single-channel format, and normalMap view-space
+	// normals in xyz at the same size.  randomVectorMap is Ssao::RandomVectorMapData, or
+	// any image of vectors packed into [0, 1].  ambientMap is single-channel, usually
+	// R16_UNORM at Ssao::SsaoMapWidth by Ssao::SsaoMapHeight, and receives the blurred
+	// ambient accessibility.
+	void ComputeSsao(const CpuImage& depthMap, const CpuImage& normalMap, const CpuImage& randomVectorMap,
+		CpuImage& ambientMap, int blurCount, ThreadPool& pool = ThreadPool::Default());
+	void ComputeSsaoScalar(const CpuImage& depthMap, const CpuImage& normalMap, const CpuImage& randomVectorMap,
+		CpuImage& ambientMap, int blurCount);
+
+private:
+	// Decodes the inputs into the planes below, on pool when there is one.
+	void LoadInputs(const CpuImage& depthMap, const CpuImage& normalMap, const CpuImage& randomVectorMap,
+		const CpuImage& ambientMap, ThreadPool* pool);
+
+	// Ssao.hlsl for texel (x, y) of the ambient map, and for an 8x8 tile.
+	float OcclusionTexel(std::uint32_t x, std::uint32_t y)const;
+	void OcclusionTile(std::uint32_t x0, std::uint32_t y0);
+
+	// SsaoBlur.hlsl for texel (x, y), reading mAmbient[0] when horzBlur is set and
+	// mAmbient[1] otherwise, and for an 8x8 tile using mBlurMasks.
+	float BlurTexel(std::uint32_t x, std::uint32_t y, bool horzBlur)const;
+	void BlurTile(std::uint32_t x0, std::uint32_t y0, bool horzBlur);
+
+	// Bit radius + i of the mask is set when tap i passes the blur's depth and normal
+	// tests for texel (x, y); horizontal taps in the low 16 bits, vertical in the high.
+	std::uint32_t BlurMask(std::uint32_t x, std::uint32_t y)const;
+
+	float NdcDepthToViewDepth(float zNdc)const;
+	float SampleDepth(float u, float v)const;
+
+	void StoreAmbientMap(CpuImage& ambientMap, ThreadPool* pool)const;
+
+private:
+	CpuSsaoConstants mConstants;
+	DirectX::XMFLOAT4X4 mProjTex;
+
+	// View-space points on the near plane at texture coordinates (0, 0), and the steps
+	// to (1, 0) and (0, 1), as the vertex shader's PosV is interpolated.
+	DirectX::XMFLOAT3 mNearTopLeft;
+	DirectX::XMFLOAT3 mNearRight;
+	DirectX::XMFLOAT3 mNearDown;
+
+	std::uint32_t mWidth = 0;
+	std::uint32_t mHeight = 0;
+	std::uint32_t mAmbientWidth = 0;
+	std::uint32_t mAmbientHeight = 0;
+	std::uint32_t mRandomWidth = 0;
+	std::uint32_t mRandomHeight = 0;
+	CpuImageFormat mAmbientFormat = CpuImageFormat::R16_UNORM;
+
+	std::vector<float> mDepth;
+	std::vector<float> mNormalX;
+	std::vector<float> mNormalY;
+	std::vector<float> mNormalZ;
+	std::vector<float> mRandomX;
+	std::vector<float> mRandomY;
+	std::vector<float> mRandomZ;
+
+	// Ping-pong ambient values, rounded to the ambient map's format.
+	std::vector<float> mAmbient[2];
+
+	std::vector<std::uint32_t> mBlurMasks;
+};
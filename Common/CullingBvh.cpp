@@ -0,0 +1,284 @@
+//***************************************************************************************
+// CullingBvh.cpp
+//***************************************************************************************
+
+#include "CullingBvh.h"
+#include "MathHelper.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+using namespace DirectX;
+
+CullingFrustum CullingFrustum::FromViewProj(FXMMATRIX viewProj)
+{
+	// With row vectors, clip = p*M, so each clip coordinate is p dotted with a column
+	// of M.  The columns are the rows of the transpose.
+	XMMATRIX T = XMMatrixTranspose(viewProj);
+
+	XMVECTOR planes[8] =
+	{
+		XMVectorAdd(T.r[3], T.r[0]),      // left:   -w <= x
+		XMVectorSubtract(T.r[3], T.r[0]), // right:   x <= w
+		XMVectorAdd(T.r[3], T.r[1]),      // bottom: -w <= y
+		XMVectorSubtract(T.r[3], T.r[1]), // top:     y <= w
+		T.r[2],                           // near:    0 <= z
+		XMVectorSubtract(T.r[3], T.r[2]), // far:     z <= w
+		XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),
+		XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f)
+	};
+
+	CullingFrustum frustum;
+	for(int i = 0; i < 6; ++i)
+	{
+		planes[i] = XMPlaneNormalize(planes[i]);
+		XMStoreFloat4(&frustum.Planes[i], planes[i]);
+	}
+	for(int i = 0; i < 2; ++i)
+	{
+		XMMATRIX P(planes[4*i], planes[4*i + 1], planes[4*i + 2], planes[4*i + 3]);
+		P = XMMatrixTranspose(P);
+
+		frustum.NormalX[i] = P.r[0];
+		frustum.NormalY[i] = P.r[1];
+		frustum.NormalZ[i] = P.r[2];
+		frustum.Distance[i] = P.r[3];
+		frustum.AbsNormalX[i] = XMVectorAbs(P.r[0]);
+		frustum.AbsNormalY[i] = XMVectorAbs(P.r[1]);
+		frustum.AbsNormalZ[i] = XMVectorAbs(P.r[2]);
+	}
+
+	return frustum;
+}
+
+void CullingBvh::Build(const BoundingBox* bounds, std::uint32_t count)
+{
+	mNodes.clear();
+	mDirtyLeaves.clear();
+	mLeafDirty.clear();
+
+	mOrder.resize(count);
+	std::iota(mOrder.begin(), mOrder.end(), 0u);
+
+	mBoxes.resize(count);
+	mSlot.resize(count);
+	mLeaf.resize(count);
+
+	if(count == 0)
+		return;
+
+	std::vector<XMFLOAT3> centroids(count);
+	for(std::uint32_t i = 0; i < count; ++i)
+		centroids[i] = bounds[i].Center;
+
+	// Median splits leave at least MaxLeafSize/2 instances per leaf, so there are
+	// fewer than 4n/MaxLeafSize nodes.
+	mNodes.reserve(4*count / MaxLeafSize + 1);
+	BuildNode(0, 0, count, centroids);
+
+	for(std::uint32_t slot = 0; slot < count; ++slot)
+	{
+		std::uint32_t instance = mOrder[slot];
+		mSlot[instance] = slot;
+		mBoxes[slot].Center = bounds[instance].Center;
+		mBoxes[slot].Extents = bounds[instance].Extents;
+	}
+
+	for(std::uint32_t node = 0; node < (std::uint32_t)mNodes.size(); ++node)
+	{
+		if(mNodes[node].SecondChild == 0)
+		{
+			for(std::uint32_t slot = mNodes[node].First; slot < mNodes[node].First + mNodes[node].Count; ++slot)
+				mLeaf[mOrder[slot]] = node;
+		}
+	}
+	mLeafDirty.assign(mNodes.size(), 0);
+
+	// Children follow their parents, so a reverse sweep fits every box bottom-up.
+	for(std::uint32_t node = (std::uint32_t)mNodes.size(); node-- > 0; )
+		UpdateNodeBox(node);
+}
+
+std::uint32_t CullingBvh::BuildNode(std::uint32_t parent, std::uint32_t first, std::uint32_t count,
+	std::vector<XMFLOAT3>& centroids)
+{
+	std::uint32_t index = (std::uint32_t)mNodes.size();
+
+	Node node = {};
+	node.Parent = parent;
+	node.First = first;
+	node.Count = count;
+	mNodes.push_back(node);
+
+	if(count <= MaxLeafSize)
+		return index;
+
+	// Split at the median centroid along the axis where the centroids spread most.
+	XMVECTOR cmin = XMLoadFloat3(&centroids[mOrder[first]]);
+	XMVECTOR cmax = cmin;
+	for(std::uint32_t i = first + 1; i < first + count; ++i)
+	{
+		XMVECTOR c = XMLoadFloat3(&centroids[mOrder[i]]);
+		cmin = XMVectorMin(cmin, c);
+		cmax = XMVectorMax(cmax, c);
+	}
+
+	XMFLOAT3 spread;
+	XMStoreFloat3(&spread, XMVectorSubtract(cmax, cmin));
+
+	int axis = 0;
+	if(spread.y > spread.x)
+		axis = 1;
+	if(spread.z > (axis == 0 ? spread.x : spread.y))
+		axis = 2;
+
+	auto key = [&centroids, axis](std::uint32_t i)
+	{
+		const XMFLOAT3& c = centroids[i];
+		return axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+	};
+
+	std::uint32_t half = count / 2;
+	std::nth_element(mOrder.begin() + first, mOrder.begin() + first + half, mOrder.begin() + first + count,
+		[&key](std::uint32_t a, std::uint32_t b) { return key(a) < key(b); });
+
+	BuildNode(index, first, half, centroids);
+	std::uint32_t second = BuildNode(index, first + half, count - half, centroids);
+	mNodes[index].SecondChild = second;
+
+	return index;
+}
+
+bool CullingBvh::UpdateNodeBox(std::uint32_t index)
+{
+	Node& node = mNodes[index];
+
+	XMVECTOR bmin;
+	XMVECTOR bmax;
+
+	auto merge = [&bmin, &bmax](const XMFLOAT3& center, const XMFLOAT3& extents, bool firstBox)
+	{
+		XMVECTOR c = XMLoadFloat3(&center);
+		XMVECTOR e = XMLoadFloat3(&extents);
+		if(firstBox)
+		{
+			bmin = XMVectorSubtract(c, e);
+			bmax = XMVectorAdd(c, e);
+		}
+		else
+		{
+			bmin = XMVectorMin(bmin, XMVectorSubtract(c, e));
+			bmax = XMVectorMax(bmax, XMVectorAdd(c, e));
+		}
+	};
+
+	if(node.SecondChild == 0)
+	{
+		for(std::uint32_t slot = node.First; slot < node.First + node.Count; ++slot)
+			merge(mBoxes[slot].Center, mBoxes[slot].Extents, slot == node.First);
+	}
+	else
+	{
+		const Node& a = mNodes[index + 1];
+		const Node& b = mNodes[node.SecondChild];
+		merge(a.Center, a.Extents, true);
+		merge(b.Center, b.Extents, false);
+	}
+
+	XMFLOAT3 center;
+	XMFLOAT3 extents;
+	XMStoreFloat3(&center, XMVectorScale(XMVectorAdd(bmin, bmax), 0.5f));
+	XMStoreFloat3(&extents, XMVectorScale(XMVectorSubtract(bmax, bmin), 0.5f));
+
+	if(std::memcmp(&center, &node.Center, sizeof(center)) == 0 &&
+	   std::memcmp(&extents, &node.Extents, sizeof(extents)) == 0)
+		return false;
+
+	node.Center = center;
+	node.Extents = extents;
+	return true;
+}
+
+void CullingBvh::SetBounds(std::uint32_t instance, const BoundingBox& bounds)
+{
+	InstanceBox& box = mBoxes[mSlot[instance]];
+	box.Center = bounds.Center;
+	box.Extents = bounds.Extents;
+
+	std::uint32_t leaf = mLeaf[instance];
+	if(!mLeafDirty[leaf])
+	{
+		mLeafDirty[leaf] = 1;
+		mDirtyLeaves.push_back(leaf);
+	}
+}
+
+void CullingBvh::Refit()
+{
+	for(std::uint32_t leaf : mDirtyLeaves)
+	{
+		mLeafDirty[leaf] = 0;
+
+		// Walk up while boxes keep changing.  A parent reached from two dirty leaves
+		// is simply refit twice.
+		std::uint32_t node = leaf;
+		while(UpdateNodeBox(node) && node != 0)
+			node = mNodes[node].Parent;
+	}
+
+	mDirtyLeaves.clear();
+}
+
+void CullingBvh::Cull(const CullingFrustum& frustum, std::vector<std::uint32_t>& visible)const
+{
+	visible.clear();
+	CullRange(frustum, 0, InstanceCount(), visible);
+}
+
+void CullingBvh::CullRange(const CullingFrustum& frustum, std::uint32_t first, std::uint32_t last,
+	std::vector<std::uint32_t>& visible)const
+{
+	if(mNodes.empty() || first >= last)
+		return;
+
+	// Median splits keep the depth near log2(n / MaxLeafSize), far below the stack size.
+	std::uint32_t stack[64];
+	std::uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while(stackSize > 0)
+	{
+		const Node& node = mNodes[stack[--stackSize]];
+
+		// Subtrees holding none of the range are skipped without a plane test.
+		std::uint32_t begin = MathHelper::Max(node.First, first);
+		std::uint32_t end = MathHelper::Min(node.First + node.Count, last);
+		if(begin >= end)
+			continue;
+
+		ContainmentType containment = frustum.Classify(XMLoadFloat3(&node.Center), XMLoadFloat3(&node.Extents));
+		if(containment == DISJOINT)
+			continue;
+
+		if(containment == CONTAINS)
+		{
+			visible.insert(visible.end(), mOrder.begin() + begin, mOrder.begin() + end);
+			continue;
+		}
+
+		if(node.SecondChild != 0)
+		{
+			std::uint32_t index = (std::uint32_t)(&node - mNodes.data());
+			stack[stackSize++] = node.SecondChild;
+			stack[stackSize++] = index + 1;
+			continue;
+		}
+
+		for(std::uint32_t slot = begin; slot < end; ++slot)
+		{
+			const InstanceBox& box = mBoxes[slot];
+			if(frustum.Classify(XMLoadFloat3(&box.Center), XMLoadFloat3(&box.Extents)) != DISJOINT)
+				visible.push_back(mOrder[slot]);
+		}
+	}
+}
@@ -0,0 +1,144 @@
+//***************************************************************************************
+// CullingBvh.h
+//
+// Bounding volume hierarchy over world-space instance boxes for view frustum culling.
+// Culling walks the tree from the root, skips subtrees outside the frustum and emits
+// subtrees fully inside it without looking at their instances, so the cost follows the
+// number of nodes that straddle the frustum rather than the number of instances.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <vector>
+
+// The six planes of a view frustum in world space, transposed so one plane test covers
+// four planes.  The normals point into the frustum.
+struct CullingFrustum
+{
+	// Extracts the planes from a view-projection matrix (row vectors, 0 <= z <= w in
+	// clip space, as built by XMMatrixPerspectiveFovLH).
+	static CullingFrustum FromViewProj(DirectX::FXMMATRIX viewProj);
+
+	// Classifies the box center +- extents.  Like BoundingFrustum::Contains it is
+	// conservative: a box just outside a corner of the frustum can report INTERSECTS.
+	DirectX::ContainmentType Classify(DirectX::FXMVECTOR center, DirectX::FXMVECTOR extents)const;
+
+	// Left, right, bottom, top, near, far as (normal, distance).
+	DirectX::XMFLOAT4 Planes[6];
+
+	// The same planes transposed: planes 0-3 in [0], planes 4-5 in [1].  The two spare
+	// lanes hold a plane that contains everything, so they never reject a box.
+	DirectX::XMVECTOR NormalX[2];
+	DirectX::XMVECTOR NormalY[2];
+	DirectX::XMVECTOR NormalZ[2];
+	DirectX::XMVECTOR Distance[2];
+	DirectX::XMVECTOR AbsNormalX[2];
+	DirectX::XMVECTOR AbsNormalY[2];
+	DirectX::XMVECTOR AbsNormalZ[2];
+};
+
+inline DirectX::ContainmentType CullingFrustum::Classify(DirectX::FXMVECTOR center, DirectX::FXMVECTOR extents)const
+{
+	using namespace DirectX;
+
+	XMVECTOR cx = XMVectorSplatX(center);
+	XMVECTOR cy = XMVectorSplatY(center);
+	XMVECTOR cz = XMVectorSplatZ(center);
+	XMVECTOR ex = XMVectorSplatX(extents);
+	XMVECTOR ey = XMVectorSplatY(extents);
+	XMVECTOR ez = XMVectorSplatZ(extents);
+
+	bool inside = true;
+	for(int i = 0; i < 2; ++i)
+	{
+		// Signed distance of the center and the projected radius of the box, per plane.
+		XMVECTOR d = XMVectorMultiplyAdd(cz, NormalZ[i],
+			XMVectorMultiplyAdd(cy, NormalY[i], XMVectorMultiplyAdd(cx, NormalX[i], Distance[i])));
+		XMVECTOR r = XMVectorMultiplyAdd(ez, AbsNormalZ[i],
+			XMVectorMultiplyAdd(ey, AbsNormalY[i], XMVectorMultiply(ex, AbsNormalX[i])));
+
+		if(!XMVector4GreaterOrEqual(XMVectorAdd(d, r), XMVectorZero()))
+			return DISJOINT;
+
+		inside = inside && XMVector4GreaterOrEqual(d, r);
+	}
+
+	return inside ? CONTAINS : INTERSECTS;
+}
+
+class CullingBvh
+{
+public:
+	// Leaves hold at most this many instances.
+	static const std::uint32_t MaxLeafSize = 8;
+
+	// Builds the tree over bounds[0, count).  Instances are identified by their index
+	// in bounds from then on.
+	void Build(const DirectX::BoundingBox* bounds, std::uint32_t count);
+
+	std::uint32_t InstanceCount()const { return (std::uint32_t)mOrder.size(); }
+	std::uint32_t NodeCount()const { return (std::uint32_t)mNodes.size(); }
+
+	// Moves an instance.  Its ancestors are enlarged or shrunk by the next Refit; until
+	// then Cull must not be called.
+	void SetBounds(std::uint32_t instance, const DirectX::BoundingBox& bounds);
+
+	// Refits the nodes above every instance moved since the last call, stopping at the
+	// first ancestor whose box does not change.  The tree shape is kept, so rebuild once
+	// instances have drifted far from where they were when the tree was built.
+	void Refit();
+
+	// Replaces visible with the instances whose boxes are not outside the frustum.
+	// Indices come out in tree order.
+	void Cull(const CullingFrustum& frustum, std::vector<std::uint32_t>& visible)const;
+
+	// Like Cull, but only looks at the instances in tree order positions [first, last)
+	// and appends to visible.  Threads can cull disjoint ranges at once; the results of
+	// consecutive ranges concatenate to what Cull returns for their union.
+	void CullRange(const CullingFrustum& frustum, std::uint32_t first, std::uint32_t last,
+		std::vector<std::uint32_t>& visible)const;
+
+private:
+	struct Node
+	{
+		DirectX::XMFLOAT3 Center;
+		// Index of the second child; the first child directly follows its parent.
+		// Zero for leaves.
+		std::uint32_t SecondChild;
+		DirectX::XMFLOAT3 Extents;
+		std::uint32_t Parent;
+		// The instances below this node are mOrder[First, First + Count).
+		std::uint32_t First;
+		std::uint32_t Count;
+	};
+
+	struct InstanceBox
+	{
+		DirectX::XMFLOAT3 Center;
+		DirectX::XMFLOAT3 Extents;
+	};
+
+	std::uint32_t BuildNode(std::uint32_t parent, std::uint32_t first, std::uint32_t count,
+		std::vector<DirectX::XMFLOAT3>& centroids);
+
+	// Recomputes the box of node from its children or instances.  Returns false if
+	// it did not change.
+	bool UpdateNodeBox(std::uint32_t node);
+
+	std::vector<Node> mNodes;
+
+	// Instance boxes in tree order, so the instances of a leaf are contiguous.
+	std::vector<InstanceBox> mBoxes;
+	std::vector<std::uint32_t> mOrder;
+
+	// Inverse of mOrder, and the leaf holding each instance.
+	std::vector<std::uint32_t> mSlot;
+	std::vector<std::uint32_t> mLeaf;
+
+	// Leaves with moved instances, waiting for Refit.
+	std::vector<std::uint32_t> mDirtyLeaves;
+	std::vector<std::uint8_t> mLeafDirty;
+};
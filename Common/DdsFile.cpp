@@ -0,0 +1,588 @@
+//***************************************************************************************
+// DdsFile.cpp
+//
+// The header layout, format mapping and surface math follow Microsoft's DDSTextureLoader,
+// checked for every field a corrupt file could lie about.
+//***************************************************************************************
+
+#include "DdsFile.h"
+#include <cstring>
+
+namespace
+{
+	const std::uint32_t DdsMagic = 0x20534444; // "DDS "
+
+	std::uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return (std::uint32_t)(std::uint8_t)a | ((std::uint32_t)(std::uint8_t)b << 8) |
+			((std::uint32_t)(std::uint8_t)c << 16) | ((std::uint32_t)(std::uint8_t)d << 24);
+	}
+
+	struct DdsPixelFormat
+	{
+		std::uint32_t Size;
+		std::uint32_t Flags;
+		std::uint32_t FourCC;
+		std::uint32_t RGBBitCount;
+		std::uint32_t RBitMask;
+		std::uint32_t GBitMask;
+		std::uint32_t BBitMask;
+		std::uint32_t ABitMask;
+	};
+
+	struct DdsHeader
+	{
+		std::uint32_t Size;
+		std::uint32_t Flags;
+		std::uint32_t Height;
+		std::uint32_t Width;
+		std::uint32_t PitchOrLinearSize;
+		std::uint32_t Depth;
+		std::uint32_t MipMapCount;
+		std::uint32_t Reserved1[11];
+		DdsPixelFormat PixelFormat;
+		std::uint32_t Caps;
+		std::uint32_t Caps2;
+		std::uint32_t Caps3;
+		std::uint32_t Caps4;
+		std::uint32_t Reserved2;
+	};
+
+	struct DdsHeaderDx10
+	{
+		std::uint32_t DxgiFormat;
+		std::uint32_t ResourceDimension;
+		std::uint32_t MiscFlag;
+		std::uint32_t ArraySize;
+		std::uint32_t MiscFlags2;
+	};
+
+	static_assert(sizeof(DdsPixelFormat) == 32, "DDS_PIXELFORMAT is 32 bytes");
+	static_assert(sizeof(DdsHeader) == 124, "DDS_HEADER is 124 bytes");
+	static_assert(sizeof(DdsHeaderDx10) == 20, "DDS_HEADER_DXT10 is 20 bytes");
+
+	const std::uint32_t PixelFormatAlpha = 0x00000002;
+	const std::uint32_t PixelFormatFourCC = 0x00000004;
+	const std::uint32_t PixelFormatRGB = 0x00000040;
+	const std::uint32_t PixelFormatLuminance = 0x00020000;
+
+	const std::uint32_t HeaderFlagsHeight = 0x00000002;
+	const std::uint32_t HeaderFlagsVolume = 0x00800000;
+
+	const std::uint32_t Caps2CubeMap = 0x00000200;
+	const std::uint32_t Caps2CubeMapAllFaces = 0x0000fe00;
+
+	const std::uint32_t MiscTextureCube = 0x4;
+	const std::uint32_t MiscFlags2AlphaModeMask = 0x7;
+
+	// The D3D12 resource limits.
+	const std::uint32_t MaxMipLevels = 15;
+	const std::uint32_t MaxTexture1DSize = 16384;
+	const std::uint32_t MaxTexture2DSize = 16384;
+	const std::uint32_t MaxTexture3DSize = 2048;
+	const std::uint32_t MaxArraySize = 2048;
+
+	bool Fail(DdsError* error, DdsError value)
+	{
+		if(error != nullptr)
+			*error = value;
+		return false;
+	}
+
+	bool IsBitMask(const DdsPixelFormat& pf, std::uint32_t r, std::uint32_t g, std::uint32_t b, std::uint32_t a)
+	{
+		return pf.RBitMask == r && pf.GBitMask == g && pf.BBitMask == b && pf.ABitMask == a;
+	}
+
+	// The format of a file without the DX10 extension.
+	DdsFormat GetLegacyFormat(const DdsPixelFormat& pf)
+	{
+		if(pf.Flags & PixelFormatRGB)
+		{
+			switch(pf.RGBBitCount)
+			{
+			case 32:
+				if(IsBitMask(pf, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+					return DdsFormat::R8G8B8A8_UNORM;
+				if(IsBitMask(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
+					return DdsFormat::B8G8R8A8_UNORM;
+				if(IsBitMask(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000))
+					return DdsFormat::B8G8R8X8_UNORM;
+
+				// D3DX writes 10:10:10:2 with the red and blue masks swapped.
+				if(IsBitMask(pf, 0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000))
+					return DdsFormat::R10G10B10A2_UNORM;
+				if(IsBitMask(pf, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000))
+					return DdsFormat::R16G16_UNORM;
+				if(IsBitMask(pf, 0xffffffff, 0x00000000, 0x00000000, 0x00000000))
+					return DdsFormat::R32_FLOAT;
+				break;
+
+			case 16:
+				if(IsBitMask(pf, 0x7c00, 0x03e0, 0x001f, 0x8000))
+					return DdsFormat::B5G5R5A1_UNORM;
+				if(IsBitMask(pf, 0xf800, 0x07e0, 0x001f, 0x0000))
+					return DdsFormat::B5G6R5_UNORM;
+				if(IsBitMask(pf, 0x0f00, 0x00f0, 0x000f, 0xf000))
+					return DdsFormat::B4G4R4A4_UNORM;
+				break;
+			}
+		}
+		else if(pf.Flags & PixelFormatLuminance)
+		{
+			if(pf.RGBBitCount == 8 && IsBitMask(pf, 0x000000ff, 0x00000000, 0x00000000, 0x00000000))
+				return DdsFormat::R8_UNORM;
+			if(pf.RGBBitCount == 16 && IsBitMask(pf, 0x0000ffff, 0x00000000, 0x00000000, 0x00000000))
+				return DdsFormat::R16_UNORM;
+			if(pf.RGBBitCount == 16 && IsBitMask(pf, 0x000000ff, 0x00000000, 0x00000000, 0x0000ff00))
+				return DdsFormat::R8G8_UNORM;
+		}
+		else if(pf.Flags & PixelFormatAlpha)
+		{
+			if(pf.RGBBitCount == 8)
+				return DdsFormat::A8_UNORM;
+		}
+		else if(pf.Flags & PixelFormatFourCC)
+		{
+			const struct { std::uint32_t FourCC; DdsFormat Format; } fourCCs[] =
+			{
+				{ MakeFourCC('D', 'X', 'T', '1'), DdsFormat::BC1_UNORM },
+				{ MakeFourCC('D', 'X', 'T', '3'), DdsFormat::BC2_UNORM },
+				{ MakeFourCC('D', 'X', 'T', '5'), DdsFormat::BC3_UNORM },
+				// Premultiplied alpha is the same data as BC2 and BC3.
+				{ MakeFourCC('D', 'X', 'T', '2'), DdsFormat::BC2_UNORM },
+				{ MakeFourCC('D', 'X', 'T', '4'), DdsFormat::BC3_UNORM },
+				{ MakeFourCC('A', 'T', 'I', '1'), DdsFormat::BC4_UNORM },
+				{ MakeFourCC('B', 'C', '4', 'U'), DdsFormat::BC4_UNORM },
+				{ MakeFourCC('B', 'C', '4', 'S'), DdsFormat::BC4_SNORM },
+				{ MakeFourCC('A', 'T', 'I', '2'), DdsFormat::BC5_UNORM },
+				{ MakeFourCC('B', 'C', '5', 'U'), DdsFormat::BC5_UNORM },
+				{ MakeFourCC('B', 'C', '5', 'S'), DdsFormat::BC5_SNORM },
+				{ MakeFourCC('R', 'G', 'B', 'G'), DdsFormat::R8G8_B8G8_UNORM },
+				{ MakeFourCC('G', 'R', 'G', 'B'), DdsFormat::G8R8_G8B8_UNORM },
+				{ MakeFourCC('Y', 'U', 'Y', '2'), DdsFormat::YUY2 },
+				// D3DFORMAT values.
+				{ 36, DdsFormat::R16G16B16A16_UNORM },
+				{ 110, DdsFormat::R16G16B16A16_SNORM },
+				{ 111, DdsFormat::R16_FLOAT },
+				{ 112, DdsFormat::R16G16_FLOAT },
+				{ 113, DdsFormat::R16G16B16A16_FLOAT },
+				{ 114, DdsFormat::R32_FLOAT },
+				{ 115, DdsFormat::R32G32_FLOAT },
+				{ 116, DdsFormat::R32G32B32A32_FLOAT }
+			};
+
+			for(const auto& entry : fourCCs)
+			{
+				if(entry.FourCC == pf.FourCC)
+					return entry.Format;
+			}
+		}
+
+		return DdsFormat::UNKNOWN;
+	}
+
+	std::uint32_t MaxMipCount(std::uint32_t width, std::uint32_t height, std::uint32_t depth)
+	{
+		std::uint32_t size = width > height ? width : height;
+		size = size > depth ? size : depth;
+
+		std::uint32_t count = 1;
+		while(size > 1)
+		{
+			size >>= 1;
+			++count;
+		}
+		return count;
+	}
+}
+
+const char* DdsErrorString(DdsError error)
+{
+	switch(error)
+	{
+	case DdsError::None: return "no error";
+	case DdsError::OpenFailed: return "could not open the file";
+	case DdsError::InvalidData: return "not a valid DDS file";
+	case DdsError::NotSupported: return "unsupported DDS texture";
+	case DdsError::Truncated: return "DDS file is truncated";
+	}
+	return "unknown error";
+}
+
+std::uint32_t DdsBitsPerPixel(DdsFormat format)
+{
+	switch(format)
+	{
+	case DdsFormat::R32G32B32A32_TYPELESS: case DdsFormat::R32G32B32A32_FLOAT:
+	case DdsFormat::R32G32B32A32_UINT: case DdsFormat::R32G32B32A32_SINT:
+		return 128;
+
+	case DdsFormat::R32G32B32_TYPELESS: case DdsFormat::R32G32B32_FLOAT:
+	case DdsFormat::R32G32B32_UINT: case DdsFormat::R32G32B32_SINT:
+		return 96;
+
+	case DdsFormat::R16G16B16A16_TYPELESS: case DdsFormat::R16G16B16A16_FLOAT:
+	case DdsFormat::R16G16B16A16_UNORM: case DdsFormat::R16G16B16A16_UINT:
+	case DdsFormat::R16G16B16A16_SNORM: case DdsFormat::R16G16B16A16_SINT:
+	case DdsFormat::R32G32_TYPELESS: case DdsFormat::R32G32_FLOAT:
+	case DdsFormat::R32G32_UINT: case DdsFormat::R32G32_SINT:
+	case DdsFormat::R32G8X24_TYPELESS: case DdsFormat::D32_FLOAT_S8X24_UINT:
+	case DdsFormat::R32_FLOAT_X8X24_TYPELESS: case DdsFormat::X32_TYPELESS_G8X24_UINT:
+	case DdsFormat::Y416: case DdsFormat::Y210: case DdsFormat::Y216:
+		return 64;
+
+	case DdsFormat::R10G10B10A2_TYPELESS: case DdsFormat::R10G10B10A2_UNORM:
+	case DdsFormat::R10G10B10A2_UINT: case DdsFormat::R11G11B10_FLOAT:
+	case DdsFormat::R8G8B8A8_TYPELESS: case DdsFormat::R8G8B8A8_UNORM:
+	case DdsFormat::R8G8B8A8_UNORM_SRGB: case DdsFormat::R8G8B8A8_UINT:
+	case DdsFormat::R8G8B8A8_SNORM: case DdsFormat::R8G8B8A8_SINT:
+	case DdsFormat::R16G16_TYPELESS: case DdsFormat::R16G16_FLOAT:
+	case DdsFormat::R16G16_UNORM: case DdsFormat::R16G16_UINT:
+	case DdsFormat::R16G16_SNORM: case DdsFormat::R16G16_SINT:
+	case DdsFormat::R32_TYPELESS: case DdsFormat::D32_FLOAT:
+	case DdsFormat::R32_FLOAT: case DdsFormat::R32_UINT: case DdsFormat::R32_SINT:
+	case DdsFormat::R24G8_TYPELESS: case DdsFormat::D24_UNORM_S8_UINT:
+	case DdsFormat::R24_UNORM_X8_TYPELESS: case DdsFormat::X24_TYPELESS_G8_UINT:
+	case DdsFormat::R9G9B9E5_SHAREDEXP: case DdsFormat::R8G8_B8G8_UNORM:
+	case DdsFormat::G8R8_G8B8_UNORM: case DdsFormat::B8G8R8A8_UNORM:
+	case DdsFormat::B8G8R8X8_UNORM: case DdsFormat::R10G10B10_XR_BIAS_A2_UNORM:
+	case DdsFormat::B8G8R8A8_TYPELESS: case DdsFormat::B8G8R8A8_UNORM_SRGB:
+	case DdsFormat::B8G8R8X8_TYPELESS: case DdsFormat::B8G8R8X8_UNORM_SRGB:
+	case DdsFormat::AYUV: case DdsFormat::Y410: case DdsFormat::YUY2:
+		return 32;
+
+	case DdsFormat::P010: case DdsFormat::P016:
+		return 24;
+
+	case DdsFormat::R8G8_TYPELESS: case DdsFormat::R8G8_UNORM: case DdsFormat::R8G8_UINT:
+	case DdsFormat::R8G8_SNORM: case DdsFormat::R8G8_SINT:
+	case DdsFormat::R16_TYPELESS: case DdsFormat::R16_FLOAT: case DdsFormat::D16_UNORM:
+	case DdsFormat::R16_UNORM: case DdsFormat::R16_UINT: case DdsFormat::R16_SNORM:
+	case DdsFormat::R16_SINT: case DdsFormat::B5G6R5_UNORM: case DdsFormat::B5G5R5A1_UNORM:
+	case DdsFormat::A8P8: case DdsFormat::B4G4R4A4_UNORM:
+		return 16;
+
+	case DdsFormat::NV12: case DdsFormat::OPAQUE_420: case DdsFormat::NV11:
+		return 12;
+
+	case DdsFormat::R8_TYPELESS: case DdsFormat::R8_UNORM: case DdsFormat::R8_UINT:
+	case DdsFormat::R8_SNORM: case DdsFormat::R8_SINT: case DdsFormat::A8_UNORM:
+	case DdsFormat::AI44: case DdsFormat::IA44: case DdsFormat::P8:
+		return 8;
+
+	case DdsFormat::R1_UNORM:
+		return 1;
+
+	case DdsFormat::BC1_TYPELESS: case DdsFormat::BC1_UNORM: case DdsFormat::BC1_UNORM_SRGB:
+	case DdsFormat::BC4_TYPELESS: case DdsFormat::BC4_UNORM: case DdsFormat::BC4_SNORM:
+		return 4;
+
+	case DdsFormat::BC2_TYPELESS: case DdsFormat::BC2_UNORM: case DdsFormat::BC2_UNORM_SRGB:
+	case DdsFormat::BC3_TYPELESS: case DdsFormat::BC3_UNORM: case DdsFormat::BC3_UNORM_SRGB:
+	case DdsFormat::BC5_TYPELESS: case DdsFormat::BC5_UNORM: case DdsFormat::BC5_SNORM:
+	case DdsFormat::BC6H_TYPELESS: case DdsFormat::BC6H_UF16: case DdsFormat::BC6H_SF16:
+	case DdsFormat::BC7_TYPELESS: case DdsFormat::BC7_UNORM: case DdsFormat::BC7_UNORM_SRGB:
+		return 8;
+
+	default:
+		return 0;
+	}
+}
+
+bool IsDdsBlockCompressed(DdsFormat format)
+{
+	std::uint32_t f = (std::uint32_t)format;
+	return (f >= (std::uint32_t)DdsFormat::BC1_TYPELESS && f <= (std::uint32_t)DdsFormat::BC5_SNORM) ||
+		(f >= (std::uint32_t)DdsFormat::BC6H_TYPELESS && f <= (std::uint32_t)DdsFormat::BC7_UNORM_SRGB);
+}
+
+void GetDdsSurfaceInfo(std::uint32_t width, std::uint32_t height, DdsFormat format,
+	std::uint64_t* rowBytes, std::uint32_t* rowCount, std::uint64_t* sliceBytes)
+{
+	std::uint64_t row = 0;
+	std::uint32_t rows = 0;
+	std::uint64_t slice = 0;
+
+	if(IsDdsBlockCompressed(format))
+	{
+		// 4x4 blocks of 8 or 16 bytes.
+		std::uint64_t blockBytes = DdsBitsPerPixel(format) * 2;
+		std::uint64_t blocksWide = width > 0 ? ((std::uint64_t)width + 3) / 4 : 0;
+		std::uint32_t blocksHigh = height > 0 ? (height + 3) / 4 : 0;
+		row = blocksWide*blockBytes;
+		rows = blocksHigh;
+		slice = row*blocksHigh;
+	}
+	else if(format == DdsFormat::R8G8_B8G8_UNORM || format == DdsFormat::G8R8_G8B8_UNORM ||
+		format == DdsFormat::YUY2 || format == DdsFormat::Y210 || format == DdsFormat::Y216)
+	{
+		// Pairs of pixels packed together.
+		std::uint64_t pairBytes = (format == DdsFormat::Y210 || format == DdsFormat::Y216) ? 8 : 4;
+		row = (((std::uint64_t)width + 1) >> 1)*pairBytes;
+		rows = height;
+		slice = row*height;
+	}
+	else if(format == DdsFormat::NV11)
+	{
+		// Direct3D's simplification, larger than the 4:1:1 data.
+		row = (((std::uint64_t)width + 3) >> 2)*4;
+		rows = height*2;
+		slice = row*rows;
+	}
+	else if(format == DdsFormat::NV12 || format == DdsFormat::OPAQUE_420 ||
+		format == DdsFormat::P010 || format == DdsFormat::P016)
+	{
+		// A luma plane then a half height chroma plane.
+		std::uint64_t pairBytes = (format == DdsFormat::P010 || format == DdsFormat::P016) ? 4 : 2;
+		row = (((std::uint64_t)width + 1) >> 1)*pairBytes;
+		slice = row*height + ((row*height + 1) >> 1);
+		rows = height + ((height + 1) >> 1);
+	}
+	else
+	{
+		row = ((std::uint64_t)width*DdsBitsPerPixel(format) + 7) / 8;
+		rows = height;
+		slice = row*height;
+	}
+
+	if(rowBytes != nullptr)
+		*rowBytes = row;
+	if(rowCount != nullptr)
+		*rowCount = rows;
+	if(sliceBytes != nullptr)
+		*sliceBytes = slice;
+}
+
+bool ParseDds(const std::uint8_t* data, std::uint64_t size, DdsTexture& texture, DdsError* error)
+{
+	texture = DdsTexture();
+	if(error != nullptr)
+		*error = DdsError::None;
+
+	//
+	// Header.  The file is read with memcpy, as a mapping has no alignment to trust.
+	//
+
+	if(data == nullptr || size < sizeof(std::uint32_t) + sizeof(DdsHeader))
+		return Fail(error, DdsError::InvalidData);
+
+	std::uint32_t magic;
+	DdsHeader header;
+	std::memcpy(&magic, data, sizeof(magic));
+	std::memcpy(&header, data + sizeof(magic), sizeof(header));
+	if(magic != DdsMagic || header.Size != sizeof(DdsHeader) || header.PixelFormat.Size != sizeof(DdsPixelFormat))
+		return Fail(error, DdsError::InvalidData);
+
+	std::uint64_t dataOffset = sizeof(magic) + sizeof(header);
+
+	std::uint32_t width = header.Width;
+	std::uint32_t height = header.Height;
+	std::uint32_t depth = header.Depth;
+	std::uint32_t arraySize = 1;
+	std::uint32_t mipCount = header.MipMapCount == 0 ? 1 : header.MipMapCount;
+	DdsDimension dimension = DdsDimension::Texture2D;
+	DdsFormat format = DdsFormat::UNKNOWN;
+	bool isCubeMap = false;
+	std::uint32_t alphaMode = 0;
+
+	if((header.PixelFormat.Flags & PixelFormatFourCC) && header.PixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if(size < dataOffset + sizeof(DdsHeaderDx10))
+			return Fail(error, DdsError::InvalidData);
+
+		DdsHeaderDx10 dx10;
+		std::memcpy(&dx10, data + dataOffset, sizeof(dx10));
+		dataOffset += sizeof(dx10);
+
+		arraySize = dx10.ArraySize;
+		if(arraySize == 0)
+			return Fail(error, DdsError::InvalidData);
+
+		format = (DdsFormat)dx10.DxgiFormat;
+		if(format == DdsFormat::AI44 || format == DdsFormat::IA44 || format == DdsFormat::P8 ||
+			format == DdsFormat::A8P8 || DdsBitsPerPixel(format) == 0)
+		{
+			return Fail(error, DdsError::NotSupported);
+		}
+
+		// D3D10_RESOURCE_DIMENSION_TEXTURE1D, 2D and 3D.
+		switch(dx10.ResourceDimension)
+		{
+		case 2:
+			if((header.Flags & HeaderFlagsHeight) && height != 1)
+				return Fail(error, DdsError::InvalidData);
+			height = depth = 1;
+			dimension = DdsDimension::Texture1D;
+			break;
+
+		case 3:
+			if(dx10.MiscFlag & MiscTextureCube)
+			{
+				if(arraySize > MaxArraySize / 6)
+					return Fail(error, DdsError::NotSupported);
+				arraySize *= 6;
+				isCubeMap = true;
+			}
+			depth = 1;
+			dimension = DdsDimension::Texture2D;
+			break;
+
+		case 4:
+			if(!(header.Flags & HeaderFlagsVolume))
+				return Fail(error, DdsError::InvalidData);
+			if(arraySize > 1)
+				return Fail(error, DdsError::NotSupported);
+			dimension = DdsDimension::Texture3D;
+			break;
+
+		default:
+			return Fail(error, DdsError::NotSupported);
+		}
+
+		// DDS_ALPHA_MODE_STRAIGHT through DDS_ALPHA_MODE_CUSTOM; anything else is unknown.
+		alphaMode = dx10.MiscFlags2 & MiscFlags2AlphaModeMask;
+		if(alphaMode > 4)
+			alphaMode = 0;
+	}
+	else
+	{
+		format = GetLegacyFormat(header.PixelFormat);
+		if(format == DdsFormat::UNKNOWN)
+			return Fail(error, DdsError::NotSupported);
+
+		if(header.Flags & HeaderFlagsVolume)
+		{
+			dimension = DdsDimension::Texture3D;
+		}
+		else
+		{
+			if(header.Caps2 & Caps2CubeMap)
+			{
+				// D3D has no partial cube maps.
+				if((header.Caps2 & Caps2CubeMapAllFaces) != Caps2CubeMapAllFaces)
+					return Fail(error, DdsError::NotSupported);
+				arraySize = 6;
+				isCubeMap = true;
+			}
+			depth = 1;
+			dimension = DdsDimension::Texture2D;
+		}
+
+		if((header.PixelFormat.Flags & PixelFormatFourCC) &&
+			(header.PixelFormat.FourCC == MakeFourCC('D', 'X', 'T', '2') || header.PixelFormat.FourCC == MakeFourCC('D', 'X', 'T', '4')))
+		{
+			alphaMode = 2; // DDS_ALPHA_MODE_PREMULTIPLIED
+		}
+	}
+
+	//
+	// Bounds.  Past these D3D12 cannot make the texture, and within them the sizes below
+	// cannot overflow.
+	//
+
+	if(width == 0 || height == 0 || depth == 0)
+		return Fail(error, DdsError::InvalidData);
+	if(mipCount > MaxMipLevels || mipCount > MaxMipCount(width, height, depth))
+		return Fail(error, DdsError::NotSupported);
+
+	switch(dimension)
+	{
+	case DdsDimension::Texture1D:
+		if(arraySize > MaxArraySize || width > MaxTexture1DSize)
+			return Fail(error, DdsError::NotSupported);
+		break;
+
+	case DdsDimension::Texture2D:
+		if(arraySize > MaxArraySize || width > MaxTexture2DSize || height > MaxTexture2DSize)
+			return Fail(error, DdsError::NotSupported);
+		break;
+
+	case DdsDimension::Texture3D:
+		if(width > MaxTexture3DSize || height > MaxTexture3DSize || depth > MaxTexture3DSize)
+			return Fail(error, DdsError::NotSupported);
+		break;
+	}
+
+	//
+	// Subresources, array slice by array slice, each slice's mips from the largest.
+	//
+
+	texture.Subresources.resize((std::size_t)arraySize*mipCount);
+
+	std::uint64_t offset = dataOffset;
+	for(std::uint32_t a = 0; a < arraySize; ++a)
+	{
+		std::uint32_t w = width;
+		std::uint32_t h = height;
+		std::uint32_t d = depth;
+		for(std::uint32_t m = 0; m < mipCount; ++m)
+		{
+			DdsSubresource& sub = texture.Subresources[(std::size_t)a*mipCount + m];
+			GetDdsSurfaceInfo(w, h, format, &sub.RowPitch, &sub.RowCount, &sub.SlicePitch);
+			sub.Offset = offset;
+			sub.Size = sub.SlicePitch*d;
+			sub.Width = w;
+			sub.Height = h;
+			sub.Depth = d;
+			sub.MipLevel = m;
+			sub.ArraySlice = a;
+
+			if(sub.Size > size - offset)
+			{
+				texture.Subresources.clear();
+				return Fail(error, DdsError::Truncated);
+			}
+			offset += sub.Size;
+
+			w = w > 1 ? w >> 1 : 1;
+			h = h > 1 ? h >> 1 : 1;
+			d = d > 1 ? d >> 1 : 1;
+		}
+	}
+
+	texture.Dimension = dimension;
+	texture.Format = format;
+	texture.Width = width;
+	texture.Height = height;
+	texture.Depth = depth;
+	texture.MipCount = mipCount;
+	texture.ArraySize = arraySize;
+	texture.IsCubeMap = isCubeMap;
+	texture.AlphaMode = alphaMode;
+	return true;
+}
+
+bool DdsFile::Open(const std::string& filename, DdsError* error)
+{
+	Close();
+	if(!mFile.Open(filename))
+		return Fail(error, DdsError::OpenFailed);
+	return Parse(error);
+}
+
+#if defined(_WIN32)
+bool DdsFile::Open(const std::wstring& filename, DdsError* error)
+{
+	Close();
+	if(!mFile.Open(filename))
+		return Fail(error, DdsError::OpenFailed);
+	return Parse(error);
+}
+#endif
+
+void DdsFile::Close()
+{
+	mFile.Close();
+	mTexture = DdsTexture();
+}
+
+bool DdsFile::Parse(DdsError* error)
+{
+	if(!ParseDds(mFile.Data(), mFile.Size(), mTexture, error))
+	{
+		mFile.Close();
+		return false;
+	}
+	return true;
+}
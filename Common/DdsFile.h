@@ -0,0 +1,143 @@
+//***************************************************************************************
+// DdsFile.h
+//
+// Parses DDS files without Direct3D or Windows.  ParseDds validates the header and the
+// DX10 extension against the bounds D3D12 puts on textures and lays out every
+// subresource: its offset in the file, size, row pitch and slice pitch, in D3D12
+// subresource order.  DdsFile memory maps the file, so the subresources are read
+// straight from the page cache into an upload heap, with no copy in between and no 4 GB
+// limit.
+//***************************************************************************************
+
+#pragma once
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// DXGI_FORMAT, numerically: a DdsFormat casts to a DXGI_FORMAT and back.
+enum class DdsFormat : std::uint32_t
+{
+	UNKNOWN = 0,
+	R32G32B32A32_TYPELESS = 1, R32G32B32A32_FLOAT = 2, R32G32B32A32_UINT = 3, R32G32B32A32_SINT = 4,
+	R32G32B32_TYPELESS = 5, R32G32B32_FLOAT = 6, R32G32B32_UINT = 7, R32G32B32_SINT = 8,
+	R16G16B16A16_TYPELESS = 9, R16G16B16A16_FLOAT = 10, R16G16B16A16_UNORM = 11, R16G16B16A16_UINT = 12,
+	R16G16B16A16_SNORM = 13, R16G16B16A16_SINT = 14,
+	R32G32_TYPELESS = 15, R32G32_FLOAT = 16, R32G32_UINT = 17, R32G32_SINT = 18,
+	R32G8X24_TYPELESS = 19, D32_FLOAT_S8X24_UINT = 20, R32_FLOAT_X8X24_TYPELESS = 21, X32_TYPELESS_G8X24_UINT = 22,
+	R10G10B10A2_TYPELESS = 23, R10G10B10A2_UNORM = 24, R10G10B10A2_UINT = 25, R11G11B10_FLOAT = 26,
+	R8G8B8A8_TYPELESS = 27, R8G8B8A8_UNORM = 28, R8G8B8A8_UNORM_SRGB = 29, R8G8B8A8_UINT = 30,
+	R8G8B8A8_SNORM = 31, R8G8B8A8_SINT = 32,
+	R16G16_TYPELESS = 33, R16G16_FLOAT = 34, R16G16_UNORM = 35, R16G16_UINT = 36, R16G16_SNORM = 37, R16G16_SINT = 38,
+	R32_TYPELESS = 39, D32_FLOAT = 40, R32_FLOAT = 41, R32_UINT = 42, R32_SINT = 43,
+	R24G8_TYPELESS = 44, D24_UNORM_S8_UINT = 45, R24_UNORM_X8_TYPELESS = 46, X24_TYPELESS_G8_UINT = 47,
+	R8G8_TYPELESS = 48, R8G8_UNORM = 49, R8G8_UINT = 50, R8G8_SNORM = 51, R8G8_SINT = 52,
+	R16_TYPELESS = 53, R16_FLOAT = 54, D16_UNORM = 55, R16_UNORM = 56, R16_UINT = 57, R16_SNORM = 58, R16_SINT = 59,
+	R8_TYPELESS = 60, R8_UNORM = 61, R8_UINT = 62, R8_SNORM = 63, R8_SINT = 64, A8_UNORM = 65,
+	R1_UNORM = 66, R9G9B9E5_SHAREDEXP = 67, R8G8_B8G8_UNORM = 68, G8R8_G8B8_UNORM = 69,
+	BC1_TYPELESS = 70, BC1_UNORM = 71, BC1_UNORM_SRGB = 72,
+	BC2_TYPELESS = 73, BC2_UNORM = 74, BC2_UNORM_SRGB = 75,
+	BC3_TYPELESS = 76, BC3_UNORM = 77, BC3_UNORM_SRGB = 78,
+	BC4_TYPELESS = 79, BC4_UNORM = 80, BC4_SNORM = 81,
+	BC5_TYPELESS = 82, BC5_UNORM = 83, BC5_SNORM = 84,
+	B5G6R5_UNORM = 85, B5G5R5A1_UNORM = 86, B8G8R8A8_UNORM = 87, B8G8R8X8_UNORM = 88,
+	R10G10B10_XR_BIAS_A2_UNORM = 89, B8G8R8A8_TYPELESS = 90, B8G8R8A8_UNORM_SRGB = 91,
+	B8G8R8X8_TYPELESS = 92, B8G8R8X8_UNORM_SRGB = 93,
+	BC6H_TYPELESS = 94, BC6H_UF16 = 95, BC6H_SF16 = 96,
+	BC7_TYPELESS = 97, BC7_UNORM = 98, BC7_UNORM_SRGB = 99,
+	AYUV = 100, Y410 = 101, Y416 = 102, NV12 = 103, P010 = 104, P016 = 105, OPAQUE_420 = 106,
+	YUY2 = 107, Y210 = 108, Y216 = 109, NV11 = 110, AI44 = 111, IA44 = 112, P8 = 113, A8P8 = 114,
+	B4G4R4A4_UNORM = 115
+};
+
+// D3D12_RESOURCE_DIMENSION, numerically.
+enum class DdsDimension : std::uint32_t
+{
+	Texture1D = 2,
+	Texture2D = 3,
+	Texture3D = 4
+};
+
+enum class DdsError
+{
+	None,
+	OpenFailed,     // The file could not be opened or mapped.
+	InvalidData,    // Not a DDS file, or its header contradicts itself.
+	NotSupported,   // A valid DDS file that D3D12 cannot make a texture of.
+	Truncated       // The file ends before the last subresource.
+};
+
+const char* DdsErrorString(DdsError error);
+
+// One mip level of one array slice.  A 3D subresource holds Depth slices SlicePitch
+// apart; Size is SlicePitch*Depth.
+struct DdsSubresource
+{
+	std::uint64_t Offset = 0;
+	std::uint64_t Size = 0;
+	std::uint64_t RowPitch = 0;
+	std::uint64_t SlicePitch = 0;
+	std::uint32_t RowCount = 0;
+
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::uint32_t Depth = 0;
+	std::uint32_t MipLevel = 0;
+	std::uint32_t ArraySlice = 0;
+};
+
+struct DdsTexture
+{
+	DdsDimension Dimension = DdsDimension::Texture2D;
+	DdsFormat Format = DdsFormat::UNKNOWN;
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::uint32_t Depth = 0;
+	std::uint32_t MipCount = 0;
+
+	// Six per cube.
+	std::uint32_t ArraySize = 0;
+	bool IsCubeMap = false;
+
+	// DDS_ALPHA_MODE.
+	std::uint32_t AlphaMode = 0;
+
+	// Mip level m of array slice a is Subresources[a*MipCount + m].
+	std::vector<DdsSubresource> Subresources;
+};
+
+// Parses the size bytes of a DDS file at data.  The subresource offsets are from data.
+bool ParseDds(const std::uint8_t* data, std::uint64_t size, DdsTexture& texture, DdsError* error = nullptr);
+
+// Bits per pixel of format; 0 if it is not a format DDS files hold.  Block compressed
+// formats give bits per pixel of a block.
+std::uint32_t DdsBitsPerPixel(DdsFormat format);
+bool IsDdsBlockCompressed(DdsFormat format);
+
+// The layout of one width x height surface of format.
+void GetDdsSurfaceInfo(std::uint32_t width, std::uint32_t height, DdsFormat format,
+	std::uint64_t* rowBytes, std::uint32_t* rowCount, std::uint64_t* sliceBytes);
+
+class DdsFile
+{
+public:
+	// Maps and parses filename; see ParseDds.
+	bool Open(const std::string& filename, DdsError* error = nullptr);
+#if defined(_WIN32)
+	bool Open(const std::wstring& filename, DdsError* error = nullptr);
+#endif
+	void Close();
+
+	const DdsTexture& Texture()const { return mTexture; }
+	const MappedFile& File()const { return mFile; }
+
+	// The first byte of a subresource, in the mapping; valid until Close.
+	const std::uint8_t* Data(const DdsSubresource& subresource)const { return mFile.Data() + subresource.Offset; }
+
+private:
+	bool Parse(DdsError* error);
+
+	MappedFile mFile;
+	DdsTexture mTexture;
+};
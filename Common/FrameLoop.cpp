@@ -0,0 +1,121 @@
+//***************************************************************************************
+// FrameLoop.cpp
+//***************************************************************************************
+
+#include "FrameLoop.h"
+#include <cmath>
+#include <thread>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Sleeps can wake a scheduler quantum late, so pacing sleeps until this long before
+	// the frame is due and yields for the rest.
+	const Clock::duration SpinMargin = std::chrono::milliseconds(2);
+}
+
+FrameLoop::FrameLoop(GameTimer& clock, const FrameLoopSettings& settings)
+	: mClock(clock), mSettings(settings)
+{
+}
+
+void FrameLoop::SetSettings(const FrameLoopSettings& settings)
+{
+	mSettings = settings;
+	mAccumulator = 0.0;
+	mNextFrame = Clock::now();
+}
+
+void FrameLoop::Reset()
+{
+	mClock.Reset();
+	mStepTimer.Reset();
+	mAccumulator = 0.0;
+	mFrameCount = 0;
+	mNextFrame = Clock::now();
+}
+
+std::uint32_t FrameLoop::RunFrame(const FrameFunc& update, const FrameFunc& draw)
+{
+	mClock.Tick();
+
+	std::uint32_t updates = UpdateCount();
+	for(std::uint32_t i = 0; i < updates; ++i)
+	{
+		if(mSettings.Timestep == FrameTimestep::Fixed)
+			mStepTimer.Advance(mSettings.FixedDeltaTime);
+		update(SimulationTimer());
+	}
+
+	if(draw)
+		draw(SimulationTimer());
+
+	++mFrameCount;
+	WaitForNextFrame();
+	return updates;
+}
+
+void FrameLoop::Run(std::uint64_t frameCount, const FrameFunc& update, const FrameFunc& draw)
+{
+	for(std::uint64_t f = 0; f < frameCount; ++f)
+		RunFrame(update, draw);
+}
+
+const GameTimer& FrameLoop::SimulationTimer()const
+{
+	return mSettings.Timestep == FrameTimestep::Fixed ? mStepTimer : mClock;
+}
+
+float FrameLoop::Alpha()const
+{
+	if(mSettings.Timestep != FrameTimestep::Fixed || mSettings.IgnoreClock)
+		return 0.0f;
+	return (float)(mAccumulator / mSettings.FixedDeltaTime);
+}
+
+std::uint32_t FrameLoop::UpdateCount()
+{
+	if(mSettings.Timestep == FrameTimestep::Variable)
+		return 1;
+
+	if(mSettings.IgnoreClock)
+		return 1;
+
+	// Whole steps of the time elapsed, carrying the remainder to the next frame.  A
+	// frame that took longer than MaxUpdatesPerFrame steps loses the excess.
+	const double step = mSettings.FixedDeltaTime;
+	mAccumulator += mClock.DeltaTime();
+
+	double steps = std::floor(mAccumulator / step);
+	if(steps > (double)mSettings.MaxUpdatesPerFrame)
+	{
+		steps = (double)mSettings.MaxUpdatesPerFrame;
+		mAccumulator = steps*step;
+	}
+
+	mAccumulator -= steps*step;
+	return (std::uint32_t)steps;
+}
+
+void FrameLoop::WaitForNextFrame()
+{
+	if(mSettings.TargetFrameRate <= 0.0)
+		return;
+
+	const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(1.0 / mSettings.TargetFrameRate));
+
+	// Frames are due one period apart, so a frame that runs a little long is made up by
+	// the next one.  More than a period behind, catching up would only rush a burst of
+	// frames, so the schedule starts over from now.
+	Clock::time_point now = Clock::now();
+	mNextFrame += period;
+	if(mNextFrame + period < now)
+		mNextFrame = now;
+
+	if(mNextFrame - SpinMargin > now)
+		std::this_thread::sleep_until(mNextFrame - SpinMargin);
+	while(Clock::now() < mNextFrame)
+		std::this_thread::yield();
+}
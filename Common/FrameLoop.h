@@ -0,0 +1,88 @@
+//***************************************************************************************
+// FrameLoop.h
+//
+// The platform-neutral core of a frame loop: ticks a GameTimer, runs the update with a
+// variable or a fixed timestep, draws, and paces frames to a target rate.  D3DApp::Run
+// drives it between window messages; a headless program drives it directly, with no
+// window or device, so the same Update code runs in a console, on Linux, or on a server.
+//***************************************************************************************
+
+#pragma once
+
+#include "GameTimer.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+enum class FrameTimestep
+{
+	Variable, // One update per frame, by the time the frame took.
+	Fixed     // One update per FixedDeltaTime of elapsed time, zero or more per frame.
+};
+
+struct FrameLoopSettings
+{
+	FrameTimestep Timestep = FrameTimestep::Variable;
+	double FixedDeltaTime = 1.0 / 60.0;
+
+	// With a fixed timestep, at most this many updates run per frame and any time left
+	// over is dropped, so updates slower than real time cannot fall further and further
+	// behind.
+	std::uint32_t MaxUpdatesPerFrame = 8;
+
+	// Frames per second to pace to; 0 runs frames back to back.
+	double TargetFrameRate = 0.0;
+
+	// With a fixed timestep, runs exactly one update per frame whatever the clock says,
+	// so a headless simulation or benchmark goes as fast as its updates allow and steps
+	// the same way on every run.
+	bool IgnoreClock = false;
+};
+
+class FrameLoop
+{
+public:
+	typedef std::function<void(const GameTimer&)> FrameFunc;
+
+	// clock measures real time.  It stays the caller's, to Stop and Start when the
+	// application pauses.
+	explicit FrameLoop(GameTimer& clock, const FrameLoopSettings& settings = FrameLoopSettings());
+	FrameLoop(const FrameLoop& rhs) = delete;
+	FrameLoop& operator=(const FrameLoop& rhs) = delete;
+
+	const FrameLoopSettings& Settings()const { return mSettings; }
+	void SetSettings(const FrameLoopSettings& settings);
+
+	// Restarts the clock and the simulation time.  Call before the first frame.
+	void Reset();
+
+	// Runs one frame: update as the timestep policy says, then draw once, then wait for
+	// the next frame at the target rate.  Returns the number of updates.  draw may be
+	// empty.
+	std::uint32_t RunFrame(const FrameFunc& update, const FrameFunc& draw);
+
+	// Runs frameCount frames.
+	void Run(std::uint64_t frameCount, const FrameFunc& update, const FrameFunc& draw);
+
+	// The time the update sees: the clock itself with a variable timestep, otherwise a
+	// timer advanced by FixedDeltaTime per update.
+	const GameTimer& SimulationTimer()const;
+
+	// With a fixed timestep, how far real time is past the last update, in updates, in
+	// [0, 1).  Draw can blend the last two updates' states by it.
+	float Alpha()const;
+
+	std::uint64_t FrameCount()const { return mFrameCount; }
+
+private:
+	std::uint32_t UpdateCount();
+	void WaitForNextFrame();
+
+	GameTimer& mClock;
+	GameTimer mStepTimer;
+	FrameLoopSettings mSettings;
+
+	double mAccumulator = 0.0;
+	std::uint64_t mFrameCount = 0;
+	std::chrono::steady_clock::time_point mNextFrame;
+};
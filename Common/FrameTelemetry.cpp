@@ -0,0 +1,412 @@
+//***************************************************************************************
+// FrameTelemetry.cpp
+//***************************************************************************************
+
+#include "FrameTelemetry.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Bucket layout: values below SubBucketCount microseconds have a bucket each; above,
+	// each power of two [2^k, 2^(k+1)) is split into SubBucketCount/2 equal buckets.
+	const std::uint32_t SubBucketBits = 7;
+	const std::uint64_t SubBucketCount = 1ull << SubBucketBits;
+	const std::uint64_t SubBucketHalfCount = SubBucketCount / 2;
+	const std::uint64_t MaxValue = (1ull << 32) - 1;
+	const std::uint32_t BucketCount = (std::uint32_t)(SubBucketCount + (32 - SubBucketBits)*SubBucketHalfCount);
+
+	std::uint32_t FloorLog2(std::uint64_t v)
+	{
+		std::uint32_t log = 0;
+		while(v >>= 1)
+			++log;
+		return log;
+	}
+
+	std::uint64_t ToMicroseconds(double milliseconds)
+	{
+		if(!(milliseconds > 0.0))
+			return 0;
+		return std::min((std::uint64_t)(milliseconds*1000.0 + 0.5), MaxValue);
+	}
+
+	std::uint32_t BucketIndex(std::uint64_t us)
+	{
+		if(us < SubBucketCount)
+			return (std::uint32_t)us;
+
+		std::uint32_t shift = FloorLog2(us) - (SubBucketBits - 1);
+		return (std::uint32_t)(SubBucketCount + (shift - 1)*SubBucketHalfCount + ((us >> shift) - SubBucketHalfCount));
+	}
+
+	// The middle of the values bucket holds.
+	std::uint64_t BucketValue(std::uint32_t index)
+	{
+		if(index < SubBucketCount)
+			return index;
+
+		std::uint32_t shift = (std::uint32_t)((index - SubBucketCount) / SubBucketHalfCount) + 1;
+		std::uint64_t sub = (index - SubBucketCount) % SubBucketHalfCount + SubBucketHalfCount;
+		return (sub << shift) + (1ull << (shift - 1));
+	}
+
+	double Milliseconds(Clock::duration d)
+	{
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+
+	FrameStats MakeStats(const FrameHistogram& histogram)
+	{
+		FrameStats stats;
+		stats.Count = histogram.Count();
+		stats.MeanMs = histogram.MeanMs();
+		stats.P50Ms = histogram.PercentileMs(50.0);
+		stats.P95Ms = histogram.PercentileMs(95.0);
+		stats.P99Ms = histogram.PercentileMs(99.0);
+		stats.MaxMs = histogram.MaxMs();
+		return stats;
+	}
+
+	std::string JsonString(const std::string& s)
+	{
+		std::string quoted = "\"";
+		for(char c : s)
+		{
+			if(c == '"' || c == '\\')
+				quoted += '\\';
+			quoted += c;
+		}
+		return quoted + "\"";
+	}
+}
+
+FrameHistogram::FrameHistogram()
+	: mCounts(BucketCount, 0)
+{
+}
+
+void FrameHistogram::Record(double milliseconds)
+{
+	std::uint64_t us = ToMicroseconds(milliseconds);
+
+	++mCounts[BucketIndex(us)];
+	mMin = mCount == 0 ? us : std::min(mMin, us);
+	mMax = std::max(mMax, us);
+	mSum += us;
+	++mCount;
+}
+
+void FrameHistogram::Merge(const FrameHistogram& rhs)
+{
+	if(rhs.mCount == 0)
+		return;
+
+	for(std::uint32_t i = 0; i < BucketCount; ++i)
+		mCounts[i] += rhs.mCounts[i];
+	mMin = mCount == 0 ? rhs.mMin : std::min(mMin, rhs.mMin);
+	mMax = std::max(mMax, rhs.mMax);
+	mSum += rhs.mSum;
+	mCount += rhs.mCount;
+}
+
+void FrameHistogram::Reset()
+{
+	std::fill(mCounts.begin(), mCounts.end(), 0);
+	mCount = 0;
+	mMin = 0;
+	mMax = 0;
+	mSum = 0.0;
+}
+
+double FrameHistogram::MinMs()const
+{
+	return mMin / 1000.0;
+}
+
+double FrameHistogram::MaxMs()const
+{
+	return mMax / 1000.0;
+}
+
+double FrameHistogram::MeanMs()const
+{
+	return mCount > 0 ? mSum / mCount / 1000.0 : 0.0;
+}
+
+double FrameHistogram::PercentileMs(double percentile)const
+{
+	if(mCount == 0)
+		return 0.0;
+
+	double p = std::min(std::max(percentile, 0.0), 100.0);
+	std::uint64_t rank = std::max((std::uint64_t)std::ceil(p / 100.0*mCount), (std::uint64_t)1);
+
+	std::uint64_t seen = 0;
+	for(std::uint32_t i = 0; i < BucketCount; ++i)
+	{
+		seen += mCounts[i];
+		if(seen == mCount)
+			return MaxMs();
+		if(seen >= rank)
+			return std::min(std::max(BucketValue(i), mMin), mMax) / 1000.0;
+	}
+	return MaxMs();
+}
+
+FrameTelemetry::FrameTelemetry(std::uint32_t ringCapacity)
+	: mTotal(MaxFrameScopes), mWindow(MaxFrameScopes)
+{
+	std::uint64_t capacity = 1;
+	while(capacity < ringCapacity)
+		capacity <<= 1;
+	mRing.resize((std::size_t)capacity);
+	mRingMask = capacity - 1;
+
+	mScopeNames.push_back("Frame");
+	mScopeNames.push_back("CPU");
+}
+
+std::uint32_t FrameTelemetry::RegisterScope(const std::string& name)
+{
+	std::uint32_t scope = FindScope(name);
+	if(scope != InvalidScope)
+		return scope;
+
+	if(mScopeNames.size() == MaxFrameScopes)
+		return InvalidScope;
+
+	mScopeNames.push_back(name);
+	return (std::uint32_t)mScopeNames.size() - 1;
+}
+
+std::uint32_t FrameTelemetry::FindScope(const std::string& name)const
+{
+	for(std::uint32_t i = 0; i < (std::uint32_t)mScopeNames.size(); ++i)
+	{
+		if(mScopeNames[i] == name)
+			return i;
+	}
+	return InvalidScope;
+}
+
+void FrameTelemetry::BeginFrame()
+{
+	mFrameStart = Clock::now();
+	mFrameBegun = true;
+}
+
+void FrameTelemetry::AddScopeTime(std::uint32_t scope, double milliseconds)
+{
+	if(scope >= MaxFrameScopes)
+		return;
+
+	mCurrent.Ms[scope] += (float)milliseconds;
+	mCurrent.ScopeMask |= 1u << scope;
+}
+
+void FrameTelemetry::EndFrame()
+{
+	Clock::time_point now = Clock::now();
+
+	if(mFrameBegun)
+		AddScopeTime(CpuScope, Milliseconds(now - mFrameStart));
+	if(mFrameEnded)
+		AddScopeTime(FrameScope, Milliseconds(now - mLastFrameEnd));
+	mCurrent.Frame = mFrameIndex++;
+
+	std::uint64_t write = mWriteCount.load(std::memory_order_relaxed);
+	std::uint64_t read = mReadCount.load(std::memory_order_acquire);
+	if(write - read <= mRingMask)
+	{
+		mRing[(std::size_t)(write & mRingMask)] = mCurrent;
+		mWriteCount.store(write + 1, std::memory_order_release);
+	}
+	else
+	{
+		mFramesDropped.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	mCurrent = FrameRecord();
+	mLastFrameEnd = now;
+	mFrameBegun = false;
+	mFrameEnded = true;
+}
+
+void FrameTelemetry::Pause()
+{
+	mFrameEnded = false;
+}
+
+FrameTelemetry::ScopeTimer::ScopeTimer(FrameTelemetry& telemetry, std::uint32_t scope)
+	: mTelemetry(telemetry), mScope(scope), mStart(Clock::now())
+{
+}
+
+FrameTelemetry::ScopeTimer::~ScopeTimer()
+{
+	Stop();
+}
+
+void FrameTelemetry::ScopeTimer::Stop()
+{
+	if(mStopped)
+		return;
+
+	mTelemetry.AddScopeTime(mScope, Milliseconds(Clock::now() - mStart));
+	mStopped = true;
+}
+
+std::uint32_t FrameTelemetry::Drain()
+{
+	std::uint64_t read = mReadCount.load(std::memory_order_relaxed);
+	std::uint64_t write = mWriteCount.load(std::memory_order_acquire);
+
+	for(std::uint64_t r = read; r < write; ++r)
+	{
+		const FrameRecord& record = mRing[(std::size_t)(r & mRingMask)];
+		for(std::uint32_t scope = 0; scope < MaxFrameScopes; ++scope)
+		{
+			if(record.ScopeMask & (1u << scope))
+			{
+				mTotal[scope].Record(record.Ms[scope]);
+				mWindow[scope].Record(record.Ms[scope]);
+			}
+		}
+
+		if(mHistoryCapacity > 0)
+		{
+			if(mHistory.size() < mHistoryCapacity)
+				mHistory.push_back(record);
+			else
+				mHistory[mHistoryNext] = record;
+			mHistoryNext = (mHistoryNext + 1) % mHistoryCapacity;
+		}
+	}
+
+	mReadCount.store(write, std::memory_order_release);
+	mFramesDrained += write - read;
+	return (std::uint32_t)(write - read);
+}
+
+void FrameTelemetry::SetHistoryCapacity(std::size_t frameCount)
+{
+	mHistory.clear();
+	mHistoryCapacity = frameCount;
+	mHistoryNext = 0;
+}
+
+FrameStats FrameTelemetry::Stats(std::uint32_t scope)const
+{
+	return MakeStats(mTotal[scope]);
+}
+
+FrameStats FrameTelemetry::WindowStats(std::uint32_t scope)const
+{
+	return MakeStats(mWindow[scope]);
+}
+
+void FrameTelemetry::ResetWindow()
+{
+	for(auto& histogram : mWindow)
+		histogram.Reset();
+}
+
+bool FrameTelemetry::WriteCsv(const std::string& filename)const
+{
+	std::ofstream fout(filename);
+	if(!fout)
+		return false;
+
+	fout << "frame";
+	for(const auto& name : mScopeNames)
+		fout << "," << name;
+	fout << "\n";
+
+	// Oldest first; once the history has wrapped, the oldest is the next to overwrite.
+	std::size_t first = mHistory.size() < mHistoryCapacity ? 0 : mHistoryNext;
+	for(std::size_t i = 0; i < mHistory.size(); ++i)
+	{
+		const FrameRecord& record = mHistory[(first + i) % mHistory.size()];
+
+		fout << record.Frame;
+		for(std::uint32_t scope = 0; scope < ScopeCount(); ++scope)
+		{
+			fout << ",";
+			if(record.ScopeMask & (1u << scope))
+				fout << record.Ms[scope];
+		}
+		fout << "\n";
+	}
+
+	return (bool)fout;
+}
+
+bool FrameTelemetry::WriteJson(const std::string& filename)const
+{
+	std::ofstream fout(filename);
+	if(!fout)
+		return false;
+
+	fout << "{\n";
+	fout << "  \"frames\": " << mFramesDrained << ",\n";
+	fout << "  \"dropped\": " << FramesDropped() << ",\n";
+	fout << "  \"scopes\": [\n";
+	for(std::uint32_t scope = 0; scope < ScopeCount(); ++scope)
+	{
+		FrameStats stats = Stats(scope);
+		fout << "    { \"name\": " << JsonString(mScopeNames[scope])
+			<< ", \"count\": " << stats.Count
+			<< ", \"mean_ms\": " << stats.MeanMs
+			<< ", \"p50_ms\": " << stats.P50Ms
+			<< ", \"p95_ms\": " << stats.P95Ms
+			<< ", \"p99_ms\": " << stats.P99Ms
+			<< ", \"max_ms\": " << stats.MaxMs
+			<< " }" << (scope + 1 < ScopeCount() ? "," : "") << "\n";
+	}
+	fout << "  ]\n";
+	fout << "}\n";
+
+	return (bool)fout;
+}
+
+bool FrameTelemetry::CheckBudgets(const std::vector<FrameTimeBudget>& budgets, std::vector<std::string>* failures)const
+{
+	bool passed = true;
+	for(const auto& budget : budgets)
+	{
+		std::string failure;
+
+		std::uint32_t scope = FindScope(budget.Scope);
+		if(scope == InvalidScope)
+		{
+			failure = budget.Scope + ": no such scope";
+		}
+		else if(mTotal[scope].Count() == 0)
+		{
+			failure = budget.Scope + ": never timed";
+		}
+		else
+		{
+			double ms = mTotal[scope].PercentileMs(budget.Percentile);
+			if(ms > budget.MaxMs)
+			{
+				std::ostringstream oss;
+				oss << budget.Scope << ": p" << budget.Percentile << " of " << ms << " ms is over the budget of " << budget.MaxMs << " ms";
+				failure = oss.str();
+			}
+		}
+
+		if(!failure.empty())
+		{
+			passed = false;
+			if(failures != nullptr)
+				failures->push_back(failure);
+		}
+	}
+	return passed;
+}
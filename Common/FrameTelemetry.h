@@ -0,0 +1,190 @@
+//***************************************************************************************
+// FrameTelemetry.h
+//
+// Per-frame CPU timings, for tail latency rather than an average.  The frame's thread
+// times the frame and any named scopes inside it (Update, Draw, or their sub-stages) and
+// pushes one FrameRecord per frame into a lock-free single producer, single consumer ring.
+// Drain, on the same or another thread, folds the records into log-linear histograms that
+// give p50/p95/p99/max within 1%, keeps the most recent records for a CSV dump, and the
+// totals can be written as JSON or checked against budgets to fail a CI run.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Counts of durations in buckets a power of two wide at most 1/64 of their value, in the
+// manner of HdrHistogram: values to 128 us are exact and larger ones are within 0.8%,
+// from a microsecond to about 71 minutes, in 7 KB.
+class FrameHistogram
+{
+public:
+	FrameHistogram();
+
+	void Record(double milliseconds);
+	void Merge(const FrameHistogram& rhs);
+	void Reset();
+
+	std::uint64_t Count()const { return mCount; }
+	double MinMs()const;
+	double MaxMs()const;
+	double MeanMs()const;
+
+	// The smallest recorded value that percentile percent of the values are at or below,
+	// to the histogram's precision.  0 if nothing was recorded.
+	double PercentileMs(double percentile)const;
+
+private:
+	std::vector<std::uint32_t> mCounts;
+	std::uint64_t mCount = 0;
+	std::uint64_t mMin = 0;
+	std::uint64_t mMax = 0;
+	double mSum = 0.0;
+};
+
+struct FrameStats
+{
+	std::uint64_t Count = 0;
+	double MeanMs = 0.0;
+	double P50Ms = 0.0;
+	double P95Ms = 0.0;
+	double P99Ms = 0.0;
+	double MaxMs = 0.0;
+};
+
+// Fails CheckBudgets when the scope's Percentile is over MaxMs.
+struct FrameTimeBudget
+{
+	std::string Scope;
+	double Percentile = 99.0;
+	double MaxMs = 0.0;
+};
+
+const std::uint32_t MaxFrameScopes = 16;
+
+struct FrameRecord
+{
+	std::uint64_t Frame = 0;
+
+	// Bit i is set if scope i was timed this frame.
+	std::uint32_t ScopeMask = 0;
+	float Ms[MaxFrameScopes] = {};
+};
+
+class FrameTelemetry
+{
+public:
+	// Scopes every FrameTelemetry has: the time from the end of one frame to the end of
+	// the next, and from BeginFrame to EndFrame.
+	static const std::uint32_t FrameScope = 0;
+	static const std::uint32_t CpuScope = 1;
+	static const std::uint32_t InvalidScope = 0xffffffff;
+
+	// ringCapacity is rounded up to a power of two; frames pushed while the ring is full
+	// are dropped and counted.
+	explicit FrameTelemetry(std::uint32_t ringCapacity = 1024);
+	FrameTelemetry(const FrameTelemetry& rhs) = delete;
+	FrameTelemetry& operator=(const FrameTelemetry& rhs) = delete;
+
+	// Returns the index of the scope called name, adding it if it is new, or InvalidScope
+	// once there are MaxFrameScopes.  Register scopes before the first frame.
+	std::uint32_t RegisterScope(const std::string& name);
+	std::uint32_t FindScope(const std::string& name)const;
+	std::uint32_t ScopeCount()const { return (std::uint32_t)mScopeNames.size(); }
+	const std::string& ScopeName(std::uint32_t scope)const { return mScopeNames[scope]; }
+
+	//
+	// The frame's thread.
+	//
+
+	void BeginFrame();
+
+	// Adds to the scope's time this frame; a scope timed more than once sums.
+	void AddScopeTime(std::uint32_t scope, double milliseconds);
+
+	// Finishes the frame's record and pushes it to the ring.
+	void EndFrame();
+
+	// Call when frames stop, as when the app is paused.  The next frame records no Frame
+	// time, since the time since the last EndFrame includes the pause.
+	void Pause();
+
+	class ScopeTimer
+	{
+	public:
+		ScopeTimer(FrameTelemetry& telemetry, std::uint32_t scope);
+		ScopeTimer(const ScopeTimer& rhs) = delete;
+		ScopeTimer& operator=(const ScopeTimer& rhs) = delete;
+		~ScopeTimer();
+
+		// Adds the time so far to the scope, before the end of the block.
+		void Stop();
+
+	private:
+		FrameTelemetry& mTelemetry;
+		std::uint32_t mScope;
+		std::chrono::steady_clock::time_point mStart;
+		bool mStopped = false;
+	};
+
+	//
+	// The consumer's thread.  Nothing below may run concurrently with itself.
+	//
+
+	// Moves the records in the ring into the histograms and the history.  Returns the
+	// number of records.
+	std::uint32_t Drain();
+
+	// Keeps up to frameCount of the most recent drained records for WriteCsv.
+	void SetHistoryCapacity(std::size_t frameCount);
+
+	// Since the telemetry was made, and since ResetWindow.
+	FrameStats Stats(std::uint32_t scope)const;
+	FrameStats WindowStats(std::uint32_t scope)const;
+	const FrameHistogram& Histogram(std::uint32_t scope)const { return mTotal[scope]; }
+	void ResetWindow();
+
+	std::uint64_t FramesDrained()const { return mFramesDrained; }
+	std::uint64_t FramesDropped()const { return mFramesDropped.load(std::memory_order_relaxed); }
+
+	// One row per kept record, one column of milliseconds per scope, empty where the scope
+	// was not timed.
+	bool WriteCsv(const std::string& filename)const;
+
+	// The totals: count, mean, p50, p95, p99 and max of every scope.
+	bool WriteJson(const std::string& filename)const;
+
+	// Returns false if a budget is exceeded, names an unknown scope, or names a scope with
+	// no times, and describes each such budget in failures.
+	bool CheckBudgets(const std::vector<FrameTimeBudget>& budgets, std::vector<std::string>* failures = nullptr)const;
+
+private:
+	std::vector<std::string> mScopeNames;
+
+	// Producer state.
+	FrameRecord mCurrent;
+	std::chrono::steady_clock::time_point mFrameStart;
+	std::chrono::steady_clock::time_point mLastFrameEnd;
+	bool mFrameBegun = false;
+	bool mFrameEnded = false;
+	std::uint64_t mFrameIndex = 0;
+
+	// The ring.  Only the producer writes mWriteCount and only the consumer mReadCount.
+	std::vector<FrameRecord> mRing;
+	std::uint64_t mRingMask = 0;
+	std::atomic<std::uint64_t> mWriteCount{ 0 };
+	std::atomic<std::uint64_t> mReadCount{ 0 };
+	std::atomic<std::uint64_t> mFramesDropped{ 0 };
+
+	// Consumer state.
+	std::vector<FrameHistogram> mTotal;
+	std::vector<FrameHistogram> mWindow;
+	std::vector<FrameRecord> mHistory;
+	std::size_t mHistoryCapacity = 0;
+	std::size_t mHistoryNext = 0;
+	std::uint64_t mFramesDrained = 0;
+};
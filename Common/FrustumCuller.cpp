@@ -0,0 +1,185 @@
+//***************************************************************************************
+// FrustumCuller.cpp
+//***************************************************************************************
+
+#include "FrustumCuller.h"
+#include "SimdFloat.h"
+#include <cassert>
+#include <cmath>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	// One box against one plane.  The vector kernel evaluates the same expressions in
+	// the same order.
+	inline bool OutsidePlane(float cx, float cy, float cz, float ex, float ey, float ez, const XMFLOAT4& p)
+	{
+		float d = cx*p.x + cy*p.y + cz*p.z + p.w;
+		float r = ex*std::fabs(p.x) + ey*std::fabs(p.y) + ez*std::fabs(p.z);
+		return d + r < 0.0f;
+	}
+
+	// Clears the bits at and past last in the mask word that holds bit last-1.
+	inline void ClearTail(std::uint32_t last, std::uint32_t* visibleMask)
+	{
+		if(last % 32 != 0)
+			visibleMask[last / 32] &= (1u << (last % 32)) - 1;
+	}
+
+	inline std::uint32_t LowestBit(std::uint32_t bits)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, bits);
+		return (std::uint32_t)index;
+#else
+		return (std::uint32_t)__builtin_ctz(bits);
+#endif
+	}
+}
+
+void CullingBoxList::Resize(std::uint32_t count)
+{
+	mCount = count;
+
+	std::uint32_t padded = (count + GroupSize - 1) / GroupSize * GroupSize;
+	mCenterX.resize(padded, 0.0f);
+	mCenterY.resize(padded, 0.0f);
+	mCenterZ.resize(padded, 0.0f);
+	mExtentX.resize(padded, 0.0f);
+	mExtentY.resize(padded, 0.0f);
+	mExtentZ.resize(padded, 0.0f);
+}
+
+void CullingBoxList::SetBox(std::uint32_t i, const BoundingBox& box)
+{
+	mCenterX[i] = box.Center.x;
+	mCenterY[i] = box.Center.y;
+	mCenterZ[i] = box.Center.z;
+	mExtentX[i] = box.Extents.x;
+	mExtentY[i] = box.Extents.y;
+	mExtentZ[i] = box.Extents.z;
+}
+
+BoundingBox CullingBoxList::GetBox(std::uint32_t i)const
+{
+	return BoundingBox(XMFLOAT3(mCenterX[i], mCenterY[i], mCenterZ[i]),
+		XMFLOAT3(mExtentX[i], mExtentY[i], mExtentZ[i]));
+}
+
+void CullBoxesScalar(const CullingFrustum& frustum, const CullingBoxList& boxes,
+	std::uint32_t first, std::uint32_t last, std::uint32_t* visibleMask)
+{
+	assert(first % 32 == 0 && last <= boxes.Count());
+
+	for(std::uint32_t w = first / 32; w < (last + 31) / 32; ++w)
+		visibleMask[w] = 0;
+
+	const float* cx = boxes.CenterX();
+	const float* cy = boxes.CenterY();
+	const float* cz = boxes.CenterZ();
+	const float* ex = boxes.ExtentX();
+	const float* ey = boxes.ExtentY();
+	const float* ez = boxes.ExtentZ();
+
+	for(std::uint32_t i = first; i < last; ++i)
+	{
+		bool outside = false;
+		for(int p = 0; p < 6; ++p)
+			outside = outside || OutsidePlane(cx[i], cy[i], cz[i], ex[i], ey[i], ez[i], frustum.Planes[p]);
+
+		if(!outside)
+			visibleMask[i / 32] |= 1u << (i % 32);
+	}
+}
+
+void CullBoxes(const CullingFrustum& frustum, const CullingBoxList& boxes,
+	std::uint32_t first, std::uint32_t last, std::uint32_t* visibleMask)
+{
+#if defined(SIMD_FLOAT_AVX) || defined(SIMD_FLOAT_SSE) || defined(SIMD_FLOAT_NEON)
+	assert(first % 32 == 0 && last <= boxes.Count());
+
+	FloatV nx[6], ny[6], nz[6], d[6], ax[6], ay[6], az[6];
+	for(int p = 0; p < 6; ++p)
+	{
+		const XMFLOAT4& plane = frustum.Planes[p];
+		nx[p] = SplatV(plane.x);
+		ny[p] = SplatV(plane.y);
+		nz[p] = SplatV(plane.z);
+		d[p] = SplatV(plane.w);
+		ax[p] = SplatV(std::fabs(plane.x));
+		ay[p] = SplatV(std::fabs(plane.y));
+		az[p] = SplatV(std::fabs(plane.z));
+	}
+
+	const FloatV zero = SplatV(0.0f);
+	const std::uint32_t laneMask = (1u << FloatVWidth) - 1;
+
+	const float* cx = boxes.CenterX();
+	const float* cy = boxes.CenterY();
+	const float* cz = boxes.CenterZ();
+	const float* ex = boxes.ExtentX();
+	const float* ey = boxes.ExtentY();
+	const float* ez = boxes.ExtentZ();
+
+	// The box arrays are padded to a multiple of 8, so a group that starts before last
+	// can always be loaded whole.  Lanes past last are cleared afterwards.
+	for(std::uint32_t w = first / 32; w < (last + 31) / 32; ++w)
+	{
+		std::uint32_t bits = 0;
+		for(std::uint32_t lane = 0; lane < 32 && w*32 + lane < last; lane += FloatVWidth)
+		{
+			const std::uint32_t i = w*32 + lane;
+
+			FloatV x = LoadV(cx + i);
+			FloatV y = LoadV(cy + i);
+			FloatV z = LoadV(cz + i);
+			FloatV sx = LoadV(ex + i);
+			FloatV sy = LoadV(ey + i);
+			FloatV sz = LoadV(ez + i);
+
+			FloatV outside = LessV(zero, zero);
+			for(int p = 0; p < 6; ++p)
+			{
+				FloatV dist = AddV(AddV(AddV(MulV(x, nx[p]), MulV(y, ny[p])), MulV(z, nz[p])), d[p]);
+				FloatV radius = AddV(AddV(MulV(sx, ax[p]), MulV(sy, ay[p])), MulV(sz, az[p]));
+				outside = OrV(outside, LessV(AddV(dist, radius), zero));
+			}
+
+			bits |= (~MaskBitsV(outside) & laneMask) << lane;
+		}
+
+		visibleMask[w] = bits;
+	}
+
+	ClearTail(last, visibleMask);
+#else
+	CullBoxesScalar(frustum, boxes, first, last, visibleMask);
+#endif
+}
+
+void AppendVisibleIndices(const std::uint32_t* mask, std::uint32_t first, std::uint32_t last,
+	std::vector<std::uint32_t>& indices)
+{
+	for(std::uint32_t w = first / 32; w < (last + 31) / 32; ++w)
+	{
+		std::uint32_t bits = mask[w];
+
+		// Drop the bits outside [first, last) in the first and last words.
+		if(w == first / 32)
+			bits &= ~0u << (first % 32);
+		if(w == (last - 1) / 32 && last % 32 != 0)
+			bits &= (1u << (last % 32)) - 1;
+
+		while(bits != 0)
+		{
+			indices.push_back(w*32 + LowestBit(bits));
+			bits &= bits - 1;
+		}
+	}
+}
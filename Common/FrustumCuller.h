@@ -0,0 +1,60 @@
+//***************************************************************************************
+// FrustumCuller.h
+//
+// Flat frustum culling of many world-space boxes at once.  The boxes are kept as separate
+// center and extent arrays so the vector kernel tests 4 (SSE, NEON) or 8 (AVX2) boxes per
+// instruction against one plane.  The result is one visibility bit per box.
+//
+// CullBoxesScalar is the reference.  CullBoxes evaluates the same expressions in the same
+// order with only add/mul, so both give identical bits on builds without FMA contraction.
+//***************************************************************************************
+
+#pragma once
+
+#include "CullingBvh.h"
+
+class CullingBoxList
+{
+public:
+	// Boxes are stored in groups of this many; the arrays are padded to a whole group.
+	static const std::uint32_t GroupSize = 8;
+
+	void Resize(std::uint32_t count);
+	std::uint32_t Count()const { return mCount; }
+
+	void SetBox(std::uint32_t i, const DirectX::BoundingBox& box);
+	DirectX::BoundingBox GetBox(std::uint32_t i)const;
+
+	// Number of 32-bit words a visibility mask for these boxes takes.
+	std::uint32_t MaskWordCount()const { return (mCount + 31) / 32; }
+
+	const float* CenterX()const { return mCenterX.data(); }
+	const float* CenterY()const { return mCenterY.data(); }
+	const float* CenterZ()const { return mCenterZ.data(); }
+	const float* ExtentX()const { return mExtentX.data(); }
+	const float* ExtentY()const { return mExtentY.data(); }
+	const float* ExtentZ()const { return mExtentZ.data(); }
+
+private:
+	std::uint32_t mCount = 0;
+
+	std::vector<float> mCenterX;
+	std::vector<float> mCenterY;
+	std::vector<float> mCenterZ;
+	std::vector<float> mExtentX;
+	std::vector<float> mExtentY;
+	std::vector<float> mExtentZ;
+};
+
+// Sets bit i%32 of visibleMask[i/32] for every box i in [first, last) that is not outside
+// the frustum, and clears it otherwise.  first must be a multiple of 32; the mask words
+// covering [first, last) are overwritten, including the bits past last in the final one.
+// Separate threads can cull ranges split at multiples of 32 into the same mask.
+void CullBoxesScalar(const CullingFrustum& frustum, const CullingBoxList& boxes,
+	std::uint32_t first, std::uint32_t last, std::uint32_t* visibleMask);
+void CullBoxes(const CullingFrustum& frustum, const CullingBoxList& boxes,
+	std::uint32_t first, std::uint32_t last, std::uint32_t* visibleMask);
+
+// Appends the index of every set bit in [first, last) of mask to indices, in order.
+void AppendVisibleIndices(const std::uint32_t* mask, std::uint32_t first, std::uint32_t last,
+	std::vector<std::uint32_t>& indices);
@@ -2,16 +2,23 @@
 // GameTimer.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
-#include <windows.h>
 #include "GameTimer.h"
+#include <chrono>
+
+namespace
+{
+	std::int64_t CurrentCount()
+	{
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+	}
+}
 
 GameTimer::GameTimer()
 : mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
-  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+  mPausedTime(0), mStopTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
 {
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	mSecondsPerCount = 1.0 / (double)countsPerSec;
+	typedef std::chrono::steady_clock::period Period;
+	mSecondsPerCount = (double)Period::num / (double)Period::den;
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
@@ -55,19 +62,19 @@ float GameTimer::DeltaTime()const
 
 void GameTimer::Reset()
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	std::int64_t currTime = CurrentCount();
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
+	mCurrTime = currTime;
+	mPausedTime = 0;
 	mStopTime = 0;
 	mStopped  = false;
 }
 
 void GameTimer::Start()
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	std::int64_t startTime = CurrentCount();
 
 
 	// Accumulate the time elapsed between stop and start pairs.
@@ -97,8 +104,7 @@ void GameTimer::Stop()
 	// ̹  ¸ ƹ ϵ  ʴ´.
 	if( !mStopped )
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+		std::int64_t currTime = CurrentCount();
 		// ׷ ʴٸ  ð Ÿ̸   ð ϰ,
 		// Ÿ̸Ӱ Ǿ ϴ ο ÷׸ Ѵ.
 		mStopTime = currTime;
@@ -114,9 +120,7 @@ void GameTimer::Tick()
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-	mCurrTime = currTime;
+	mCurrTime = CurrentCount();
 
 	// Time difference between this frame and the previous.
 	mDeltaTime = (mCurrTime - mPrevTime)*mSecondsPerCount;
@@ -133,3 +137,9 @@ void GameTimer::Tick()
 	}
 }
 
+void GameTimer::Advance(double seconds)
+{
+	mCurrTime += (std::int64_t)(seconds / mSecondsPerCount + 0.5);
+	mPrevTime = mCurrTime;
+	mDeltaTime = seconds;
+}
@@ -5,6 +5,9 @@
 #ifndef GAMETIMER_H
 #define GAMETIMER_H
 
+#include <cstdint>
+
+// Measures time with std::chrono::steady_clock, so it runs the same on every platform.
 class GameTimer
 {
 public:
@@ -18,15 +21,20 @@ public:
 	void Stop();  // Call when paused.
 	void Tick();  // Call every frame.
 
+	// Moves the timer forward by exactly seconds instead of reading the clock, for
+	// fixed timesteps and for simulations that run faster than real time.  A timer
+	// driven this way should only be Reset and Advanced, never Ticked or stopped.
+	void Advance(double seconds);
+
 private:
 	double mSecondsPerCount;
 	double mDeltaTime;
 
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	std::int64_t mBaseTime;
+	std::int64_t mPausedTime;
+	std::int64_t mStopTime;
+	std::int64_t mPrevTime;
+	std::int64_t mCurrTime;
 
 	bool mStopped;
 };
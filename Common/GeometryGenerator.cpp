@@ -3,11 +3,67 @@
 //***************************************************************************************
 
 #include "GeometryGenerator.h"
+#include "MeshOptimizer.h"
 #include <algorithm>
 
+namespace
+{
+	// Open addressing hash table from an undirected edge, as its two vertex indices, to
+	// the index of its midpoint vertex.  Sized once for the most edges it can be asked
+	// to hold and kept at most half full, so a lookup probes only a slot or two.
+	class EdgeMidpointTable
+	{
+	public:
+		explicit EdgeMidpointTable(std::uint32_t maxEdges)
+		{
+			std::uint64_t slotCount = 16;
+			while(slotCount < 2*(std::uint64_t)maxEdges)
+				slotCount *= 2;
+
+			mSlots.assign((size_t)slotCount, Slot{ EmptyKey, 0 });
+			mMask = slotCount - 1;
+		}
+
+		// Returns the midpoint index of edge (a, b).  An edge seen for the first time
+		// gets nextIndex, and inserted is set.
+		std::uint32_t FindOrInsert(std::uint32_t a, std::uint32_t b, std::uint32_t nextIndex, bool& inserted)
+		{
+			std::uint64_t key = a < b ? ((std::uint64_t)a << 32 | b) : ((std::uint64_t)b << 32 | a);
+
+			// Fibonacci hashing spreads the sequential indices of neighbouring vertices.
+			std::uint64_t slot = (key*0x9E3779B97F4A7C15ull >> 32) & mMask;
+			while(mSlots[(size_t)slot].Key != key)
+			{
+				if(mSlots[(size_t)slot].Key == EmptyKey)
+				{
+					mSlots[(size_t)slot] = Slot{ key, nextIndex };
+					inserted = true;
+					return nextIndex;
+				}
+				slot = (slot + 1) & mMask;
+			}
+
+			inserted = false;
+			return mSlots[(size_t)slot].Midpoint;
+		}
+
+	private:
+		static const std::uint64_t EmptyKey = ~0ull;
+
+		struct Slot
+		{
+			std::uint64_t Key;
+			std::uint32_t Midpoint;
+		};
+
+		std::vector<Slot> mSlots;
+		std::uint64_t mMask = 0;
+	};
+}
+
 using namespace DirectX;
 
-GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
+GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions, uint32 maxSubdivisions)
 {
     MeshData meshData;
 
@@ -92,11 +148,14 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 	meshData.Indices32.assign(&i[0], &i[36]);
 
     // Put a cap on the number of subdivisions.
-    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+    numSubdivisions = std::min<uint32>(numSubdivisions, maxSubdivisions);
 
     for(uint32 i = 0; i < numSubdivisions; ++i)
         Subdivide(meshData);
 
+    if(mOptimizeMeshes)
+        OptimizeMesh(meshData);
+
     return meshData;
 }
 
@@ -208,18 +267,14 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 		meshData.Indices32.push_back(baseIndex+i+1);
 	}
 
+    if(mOptimizeMeshes)
+        OptimizeMesh(meshData);
+
     return meshData;
 }
  
 void GeometryGenerator::Subdivide(MeshData& meshData)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
-
-
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
-
 	//       v1
 	//       *
 	//      / \
@@ -230,48 +285,65 @@ void GeometryGenerator::Subdivide(MeshData& meshData)
 	// *-----*-----*
 	// v0    m2     v2
 
-	uint32 numTris = (uint32)inputCopy.Indices32.size()/3;
+	const uint32 numTris = (uint32)meshData.Indices32.size()/3;
+	const uint32 numVertices = (uint32)meshData.Vertices.size();
+
+	// A mesh has at most three edges per triangle; a closed one has 1.5.
+	EdgeMidpointTable midpoints(3*numTris);
+	std::vector<uint32> edgeVertices;
+	edgeVertices.reserve(6*(size_t)numTris);
+
+	std::vector<uint32> indices(12*(size_t)numTris);
+
+	// Midpoints are numbered in the order the triangles first reach them, so the new
+	// vertices of neighbouring triangles end up near each other in the vertex buffer.
+	auto midpoint = [&](uint32 a, uint32 b)
+	{
+		bool inserted = false;
+		uint32 m = midpoints.FindOrInsert(a, b, numVertices + (uint32)edgeVertices.size()/2, inserted);
+		if(inserted)
+		{
+			edgeVertices.push_back(a);
+			edgeVertices.push_back(b);
+		}
+		return m;
+	};
+
 	for(uint32 i = 0; i < numTris; ++i)
 	{
-		Vertex v0 = inputCopy.Vertices[ inputCopy.Indices32[i*3+0] ];
-		Vertex v1 = inputCopy.Vertices[ inputCopy.Indices32[i*3+1] ];
-		Vertex v2 = inputCopy.Vertices[ inputCopy.Indices32[i*3+2] ];
+		uint32 v0 = meshData.Indices32[i*3+0];
+		uint32 v1 = meshData.Indices32[i*3+1];
+		uint32 v2 = meshData.Indices32[i*3+2];
 
 		//
 		// Generate the midpoints.
 		//
 
-        Vertex m0 = MidPoint(v0, v1);
-        Vertex m1 = MidPoint(v1, v2);
-        Vertex m2 = MidPoint(v0, v2);
+		uint32 m0 = midpoint(v0, v1);
+		uint32 m1 = midpoint(v1, v2);
+		uint32 m2 = midpoint(v0, v2);
 
 		//
 		// Add new geometry.
 		//
 
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
- 
-		meshData.Indices32.push_back(i*6+0);
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+5);
-
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+5);
-
-		meshData.Indices32.push_back(i*6+5);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+2);
+		uint32* tri = &indices[i*12];
+		tri[0] = v0; tri[1]  = m0; tri[2]  = m2;
+		tri[3] = m0; tri[4]  = m1; tri[5]  = m2;
+		tri[6] = m2; tri[7]  = m1; tri[8]  = v2;
+		tri[9] = m0; tri[10] = v1; tri[11] = m1;
+	}
 
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+1);
-		meshData.Indices32.push_back(i*6+4);
+	const uint32 numEdges = (uint32)edgeVertices.size()/2;
+	meshData.Vertices.reserve(numVertices + numEdges);
+	meshData.Vertices.resize(numVertices + numEdges);
+	for(uint32 e = 0; e < numEdges; ++e)
+	{
+		meshData.Vertices[numVertices + e] = MidPoint(
+			meshData.Vertices[edgeVertices[e*2+0]], meshData.Vertices[edgeVertices[e*2+1]]);
 	}
+
+	meshData.Indices32.swap(indices);
 }
 
 GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Vertex& v1)
@@ -304,12 +376,12 @@ GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Ve
     return v;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
+GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions, uint32 maxSubdivisions)
 {
     MeshData meshData;
 
 	// Put a cap on the number of subdivisions.
-    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+    numSubdivisions = std::min<uint32>(numSubdivisions, maxSubdivisions);
 
 	// Approximate a sphere by tessellating an icosahedron.
 
@@ -376,6 +448,9 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 		XMStoreFloat3(&meshData.Vertices[i].TangentU, XMVector3Normalize(T));
 	}
 
+    if(mOptimizeMeshes)
+        OptimizeMesh(meshData);
+
     return meshData;
 }
 
@@ -470,6 +545,9 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 	BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
 	BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
 
+    if(mOptimizeMeshes)
+        OptimizeMesh(meshData);
+
     return meshData;
 }
 
@@ -610,6 +688,9 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 		}
 	}
 
+    if(mOptimizeMeshes)
+        OptimizeMesh(meshData);
+
     return meshData;
 }
 
@@ -653,5 +734,8 @@ GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, floa
 	meshData.Indices32[4] = 2;
 	meshData.Indices32[5] = 3;
 
+    if(mOptimizeMeshes)
+        OptimizeMesh(meshData);
+
     return meshData;
 }
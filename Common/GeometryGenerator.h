@@ -74,11 +74,19 @@ public:
 		std::vector<uint16> mIndices16;
 	};
 
+	///<summary>
+	/// Every Create* call runs OptimizeMesh on its result, reordering the triangles
+	/// for the vertex cache and the vertices for fetching, unless optimizeMeshes is
+	/// false.  Pass false to get the meshes in the order they are generated.
+	///</summary>
+	explicit GeometryGenerator(bool optimizeMeshes = true) : mOptimizeMeshes(optimizeMeshes) {}
+
 	///<summary>
 	/// Creates a box centered at the origin with the given dimensions, where each
-    /// face has m rows and n columns of vertices.
+    /// face has m rows and n columns of vertices.  numSubdivisions is capped at
+    /// maxSubdivisions; past level 6 the vertices no longer fit 16-bit indices.
 	///</summary>
-    MeshData CreateBox(float width, float height, float depth, uint32 numSubdivisions);
+    MeshData CreateBox(float width, float height, float depth, uint32 numSubdivisions, uint32 maxSubdivisions = 6);
 
 	///<summary>
 	/// Creates a sphere centered at the origin with the given radius.  The
@@ -88,9 +96,10 @@ public:
 
 	///<summary>
 	/// Creates a geosphere centered at the origin with the given radius.  The
-	/// depth controls the level of tessellation.
+	/// depth controls the level of tessellation, capped at maxSubdivisions.  Level n
+	/// has 20*4^n triangles and 10*4^n + 2 vertices, so past level 6 use Indices32.
 	///</summary>
-    MeshData CreateGeosphere(float radius, uint32 numSubdivisions);
+    MeshData CreateGeosphere(float radius, uint32 numSubdivisions, uint32 maxSubdivisions = 6);
 
 	///<summary>
 	/// Creates a cylinder parallel to the y-axis, and centered about the origin.  
@@ -111,9 +120,13 @@ public:
     MeshData CreateQuad(float x, float y, float w, float h, float depth);
 
 private:
+	// Splits every triangle into four at its edge midpoints.  Triangles that share an
+	// edge (the same two vertex indices) share its midpoint vertex.
 	void Subdivide(MeshData& meshData);
     Vertex MidPoint(const Vertex& v0, const Vertex& v1);
     void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
     void BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
+
+	bool mOptimizeMeshes;
 };
 
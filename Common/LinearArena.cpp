@@ -0,0 +1,36 @@
+//***************************************************************************************
+// LinearArena.cpp
+//***************************************************************************************
+
+#include "LinearArena.h"
+
+LinearArena::LinearArena(size_t capacity)
+{
+	Reserve(capacity);
+}
+
+void LinearArena::Reserve(size_t capacity)
+{
+	mBlock.reset(capacity > 0 ? new std::uint8_t[capacity] : nullptr);
+	mCapacity = capacity;
+	mUsed = 0;
+	mHighWater = 0;
+}
+
+void* LinearArena::Allocate(size_t bytes, size_t alignment)
+{
+	// Align the address rather than the offset: new[] only guarantees the alignment of
+	// fundamental types.
+	std::uintptr_t base = reinterpret_cast<std::uintptr_t>(mBlock.get());
+	std::uintptr_t p = (base + mUsed + alignment - 1) & ~(std::uintptr_t)(alignment - 1);
+	size_t end = (size_t)(p - base) + bytes;
+
+	if(mBlock == nullptr || end > mCapacity)
+		return nullptr;
+
+	mUsed = end;
+	if(mUsed > mHighWater)
+		mHighWater = mUsed;
+
+	return reinterpret_cast<void*>(p);
+}
@@ -0,0 +1,53 @@
+//***************************************************************************************
+// LinearArena.h
+//
+// Bump allocator over one fixed block.  Allocations are never freed individually; Reset()
+// releases everything at once, which suits scratch data that lives for a single frame.
+// Each thread should own its own arena.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class LinearArena
+{
+public:
+	LinearArena() = default;
+	explicit LinearArena(size_t capacity);
+	LinearArena(const LinearArena& rhs) = delete;
+	LinearArena& operator=(const LinearArena& rhs) = delete;
+	LinearArena(LinearArena&& rhs) = default;
+	LinearArena& operator=(LinearArena&& rhs) = default;
+
+	// Replaces the block with one of at least capacity bytes.  Invalidates every
+	// pointer handed out so far.
+	void Reserve(size_t capacity);
+
+	// Returns bytes aligned to alignment (a power of two), or nullptr if the block is full.
+	void* Allocate(size_t bytes, size_t alignment);
+
+	// Uninitialized storage for count objects of T.  Only meant for trivially
+	// constructible types; no constructors or destructors are run.
+	template<typename T>
+	T* Allocate(size_t count)
+	{
+		return static_cast<T*>(Allocate(count*sizeof(T), alignof(T)));
+	}
+
+	void Reset() { mUsed = 0; }
+
+	size_t Capacity()const { return mCapacity; }
+	size_t Used()const { return mUsed; }
+
+	// Largest Used() seen since the block was reserved; useful for sizing.
+	size_t HighWater()const { return mHighWater; }
+
+private:
+	std::unique_ptr<std::uint8_t[]> mBlock;
+	size_t mCapacity = 0;
+	size_t mUsed = 0;
+	size_t mHighWater = 0;
+};
@@ -0,0 +1,176 @@
+//***************************************************************************************
+// MappedFile.cpp
+//***************************************************************************************
+
+#include "MappedFile.h"
+#include <utility>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& rhs)
+{
+	*this = std::move(rhs);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs)
+{
+	if(this != &rhs)
+	{
+		Close();
+
+		mData = rhs.mData;
+		mSize = rhs.mSize;
+		mIsOpen = rhs.mIsOpen;
+#if defined(_WIN32)
+		mFileHandle = rhs.mFileHandle;
+		mMappingHandle = rhs.mMappingHandle;
+		rhs.mFileHandle = nullptr;
+		rhs.mMappingHandle = nullptr;
+#endif
+		rhs.mData = nullptr;
+		rhs.mSize = 0;
+		rhs.mIsOpen = false;
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	return MapFileHandle(file);
+}
+
+bool MappedFile::Open(const std::wstring& filename)
+{
+	Close();
+
+	HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	return MapFileHandle(file);
+}
+
+// Takes ownership of file.
+bool MappedFile::MapFileHandle(void* file)
+{
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx((HANDLE)file, &size))
+	{
+		CloseHandle((HANDLE)file);
+		return false;
+	}
+
+	mFileHandle = file;
+	mSize = (std::uint64_t)size.QuadPart;
+	mIsOpen = true;
+
+	// CreateFileMapping fails on zero-length files; treat them as empty mappings.
+	if(mSize == 0)
+		return true;
+
+	mMappingHandle = CreateFileMappingA((HANDLE)file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mMappingHandle == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	mData = (const std::uint8_t*)MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if(mData == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(mData)
+		UnmapViewOfFile(mData);
+	if(mMappingHandle)
+		CloseHandle((HANDLE)mMappingHandle);
+	if(mFileHandle)
+		CloseHandle((HANDLE)mFileHandle);
+
+	mData = nullptr;
+	mMappingHandle = nullptr;
+	mFileHandle = nullptr;
+	mSize = 0;
+	mIsOpen = false;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	mSize = (std::uint64_t)st.st_size;
+	mIsOpen = true;
+
+	if(mSize > 0)
+	{
+		void* p = mmap(nullptr, (size_t)mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(p == MAP_FAILED)
+		{
+			close(fd);
+			Close();
+			return false;
+		}
+		mData = (const std::uint8_t*)p;
+	}
+
+	// The mapping stays valid after the descriptor is closed.
+	close(fd);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(mData)
+		munmap((void*)mData, (size_t)mSize);
+
+	mData = nullptr;
+	mSize = 0;
+	mIsOpen = false;
+}
+
+#endif
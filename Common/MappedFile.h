@@ -0,0 +1,47 @@
+//***************************************************************************************
+// MappedFile.h
+//
+// Read-only memory mapping of a whole file.  Loaders hand out pointers into the mapping
+// instead of reading the file into a heap buffer first.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+	MappedFile(MappedFile&& rhs);
+	MappedFile& operator=(MappedFile&& rhs);
+	~MappedFile();
+
+	// Maps filename.  Returns false if the file cannot be opened or mapped.
+	// Empty files open successfully with Data() == nullptr and Size() == 0.
+	bool Open(const std::string& filename);
+#if defined(_WIN32)
+	bool Open(const std::wstring& filename);
+#endif
+	void Close();
+
+	bool IsOpen()const { return mIsOpen; }
+	const std::uint8_t* Data()const { return mData; }
+	std::uint64_t Size()const { return mSize; }
+
+private:
+	const std::uint8_t* mData = nullptr;
+	std::uint64_t mSize = 0;
+	bool mIsOpen = false;
+
+#if defined(_WIN32)
+	bool MapFileHandle(void* file);
+
+	void* mFileHandle = nullptr;
+	void* mMappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,362 @@
+//***************************************************************************************
+// MeshCache.cpp
+//***************************************************************************************
+
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t MeshFileMagic = 0x4853454D; // "MESH"
+	const std::uint32_t MeshFileVersion = 2;
+	const std::uint64_t MeshSectionAlignment = 16;
+
+	struct MeshFileHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Version;
+		std::uint32_t VertexCount;
+		std::uint32_t IndexCount;
+
+		// Size and modification time of the text file the cache was built from.
+		std::uint64_t SourceSize;
+		std::int64_t SourceTime;
+
+		XMFLOAT3 BoundsCenter;
+		XMFLOAT3 BoundsExtents;
+
+		std::uint64_t PositionsOffset;
+		std::uint64_t NormalsOffset;
+		std::uint64_t TexCoordsOffset;
+		std::uint64_t IndicesOffset;
+	};
+
+	std::uint64_t AlignUp(std::uint64_t x)
+	{
+		return (x + MeshSectionAlignment - 1) & ~(MeshSectionAlignment - 1);
+	}
+
+	bool GetSourceStamp(const std::string& filename, std::uint64_t& size, std::int64_t& time)
+	{
+		struct stat st;
+		if(stat(filename.c_str(), &st) != 0)
+			return false;
+
+		size = (std::uint64_t)st.st_size;
+		time = (std::int64_t)st.st_mtime;
+		return true;
+	}
+
+	// Cursor over the text file.  The buffer is null terminated, so strtof/strtoul
+	// always stop inside it.
+	struct TextCursor
+	{
+		const char* P;
+		bool Failed = false;
+
+		void SkipToken()
+		{
+			while(*P == ' ' || *P == '\t' || *P == '\r' || *P == '\n') ++P;
+			if(*P == '\0') { Failed = true; return; }
+			while(*P && *P != ' ' && *P != '\t' && *P != '\r' && *P != '\n') ++P;
+		}
+
+		float ReadFloat()
+		{
+			char* end = nullptr;
+			float f = std::strtof(P, &end);
+			if(end == P) Failed = true;
+			P = end;
+			return f;
+		}
+
+		std::uint32_t ReadUInt()
+		{
+			char* end = nullptr;
+			unsigned long u = std::strtoul(P, &end, 10);
+			if(end == P) Failed = true;
+			P = end;
+			return (std::uint32_t)u;
+		}
+	};
+}
+
+bool MeshCache::Load(const std::string& textFilename)
+{
+	std::string cacheFilename = CacheFilename(textFilename);
+
+	if(LoadBinary(cacheFilename) && IsCacheCurrent(textFilename))
+		return true;
+
+	if(!LoadText(textFilename))
+		return false;
+
+	// A failed write only costs the next launch another text parse.
+	WriteBinary(cacheFilename, textFilename);
+	return true;
+}
+
+bool MeshCache::LoadText(const std::string& textFilename, bool optimize)
+{
+	Reset();
+
+	std::ifstream fin(textFilename, std::ios::binary);
+	if(!fin)
+		return false;
+
+	fin.seekg(0, std::ios::end);
+	std::streamoff length = fin.tellg();
+	fin.seekg(0, std::ios::beg);
+
+	std::string text((size_t)length, '\0');
+	fin.read(&text[0], length);
+	fin.close();
+
+	TextCursor cur;
+	cur.P = text.c_str();
+
+	cur.SkipToken();                      // VertexCount:
+	std::uint32_t vcount = cur.ReadUInt();
+	cur.SkipToken();                      // TriangleCount:
+	std::uint32_t tcount = cur.ReadUInt();
+	for(int i = 0; i < 4; ++i)            // VertexList (pos, normal) {
+		cur.SkipToken();
+
+	if(cur.Failed)
+		return false;
+
+	mTextPositions.resize(vcount);
+	mTextNormals.resize(vcount);
+	mTextTexCoords.resize(vcount);
+
+	XMFLOAT3 vMin(+INFINITY, +INFINITY, +INFINITY);
+	XMFLOAT3 vMax(-INFINITY, -INFINITY, -INFINITY);
+
+	for(std::uint32_t i = 0; i < vcount; ++i)
+	{
+		XMFLOAT3& p = mTextPositions[i];
+		XMFLOAT3& n = mTextNormals[i];
+		p.x = cur.ReadFloat(); p.y = cur.ReadFloat(); p.z = cur.ReadFloat();
+		n.x = cur.ReadFloat(); n.y = cur.ReadFloat(); n.z = cur.ReadFloat();
+
+		// Project point onto unit sphere and generate spherical texture coordinates.
+		float len = std::sqrt(p.x*p.x + p.y*p.y + p.z*p.z);
+		float invLen = len > 0.0f ? 1.0f / len : 0.0f;
+
+		float theta = atan2f(p.z*invLen, p.x*invLen);
+
+		// Put in [0, 2pi].
+		if(theta < 0.0f)
+			theta += XM_2PI;
+
+		float phi = acosf(p.y*invLen);
+
+		mTextTexCoords[i] = XMFLOAT2(theta / (2.0f*XM_PI), phi / XM_PI);
+
+		vMin = XMFLOAT3(fminf(vMin.x, p.x), fminf(vMin.y, p.y), fminf(vMin.z, p.z));
+		vMax = XMFLOAT3(fmaxf(vMax.x, p.x), fmaxf(vMax.y, p.y), fmaxf(vMax.z, p.z));
+	}
+
+	for(int i = 0; i < 3; ++i)            // } TriangleList {
+		cur.SkipToken();
+
+	mTextIndices.resize(3 * (size_t)tcount);
+	for(size_t i = 0; i < mTextIndices.size(); ++i)
+		mTextIndices[i] = cur.ReadUInt();
+
+	if(cur.Failed)
+	{
+		Reset();
+		return false;
+	}
+
+	for(std::uint32_t index : mTextIndices)
+	{
+		if(index >= vcount)
+		{
+			Reset();
+			return false;
+		}
+	}
+
+	if(optimize && !mTextIndices.empty())
+	{
+		std::vector<std::uint32_t> clusterStarts;
+		OptimizeVertexCache(mTextIndices.data(), mTextIndices.size(), vcount, 16, &clusterStarts);
+		OptimizeOverdraw(mTextIndices.data(), mTextIndices.size(), mTextPositions.data(), sizeof(XMFLOAT3), clusterStarts);
+
+		std::vector<std::uint32_t> remap;
+		vcount = OptimizeVertexFetch(mTextIndices.data(), mTextIndices.size(), vcount, remap);
+		RemapVertices(mTextPositions, remap, vcount);
+		RemapVertices(mTextNormals, remap, vcount);
+		RemapVertices(mTextTexCoords, remap, vcount);
+	}
+
+	mVertexCount = vcount;
+	mIndexCount = (std::uint32_t)mTextIndices.size();
+	mPositions = mTextPositions.data();
+	mNormals = mTextNormals.data();
+	mTexCoords = mTextTexCoords.data();
+	mIndices = mTextIndices.data();
+
+	if(vcount > 0)
+	{
+		mBounds.Center = XMFLOAT3(0.5f*(vMin.x + vMax.x), 0.5f*(vMin.y + vMax.y), 0.5f*(vMin.z + vMax.z));
+		mBounds.Extents = XMFLOAT3(0.5f*(vMax.x - vMin.x), 0.5f*(vMax.y - vMin.y), 0.5f*(vMax.z - vMin.z));
+	}
+
+	return true;
+}
+
+bool MeshCache::LoadBinary(const std::string& binFilename)
+{
+	Reset();
+
+	if(!mFile.Open(binFilename))
+		return false;
+
+	const std::uint8_t* base = mFile.Data();
+	const std::uint64_t fileSize = mFile.Size();
+
+	MeshFileHeader header;
+	if(fileSize < sizeof(header))
+	{
+		Reset();
+		return false;
+	}
+	std::memcpy(&header, base, sizeof(header));
+
+	if(header.Magic != MeshFileMagic || header.Version != MeshFileVersion)
+	{
+		Reset();
+		return false;
+	}
+
+	auto sectionFits = [fileSize](std::uint64_t offset, std::uint64_t bytes)
+	{
+		return offset % MeshSectionAlignment == 0 && offset <= fileSize && bytes <= fileSize - offset;
+	};
+
+	const std::uint64_t vcount = header.VertexCount;
+	const std::uint64_t icount = header.IndexCount;
+	if(!sectionFits(header.PositionsOffset, vcount*sizeof(XMFLOAT3)) ||
+	   !sectionFits(header.NormalsOffset, vcount*sizeof(XMFLOAT3)) ||
+	   !sectionFits(header.TexCoordsOffset, vcount*sizeof(XMFLOAT2)) ||
+	   !sectionFits(header.IndicesOffset, icount*sizeof(std::uint32_t)))
+	{
+		Reset();
+		return false;
+	}
+
+	const std::uint32_t* indices = reinterpret_cast<const std::uint32_t*>(base + header.IndicesOffset);
+	for(std::uint64_t i = 0; i < icount; ++i)
+	{
+		if(indices[i] >= header.VertexCount)
+		{
+			Reset();
+			return false;
+		}
+	}
+
+	mVertexCount = header.VertexCount;
+	mIndexCount = header.IndexCount;
+	mPositions = reinterpret_cast<const XMFLOAT3*>(base + header.PositionsOffset);
+	mNormals = reinterpret_cast<const XMFLOAT3*>(base + header.NormalsOffset);
+	mTexCoords = reinterpret_cast<const XMFLOAT2*>(base + header.TexCoordsOffset);
+	mIndices = indices;
+	mBounds.Center = header.BoundsCenter;
+	mBounds.Extents = header.BoundsExtents;
+
+	return true;
+}
+
+bool MeshCache::WriteBinary(const std::string& binFilename, const std::string& sourceFilename)const
+{
+	MeshFileHeader header = {};
+	header.Magic = MeshFileMagic;
+	header.Version = MeshFileVersion;
+	header.VertexCount = mVertexCount;
+	header.IndexCount = mIndexCount;
+	header.BoundsCenter = mBounds.Center;
+	header.BoundsExtents = mBounds.Extents;
+
+	if(!GetSourceStamp(sourceFilename, header.SourceSize, header.SourceTime))
+		return false;
+
+	header.PositionsOffset = AlignUp(sizeof(MeshFileHeader));
+	header.NormalsOffset = AlignUp(header.PositionsOffset + mVertexCount*sizeof(XMFLOAT3));
+	header.TexCoordsOffset = AlignUp(header.NormalsOffset + mVertexCount*sizeof(XMFLOAT3));
+	header.IndicesOffset = AlignUp(header.TexCoordsOffset + mVertexCount*sizeof(XMFLOAT2));
+
+	std::ofstream fout(binFilename, std::ios::binary | std::ios::trunc);
+	if(!fout)
+		return false;
+
+	std::uint64_t written = 0;
+	auto writeSection = [&](std::uint64_t offset, const void* data, std::uint64_t bytes)
+	{
+		static const char zeros[MeshSectionAlignment] = {};
+		fout.write(zeros, (std::streamsize)(offset - written));
+		fout.write((const char*)data, (std::streamsize)bytes);
+		written = offset + bytes;
+	};
+
+	writeSection(0, &header, sizeof(header));
+	writeSection(header.PositionsOffset, mPositions, mVertexCount*sizeof(XMFLOAT3));
+	writeSection(header.NormalsOffset, mNormals, mVertexCount*sizeof(XMFLOAT3));
+	writeSection(header.TexCoordsOffset, mTexCoords, mVertexCount*sizeof(XMFLOAT2));
+	writeSection(header.IndicesOffset, mIndices, mIndexCount*sizeof(std::uint32_t));
+
+	return (bool)fout;
+}
+
+std::string MeshCache::CacheFilename(const std::string& textFilename)
+{
+	size_t dot = textFilename.find_last_of('.');
+	size_t slash = textFilename.find_last_of("/\\");
+	if(dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return textFilename + ".mesh";
+
+	return textFilename.substr(0, dot) + ".mesh";
+}
+
+void MeshCache::Reset()
+{
+	mFile.Close();
+	mTextPositions.clear();
+	mTextNormals.clear();
+	mTextTexCoords.clear();
+	mTextIndices.clear();
+
+	mVertexCount = 0;
+	mIndexCount = 0;
+	mPositions = nullptr;
+	mNormals = nullptr;
+	mTexCoords = nullptr;
+	mIndices = nullptr;
+	mBounds = BoundingBox();
+}
+
+bool MeshCache::IsCacheCurrent(const std::string& textFilename)const
+{
+	std::uint64_t size = 0;
+	std::int64_t time = 0;
+	if(!GetSourceStamp(textFilename, size, time))
+	{
+		// No text file to compare against; a cache on its own is still usable.
+		return true;
+	}
+
+	// Only called after LoadBinary succeeded, so the header is known to be in the mapping.
+	MeshFileHeader header;
+	std::memcpy(&header, mFile.Data(), sizeof(header));
+
+	return header.SourceSize == size && header.SourceTime == time;
+}
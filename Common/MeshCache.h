@@ -0,0 +1,90 @@
+//***************************************************************************************
+// MeshCache.h
+//
+// Loads the text models used by the demos (Models/skull.txt, Models/car.txt) through a
+// binary cache.  The first load parses the text file and writes "<name>.mesh" next to it;
+// later loads map the binary file and hand out pointers straight into the mapping.
+// Parsed meshes are run through MeshOptimizer before they are cached, so the cached
+// triangle and vertex order is already tuned for the GPU's vertex cache.
+//
+// Binary layout (little endian, every section 16-byte aligned):
+//     MeshFileHeader
+//     XMFLOAT3 positions[VertexCount]
+//     XMFLOAT3 normals[VertexCount]
+//     XMFLOAT2 texcoords[VertexCount]   (spherical mapping, as the demos compute it)
+//     uint32   indices[IndexCount]
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+class MeshCache
+{
+public:
+	MeshCache() = default;
+	MeshCache(const MeshCache& rhs) = delete;
+	MeshCache& operator=(const MeshCache& rhs) = delete;
+
+	// Loads textFilename, going through its binary cache when the cache is up to date.
+	// A missing or stale cache is rebuilt from the text file.  Returns false only if the
+	// text file is needed and cannot be read.
+	bool Load(const std::string& textFilename);
+
+	// Parses a text model.  The mesh is kept in heap memory owned by this object.  With
+	// optimize set the triangles and vertices are reordered (see MeshOptimizer.h) and
+	// vertices no triangle uses are dropped.  Fails on an index past the vertex count.
+	bool LoadText(const std::string& textFilename, bool optimize = true);
+
+	// Maps a binary cache file.  Fails if the file is missing, from another format
+	// version, has a section outside the file or an index past the vertex count.
+	bool LoadBinary(const std::string& binFilename);
+
+	// Writes the loaded mesh in the binary format, stamped with the size and modification
+	// time of sourceFilename so Load can tell when the cache is stale.
+	bool WriteBinary(const std::string& binFilename, const std::string& sourceFilename)const;
+
+	// "Models/skull.txt" -> "Models/skull.mesh".
+	static std::string CacheFilename(const std::string& textFilename);
+
+	std::uint32_t VertexCount()const { return mVertexCount; }
+	std::uint32_t IndexCount()const { return mIndexCount; }
+
+	const DirectX::XMFLOAT3* Positions()const { return mPositions; }
+	const DirectX::XMFLOAT3* Normals()const { return mNormals; }
+	const DirectX::XMFLOAT2* TexCoords()const { return mTexCoords; }
+	const std::uint32_t* Indices()const { return mIndices; }
+
+	const DirectX::BoundingBox& Bounds()const { return mBounds; }
+
+	// True when the arrays point into a mapped cache file rather than parsed data.
+	bool IsMapped()const { return mFile.IsOpen(); }
+
+private:
+	void Reset();
+	// True if the mapped cache was built from textFilename as it is on disk now.
+	bool IsCacheCurrent(const std::string& textFilename)const;
+
+private:
+	std::uint32_t mVertexCount = 0;
+	std::uint32_t mIndexCount = 0;
+
+	const DirectX::XMFLOAT3* mPositions = nullptr;
+	const DirectX::XMFLOAT3* mNormals = nullptr;
+	const DirectX::XMFLOAT2* mTexCoords = nullptr;
+	const std::uint32_t* mIndices = nullptr;
+
+	DirectX::BoundingBox mBounds;
+
+	// Backing storage for whichever path loaded the mesh.
+	MappedFile mFile;
+	std::vector<DirectX::XMFLOAT3> mTextPositions;
+	std::vector<DirectX::XMFLOAT3> mTextNormals;
+	std::vector<DirectX::XMFLOAT2> mTextTexCoords;
+	std::vector<std::uint32_t> mTextIndices;
+};
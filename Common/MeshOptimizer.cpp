@@ -0,0 +1,284 @@
+//***************************************************************************************
+// MeshOptimizer.cpp
+//***************************************************************************************
+
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+using namespace DirectX;
+
+VertexCacheStats AnalyzeVertexCache(const std::uint32_t* indices, std::size_t indexCount,
+	std::uint32_t vertexCount, std::uint32_t cacheSize)
+{
+	VertexCacheStats stats;
+	if(indexCount < 3)
+		return stats;
+
+	// A vertex is in the FIFO if fewer than cacheSize misses happened since it was
+	// loaded.  loadedAt holds the miss count after its load, 0 for never loaded.
+	std::vector<std::uint32_t> loadedAt(vertexCount, 0);
+	std::uint32_t misses = 0;
+	std::uint32_t used = 0;
+
+	for(std::size_t i = 0; i < indexCount; ++i)
+	{
+		std::uint32_t v = indices[i];
+		if(loadedAt[v] == 0)
+			++used;
+
+		if(loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize)
+			loadedAt[v] = ++misses;
+	}
+
+	stats.Acmr = (float)misses / (float)(indexCount / 3);
+	stats.Atvr = (float)misses / (float)used;
+	return stats;
+}
+
+void OptimizeVertexCache(std::uint32_t* indices, std::size_t indexCount, std::uint32_t vertexCount,
+	std::uint32_t cacheSize, std::vector<std::uint32_t>* clusterStarts)
+{
+	const std::uint32_t triCount = (std::uint32_t)(indexCount / 3);
+
+	if(clusterStarts != nullptr)
+		clusterStarts->clear();
+	if(triCount == 0)
+		return;
+
+	// Triangles around each vertex, as offsets into one array.  live counts the ones
+	// not emitted yet.
+	std::vector<std::uint32_t> live(vertexCount, 0);
+	for(std::size_t i = 0; i < 3*(std::size_t)triCount; ++i)
+		++live[indices[i]];
+
+	std::vector<std::uint32_t> firstAdjacent(vertexCount + 1, 0);
+	for(std::uint32_t v = 0; v < vertexCount; ++v)
+		firstAdjacent[v + 1] = firstAdjacent[v] + live[v];
+
+	std::vector<std::uint32_t> adjacent(3*(std::size_t)triCount);
+	{
+		std::vector<std::uint32_t> fill(firstAdjacent.begin(), firstAdjacent.end() - 1);
+		for(std::uint32_t t = 0; t < triCount; ++t)
+		{
+			for(int k = 0; k < 3; ++k)
+				adjacent[fill[indices[3*t + k]]++] = t;
+		}
+	}
+
+	std::vector<std::uint32_t> output;
+	output.reserve(3*(std::size_t)triCount);
+
+	std::vector<std::uint32_t> cachedAt(vertexCount, 0);
+	std::vector<std::uint8_t> emitted(triCount, 0);
+	std::vector<std::uint32_t> deadEnds;
+	std::vector<std::uint32_t> candidates;
+	deadEnds.reserve(3*(std::size_t)triCount);
+
+	const std::uint32_t None = 0xffffffff;
+
+	// time counts cache loads, so a vertex loaded at cachedAt[v] is still cached while
+	// time - cachedAt[v] <= cacheSize.
+	std::uint32_t time = cacheSize + 1;
+	std::uint32_t scan = 0;
+	std::uint32_t fan = indices[0];
+
+	if(clusterStarts != nullptr)
+		clusterStarts->push_back(0);
+
+	while(fan != None)
+	{
+		// Emit every remaining triangle around the fanning vertex.
+		candidates.clear();
+		for(std::uint32_t a = firstAdjacent[fan]; a < firstAdjacent[fan + 1]; ++a)
+		{
+			std::uint32_t t = adjacent[a];
+			if(emitted[t])
+				continue;
+
+			for(int k = 0; k < 3; ++k)
+			{
+				std::uint32_t v = indices[3*t + k];
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				--live[v];
+
+				if(time - cachedAt[v] > cacheSize)
+					cachedAt[v] = time++;
+			}
+			emitted[t] = 1;
+		}
+
+		// Next fan around the candidate that has been in the cache longest but will still
+		// be there after its remaining triangles are emitted.
+		std::uint32_t next = None;
+		std::int64_t bestPriority = -1;
+		for(std::uint32_t v : candidates)
+		{
+			if(live[v] == 0)
+				continue;
+
+			std::int64_t priority = 0;
+			if(time - cachedAt[v] + 2*live[v] <= cacheSize)
+				priority = time - cachedAt[v];
+
+			if(priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		if(next == None)
+		{
+			// Dead end: go back to a recently used vertex with triangles left, or failing
+			// that to the first such vertex in index order.
+			while(!deadEnds.empty() && next == None)
+			{
+				std::uint32_t v = deadEnds.back();
+				deadEnds.pop_back();
+				if(live[v] > 0)
+					next = v;
+			}
+
+			while(scan < vertexCount && next == None)
+			{
+				if(live[scan] > 0)
+					next = scan;
+				else
+					++scan;
+			}
+
+			if(next != None && clusterStarts != nullptr)
+				clusterStarts->push_back((std::uint32_t)(output.size() / 3));
+		}
+
+		fan = next;
+	}
+
+	// Tipsify is greedy, so a mesh that was already well ordered can come out slightly
+	// worse.  Keep the input then, as one cluster.
+	if(AnalyzeVertexCache(output.data(), output.size(), vertexCount, cacheSize).Acmr >=
+	   AnalyzeVertexCache(indices, 3*(std::size_t)triCount, vertexCount, cacheSize).Acmr)
+	{
+		if(clusterStarts != nullptr)
+			clusterStarts->assign(1, 0);
+		return;
+	}
+
+	std::memcpy(indices, output.data(), output.size()*sizeof(std::uint32_t));
+}
+
+void OptimizeOverdraw(std::uint32_t* indices, std::size_t indexCount, const XMFLOAT3* positions,
+	std::size_t positionStride, const std::vector<std::uint32_t>& clusterStarts)
+{
+	const std::uint32_t triCount = (std::uint32_t)(indexCount / 3);
+	const std::uint32_t clusterCount = (std::uint32_t)clusterStarts.size();
+	if(clusterCount < 2)
+		return;
+
+	auto position = [positions, positionStride](std::uint32_t v)
+	{
+		return XMLoadFloat3((const XMFLOAT3*)((const char*)positions + v*positionStride));
+	};
+
+	// Area weighted centroid and summed normal of each cluster.  The cross product of
+	// two edges has twice the triangle's area as its length and points out of the front
+	// face for clockwise winding.
+	std::vector<XMFLOAT3> clusterCentroids(clusterCount);
+	std::vector<XMFLOAT3> clusterNormals(clusterCount);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+
+	for(std::uint32_t c = 0; c < clusterCount; ++c)
+	{
+		std::uint32_t end = c + 1 < clusterCount ? clusterStarts[c + 1] : triCount;
+
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+		for(std::uint32_t t = clusterStarts[c]; t < end; ++t)
+		{
+			XMVECTOR p0 = position(indices[3*t + 0]);
+			XMVECTOR p1 = position(indices[3*t + 1]);
+			XMVECTOR p2 = position(indices[3*t + 2]);
+
+			XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			float a = XMVectorGetX(XMVector3Length(n));
+
+			centroid = XMVectorAdd(centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), a / 3.0f));
+			normal = XMVectorAdd(normal, n);
+			area += a;
+		}
+
+		meshCentroid = XMVectorAdd(meshCentroid, centroid);
+		meshArea += area;
+
+		XMStoreFloat3(&clusterCentroids[c], area > 0.0f ? XMVectorScale(centroid, 1.0f / area) : centroid);
+		XMStoreFloat3(&clusterNormals[c], XMVector3Normalize(normal));
+	}
+
+	if(meshArea > 0.0f)
+		meshCentroid = XMVectorScale(meshCentroid, 1.0f / meshArea);
+
+	// How far a cluster faces away from the middle of the mesh.  Clusters on the outside
+	// facing out are the likeliest to hide others, so they go first.
+	std::vector<float> outwardness(clusterCount);
+	for(std::uint32_t c = 0; c < clusterCount; ++c)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&clusterCentroids[c]), meshCentroid);
+		outwardness[c] = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormals[c])));
+	}
+
+	std::vector<std::uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&outwardness](std::uint32_t a, std::uint32_t b)
+	{
+		return outwardness[a] > outwardness[b];
+	});
+
+	std::vector<std::uint32_t> sorted;
+	sorted.reserve(3*(std::size_t)triCount);
+	for(std::uint32_t c : order)
+	{
+		std::uint32_t end = c + 1 < clusterCount ? clusterStarts[c + 1] : triCount;
+		sorted.insert(sorted.end(), indices + 3*(std::size_t)clusterStarts[c], indices + 3*(std::size_t)end);
+	}
+
+	std::memcpy(indices, sorted.data(), sorted.size()*sizeof(std::uint32_t));
+}
+
+std::uint32_t OptimizeVertexFetch(std::uint32_t* indices, std::size_t indexCount, std::uint32_t vertexCount,
+	std::vector<std::uint32_t>& remap)
+{
+	remap.assign(vertexCount, UnusedVertex);
+
+	std::uint32_t next = 0;
+	for(std::size_t i = 0; i < indexCount; ++i)
+	{
+		std::uint32_t& r = remap[indices[i]];
+		if(r == UnusedVertex)
+			r = next++;
+		indices[i] = r;
+	}
+
+	return next;
+}
+
+void OptimizeMesh(GeometryGenerator::MeshData& meshData, std::uint32_t cacheSize)
+{
+	auto& indices = meshData.Indices32;
+	auto& vertices = meshData.Vertices;
+	if(indices.empty())
+		return;
+
+	std::vector<std::uint32_t> clusterStarts;
+	OptimizeVertexCache(indices.data(), indices.size(), (std::uint32_t)vertices.size(), cacheSize, &clusterStarts);
+	OptimizeOverdraw(indices.data(), indices.size(), &vertices[0].Position, sizeof(GeometryGenerator::Vertex), clusterStarts);
+
+	std::vector<std::uint32_t> remap;
+	std::uint32_t used = OptimizeVertexFetch(indices.data(), indices.size(), (std::uint32_t)vertices.size(), remap);
+	RemapVertices(vertices, remap, used);
+}
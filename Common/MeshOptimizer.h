@@ -0,0 +1,69 @@
+//***************************************************************************************
+// MeshOptimizer.h
+//
+// Reorders indexed triangle lists for the GPU.  Three passes, run in this order:
+//
+//   1. OptimizeVertexCache orders triangles for the post-transform vertex cache (Tipsify,
+//      Sander et al. 2007) and marks where it had to jump to a far away triangle.
+//   2. OptimizeOverdraw sorts the runs between those jumps so the ones facing outward
+//      from the mesh center draw first, which lets early depth testing reject more of
+//      the rest.  Only whole runs move, so the cache order inside each run is kept.
+//   3. OptimizeVertexFetch renumbers vertices in the order the indices first use them,
+//      so vertex fetches walk the buffer forward.
+//
+// AnalyzeVertexCache measures the result with a FIFO cache model: ACMR is vertices
+// transformed per triangle (0.5 is the floor for large regular meshes, 3 the worst) and
+// ATVR is vertices transformed per vertex used (1 is perfect).
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GeometryGenerator.h"
+
+struct VertexCacheStats
+{
+	float Acmr = 0.0f;
+	float Atvr = 0.0f;
+};
+
+// Simulates a FIFO post-transform cache of cacheSize entries over the triangle list.
+VertexCacheStats AnalyzeVertexCache(const std::uint32_t* indices, std::size_t indexCount,
+	std::uint32_t vertexCount, std::uint32_t cacheSize = 16);
+
+// Reorders the triangles of indices in place, unless the input order already has the
+// lower ACMR.  If clusterStarts is not null it receives the first triangle of every run
+// that starts with a jump, beginning with 0.
+void OptimizeVertexCache(std::uint32_t* indices, std::size_t indexCount, std::uint32_t vertexCount,
+	std::uint32_t cacheSize = 16, std::vector<std::uint32_t>* clusterStarts = nullptr);
+
+// Reorders whole clusters of triangles in place, outward facing clusters first.
+// Vertex v's position is the XMFLOAT3 positionStride*v bytes past positions.
+void OptimizeOverdraw(std::uint32_t* indices, std::size_t indexCount, const DirectX::XMFLOAT3* positions,
+	std::size_t positionStride, const std::vector<std::uint32_t>& clusterStarts);
+
+// Renumbers the vertices in the order indices first reference them and rewrites indices.
+// remap[old] receives the new index of every vertex, or UnusedVertex for vertices no
+// triangle uses.  Returns the number of used vertices; apply remap with RemapVertices.
+const std::uint32_t UnusedVertex = 0xffffffff;
+std::uint32_t OptimizeVertexFetch(std::uint32_t* indices, std::size_t indexCount, std::uint32_t vertexCount,
+	std::vector<std::uint32_t>& remap);
+
+// Moves vertices[old] to vertices[remap[old]] and drops unused vertices.
+template<typename T>
+void RemapVertices(std::vector<T>& vertices, const std::vector<std::uint32_t>& remap, std::uint32_t usedCount)
+{
+	std::vector<T> remapped(usedCount);
+	for(std::size_t i = 0; i < vertices.size(); ++i)
+	{
+		if(remap[i] != UnusedVertex)
+			remapped[remap[i]] = vertices[i];
+	}
+	vertices.swap(remapped);
+}
+
+// Runs all three passes on a generated mesh.  Call it before GetIndices16.
+void OptimizeMesh(GeometryGenerator::MeshData& meshData, std::uint32_t cacheSize = 16);
@@ -0,0 +1,572 @@
+//***************************************************************************************
+// MeshSimplifier.cpp
+//***************************************************************************************
+
+#include "MeshSimplifier.h"
+#include "MathHelper.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t None = 0xffffffff;
+
+	// Open edges weigh this much more than faces, so borders and seams keep their shape.
+	const double OpenEdgeWeight = 10.0;
+
+	// A LOD chain stops where its error passes this fraction of the mesh's bounding
+	// radius; a coarser LOD would only be picked once the whole mesh covers a few pixels.
+	const float MaxLodRelativeError = 0.1f;
+
+	// A collapse may turn no triangle's normal further than acos(0.25), about 75 degrees.
+	const float MaxNormalTurnCos = 0.25f;
+
+	enum class VertexKind : std::uint8_t
+	{
+		Manifold, // Moves to any neighbor.
+		Border,   // Moves to a neighbor along its open border.
+		Seam,     // Moves along the seam, with its twin on the other side.
+		Locked    // Never moves.
+	};
+
+	// Weighted sum of squared distances to planes, as the symmetric 4x4 matrix
+	// [A b; b^T c].  Error divides by the summed weight, so it is a mean squared distance.
+	struct Quadric
+	{
+		double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+		double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+		double C = 0.0;
+		double W = 0.0;
+
+		// Plane n.p + d = 0 with unit n.
+		void AddPlane(const XMFLOAT3& n, double d, double w)
+		{
+			A00 += w*n.x*n.x; A01 += w*n.x*n.y; A02 += w*n.x*n.z;
+			A11 += w*n.y*n.y; A12 += w*n.y*n.z; A22 += w*n.z*n.z;
+			B0 += w*n.x*d; B1 += w*n.y*d; B2 += w*n.z*d;
+			C += w*d*d;
+			W += w;
+		}
+
+		void Add(const Quadric& q)
+		{
+			A00 += q.A00; A01 += q.A01; A02 += q.A02;
+			A11 += q.A11; A12 += q.A12; A22 += q.A22;
+			B0 += q.B0; B1 += q.B1; B2 += q.B2;
+			C += q.C;
+			W += q.W;
+		}
+
+		double Error(const XMFLOAT3& p)const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double e = A00*x*x + A11*y*y + A22*z*z + 2.0*(A01*x*y + A02*x*z + A12*y*z) +
+				2.0*(B0*x + B1*y + B2*z) + C;
+			return W > 0.0 ? MathHelper::Max(e, 0.0) / W : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		double Cost;
+		std::uint32_t From;
+		std::uint32_t To;
+	};
+
+	class Simplifier
+	{
+	public:
+		Simplifier(const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+			const std::uint32_t* indices, std::size_t indexCount);
+
+		// Runs collapse passes until the mesh is down to targetIndexCount indices, no
+		// collapse is allowed, or the cheapest costs more than maxCost.
+		void Run(std::size_t targetIndexCount, double maxCost);
+
+		const std::vector<std::uint32_t>& Indices()const { return mIndices; }
+		double Cost()const { return mCost; }
+
+	private:
+		const XMFLOAT3& Position(std::uint32_t v)const
+		{
+			return *(const XMFLOAT3*)((const char*)mPositions + v*mPositionStride);
+		}
+
+		void WeldPositions();
+		void AddQuadrics();
+		void BuildAdjacency();
+		void ClassifyVertices();
+
+		// The other live wedge of a seam vertex, and where it goes if v goes to w.
+		void SeamTwin(std::uint32_t v, std::uint32_t w, std::uint32_t& twin, std::uint32_t& twinTo)const;
+
+		bool Flips(std::uint32_t v, std::uint32_t w)const;
+		void Touch(std::uint32_t v);
+		std::uint32_t TrianglesLost(std::uint32_t v, std::uint32_t w)const;
+
+		const XMFLOAT3* mPositions;
+		std::size_t mPositionStride;
+		std::uint32_t mVertexCount;
+
+		std::vector<std::uint32_t> mIndices;
+
+		// Vertices at the same position share a position id and are linked in a ring by
+		// mNextWedge.  Quadrics are kept per position.
+		std::vector<std::uint32_t> mPositionId;
+		std::vector<std::uint32_t> mNextWedge;
+		std::vector<Quadric> mQuadrics;
+
+		// Per pass: the current triangles around each vertex, the corners 3*t+k whose
+		// edge to the next corner of triangle t is open, and each vertex's single open
+		// edge out and in, or None.
+		std::vector<std::uint32_t> mFirstAdjacent;
+		std::vector<std::uint32_t> mAdjacent;
+		std::vector<std::uint32_t> mOpenCorners;
+		std::vector<std::uint32_t> mOpenOut;
+		std::vector<std::uint32_t> mOpenIn;
+		std::vector<VertexKind> mKind;
+		std::vector<std::uint8_t> mTouched;
+
+		double mCost = 0.0;
+	};
+
+	Simplifier::Simplifier(const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+		const std::uint32_t* indices, std::size_t indexCount) :
+		mPositions(positions),
+		mPositionStride(positionStride),
+		mVertexCount(vertexCount),
+		mIndices(indices, indices + 3*(indexCount / 3))
+	{
+		WeldPositions();
+		BuildAdjacency();
+		ClassifyVertices();
+		AddQuadrics();
+	}
+
+	void Simplifier::WeldPositions()
+	{
+		std::vector<std::uint32_t> order(mVertexCount);
+		std::iota(order.begin(), order.end(), 0u);
+		std::sort(order.begin(), order.end(), [this](std::uint32_t a, std::uint32_t b)
+		{
+			const XMFLOAT3& pa = Position(a);
+			const XMFLOAT3& pb = Position(b);
+			if(pa.x != pb.x) return pa.x < pb.x;
+			if(pa.y != pb.y) return pa.y < pb.y;
+			if(pa.z != pb.z) return pa.z < pb.z;
+			return a < b;
+		});
+
+		mPositionId.resize(mVertexCount);
+		mNextWedge.resize(mVertexCount);
+
+		std::uint32_t positionCount = 0;
+		for(std::uint32_t i = 0; i < mVertexCount; )
+		{
+			const XMFLOAT3& p = Position(order[i]);
+			std::uint32_t end = i + 1;
+			while(end < mVertexCount && Position(order[end]).x == p.x &&
+				  Position(order[end]).y == p.y && Position(order[end]).z == p.z)
+				++end;
+
+			for(std::uint32_t k = i; k < end; ++k)
+			{
+				mPositionId[order[k]] = positionCount;
+				mNextWedge[order[k]] = order[k + 1 < end ? k + 1 : i];
+			}
+
+			++positionCount;
+			i = end;
+		}
+
+		mQuadrics.resize(positionCount);
+	}
+
+	void Simplifier::AddQuadrics()
+	{
+		auto faceNormal = [this](std::size_t t)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&Position(mIndices[3*t + 0]));
+			XMVECTOR p1 = XMLoadFloat3(&Position(mIndices[3*t + 1]));
+			XMVECTOR p2 = XMLoadFloat3(&Position(mIndices[3*t + 2]));
+			return XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		};
+
+		// Face planes, weighted by area.
+		for(std::size_t t = 0; t < mIndices.size() / 3; ++t)
+		{
+			XMVECTOR n = faceNormal(t);
+			float length = XMVectorGetX(XMVector3Length(n));
+			if(length == 0.0f)
+				continue;
+
+			n = XMVectorScale(n, 1.0f / length);
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, n);
+			double d = -XMVectorGetX(XMVector3Dot(n, XMLoadFloat3(&Position(mIndices[3*t]))));
+			for(int k = 0; k < 3; ++k)
+				mQuadrics[mPositionId[mIndices[3*t + k]]].AddPlane(normal, d, 0.5*length);
+		}
+
+		// Open edges also keep a plane through the edge at right angles to the face,
+		// weighted by the squared edge length.
+		for(std::uint32_t corner : mOpenCorners)
+		{
+			std::uint32_t t = corner / 3;
+			std::uint32_t a = mIndices[corner];
+			std::uint32_t b = mIndices[3*t + (corner % 3 + 1) % 3];
+
+			XMVECTOR pa = XMLoadFloat3(&Position(a));
+			XMVECTOR edge = XMVectorSubtract(XMLoadFloat3(&Position(b)), pa);
+			XMVECTOR m = XMVector3Cross(edge, faceNormal(t));
+			float edgeLength = XMVectorGetX(XMVector3Length(edge));
+			if(edgeLength == 0.0f || XMVectorGetX(XMVector3LengthSq(m)) == 0.0f)
+				continue;
+
+			m = XMVector3Normalize(m);
+			XMFLOAT3 edgeNormal;
+			XMStoreFloat3(&edgeNormal, m);
+			double d = -XMVectorGetX(XMVector3Dot(m, pa));
+			double w = OpenEdgeWeight*edgeLength*edgeLength;
+			mQuadrics[mPositionId[a]].AddPlane(edgeNormal, d, w);
+			mQuadrics[mPositionId[b]].AddPlane(edgeNormal, d, w);
+		}
+	}
+
+	void Simplifier::BuildAdjacency()
+	{
+		const std::uint32_t triCount = (std::uint32_t)(mIndices.size() / 3);
+
+		mFirstAdjacent.assign(mVertexCount + 1, 0);
+		for(std::uint32_t v : mIndices)
+			++mFirstAdjacent[v + 1];
+		for(std::uint32_t v = 0; v < mVertexCount; ++v)
+			mFirstAdjacent[v + 1] += mFirstAdjacent[v];
+
+		mAdjacent.resize(mIndices.size());
+		std::vector<std::uint32_t> fill(mFirstAdjacent.begin(), mFirstAdjacent.end() - 1);
+		for(std::uint32_t t = 0; t < triCount; ++t)
+		{
+			for(int k = 0; k < 3; ++k)
+				mAdjacent[fill[mIndices[3*t + k]]++] = t;
+		}
+
+		// A half edge a->b is open if no triangle has b->a.  A vertex with more than one
+		// open edge either way gets Locked, marked here by an open edge to itself.
+		std::vector<std::uint64_t> halfEdges(mIndices.size());
+		for(std::uint32_t t = 0; t < triCount; ++t)
+		{
+			for(int k = 0; k < 3; ++k)
+				halfEdges[3*t + k] = (std::uint64_t)mIndices[3*t + k] << 32 | mIndices[3*t + (k + 1) % 3];
+		}
+		std::vector<std::uint64_t> sortedHalfEdges(halfEdges);
+		std::sort(sortedHalfEdges.begin(), sortedHalfEdges.end());
+
+		mOpenCorners.clear();
+		mOpenOut.assign(mVertexCount, None);
+		mOpenIn.assign(mVertexCount, None);
+		for(std::uint32_t corner = 0; corner < 3*triCount; ++corner)
+		{
+			std::uint32_t a = (std::uint32_t)(halfEdges[corner] >> 32);
+			std::uint32_t b = (std::uint32_t)halfEdges[corner];
+			if(std::binary_search(sortedHalfEdges.begin(), sortedHalfEdges.end(), (std::uint64_t)b << 32 | a))
+				continue;
+
+			mOpenCorners.push_back(corner);
+			mOpenOut[a] = mOpenOut[a] == None ? b : a;
+			mOpenIn[b] = mOpenIn[b] == None ? a : b;
+		}
+	}
+
+	void Simplifier::ClassifyVertices()
+	{
+		mKind.assign(mVertexCount, VertexKind::Locked);
+
+		auto live = [this](std::uint32_t v) { return mFirstAdjacent[v + 1] > mFirstAdjacent[v]; };
+		auto singleOpen = [this](std::uint32_t v)
+		{
+			return mOpenOut[v] != None && mOpenOut[v] != v && mOpenIn[v] != None && mOpenIn[v] != v;
+		};
+
+		for(std::uint32_t v = 0; v < mVertexCount; ++v)
+		{
+			if(!live(v))
+				continue;
+
+			std::uint32_t twin = None;
+			std::uint32_t liveWedges = 1;
+			for(std::uint32_t u = mNextWedge[v]; u != v; u = mNextWedge[u])
+			{
+				if(live(u))
+				{
+					twin = u;
+					++liveWedges;
+				}
+			}
+
+			if(liveWedges == 1)
+			{
+				if(mOpenOut[v] == None && mOpenIn[v] == None)
+					mKind[v] = VertexKind::Manifold;
+				else if(singleOpen(v))
+					mKind[v] = VertexKind::Border;
+			}
+			else if(liveWedges == 2 && singleOpen(v) && singleOpen(twin))
+			{
+				// The seam runs the opposite way on the twin's side.
+				if(mPositionId[mOpenOut[v]] == mPositionId[mOpenIn[twin]] &&
+				   mPositionId[mOpenIn[v]] == mPositionId[mOpenOut[twin]])
+					mKind[v] = VertexKind::Seam;
+			}
+		}
+	}
+
+	void Simplifier::SeamTwin(std::uint32_t v, std::uint32_t w, std::uint32_t& twin, std::uint32_t& twinTo)const
+	{
+		twin = mNextWedge[v];
+		while(mFirstAdjacent[twin + 1] == mFirstAdjacent[twin])
+			twin = mNextWedge[twin];
+
+		twinTo = w == mOpenOut[v] ? mOpenIn[twin] : mOpenOut[twin];
+	}
+
+	bool Simplifier::Flips(std::uint32_t v, std::uint32_t w)const
+	{
+		XMVECTOR pw = XMLoadFloat3(&Position(w));
+
+		for(std::uint32_t a = mFirstAdjacent[v]; a < mFirstAdjacent[v + 1]; ++a)
+		{
+			const std::uint32_t* tri = &mIndices[3*(std::size_t)mAdjacent[a]];
+			if(tri[0] == w || tri[1] == w || tri[2] == w)
+				continue;
+
+			// Rotate so v comes first; the winding is unchanged.
+			int k = tri[0] == v ? 0 : (tri[1] == v ? 1 : 2);
+			XMVECTOR pv = XMLoadFloat3(&Position(v));
+			XMVECTOR p1 = XMLoadFloat3(&Position(tri[(k + 1) % 3]));
+			XMVECTOR p2 = XMLoadFloat3(&Position(tri[(k + 2) % 3]));
+
+			XMVECTOR before = XMVector3Cross(XMVectorSubtract(p1, pv), XMVectorSubtract(p2, pv));
+			XMVECTOR after = XMVector3Cross(XMVectorSubtract(p1, pw), XMVectorSubtract(p2, pw));
+
+			float dot = XMVectorGetX(XMVector3Dot(before, after));
+			float lengths = XMVectorGetX(XMVector3Length(before))*XMVectorGetX(XMVector3Length(after));
+			if(dot < MaxNormalTurnCos*lengths)
+				return true;
+		}
+
+		return false;
+	}
+
+	void Simplifier::Touch(std::uint32_t v)
+	{
+		for(std::uint32_t a = mFirstAdjacent[v]; a < mFirstAdjacent[v + 1]; ++a)
+		{
+			const std::uint32_t* tri = &mIndices[3*(std::size_t)mAdjacent[a]];
+			mTouched[tri[0]] = mTouched[tri[1]] = mTouched[tri[2]] = 1;
+		}
+	}
+
+	std::uint32_t Simplifier::TrianglesLost(std::uint32_t v, std::uint32_t w)const
+	{
+		std::uint32_t lost = 0;
+		for(std::uint32_t a = mFirstAdjacent[v]; a < mFirstAdjacent[v + 1]; ++a)
+		{
+			const std::uint32_t* tri = &mIndices[3*(std::size_t)mAdjacent[a]];
+			if(tri[0] == w || tri[1] == w || tri[2] == w)
+				++lost;
+		}
+		return lost;
+	}
+
+	void Simplifier::Run(std::size_t targetIndexCount, double maxCost)
+	{
+		std::vector<Collapse> collapses;
+		std::vector<std::uint32_t> remap(mVertexCount);
+		bool firstPass = true;
+
+		while(mIndices.size() > targetIndexCount)
+		{
+			if(!firstPass)
+			{
+				BuildAdjacency();
+				ClassifyVertices();
+			}
+			firstPass = false;
+
+			// The cheapest allowed collapse of every vertex.
+			collapses.clear();
+			for(std::uint32_t v = 0; v < mVertexCount; ++v)
+			{
+				VertexKind kind = mKind[v];
+				if(kind == VertexKind::Locked)
+					continue;
+
+				Collapse best = { DBL_MAX, v, None };
+				for(std::uint32_t a = mFirstAdjacent[v]; a < mFirstAdjacent[v + 1]; ++a)
+				{
+					const std::uint32_t* tri = &mIndices[3*(std::size_t)mAdjacent[a]];
+					for(int k = 0; k < 3; ++k)
+					{
+						std::uint32_t w = tri[k];
+						if(w == v)
+							continue;
+
+						// Border and seam vertices only slide along their open edges, and never
+						// onto another wedge at the same position.
+						if(kind != VertexKind::Manifold &&
+						   ((w != mOpenOut[v] && w != mOpenIn[v]) || mPositionId[w] == mPositionId[v]))
+							continue;
+
+						double cost = mQuadrics[mPositionId[v]].Error(Position(w));
+						if(cost < best.Cost)
+						{
+							best.Cost = cost;
+							best.To = w;
+						}
+					}
+				}
+
+				if(best.To != None && best.Cost <= maxCost)
+					collapses.push_back(best);
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+			{
+				return a.Cost < b.Cost || (a.Cost == b.Cost && a.From < b.From);
+			});
+
+			// Take collapses cheapest first until enough triangles go.  A collapse changes
+			// every triangle around its vertex, so the vertices of those triangles sit out
+			// the rest of the pass, which also keeps the flip tests valid.
+			std::iota(remap.begin(), remap.end(), 0u);
+			mTouched.assign(mVertexCount, 0);
+
+			const std::size_t trianglesToRemove = (mIndices.size() - targetIndexCount + 2) / 3;
+			std::size_t trianglesRemoved = 0;
+			std::size_t collapsed = 0;
+
+			for(const Collapse& c : collapses)
+			{
+				if(trianglesRemoved >= trianglesToRemove)
+					break;
+
+				std::uint32_t v = c.From;
+				std::uint32_t w = c.To;
+				if(mTouched[v] || mTouched[w])
+					continue;
+
+				std::uint32_t twin = None, twinTo = None;
+				if(mKind[v] == VertexKind::Seam)
+				{
+					SeamTwin(v, w, twin, twinTo);
+					if(mTouched[twin] || mTouched[twinTo])
+						continue;
+				}
+
+				if(Flips(v, w) || (twin != None && Flips(twin, twinTo)))
+					continue;
+
+				remap[v] = w;
+				trianglesRemoved += TrianglesLost(v, w);
+				Touch(v);
+				if(twin != None)
+				{
+					remap[twin] = twinTo;
+					trianglesRemoved += TrianglesLost(twin, twinTo);
+					Touch(twin);
+				}
+
+				mQuadrics[mPositionId[w]].Add(mQuadrics[mPositionId[v]]);
+				mCost = MathHelper::Max(mCost, c.Cost);
+				++collapsed;
+			}
+
+			if(collapsed == 0)
+				break;
+
+			const std::size_t indexCountBefore = mIndices.size();
+
+			// Remap and drop the triangles that lost an edge.
+			std::size_t kept = 0;
+			for(std::size_t i = 0; i < mIndices.size(); i += 3)
+			{
+				std::uint32_t a = remap[mIndices[i]];
+				std::uint32_t b = remap[mIndices[i + 1]];
+				std::uint32_t c = remap[mIndices[i + 2]];
+				if(a == b || b == c || c == a)
+					continue;
+
+				mIndices[kept++] = a;
+				mIndices[kept++] = b;
+				mIndices[kept++] = c;
+			}
+			mIndices.resize(kept);
+
+			if(kept == indexCountBefore)
+				break;
+		}
+	}
+}
+
+float SimplifyMesh(const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	const std::uint32_t* indices, std::size_t indexCount, std::size_t targetIndexCount, float targetError,
+	std::vector<std::uint32_t>& result)
+{
+	Simplifier simplifier(positions, positionStride, vertexCount, indices, indexCount);
+	simplifier.Run(targetIndexCount, (double)targetError*targetError);
+
+	result = simplifier.Indices();
+	return (float)std::sqrt(simplifier.Cost());
+}
+
+void BuildLodChain(const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	std::vector<std::uint32_t>& indices, std::vector<MeshLod>& lods,
+	std::uint32_t maxLodCount, float triangleRatio)
+{
+	lods.clear();
+
+	MeshLod lod0;
+	lod0.IndexCount = (std::uint32_t)indices.size();
+	lods.push_back(lod0);
+
+	XMFLOAT3 boxMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boxMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for(std::uint32_t i : indices)
+	{
+		const XMFLOAT3& p = *(const XMFLOAT3*)((const char*)positions + i*positionStride);
+		boxMin = XMFLOAT3(MathHelper::Min(boxMin.x, p.x), MathHelper::Min(boxMin.y, p.y), MathHelper::Min(boxMin.z, p.z));
+		boxMax = XMFLOAT3(MathHelper::Max(boxMax.x, p.x), MathHelper::Max(boxMax.y, p.y), MathHelper::Max(boxMax.z, p.z));
+	}
+	const float radius = indices.empty() ? 0.0f :
+		0.5f*XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&boxMax), XMLoadFloat3(&boxMin))));
+	const float maxError = MaxLodRelativeError*radius;
+
+	std::vector<std::uint32_t> simplified;
+	while(lods.size() < maxLodCount)
+	{
+		// Each LOD is simplified from the one before, so its error is bounded by the sum
+		// of the steps.
+		const MeshLod prev = lods.back();
+		std::size_t target = 3*(std::size_t)(prev.IndexCount / 3*triangleRatio);
+
+		float error = SimplifyMesh(positions, positionStride, vertexCount, &indices[prev.StartIndexLocation],
+			prev.IndexCount, target, maxError - prev.Error, simplified);
+
+		// Stop once the mesh will not get meaningfully smaller.
+		if(simplified.empty() || simplified.size() > prev.IndexCount - prev.IndexCount / 8)
+			break;
+
+		MeshLod lod;
+		lod.StartIndexLocation = (std::uint32_t)indices.size();
+		lod.IndexCount = (std::uint32_t)simplified.size();
+		lod.Error = prev.Error + error;
+		lods.push_back(lod);
+
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+	}
+}
@@ -0,0 +1,74 @@
+//***************************************************************************************
+// MeshSimplifier.h
+//
+// Quadric error metric simplification (Garland and Heckbert 1997) of indexed triangle
+// lists, and discrete LOD chains built from it.
+//
+// Every step collapses an edge onto one of its two vertices, so no vertex moves and no
+// vertex is created: a simplified mesh is just a new index list into the original vertex
+// buffer, and a whole LOD chain shares one vertex buffer.
+//
+// Attribute seams are vertices split to carry different normals or texture coordinates
+// at the same position.  A seam vertex only moves along its seam, together with its twin
+// on the other side, so the two sides keep meeting and no cracks open.  Vertices on open
+// borders only move along the border, and vertices where more than two attribute sets
+// meet never move.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Simplifies the triangles of indices to at most targetIndexCount indices, or as close as
+// the mesh allows, and stores them in result.  Stops before a collapse whose error would
+// pass targetError.  Vertex v's position is the XMFLOAT3 positionStride*v bytes past
+// positions.  Returns the error of the result in position units: the largest, over the
+// collapses made, of the root of the quadric error.  That is the weighted mean of the
+// squared distances from the kept vertex to the planes gathered into it: the original
+// triangles' planes by area, and planes along open borders.  It is a root mean square,
+// not a bound, so parts of the simplified surface can be further off than this.
+float SimplifyMesh(const DirectX::XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	const std::uint32_t* indices, std::size_t indexCount, std::size_t targetIndexCount, float targetError,
+	std::vector<std::uint32_t>& result);
+
+struct MeshLod
+{
+	std::uint32_t StartIndexLocation = 0;
+	std::uint32_t IndexCount = 0;
+
+	// SimplifyMesh's error from LOD 0, in position units, summed over the steps that
+	// built this LOD.  A root mean square distance, not the largest one.
+	float Error = 0.0f;
+};
+
+// Treats all of indices as LOD 0 and appends LODs of about triangleRatio times the
+// triangles of the one before to indices, until there are maxLodCount LODs or the mesh
+// will not simplify further within an error of a tenth of its bounding radius.  lods
+// receives one entry per LOD, finest first.
+void BuildLodChain(const DirectX::XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	std::vector<std::uint32_t>& indices, std::vector<MeshLod>& lods,
+	std::uint32_t maxLodCount = 4, float triangleRatio = 0.25f);
+
+// Height in pixels of one unit at distance 1 for a perspective projection: half the
+// viewport height times proj(1,1).
+inline float LodPixelsPerUnit(const DirectX::XMFLOAT4X4& proj, float viewportHeight)
+{
+	return 0.5f*viewportHeight*proj(1, 1);
+}
+
+// The coarsest LOD whose error, scaled by worldScale and seen from distance, covers at
+// most maxPixelError pixels.  distance should be to the nearest point of the bounds.
+inline std::uint32_t SelectLod(const std::vector<MeshLod>& lods, float distance, float worldScale,
+	float pixelsPerUnit, float maxPixelError)
+{
+	// error*worldScale*pixelsPerUnit/distance <= maxPixelError, without the division.
+	const float limit = maxPixelError*distance / (worldScale*pixelsPerUnit);
+
+	std::uint32_t lod = 0;
+	while(lod + 1 < (std::uint32_t)lods.size() && lods[lod + 1].Error <= limit)
+		++lod;
+	return lod;
+}
@@ -0,0 +1,302 @@
+//***************************************************************************************
+// MeshletBuilder.cpp
+//***************************************************************************************
+
+#include "MeshletBuilder.h"
+#include "MathHelper.h"
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t None = 0xffffffff;
+
+	// Computes the bounds and normal cone of the meshlet just filled in.
+	void FinishMeshlet(Meshlet& m, const MeshletSet& meshlets, const XMFLOAT3* positions,
+		std::size_t positionStride, const std::vector<XMFLOAT3>& triNormals,
+		const std::vector<std::uint32_t>& meshletTriangles)
+	{
+		XMFLOAT3 points[MeshletSet::MaxVertices];
+		for(std::uint32_t k = 0; k < m.VertexCount; ++k)
+			points[k] = *(const XMFLOAT3*)((const char*)positions + meshlets.Vertices[m.VertexOffset + k]*positionStride);
+
+		BoundingSphere::CreateFromPoints(m.Sphere, m.VertexCount, points, sizeof(XMFLOAT3));
+		BoundingBox::CreateFromPoints(m.Box, m.VertexCount, points, sizeof(XMFLOAT3));
+
+		// The cone axis is the average face normal; its angle reaches the normal furthest
+		// from it.  Degenerate triangles have no normal and cannot be seen, so they do not
+		// count.
+		XMVECTOR axis = XMVectorZero();
+		for(std::uint32_t t : meshletTriangles)
+			axis = XMVectorAdd(axis, XMLoadFloat3(&triNormals[t]));
+
+		if(XMVectorGetX(XMVector3LengthSq(axis)) < 1e-12f)
+			return;
+
+		axis = XMVector3Normalize(axis);
+		float minDot = 1.0f;
+		for(std::uint32_t t : meshletTriangles)
+		{
+			XMVECTOR n = XMLoadFloat3(&triNormals[t]);
+			if(XMVectorGetX(XMVector3LengthSq(n)) > 0.0f)
+				minDot = MathHelper::Min(minDot, XMVectorGetX(XMVector3Dot(axis, n)));
+		}
+
+		XMStoreFloat3(&m.ConeAxis, axis);
+		m.ConeCosAngle = minDot;
+		m.ConeSinAngle = sqrtf(MathHelper::Max(0.0f, 1.0f - minDot*minDot));
+	}
+}
+
+bool BuildMeshlets(const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	const std::uint32_t* indices, std::size_t indexCount, MeshletSet& meshlets)
+{
+	meshlets.Meshlets.clear();
+	meshlets.Vertices.clear();
+	meshlets.Triangles.clear();
+
+	const std::uint32_t triCount = (std::uint32_t)(indexCount / 3);
+	for(std::size_t i = 0; i < 3*(std::size_t)triCount; ++i)
+	{
+		if(indices[i] >= vertexCount)
+			return false;
+	}
+	if(triCount == 0)
+		return true;
+
+	auto position = [positions, positionStride](std::uint32_t v)
+	{
+		return XMLoadFloat3((const XMFLOAT3*)((const char*)positions + v*positionStride));
+	};
+
+	// Triangles around each vertex, as offsets into one array.  live counts the ones not
+	// in a meshlet yet.
+	std::vector<std::uint32_t> live(vertexCount, 0);
+	for(std::size_t i = 0; i < 3*(std::size_t)triCount; ++i)
+		++live[indices[i]];
+
+	std::vector<std::uint32_t> firstAdjacent(vertexCount + 1, 0);
+	for(std::uint32_t v = 0; v < vertexCount; ++v)
+		firstAdjacent[v + 1] = firstAdjacent[v] + live[v];
+
+	std::vector<std::uint32_t> adjacent(3*(std::size_t)triCount);
+	{
+		std::vector<std::uint32_t> fill(firstAdjacent.begin(), firstAdjacent.end() - 1);
+		for(std::uint32_t t = 0; t < triCount; ++t)
+		{
+			for(int k = 0; k < 3; ++k)
+				adjacent[fill[indices[3*t + k]]++] = t;
+		}
+	}
+
+	// Centroid and unit front face normal of every triangle (clockwise winding).
+	std::vector<XMFLOAT3> triCentroids(triCount);
+	std::vector<XMFLOAT3> triNormals(triCount);
+	for(std::uint32_t t = 0; t < triCount; ++t)
+	{
+		XMVECTOR p0 = position(indices[3*t + 0]);
+		XMVECTOR p1 = position(indices[3*t + 1]);
+		XMVECTOR p2 = position(indices[3*t + 2]);
+
+		XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		float length = XMVectorGetX(XMVector3Length(n));
+
+		XMStoreFloat3(&triCentroids[t], XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), 1.0f / 3.0f));
+		XMStoreFloat3(&triNormals[t], length > 0.0f ? XMVectorScale(n, 1.0f / length) : XMVectorZero());
+	}
+
+	meshlets.Meshlets.reserve(triCount / MeshletSet::MaxTriangles + 1);
+	meshlets.Vertices.reserve(vertexCount + vertexCount / 2);
+	meshlets.Triangles.reserve(3*(std::size_t)triCount);
+
+	// localVertex[v] is v's number in the meshlet being built, or None.
+	std::vector<std::uint32_t> localVertex(vertexCount, None);
+	std::vector<std::uint8_t> emitted(triCount, 0);
+	std::vector<std::uint32_t> meshletTriangles;
+	meshletTriangles.reserve(MeshletSet::MaxTriangles);
+	std::uint32_t scan = 0;
+	std::uint32_t seed = None;
+
+	while(true)
+	{
+		if(seed == None)
+		{
+			while(scan < triCount && emitted[scan])
+				++scan;
+			if(scan == triCount)
+				break;
+			seed = scan;
+		}
+
+		Meshlet m;
+		m.VertexOffset = (std::uint32_t)meshlets.Vertices.size();
+		m.TriangleOffset = (std::uint32_t)(meshlets.Triangles.size() / 3);
+		meshletTriangles.clear();
+
+		XMVECTOR centroidSum = XMVectorZero();
+		XMVECTOR normalSum = XMVectorZero();
+
+		std::uint32_t next = seed;
+		while(next != None)
+		{
+			for(int k = 0; k < 3; ++k)
+			{
+				std::uint32_t v = indices[3*next + k];
+				if(localVertex[v] == None)
+				{
+					localVertex[v] = m.VertexCount++;
+					meshlets.Vertices.push_back(v);
+				}
+				meshlets.Triangles.push_back((std::uint8_t)localVertex[v]);
+				--live[v];
+			}
+			emitted[next] = 1;
+			meshletTriangles.push_back(next);
+			++m.TriangleCount;
+
+			centroidSum = XMVectorAdd(centroidSum, XMLoadFloat3(&triCentroids[next]));
+			normalSum = XMVectorAdd(normalSum, XMLoadFloat3(&triNormals[next]));
+
+			if(m.TriangleCount == MeshletSet::MaxTriangles)
+				break;
+
+			// Next, the triangle touching the meshlet that adds the fewest vertices, and of
+			// those the one nearest the meshlet's center.  The distance is stretched up to 3x
+			// for triangles facing away from the meshlet's average normal, and grows with the
+			// triangles left around the candidate, so pockets that would otherwise become
+			// tiny meshlets of their own are taken first.
+			XMVECTOR centroid = XMVectorScale(centroidSum, 1.0f / m.TriangleCount);
+			XMVECTOR normal = XMVector3Normalize(normalSum);
+
+			next = None;
+			std::uint32_t bestNewVertices = 4;
+			float bestScore = FLT_MAX;
+
+			for(std::uint32_t k = 0; k < m.VertexCount; ++k)
+			{
+				std::uint32_t v = meshlets.Vertices[m.VertexOffset + k];
+				if(live[v] == 0)
+					continue;
+
+				for(std::uint32_t a = firstAdjacent[v]; a < firstAdjacent[v + 1]; ++a)
+				{
+					std::uint32_t t = adjacent[a];
+					if(emitted[t])
+						continue;
+
+					std::uint32_t newVertices =
+						(localVertex[indices[3*t + 0]] == None ? 1 : 0) +
+						(localVertex[indices[3*t + 1]] == None ? 1 : 0) +
+						(localVertex[indices[3*t + 2]] == None ? 1 : 0);
+
+					if(m.VertexCount + newVertices > MeshletSet::MaxVertices || newVertices > bestNewVertices)
+						continue;
+
+					float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&triCentroids[t]), centroid)));
+					float facing = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&triNormals[t]), normal));
+					std::uint32_t around = live[indices[3*t + 0]] + live[indices[3*t + 1]] + live[indices[3*t + 2]];
+					float score = distance*(2.0f - facing)*(1.0f + 0.25f*around);
+
+					if(newVertices < bestNewVertices || score < bestScore)
+					{
+						bestNewVertices = newVertices;
+						bestScore = score;
+						next = t;
+					}
+				}
+			}
+		}
+
+		FinishMeshlet(m, meshlets, positions, positionStride, triNormals, meshletTriangles);
+
+		// Seed the next meshlet on this one's border, with the triangle whose vertices have
+		// the fewest other triangles left.  Taking the most enclosed triangles first keeps
+		// small islands from being left behind to become meshlets of their own.
+		seed = None;
+		std::uint32_t seedLive = None;
+		for(std::uint32_t k = 0; k < m.VertexCount; ++k)
+		{
+			std::uint32_t v = meshlets.Vertices[m.VertexOffset + k];
+			localVertex[v] = None;
+
+			for(std::uint32_t a = firstAdjacent[v]; a < firstAdjacent[v + 1] && live[v] > 0; ++a)
+			{
+				std::uint32_t t = adjacent[a];
+				if(emitted[t])
+					continue;
+
+				std::uint32_t around = live[indices[3*t + 0]] + live[indices[3*t + 1]] + live[indices[3*t + 2]];
+				if(around < seedLive)
+				{
+					seedLive = around;
+					seed = t;
+				}
+			}
+		}
+
+		meshlets.Meshlets.push_back(m);
+	}
+
+	return true;
+}
+
+bool BuildMeshlets(const GeometryGenerator::MeshData& meshData, MeshletSet& meshlets)
+{
+	if(meshData.Vertices.empty())
+	{
+		meshlets = MeshletSet();
+		return meshData.Indices32.empty();
+	}
+
+	return BuildMeshlets(&meshData.Vertices[0].Position, sizeof(GeometryGenerator::Vertex),
+		(std::uint32_t)meshData.Vertices.size(), meshData.Indices32.data(), meshData.Indices32.size(), meshlets);
+}
+
+MeshletCullStats CullMeshlets(const MeshletSet& meshlets, const CullingFrustum& frustum,
+	FXMVECTOR cameraPosition, std::vector<std::uint32_t>& visible)
+{
+	MeshletCullStats stats;
+
+	for(std::uint32_t i = 0; i < (std::uint32_t)meshlets.Meshlets.size(); ++i)
+	{
+		const Meshlet& m = meshlets.Meshlets[i];
+		XMVECTOR center = XMLoadFloat3(&m.Sphere.Center);
+
+		// Every triangle faces away if the eye is behind all of their planes.  With the eye
+		// at distance d from the sphere center, at angle b between the direction to the
+		// center and the cone axis, the largest eye distance in front of any triangle
+		// plane is r - d*cos(b + a) for cone angle a and sphere radius r.
+		if(m.ConeCosAngle > 0.0f)
+		{
+			XMVECTOR toCenter = XMVectorSubtract(center, cameraPosition);
+			float along = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&m.ConeAxis), toCenter));
+			float across = sqrtf(MathHelper::Max(0.0f, XMVectorGetX(XMVector3LengthSq(toCenter)) - along*along));
+
+			if(along*m.ConeCosAngle - across*m.ConeSinAngle > m.Sphere.Radius)
+			{
+				++stats.BackfaceCulled;
+				continue;
+			}
+		}
+
+		bool outside = false;
+		for(int p = 0; p < 6 && !outside; ++p)
+		{
+			float distance = XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&frustum.Planes[p]), center));
+			outside = distance < -m.Sphere.Radius;
+		}
+
+		if(outside || frustum.Classify(XMLoadFloat3(&m.Box.Center), XMLoadFloat3(&m.Box.Extents)) == DISJOINT)
+		{
+			++stats.FrustumCulled;
+			continue;
+		}
+
+		visible.push_back(i);
+		stats.VisibleTriangles += m.TriangleCount;
+	}
+
+	return stats;
+}
@@ -0,0 +1,84 @@
+//***************************************************************************************
+// MeshletBuilder.h
+//
+// Splits an indexed triangle list into meshlets: small clusters of at most 64 vertices
+// and 124 triangles that are culled as a unit.  Every meshlet keeps a bounding sphere and
+// box for frustum culling and a normal cone for backface culling, so the triangles of a
+// large mesh that are off screen or face away never reach the index buffer.
+//
+// Meshlets grow greedily from a seed triangle, preferring triangles that add no new
+// vertices, then ones close to the meshlet and facing the same way, which keeps the
+// clusters compact and their normal cones narrow.  Each meshlet is seeded on the border
+// of the one before, so the meshlets sweep across the mesh.
+//***************************************************************************************
+
+#pragma once
+
+#include "CullingBvh.h"
+#include "GeometryGenerator.h"
+
+struct Meshlet
+{
+	// The meshlet's vertices are MeshletSet::Vertices[VertexOffset, VertexOffset+VertexCount),
+	// its triangles 3*TriangleCount local vertex numbers starting at
+	// MeshletSet::Triangles[3*TriangleOffset].
+	std::uint32_t VertexOffset = 0;
+	std::uint32_t VertexCount = 0;
+	std::uint32_t TriangleOffset = 0;
+	std::uint32_t TriangleCount = 0;
+
+	DirectX::BoundingSphere Sphere;
+	DirectX::BoundingBox Box;
+
+	// Every front face normal is within the angle acos(ConeCosAngle) of ConeAxis.  The
+	// cone is useless for culling when the angle is 90 degrees or more (ConeCosAngle <= 0).
+	DirectX::XMFLOAT3 ConeAxis = { 0.0f, 0.0f, 1.0f };
+	float ConeCosAngle = -1.0f;
+	float ConeSinAngle = 0.0f;
+};
+
+struct MeshletSet
+{
+	static const std::uint32_t MaxVertices = 64;
+	static const std::uint32_t MaxTriangles = 124;
+
+	std::vector<Meshlet> Meshlets;
+
+	// Mesh vertex indices, one run per meshlet.
+	std::vector<std::uint32_t> Vertices;
+
+	// Local vertex numbers into the meshlet's run of Vertices, 3 per triangle.
+	std::vector<std::uint8_t> Triangles;
+};
+
+// Partitions the triangles into meshlets.  Vertex v's position is the XMFLOAT3
+// positionStride*v bytes past positions.  Returns false if an index is out of range.
+bool BuildMeshlets(const DirectX::XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	const std::uint32_t* indices, std::size_t indexCount, MeshletSet& meshlets);
+bool BuildMeshlets(const GeometryGenerator::MeshData& meshData, MeshletSet& meshlets);
+
+struct MeshletCullStats
+{
+	std::uint32_t BackfaceCulled = 0;
+	std::uint32_t FrustumCulled = 0;
+	std::uint32_t VisibleTriangles = 0;
+};
+
+// Appends the index of every meshlet that may have a visible front face.  The frustum and
+// camera position are in the mesh's local space: build the frustum from world*viewProj
+// and transform the eye by the inverse world matrix.  The backface test only relies on
+// which side of each triangle's plane the eye is on, which an affine world matrix does not
+// change, so it is exact for any world matrix without a mirror.
+MeshletCullStats CullMeshlets(const MeshletSet& meshlets, const CullingFrustum& frustum,
+	DirectX::FXMVECTOR cameraPosition, std::vector<std::uint32_t>& visible);
+
+// Appends meshlet i's triangles to indices as mesh vertex indices, ready for an index buffer.
+template<typename T>
+void AppendMeshletIndices(const MeshletSet& meshlets, std::uint32_t i, std::vector<T>& indices)
+{
+	const Meshlet& m = meshlets.Meshlets[i];
+	const std::uint32_t* vertices = &meshlets.Vertices[m.VertexOffset];
+	const std::uint8_t* triangles = &meshlets.Triangles[3*(std::size_t)m.TriangleOffset];
+	for(std::uint32_t k = 0; k < 3*m.TriangleCount; ++k)
+		indices.push_back((T)vertices[triangles[k]]);
+}
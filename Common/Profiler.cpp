@@ -0,0 +1,153 @@
+//***************************************************************************************
+// Profiler.cpp
+//***************************************************************************************
+
+#include "Profiler.h"
+#include <chrono>
+#include <fstream>
+
+namespace
+{
+	std::int64_t ClockNanoseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	std::string JsonString(const std::string& s)
+	{
+		std::string quoted = "\"";
+		for(char c : s)
+		{
+			if(c == '"' || c == '\\')
+				quoted += '\\';
+			if((unsigned char)c >= 0x20)
+				quoted += c;
+		}
+		return quoted + "\"";
+	}
+}
+
+Profiler& Profiler::Get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler()
+	: mEpoch(ClockNanoseconds())
+{
+}
+
+void Profiler::BeginCapture()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for(auto& thread : mThreads)
+	{
+		thread->Count.store(0, std::memory_order_relaxed);
+		thread->Dropped.store(0, std::memory_order_relaxed);
+	}
+	mCapturing.store(true, std::memory_order_release);
+}
+
+void Profiler::EndCapture()
+{
+	mCapturing.store(false, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer = CurrentThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	buffer.Name = name;
+}
+
+std::int64_t Profiler::Now()const
+{
+	return ClockNanoseconds() - mEpoch;
+}
+
+void Profiler::RecordZone(const char* name, std::int64_t start, std::int64_t end)
+{
+	ThreadBuffer& buffer = CurrentThreadBuffer();
+
+	std::uint32_t count = buffer.Count.load(std::memory_order_relaxed);
+	if(count == MaxZonesPerThread)
+	{
+		buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.Zones[count] = { name, start, end };
+	buffer.Count.store(count + 1, std::memory_order_release);
+}
+
+std::uint64_t Profiler::ZoneCount()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	std::uint64_t count = 0;
+	for(const auto& thread : mThreads)
+		count += thread->Count.load(std::memory_order_acquire);
+	return count;
+}
+
+std::uint64_t Profiler::DroppedZoneCount()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	std::uint64_t count = 0;
+	for(const auto& thread : mThreads)
+		count += thread->Dropped.load(std::memory_order_relaxed);
+	return count;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filename)const
+{
+	std::ofstream fout(filename);
+	if(!fout)
+		return false;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	// Complete ("X") events with start and duration in microseconds; the viewer nests
+	// them by time on each thread.
+	fout << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	for(const auto& thread : mThreads)
+	{
+		std::string name = thread->Name.empty() ? "Thread " + std::to_string(thread->Id) : thread->Name;
+		fout << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->Id
+			<< ",\"args\":{\"name\":" << JsonString(name) << "}}";
+		first = false;
+
+		std::uint32_t count = thread->Count.load(std::memory_order_acquire);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			const ZoneRecord& zone = thread->Zones[i];
+			fout << ",\n{\"name\":" << JsonString(zone.Name) << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->Id
+				<< ",\"ts\":" << zone.Start / 1000 << "." << zone.Start % 1000 / 100
+				<< ",\"dur\":" << (zone.End - zone.Start) / 1000 << "." << (zone.End - zone.Start) % 1000 / 100 << "}";
+		}
+	}
+	fout << "\n]}\n";
+
+	return (bool)fout;
+}
+
+Profiler::ThreadBuffer& Profiler::CurrentThreadBuffer()
+{
+	thread_local ThreadBuffer* current = nullptr;
+	if(current == nullptr)
+	{
+		auto buffer = std::make_unique<ThreadBuffer>();
+		buffer->Zones.reset(new ZoneRecord[MaxZonesPerThread]);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		buffer->Id = (std::uint32_t)mThreads.size();
+		current = buffer.get();
+		mThreads.push_back(std::move(buffer));
+	}
+	return *current;
+}
@@ -0,0 +1,135 @@
+//***************************************************************************************
+// Profiler.h
+//
+// Hierarchical CPU zone profiler.  PROFILE_SCOPE("name") or PROFILE_FUNCTION() at the top
+// of a block times the block on the calling thread; zones nest by their times.  While a
+// capture runs, each thread appends its finished zones to its own buffer without locking,
+// and WriteChromeTrace exports them as Chrome trace_event JSON for chrome://tracing or
+// https://ui.perfetto.dev.
+//
+// The macros compile to nothing unless PROFILER_ENABLED is 1, which it is by default in
+// debug builds only.  Define PROFILER_ENABLED=1 to profile an optimized build.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef PROFILER_ENABLED
+#if defined(DEBUG) || defined(_DEBUG)
+#define PROFILER_ENABLED 1
+#else
+#define PROFILER_ENABLED 0
+#endif
+#endif
+
+class Profiler
+{
+public:
+	// Zones a thread can record per capture; later zones are dropped and counted.
+	static const std::uint32_t MaxZonesPerThread = 1 << 15;
+
+	static Profiler& Get();
+
+	Profiler(const Profiler& rhs) = delete;
+	Profiler& operator=(const Profiler& rhs) = delete;
+
+	// Zones are recorded only between BeginCapture and EndCapture.  BeginCapture throws
+	// away the last capture, so call it with no zone open on another thread.
+	void BeginCapture();
+	void EndCapture();
+	bool Capturing()const { return mCapturing.load(std::memory_order_relaxed); }
+
+	// Names the calling thread in the trace.  Unnamed threads are "Thread n".
+	void SetThreadName(const std::string& name);
+
+	// Nanoseconds since the profiler was made.
+	std::int64_t Now()const;
+
+	// Records a finished zone on the calling thread.  name must outlive the capture, as a
+	// string literal or __FUNCTION__ does.
+	void RecordZone(const char* name, std::int64_t start, std::int64_t end);
+
+	std::uint64_t ZoneCount()const;
+	std::uint64_t DroppedZoneCount()const;
+
+	// Writes the last capture, which must have ended.
+	bool WriteChromeTrace(const std::string& filename)const;
+
+	// Times a block while a capture runs; what PROFILE_SCOPE declares.
+	class Zone
+	{
+	public:
+		explicit Zone(const char* name)
+		{
+			Profiler& profiler = Profiler::Get();
+			if(profiler.Capturing())
+			{
+				mName = name;
+				mStart = profiler.Now();
+			}
+		}
+		Zone(const Zone& rhs) = delete;
+		Zone& operator=(const Zone& rhs) = delete;
+
+		~Zone()
+		{
+			if(mName != nullptr)
+			{
+				Profiler& profiler = Profiler::Get();
+				profiler.RecordZone(mName, mStart, profiler.Now());
+			}
+		}
+
+	private:
+		const char* mName = nullptr;
+		std::int64_t mStart = 0;
+	};
+
+private:
+	Profiler();
+
+	struct ZoneRecord
+	{
+		const char* Name;
+		std::int64_t Start;
+		std::int64_t End;
+	};
+
+	// One per thread that ever recorded, kept for the life of the program so a trace can
+	// still be written after the thread exits.  Only the owning thread writes Zones, and it
+	// publishes them by Count.
+	struct ThreadBuffer
+	{
+		std::uint32_t Id = 0;
+		std::string Name;
+		std::unique_ptr<ZoneRecord[]> Zones;
+		std::atomic<std::uint32_t> Count{ 0 };
+		std::atomic<std::uint64_t> Dropped{ 0 };
+	};
+
+	ThreadBuffer& CurrentThreadBuffer();
+
+	std::atomic<bool> mCapturing{ false };
+	std::int64_t mEpoch = 0;
+
+	// Guards mThreads and the thread names.
+	mutable std::mutex mMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> mThreads;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_SCOPE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#endif
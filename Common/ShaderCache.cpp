@@ -0,0 +1,472 @@
+//***************************************************************************************
+// ShaderCache.cpp
+//***************************************************************************************
+
+#include "ShaderCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	const std::uint32_t ShaderStoreMagic = 0x43444853; // "SHDC"
+	const std::uint32_t ShaderStoreVersion = 1;
+	const std::uint64_t ShaderBlobAlignment = 16;
+	const std::uint64_t FnvOffsetBasis = 0xcbf29ce484222325ull;
+
+	// Changes every key when the way keys are hashed changes.
+	const char ShaderKeyVersion[] = "ShaderCache 1";
+
+	struct ShaderStoreHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Version;
+		std::uint64_t EntryCount;
+	};
+
+	struct ShaderStoreEntry
+	{
+		std::uint64_t Key;
+		std::uint64_t Identity;
+		std::uint64_t Offset;
+		std::uint64_t Size;
+	};
+
+	std::uint64_t AlignUp(std::uint64_t x)
+	{
+		return (x + ShaderBlobAlignment - 1) & ~(ShaderBlobAlignment - 1);
+	}
+
+	// Hashes s with its terminator, so "ab","c" and "a","bc" differ.
+	std::uint64_t HashString(const std::string& s, std::uint64_t hash)
+	{
+		return HashShaderBytes(s.c_str(), s.size() + 1, hash);
+	}
+
+	std::uint64_t HashValue(std::uint64_t value, std::uint64_t hash)
+	{
+		return HashShaderBytes(&value, sizeof(value), hash);
+	}
+
+	std::string DirectoryOf(const std::string& filename)
+	{
+		std::size_t slash = filename.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : filename.substr(0, slash + 1);
+	}
+
+	bool IsAbsolutePath(const std::string& path)
+	{
+		return (!path.empty() && (path[0] == '/' || path[0] == '\\')) ||
+			(path.size() > 1 && path[1] == ':');
+	}
+
+	bool ReadWholeFile(const std::string& filename, std::string& text)
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		if(!fin)
+			return false;
+		text.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+		return !fin.bad();
+	}
+
+	// The names of the #include directives in text, outside comments.
+	void FindIncludes(const std::string& text, std::vector<std::string>& includes)
+	{
+		// Blank out comments, keeping the newlines so directives stay at line starts.
+		std::string code = text;
+		for(std::size_t i = 0; i < code.size(); ++i)
+		{
+			if(code[i] == '/' && i + 1 < code.size() && code[i + 1] == '/')
+			{
+				while(i < code.size() && code[i] != '\n')
+					code[i++] = ' ';
+			}
+			else if(code[i] == '/' && i + 1 < code.size() && code[i + 1] == '*')
+			{
+				code[i] = code[i + 1] = ' ';
+				for(i += 2; i < code.size() && !(code[i] == '*' && i + 1 < code.size() && code[i + 1] == '/'); ++i)
+				{
+					if(code[i] != '\n')
+						code[i] = ' ';
+				}
+				if(i < code.size())
+					code[i] = code[i + 1] = ' ';
+				++i;
+			}
+			else if(code[i] == '"')
+			{
+				// Skip string literals, so a "//" in one is not a comment.
+				for(++i; i < code.size() && code[i] != '"' && code[i] != '\n'; ++i)
+				{
+					if(code[i] == '\\' && i + 1 < code.size())
+						++i;
+				}
+			}
+		}
+
+		std::size_t lineStart = 0;
+		while(lineStart < code.size())
+		{
+			std::size_t lineEnd = code.find('\n', lineStart);
+			if(lineEnd == std::string::npos)
+				lineEnd = code.size();
+
+			std::size_t p = code.find_first_not_of(" \t\r", lineStart);
+			if(p < lineEnd && code[p] == '#')
+			{
+				p = code.find_first_not_of(" \t", p + 1);
+				if(p < lineEnd && code.compare(p, 7, "include") == 0)
+				{
+					p = code.find_first_not_of(" \t", p + 7);
+					if(p < lineEnd && (code[p] == '"' || code[p] == '<'))
+					{
+						char close = code[p] == '"' ? '"' : '>';
+						std::size_t end = code.find(close, p + 1);
+						if(end < lineEnd)
+							includes.push_back(code.substr(p + 1, end - p - 1));
+					}
+				}
+			}
+			lineStart = lineEnd + 1;
+		}
+	}
+
+	const ShaderSourceScan& ScanFile(const std::string& filename, std::unordered_map<std::string, ShaderSourceScan>& scans)
+	{
+		auto it = scans.find(filename);
+		if(it != scans.end())
+			return it->second;
+
+		ShaderSourceScan& scan = scans[filename];
+		std::string text;
+		if(ReadWholeFile(filename, text))
+		{
+			scan.Found = true;
+			scan.ContentHash = HashShaderBytes(text.data(), text.size());
+			FindIncludes(text, scan.Includes);
+		}
+		return scan;
+	}
+
+	void ScanRecursive(const std::string& filename, const std::string& rootDirectory,
+		std::vector<ShaderDependency>& dependencies, std::unordered_map<std::string, ShaderSourceScan>& scans)
+	{
+		for(const ShaderDependency& d : dependencies)
+		{
+			if(d.Filename == filename)
+				return;
+		}
+
+		const ShaderSourceScan& scan = ScanFile(filename, scans);
+		ShaderDependency dependency;
+		dependency.Filename = filename;
+		dependency.Found = scan.Found;
+		dependency.ContentHash = scan.ContentHash;
+		dependencies.push_back(dependency);
+
+		// Copied, as scanning the includes can grow scans.
+		const std::vector<std::string> includes = scan.Includes;
+		const std::string directory = DirectoryOf(filename);
+		for(const std::string& include : includes)
+		{
+			std::string path = IsAbsolutePath(include) ? include : directory + include;
+			if(!ScanFile(path, scans).Found && !IsAbsolutePath(include) && directory != rootDirectory)
+			{
+				std::string rootPath = rootDirectory + include;
+				if(ScanFile(rootPath, scans).Found)
+					path = rootPath;
+			}
+			ScanRecursive(path, rootDirectory, dependencies, scans);
+		}
+	}
+}
+
+std::uint64_t HashShaderBytes(const void* data, std::size_t size, std::uint64_t hash)
+{
+	const std::uint8_t* bytes = (const std::uint8_t*)data;
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+void ScanShaderDependencies(const std::string& filename, std::vector<ShaderDependency>& dependencies,
+	std::unordered_map<std::string, ShaderSourceScan>* scans)
+{
+	std::unordered_map<std::string, ShaderSourceScan> localScans;
+	ScanRecursive(filename, DirectoryOf(filename), dependencies, scans != nullptr ? *scans : localScans);
+}
+
+ShaderCache::ShaderCache(ShaderCompiler& compiler)
+	: mCompiler(compiler)
+{
+}
+
+void ShaderCache::Open(const std::string& filename)
+{
+	mFilename = filename;
+	mEntries.clear();
+	mCompiled.clear();
+	mResults.clear();
+	mDirty = false;
+
+	if(!mStore.Open(filename) || !ReadStore(mStore, mEntries))
+	{
+		mStore.Close();
+		mEntries.clear();
+	}
+}
+
+bool ShaderCache::ReadStore(const MappedFile& store, std::unordered_map<std::uint64_t, Entry>& entries)
+{
+	const std::uint64_t size = store.Size();
+	if(size < sizeof(ShaderStoreHeader))
+		return false;
+
+	ShaderStoreHeader header;
+	std::memcpy(&header, store.Data(), sizeof(header));
+	if(header.Magic != ShaderStoreMagic || header.Version != ShaderStoreVersion)
+		return false;
+	if(header.EntryCount > (size - sizeof(header)) / sizeof(ShaderStoreEntry))
+		return false;
+
+	for(std::uint64_t i = 0; i < header.EntryCount; ++i)
+	{
+		ShaderStoreEntry e;
+		std::memcpy(&e, store.Data() + sizeof(header) + i*sizeof(ShaderStoreEntry), sizeof(e));
+		if(e.Offset > size || e.Size > size - e.Offset)
+			return false;
+
+		Entry entry;
+		entry.Identity = e.Identity;
+		entry.Bytecode = store.Data() + e.Offset;
+		entry.Size = e.Size;
+		entries[e.Key] = entry;
+	}
+	return true;
+}
+
+std::uint64_t ShaderCache::Identity(const ShaderCompileRequest& request)
+{
+	std::uint64_t hash = HashString(request.Filename, FnvOffsetBasis);
+	hash = HashString(request.EntryPoint, hash);
+	hash = HashString(request.Target, hash);
+	hash = HashValue(request.Flags, hash);
+	hash = HashValue(request.Defines.size(), hash);
+	for(const ShaderDefine& define : request.Defines)
+	{
+		hash = HashString(define.Name, hash);
+		hash = HashString(define.Definition, hash);
+	}
+	return hash;
+}
+
+std::uint64_t ShaderCache::Key(const ShaderCompileRequest& request)
+{
+	std::unordered_map<std::string, ShaderSourceScan> scans;
+	return Key(request, scans);
+}
+
+std::uint64_t ShaderCache::Key(const ShaderCompileRequest& request, std::unordered_map<std::string, ShaderSourceScan>& scans)
+{
+	std::vector<ShaderDependency> dependencies;
+	ScanShaderDependencies(request.Filename, dependencies, &scans);
+
+	std::uint64_t hash = HashString(ShaderKeyVersion, FnvOffsetBasis);
+	hash = HashString(mCompiler.Version(), hash);
+	hash = HashValue(Identity(request), hash);
+	for(const ShaderDependency& d : dependencies)
+	{
+		hash = HashString(d.Filename, hash);
+		hash = HashValue(d.Found ? d.ContentHash : 0, hash);
+		hash = HashValue(d.Found ? 1 : 0, hash);
+	}
+	return hash;
+}
+
+bool ShaderCache::Build(const std::vector<ShaderCompileRequest>& requests, ThreadPool& pool)
+{
+	mResults.assign(requests.size(), Result());
+
+	// Hash every request, reading each file once for the batch, and list the misses.  A
+	// shader requested twice compiles once.
+	std::unordered_map<std::string, ShaderSourceScan> scans;
+	std::vector<std::size_t> misses;
+	std::unordered_map<std::uint64_t, std::size_t> missByKey;
+	for(std::size_t i = 0; i < requests.size(); ++i)
+	{
+		Result& result = mResults[i];
+		result.Key = Key(requests[i], scans);
+
+		auto it = mEntries.find(result.Key);
+		if(it != mEntries.end())
+		{
+			result.Succeeded = true;
+			result.Hit = true;
+			result.Bytecode = it->second.Bytecode;
+			result.BytecodeSize = (std::size_t)it->second.Size;
+			++mHitCount;
+		}
+		else if(missByKey.emplace(result.Key, i).second)
+		{
+			misses.push_back(i);
+			++mMissCount;
+		}
+	}
+
+	std::vector<std::vector<std::uint8_t>> bytecode(misses.size());
+	pool.ParallelFor(0, (int)misses.size(), [&](int m)
+	{
+		Result& result = mResults[misses[m]];
+		result.Succeeded = mCompiler.Compile(requests[misses[m]], bytecode[m], result.Messages);
+	});
+
+	bool succeeded = true;
+	for(std::size_t m = 0; m < misses.size(); ++m)
+	{
+		Result& result = mResults[misses[m]];
+		if(!result.Succeeded)
+		{
+			succeeded = false;
+			continue;
+		}
+
+		Insert(result.Key, Identity(requests[misses[m]]), std::move(bytecode[m]));
+		const Entry& entry = mEntries[result.Key];
+		result.Bytecode = entry.Bytecode;
+		result.BytecodeSize = (std::size_t)entry.Size;
+	}
+
+	// Repeats of a miss share its result.
+	for(Result& result : mResults)
+	{
+		if(!result.Hit && result.Bytecode == nullptr)
+		{
+			const Result& first = mResults[missByKey[result.Key]];
+			if(&first != &result)
+			{
+				result.Succeeded = first.Succeeded;
+				result.Bytecode = first.Bytecode;
+				result.BytecodeSize = first.BytecodeSize;
+				result.Messages = first.Messages;
+			}
+		}
+	}
+	return succeeded;
+}
+
+void ShaderCache::Insert(std::uint64_t key, std::uint64_t identity, std::vector<std::uint8_t>&& bytecode)
+{
+	// The entry this one replaces, if any: same shader, older files or compiler.
+	for(auto it = mEntries.begin(); it != mEntries.end(); )
+	{
+		if(it->second.Identity == identity)
+			it = mEntries.erase(it);
+		else
+			++it;
+	}
+
+	// Moving the vector into mCompiled keeps its buffer, so the pointer stays good.
+	mCompiled.push_back(std::move(bytecode));
+	Entry& entry = mEntries[key];
+	entry.Identity = identity;
+	entry.Bytecode = mCompiled.back().data();
+	entry.Size = mCompiled.back().size();
+	mDirty = true;
+}
+
+bool ShaderCache::Save()
+{
+	if(!mDirty || mFilename.empty())
+		return true;
+
+	// Sorted by key, so the same entries always make the same file.
+	std::vector<std::uint64_t> keys;
+	keys.reserve(mEntries.size());
+	for(const auto& e : mEntries)
+		keys.push_back(e.first);
+	std::sort(keys.begin(), keys.end());
+
+	ShaderStoreHeader header = { ShaderStoreMagic, ShaderStoreVersion, keys.size() };
+	std::vector<ShaderStoreEntry> table(keys.size());
+	std::uint64_t offset = AlignUp(sizeof(header) + keys.size()*sizeof(ShaderStoreEntry));
+	for(std::size_t i = 0; i < keys.size(); ++i)
+	{
+		const Entry& entry = mEntries[keys[i]];
+		table[i] = { keys[i], entry.Identity, offset, entry.Size };
+		offset = AlignUp(offset + entry.Size);
+	}
+
+	// Written beside the store and renamed over it, so a failed write never leaves a
+	// half-written store behind.
+	const std::string tempFilename = mFilename + ".tmp";
+	{
+		std::ofstream fout(tempFilename, std::ios::binary | std::ios::trunc);
+		if(!fout)
+			return false;
+
+		const char zeros[ShaderBlobAlignment] = {};
+		fout.write((const char*)&header, sizeof(header));
+		fout.write((const char*)table.data(), table.size()*sizeof(ShaderStoreEntry));
+		std::uint64_t written = sizeof(header) + table.size()*sizeof(ShaderStoreEntry);
+		for(std::size_t i = 0; i < keys.size(); ++i)
+		{
+			fout.write(zeros, (std::streamsize)(table[i].Offset - written));
+			fout.write((const char*)mEntries[keys[i]].Bytecode, (std::streamsize)table[i].Size);
+			written = table[i].Offset + table[i].Size;
+		}
+		if(!fout)
+		{
+			fout.close();
+			std::remove(tempFilename.c_str());
+			return false;
+		}
+	}
+
+	// The store cannot be replaced while it is mapped on Windows, so the entries still in
+	// the mapping move to memory first.
+	for(auto& e : mEntries)
+	{
+		Entry& entry = e.second;
+		if(entry.Bytecode >= mStore.Data() && entry.Bytecode < mStore.Data() + mStore.Size())
+		{
+			mCompiled.emplace_back(entry.Bytecode, entry.Bytecode + entry.Size);
+			entry.Bytecode = mCompiled.back().data();
+		}
+	}
+	RepointResults();
+	mStore.Close();
+
+	std::remove(mFilename.c_str());
+	if(std::rename(tempFilename.c_str(), mFilename.c_str()) != 0)
+	{
+		std::remove(tempFilename.c_str());
+		return false;
+	}
+
+	MappedFile store;
+	std::unordered_map<std::uint64_t, Entry> entries;
+	if(!store.Open(mFilename) || !ReadStore(store, entries))
+		return false;
+
+	mStore = std::move(store);
+	mEntries.swap(entries);
+	RepointResults();
+	mCompiled.clear();
+	mDirty = false;
+	return true;
+}
+
+void ShaderCache::RepointResults()
+{
+	for(Result& result : mResults)
+	{
+		auto it = mEntries.find(result.Key);
+		if(result.Succeeded && it != mEntries.end())
+			result.Bytecode = it->second.Bytecode;
+	}
+}
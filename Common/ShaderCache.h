@@ -0,0 +1,163 @@
+//***************************************************************************************
+// ShaderCache.h
+//
+// Content-addressed cache of compiled shader bytecode.  A shader's key is a hash of its
+// source and every file it includes, the defines, entry point, target, compile flags and
+// compiler version, so any edit to any of them misses and nothing needs a timestamp.
+// Hits come straight out of a store file that is memory mapped; misses compile in
+// parallel on a thread pool and Save writes them back.
+//
+// The compiler sits behind ShaderCompiler, so the hashing, include scanning and store
+// work, and can be checked, without Direct3D.  d3dUtil wraps D3DCompileFromFile in one.
+//
+// Store layout (little endian, blobs 16-byte aligned):
+//     ShaderStoreHeader
+//     ShaderStoreEntry entries[EntryCount]
+//     bytecode blobs
+//***************************************************************************************
+
+#pragma once
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ShaderDefine
+{
+	std::string Name;
+	std::string Definition;
+};
+
+struct ShaderCompileRequest
+{
+	std::string Filename;
+	std::vector<ShaderDefine> Defines;
+	std::string EntryPoint;
+	std::string Target;
+	std::uint32_t Flags = 0;
+};
+
+class ShaderCompiler
+{
+public:
+	virtual ~ShaderCompiler() = default;
+
+	// Identifies the compiler in the keys, so a new compiler does not reuse bytecode from
+	// an old one.
+	virtual std::string Version()const = 0;
+
+	// Compiles request into bytecode.  messages receives the compiler's warnings or
+	// errors.  Called from several threads at once.
+	virtual bool Compile(const ShaderCompileRequest& request,
+		std::vector<std::uint8_t>& bytecode, std::string& messages) = 0;
+};
+
+// 64-bit FNV-1a, continuing from hash.
+std::uint64_t HashShaderBytes(const void* data, std::size_t size, std::uint64_t hash = 0xcbf29ce484222325ull);
+
+struct ShaderDependency
+{
+	std::string Filename;
+	bool Found = false;
+	std::uint64_t ContentHash = 0;
+};
+
+// What ScanShaderDependencies read of one file.
+struct ShaderSourceScan
+{
+	bool Found = false;
+	std::uint64_t ContentHash = 0;
+	std::vector<std::string> Includes;
+};
+
+// Appends filename and every file it includes, directly or not, to dependencies, each
+// once, in the order they are first included.  #include "x" and #include <x> resolve
+// against the including file's directory and then filename's, as the compiler's
+// standard include handler does.  Includes inside comments are skipped; those inside
+// #if blocks are not, which at worst makes a key change more often than it must.  A
+// file that cannot be read is listed with Found false, so creating it later changes
+// the key.  Files already in scans are not read again, so a batch of shaders sharing
+// headers can pass the same map.
+void ScanShaderDependencies(const std::string& filename, std::vector<ShaderDependency>& dependencies,
+	std::unordered_map<std::string, ShaderSourceScan>* scans = nullptr);
+
+class ShaderCache
+{
+public:
+	explicit ShaderCache(ShaderCompiler& compiler);
+	ShaderCache(const ShaderCache& rhs) = delete;
+	ShaderCache& operator=(const ShaderCache& rhs) = delete;
+
+	// Maps the store at filename.  A missing or invalid store opens empty, and Save
+	// replaces it.
+	void Open(const std::string& filename);
+
+	// Finds or compiles every request.  Keys are hashed on the calling thread, reading
+	// each source file once, and the misses compile on pool.  Returns false if any
+	// compile failed; the results of the others are still valid.
+	bool Build(const std::vector<ShaderCompileRequest>& requests, ThreadPool& pool);
+
+	// The results of the last Build, by request.  Bytecode points into the store mapping
+	// or into memory owned by the cache, and stays valid until the next Build.
+	bool Succeeded(std::size_t request)const { return mResults[request].Succeeded; }
+	const std::uint8_t* Bytecode(std::size_t request)const { return mResults[request].Bytecode; }
+	std::size_t BytecodeSize(std::size_t request)const { return mResults[request].BytecodeSize; }
+	bool WasHit(std::size_t request)const { return mResults[request].Hit; }
+	const std::string& Messages(std::size_t request)const { return mResults[request].Messages; }
+
+	// Writes the store if a Build compiled anything, then maps it again.  An entry is
+	// dropped when a newer one is written for the same file, entry point, target, flags
+	// and defines, so stale bytecode does not pile up.  Returns false if the store could
+	// not be written.
+	bool Save();
+
+	std::size_t EntryCount()const { return mEntries.size(); }
+	std::uint64_t HitCount()const { return mHitCount; }
+	std::uint64_t MissCount()const { return mMissCount; }
+
+	// The key of request as it is on disk now, and what it is keyed by besides the files.
+	std::uint64_t Key(const ShaderCompileRequest& request);
+	static std::uint64_t Identity(const ShaderCompileRequest& request);
+
+private:
+	// Bytecode points into the store mapping, or into mCompiled for entries not saved yet.
+	struct Entry
+	{
+		std::uint64_t Identity = 0;
+		const std::uint8_t* Bytecode = nullptr;
+		std::uint64_t Size = 0;
+	};
+
+	struct Result
+	{
+		std::uint64_t Key = 0;
+		bool Succeeded = false;
+		bool Hit = false;
+		const std::uint8_t* Bytecode = nullptr;
+		std::size_t BytecodeSize = 0;
+		std::string Messages;
+	};
+
+	std::uint64_t Key(const ShaderCompileRequest& request, std::unordered_map<std::string, ShaderSourceScan>& scans);
+	void Insert(std::uint64_t key, std::uint64_t identity, std::vector<std::uint8_t>&& bytecode);
+
+	// Points the results of the last Build at where mEntries holds their bytecode now.
+	void RepointResults();
+
+	// Fills entries from a mapped store; false if the store is not valid.
+	static bool ReadStore(const MappedFile& store, std::unordered_map<std::uint64_t, Entry>& entries);
+
+	ShaderCompiler& mCompiler;
+	std::string mFilename;
+	MappedFile mStore;
+	std::unordered_map<std::uint64_t, Entry> mEntries;
+	std::vector<std::vector<std::uint8_t>> mCompiled;
+	std::vector<Result> mResults;
+	bool mDirty = false;
+
+	std::uint64_t mHitCount = 0;
+	std::uint64_t mMissCount = 0;
+};
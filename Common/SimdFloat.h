@@ -0,0 +1,122 @@
+//***************************************************************************************
+// SimdFloat.h
+//
+// Thin wrappers over the target's float vector type so each kernel is written once:
+// __m256 with AVX, __m128 with SSE2, float32x4_t on ARM64, and a plain float otherwise.
+// FloatVWidth is the number of lanes.
+//
+// Only correctly rounded operations (add/sub/mul/div/sqrt) are offered, with no fused
+// multiply-add, so every path rounds the same way.  Comparisons give all-ones or
+// all-zeros lanes for AndV and OrV to combine and MaskBitsV to turn into one bit per
+// lane.  MaxV and MinV return the second operand when the first is NaN, so saturating
+// a NaN gives 0 as HLSL's saturate does.
+//
+// Include it from .cpp files only.  Everything is in an unnamed namespace, so files
+// built for different instruction sets do not share definitions.
+//***************************************************************************************
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define SIMD_FLOAT_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define SIMD_FLOAT_SSE
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	#include <arm_neon.h>
+	#define SIMD_FLOAT_NEON
+#endif
+
+namespace
+{
+#if defined(SIMD_FLOAT_AVX)
+	typedef __m256 FloatV;
+	const std::uint32_t FloatVWidth = 8;
+	inline FloatV LoadV(const float* p) { return _mm256_loadu_ps(p); }
+	inline void StoreV(float* p, FloatV v) { _mm256_storeu_ps(p, v); }
+	inline FloatV SplatV(float s) { return _mm256_set1_ps(s); }
+	inline FloatV AddV(FloatV a, FloatV b) { return _mm256_add_ps(a, b); }
+	inline FloatV SubV(FloatV a, FloatV b) { return _mm256_sub_ps(a, b); }
+	inline FloatV MulV(FloatV a, FloatV b) { return _mm256_mul_ps(a, b); }
+	inline FloatV DivV(FloatV a, FloatV b) { return _mm256_div_ps(a, b); }
+	inline FloatV SqrtV(FloatV a) { return _mm256_sqrt_ps(a); }
+	inline FloatV MaxV(FloatV a, FloatV b) { return _mm256_max_ps(a, b); }
+	inline FloatV MinV(FloatV a, FloatV b) { return _mm256_min_ps(a, b); }
+	inline FloatV AndV(FloatV a, FloatV b) { return _mm256_and_ps(a, b); }
+	inline FloatV OrV(FloatV a, FloatV b) { return _mm256_or_ps(a, b); }
+	inline FloatV LessV(FloatV a, FloatV b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline FloatV GreaterV(FloatV a, FloatV b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	inline std::uint32_t MaskBitsV(FloatV m) { return (std::uint32_t)_mm256_movemask_ps(m); }
+#elif defined(SIMD_FLOAT_SSE)
+	typedef __m128 FloatV;
+	const std::uint32_t FloatVWidth = 4;
+	inline FloatV LoadV(const float* p) { return _mm_loadu_ps(p); }
+	inline void StoreV(float* p, FloatV v) { _mm_storeu_ps(p, v); }
+	inline FloatV SplatV(float s) { return _mm_set1_ps(s); }
+	inline FloatV AddV(FloatV a, FloatV b) { return _mm_add_ps(a, b); }
+	inline FloatV SubV(FloatV a, FloatV b) { return _mm_sub_ps(a, b); }
+	inline FloatV MulV(FloatV a, FloatV b) { return _mm_mul_ps(a, b); }
+	inline FloatV DivV(FloatV a, FloatV b) { return _mm_div_ps(a, b); }
+	inline FloatV SqrtV(FloatV a) { return _mm_sqrt_ps(a); }
+	inline FloatV MaxV(FloatV a, FloatV b) { return _mm_max_ps(a, b); }
+	inline FloatV MinV(FloatV a, FloatV b) { return _mm_min_ps(a, b); }
+	inline FloatV AndV(FloatV a, FloatV b) { return _mm_and_ps(a, b); }
+	inline FloatV OrV(FloatV a, FloatV b) { return _mm_or_ps(a, b); }
+	inline FloatV LessV(FloatV a, FloatV b) { return _mm_cmplt_ps(a, b); }
+	inline FloatV GreaterV(FloatV a, FloatV b) { return _mm_cmpgt_ps(a, b); }
+	inline std::uint32_t MaskBitsV(FloatV m) { return (std::uint32_t)_mm_movemask_ps(m); }
+#elif defined(SIMD_FLOAT_NEON)
+	typedef float32x4_t FloatV;
+	const std::uint32_t FloatVWidth = 4;
+	inline FloatV LoadV(const float* p) { return vld1q_f32(p); }
+	inline void StoreV(float* p, FloatV v) { vst1q_f32(p, v); }
+	inline FloatV SplatV(float s) { return vdupq_n_f32(s); }
+	inline FloatV AddV(FloatV a, FloatV b) { return vaddq_f32(a, b); }
+	inline FloatV SubV(FloatV a, FloatV b) { return vsubq_f32(a, b); }
+	inline FloatV MulV(FloatV a, FloatV b) { return vmulq_f32(a, b); }
+	inline FloatV DivV(FloatV a, FloatV b) { return vdivq_f32(a, b); }
+	inline FloatV SqrtV(FloatV a) { return vsqrtq_f32(a); }
+	inline FloatV MaxV(FloatV a, FloatV b) { return vmaxnmq_f32(a, b); }
+	inline FloatV MinV(FloatV a, FloatV b) { return vminnmq_f32(a, b); }
+	inline FloatV AndV(FloatV a, FloatV b)
+	{
+		return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+	}
+	inline FloatV OrV(FloatV a, FloatV b)
+	{
+		return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+	}
+	inline FloatV LessV(FloatV a, FloatV b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+	inline FloatV GreaterV(FloatV a, FloatV b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+	inline std::uint32_t MaskBitsV(FloatV m)
+	{
+		static const std::uint32_t laneBits[4] = { 1, 2, 4, 8 };
+		return vaddvq_u32(vandq_u32(vreinterpretq_u32_f32(m), vld1q_u32(laneBits)));
+	}
+#else
+	typedef float FloatV;
+	const std::uint32_t FloatVWidth = 1;
+	inline std::uint32_t FloatBits(float f) { std::uint32_t u; std::memcpy(&u, &f, sizeof(u)); return u; }
+	inline float BitsFloat(std::uint32_t u) { float f; std::memcpy(&f, &u, sizeof(f)); return f; }
+	inline FloatV LoadV(const float* p) { return *p; }
+	inline void StoreV(float* p, FloatV v) { *p = v; }
+	inline FloatV SplatV(float s) { return s; }
+	inline FloatV AddV(FloatV a, FloatV b) { return a + b; }
+	inline FloatV SubV(FloatV a, FloatV b) { return a - b; }
+	inline FloatV MulV(FloatV a, FloatV b) { return a*b; }
+	inline FloatV DivV(FloatV a, FloatV b) { return a / b; }
+	inline FloatV SqrtV(FloatV a) { return std::sqrt(a); }
+	inline FloatV MaxV(FloatV a, FloatV b) { return a > b ? a : b; }
+	inline FloatV MinV(FloatV a, FloatV b) { return a < b ? a : b; }
+	inline FloatV AndV(FloatV a, FloatV b) { return BitsFloat(FloatBits(a) & FloatBits(b)); }
+	inline FloatV OrV(FloatV a, FloatV b) { return BitsFloat(FloatBits(a) | FloatBits(b)); }
+	inline FloatV LessV(FloatV a, FloatV b) { return BitsFloat(a < b ? 0xffffffffu : 0u); }
+	inline FloatV GreaterV(FloatV a, FloatV b) { return BitsFloat(a > b ? 0xffffffffu : 0u); }
+	inline std::uint32_t MaskBitsV(FloatV m) { return FloatBits(m) >> 31; }
+#endif
+}
@@ -0,0 +1,190 @@
+//***************************************************************************************
+// StreamedTextures.cpp
+//***************************************************************************************
+
+#include "StreamedTextures.h"
+
+using Microsoft::WRL::ComPtr;
+
+StreamedTextures::StreamedTextures(ID3D12Device* device, const TextureStreamerSettings& settings)
+	: mDevice(device), mStreamer(settings)
+{
+}
+
+std::uint32_t StreamedTextures::Add(const std::wstring& filename)
+{
+	DdsError error = DdsError::None;
+	std::uint32_t index = mStreamer.Add(filename, &error);
+	if(index == TextureStreamer::InvalidTexture)
+	{
+		ThrowIfFailed(error == DdsError::OpenFailed ? HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) :
+			error == DdsError::NotSupported ? HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED) : E_FAIL);
+	}
+
+	// The textures are rebuilt at new sizes as they stream, which only 2D textures and
+	// arrays of them do here.
+	if(mStreamer.File(index).Texture().Dimension != DdsDimension::Texture2D)
+		ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+
+	mTextures.emplace_back();
+	mTextures.back().FirstMip = mStreamer.File(index).Texture().MipCount;
+	return index;
+}
+
+void StreamedTextures::Update(ID3D12GraphicsCommandList* cmdList, UINT64 completedFence, UINT64 frameFence)
+{
+	PROFILE_FUNCTION();
+
+	mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(),
+		[completedFence](const RetiredResource& r) { return r.Fence <= completedFence; }), mRetired.end());
+
+	mChanges.clear();
+	mStreamer.Update(mChanges);
+	for(const auto& change : mChanges)
+		Apply(cmdList, change, frameFence);
+}
+
+void StreamedTextures::Apply(ID3D12GraphicsCommandList* cmdList, const TextureResidencyChange& change, UINT64 frameFence)
+{
+	const DdsFile& file = mStreamer.File(change.Texture);
+	const DdsTexture& dds = file.Texture();
+	GpuTexture& gpu = mTextures[change.Texture];
+
+	const UINT oldMipLevels = dds.MipCount - change.OldFirstMip;
+	const UINT newMipLevels = dds.MipCount - change.NewFirstMip;
+	const DdsSubresource& top = dds.Subresources[change.NewFirstMip];
+
+	D3D12_RESOURCE_DESC texDesc = {};
+	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	texDesc.Width = top.Width;
+	texDesc.Height = top.Height;
+	texDesc.DepthOrArraySize = (UINT16)dds.ArraySize;
+	texDesc.MipLevels = (UINT16)newMipLevels;
+	texDesc.Format = (DXGI_FORMAT)dds.Format;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	ComPtr<ID3D12Resource> texture;
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&texDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&texture)));
+
+	// The mips both textures hold move across on the GPU.
+	if(gpu.Resource != nullptr)
+	{
+		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(gpu.Resource.Get(),
+			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+
+		const UINT firstShared = MathHelper::Max(change.OldFirstMip, change.NewFirstMip);
+		for(UINT slice = 0; slice < dds.ArraySize; ++slice)
+		{
+			for(UINT mip = firstShared; mip < dds.MipCount; ++mip)
+			{
+				CD3DX12_TEXTURE_COPY_LOCATION dst(texture.Get(),
+					D3D12CalcSubresource(mip - change.NewFirstMip, slice, 0, newMipLevels, dds.ArraySize));
+				CD3DX12_TEXTURE_COPY_LOCATION src(gpu.Resource.Get(),
+					D3D12CalcSubresource(mip - change.OldFirstMip, slice, 0, oldMipLevels, dds.ArraySize));
+				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+		}
+
+		mRetired.push_back({ gpu.Resource, frameFence });
+	}
+
+	// Newly loaded mips upload from the mapping, where the I/O thread has already read
+	// them in, through one upload buffer for all the array slices.
+	if(change.NewFirstMip < change.OldFirstMip)
+	{
+		const UINT loadedMips = change.OldFirstMip - change.NewFirstMip;
+
+		std::vector<UINT64> sliceOffsets(dds.ArraySize);
+		UINT64 uploadSize = 0;
+		for(UINT slice = 0; slice < dds.ArraySize; ++slice)
+		{
+			uploadSize = (uploadSize + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~(UINT64)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+			sliceOffsets[slice] = uploadSize;
+			uploadSize += GetRequiredIntermediateSize(texture.Get(), D3D12CalcSubresource(0, slice, 0, newMipLevels, dds.ArraySize), loadedMips);
+		}
+
+		ComPtr<ID3D12Resource> uploadBuffer;
+		ThrowIfFailed(mDevice->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(uploadSize),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&uploadBuffer)));
+
+		std::vector<D3D12_SUBRESOURCE_DATA> initData(loadedMips);
+		for(UINT slice = 0; slice < dds.ArraySize; ++slice)
+		{
+			for(UINT i = 0; i < loadedMips; ++i)
+			{
+				const DdsSubresource& sub = dds.Subresources[slice*dds.MipCount + change.NewFirstMip + i];
+				initData[i].pData = file.Data(sub);
+				initData[i].RowPitch = (LONG_PTR)sub.RowPitch;
+				initData[i].SlicePitch = (LONG_PTR)sub.SlicePitch;
+			}
+
+			UpdateSubresources(cmdList, texture.Get(), uploadBuffer.Get(), sliceOffsets[slice],
+				D3D12CalcSubresource(0, slice, 0, newMipLevels, dds.ArraySize), loadedMips, initData.data());
+		}
+
+		mRetired.push_back({ uploadBuffer, frameFence });
+	}
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+	mResidentBytes -= gpu.Bytes;
+	gpu.Resource = texture;
+	gpu.FirstMip = change.NewFirstMip;
+	gpu.Bytes = mDevice->GetResourceAllocationInfo(0, 1, &texDesc).SizeInBytes;
+	mResidentBytes += gpu.Bytes;
+}
+
+void StreamedTextures::WriteDescriptors(CD3DX12_CPU_DESCRIPTOR_HANDLE table, UINT descriptorSize)const
+{
+	for(std::uint32_t i = 0; i < (std::uint32_t)mTextures.size(); ++i)
+	{
+		const DdsTexture& dds = mStreamer.File(i).Texture();
+		const GpuTexture& gpu = mTextures[i];
+
+		UINT mipLevels = gpu.Resource != nullptr ? dds.MipCount - gpu.FirstMip : 1;
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = (DXGI_FORMAT)dds.Format;
+		if(dds.IsCubeMap && dds.ArraySize == 6)
+		{
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+			srvDesc.TextureCube.MostDetailedMip = 0;
+			srvDesc.TextureCube.MipLevels = mipLevels;
+			srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
+		}
+		else if(dds.ArraySize > 1)
+		{
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+			srvDesc.Texture2DArray.MostDetailedMip = 0;
+			srvDesc.Texture2DArray.MipLevels = mipLevels;
+			srvDesc.Texture2DArray.FirstArraySlice = 0;
+			srvDesc.Texture2DArray.ArraySize = dds.ArraySize;
+			srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0f;
+		}
+		else
+		{
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Texture2D.MostDetailedMip = 0;
+			srvDesc.Texture2D.MipLevels = mipLevels;
+			srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+		}
+
+		mDevice->CreateShaderResourceView(gpu.Resource.Get(), &srvDesc, table);
+		table.Offset(1, descriptorSize);
+	}
+}
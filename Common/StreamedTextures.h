@@ -0,0 +1,67 @@
+//***************************************************************************************
+// StreamedTextures.h
+//
+// The Direct3D 12 side of TextureStreamer.  It keeps one committed texture per streamed
+// file that holds exactly the resident mips.  When the streamer changes a texture's
+// resident mips, Update makes a texture of the new size.  The mips both textures share
+// are copied across on the GPU and newly loaded mips are uploaded straight from the
+// file's mapping.  The old texture is released once the frame that copied from it has
+// finished.  Shaders see the resident mips through SRVs that WriteDescriptors rewrites.
+// Rewrite them into a table the GPU is not reading, such as one per frame resource.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "TextureStreamer.h"
+
+class StreamedTextures
+{
+public:
+	StreamedTextures(ID3D12Device* device, const TextureStreamerSettings& settings = TextureStreamerSettings());
+	StreamedTextures(const StreamedTextures& rhs) = delete;
+	StreamedTextures& operator=(const StreamedTextures& rhs) = delete;
+
+	// Starts streaming a 2D texture or texture array; returns its index, which is also its
+	// descriptor's place in the tables WriteDescriptors fills.  Throws if the file cannot
+	// be loaded.
+	std::uint32_t Add(const std::wstring& filename);
+
+	std::uint32_t Count()const { return mStreamer.TextureCount(); }
+	TextureStreamer& Streamer() { return mStreamer; }
+
+	// Releases textures the GPU is done with, runs the streamer and records the copies
+	// its changes need into cmdList.  completedFence is the fence value the GPU has
+	// reached, and frameFence the one cmdList will signal.
+	void Update(ID3D12GraphicsCommandList* cmdList, UINT64 completedFence, UINT64 frameFence);
+
+	// Writes an SRV of every texture's resident mips, in Add order, starting at table.
+	// A texture with nothing resident yet gets a null SRV, which samples as zero.
+	void WriteDescriptors(CD3DX12_CPU_DESCRIPTOR_HANDLE table, UINT descriptorSize)const;
+
+	// Video memory of the resident textures.
+	std::uint64_t ResidentBytes()const { return mResidentBytes; }
+
+private:
+	struct GpuTexture
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		std::uint32_t FirstMip = 0;
+		std::uint64_t Bytes = 0;
+	};
+
+	struct RetiredResource
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT64 Fence = 0;
+	};
+
+	void Apply(ID3D12GraphicsCommandList* cmdList, const TextureResidencyChange& change, UINT64 frameFence);
+
+	Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+	TextureStreamer mStreamer;
+	std::vector<GpuTexture> mTextures;
+	std::vector<RetiredResource> mRetired;
+	std::vector<TextureResidencyChange> mChanges;
+	std::uint64_t mResidentBytes = 0;
+};
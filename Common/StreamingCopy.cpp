@@ -0,0 +1,52 @@
+//***************************************************************************************
+// StreamingCopy.cpp
+//***************************************************************************************
+
+#include "StreamingCopy.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define STREAMING_COPY_SSE
+#endif
+
+void StreamingCopy(void* dst, const void* src, std::size_t byteCount)
+{
+#if defined(STREAMING_COPY_SSE)
+	unsigned char* d = static_cast<unsigned char*>(dst);
+	const unsigned char* s = static_cast<const unsigned char*>(src);
+
+	// Streaming stores need a 16-byte aligned destination; the source can be anywhere.
+	std::size_t head = (16 - ((std::uintptr_t)d & 15)) & 15;
+	if(head > byteCount)
+		head = byteCount;
+	std::memcpy(d, s, head);
+	d += head;
+	s += head;
+	byteCount -= head;
+
+	for(; byteCount >= 64; byteCount -= 64, d += 64, s += 64)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(s + 0));
+		__m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+		__m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+		__m128i e = _mm_loadu_si128((const __m128i*)(s + 48));
+		_mm_stream_si128((__m128i*)(d + 0), a);
+		_mm_stream_si128((__m128i*)(d + 16), b);
+		_mm_stream_si128((__m128i*)(d + 32), c);
+		_mm_stream_si128((__m128i*)(d + 48), e);
+	}
+
+	for(; byteCount >= 16; byteCount -= 16, d += 16, s += 16)
+		_mm_stream_si128((__m128i*)d, _mm_loadu_si128((const __m128i*)s));
+
+	std::memcpy(d, s, byteCount);
+
+	// Streaming stores are weakly ordered; drain them before anyone is told the copy
+	// is done.
+	_mm_sfence();
+#else
+	std::memcpy(dst, src, byteCount);
+#endif
+}
@@ -0,0 +1,17 @@
+//***************************************************************************************
+// StreamingCopy.h
+//
+// Copies into write-combined memory such as a mapped upload heap.  Write-combined memory
+// is uncached: the CPU gathers writes in a few line-sized buffers and sends each buffer
+// over the bus when it fills or is evicted.  Small scattered writes evict partly filled
+// buffers and stall, so large blocks should be written front to back in whole lines.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+
+// Copies byteCount bytes from src to dst with non-temporal stores, 64 bytes at a time in
+// ascending order, and fences so the data is visible to other threads and the GPU once
+// the call returns.  Falls back to memcpy where there are no streaming stores.
+void StreamingCopy(void* dst, const void* src, std::size_t byteCount);
@@ -0,0 +1,300 @@
+//***************************************************************************************
+// TextureStreamer.cpp
+//***************************************************************************************
+
+#include "TextureStreamer.h"
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace
+{
+	// Page size to read a mip's pages at.  Reading a byte of each page faults the page
+	// into memory, which is all the I/O a mapped file needs.
+	const std::size_t IoPageSize = 4096;
+
+	// Where the page reads go, so they are not optimized away.
+	std::atomic<std::uint32_t> gIoSink(0);
+
+	struct MipCandidate
+	{
+		float Magnification;
+		std::uint32_t Texture;
+
+		bool operator<(const MipCandidate& rhs)const { return Magnification < rhs.Magnification; }
+	};
+}
+
+TextureStreamer::TextureStreamer(const TextureStreamerSettings& settings)
+	: mSettings(settings),
+	mIo(std::make_unique<ThreadPool>(settings.IoThreadCount > 0 ? settings.IoThreadCount : 1))
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	Wait();
+}
+
+std::uint32_t TextureStreamer::Add(const std::string& filename, DdsError* error)
+{
+	auto texture = std::make_unique<StreamedTexture>();
+	if(!texture->File.Open(filename, error))
+		return InvalidTexture;
+	return AddFile(std::move(texture));
+}
+
+#if defined(_WIN32)
+std::uint32_t TextureStreamer::Add(const std::wstring& filename, DdsError* error)
+{
+	auto texture = std::make_unique<StreamedTexture>();
+	if(!texture->File.Open(filename, error))
+		return InvalidTexture;
+	return AddFile(std::move(texture));
+}
+#endif
+
+std::uint32_t TextureStreamer::AddFile(std::unique_ptr<StreamedTexture> texture)
+{
+	const DdsTexture& dds = texture->File.Texture();
+	texture->MipCount = dds.MipCount;
+
+	texture->MipBytes.assign(dds.MipCount, 0);
+	for(const DdsSubresource& sub : dds.Subresources)
+		texture->MipBytes[sub.MipLevel] += sub.Size;
+	for(std::uint64_t bytes : texture->MipBytes)
+		mTotalBytes += bytes;
+
+	// The tail starts at the first mip within TailSize; a texture with no mip that small
+	// is all tail from its last mip.
+	texture->TailMip = dds.MipCount - 1;
+	while(texture->TailMip > 0)
+	{
+		const DdsSubresource& sub = dds.Subresources[texture->TailMip - 1];
+		if(sub.Width > mSettings.TailSize || sub.Height > mSettings.TailSize)
+			break;
+		--texture->TailMip;
+	}
+
+	texture->FirstResidentMip = dds.MipCount;
+	texture->LoadingMip = dds.MipCount;
+
+	std::uint32_t index = (std::uint32_t)mTextures.size();
+	mTextures.push_back(std::move(texture));
+	StartLoad(index, mTextures[index]->TailMip, mTextures[index]->MipCount);
+	return index;
+}
+
+void TextureStreamer::ClearRequests()
+{
+	for(auto& texture : mTextures)
+		texture->Texels = 0.0f;
+}
+
+void TextureStreamer::Request(std::uint32_t texture, float texels)
+{
+	StreamedTexture& t = *mTextures[texture];
+	t.Texels = texels > t.Texels ? texels : t.Texels;
+}
+
+std::uint32_t TextureStreamer::DesiredMip(std::uint32_t texture)const
+{
+	const StreamedTexture& t = *mTextures[texture];
+	const DdsSubresource& top = t.File.Texture().Subresources[0];
+	float size = (float)(top.Width > top.Height ? top.Width : top.Height);
+
+	// The coarsest mip at least as wide as the request, so no pixel spans more than a
+	// texel.
+	if(t.Texels <= 0.0f)
+		return t.TailMip;
+	float mip = std::floor(std::log2(size / t.Texels));
+	if(mip <= 0.0f)
+		return 0;
+	return mip >= (float)t.TailMip ? t.TailMip : (std::uint32_t)mip;
+}
+
+float TextureStreamer::Magnification(const StreamedTexture& texture, std::uint32_t mip)const
+{
+	const DdsSubresource& sub = texture.File.Texture().Subresources[mip];
+	return texture.Texels / (float)(sub.Width > sub.Height ? sub.Width : sub.Height);
+}
+
+void TextureStreamer::StartLoad(std::uint32_t texture, std::uint32_t firstMip, std::uint32_t endMip)
+{
+	StreamedTexture* t = mTextures[texture].get();
+	t->LoadingMip = firstMip;
+	for(std::uint32_t mip = firstMip; mip < endMip; ++mip)
+		mLoadingBytes += t->MipBytes[mip];
+	++mLoadsInFlight;
+
+	// Only File is read on the I/O thread, and it does not change after Add.
+	MipLoad load = { texture, firstMip, endMip };
+	mIo->Enqueue([this, t, load]()
+	{
+		const DdsTexture& dds = t->File.Texture();
+		std::uint32_t sum = 0;
+		for(std::uint32_t slice = 0; slice < dds.ArraySize; ++slice)
+		{
+			for(std::uint32_t mip = load.FirstMip; mip < load.EndMip; ++mip)
+			{
+				const DdsSubresource& sub = dds.Subresources[slice*dds.MipCount + mip];
+				const std::uint8_t* data = t->File.Data(sub);
+				for(std::uint64_t offset = 0; offset < sub.Size; offset += IoPageSize)
+					sum += data[offset];
+				sum += data[sub.Size - 1];
+			}
+		}
+		gIoSink.fetch_add(sum, std::memory_order_relaxed);
+
+		std::lock_guard<std::mutex> lock(mFinishedMutex);
+		mFinished.push_back(load);
+	});
+}
+
+void TextureStreamer::MarkChanged(StreamedTexture& texture)
+{
+	if(!texture.Changed)
+	{
+		texture.Changed = true;
+		texture.OldFirstMip = texture.FirstResidentMip;
+	}
+}
+
+TextureStreamer::StreamedTexture* TextureStreamer::FindVictim(std::uint32_t texture, float magnification)
+{
+	// The finest mip of the least magnified texture that has mips above its tail and none
+	// loading.  A mip only goes for one that is more magnified, so two textures never
+	// trade a mip back and forth.
+	StreamedTexture* victim = nullptr;
+	float victimMagnification = magnification;
+	for(std::uint32_t i = 0; i < (std::uint32_t)mTextures.size(); ++i)
+	{
+		StreamedTexture& t = *mTextures[i];
+		if(i == texture || t.FirstResidentMip >= t.TailMip || t.LoadingMip != t.FirstResidentMip)
+			continue;
+
+		float m = Magnification(t, t.FirstResidentMip);
+		if(m < victimMagnification)
+		{
+			victim = &t;
+			victimMagnification = m;
+		}
+	}
+	return victim;
+}
+
+void TextureStreamer::Evict(StreamedTexture& texture)
+{
+	MarkChanged(texture);
+	mResidentBytes -= texture.MipBytes[texture.FirstResidentMip];
+	++texture.FirstResidentMip;
+	texture.LoadingMip = texture.FirstResidentMip;
+	++mEvictionCount;
+}
+
+bool TextureStreamer::EvictFor(std::uint32_t texture, float magnification, std::uint64_t bytes)
+{
+	std::uint64_t used = mResidentBytes + mLoadingBytes;
+	if(used + bytes <= mSettings.MemoryBudget)
+		return true;
+
+	// Evict nothing unless enough can go.  Evicting only part of the way would free room
+	// that a less magnified mip could take back on the next update, over and over.
+	std::uint64_t freeable = 0;
+	for(std::uint32_t i = 0; i < (std::uint32_t)mTextures.size(); ++i)
+	{
+		const StreamedTexture& t = *mTextures[i];
+		if(i == texture || t.LoadingMip != t.FirstResidentMip)
+			continue;
+		for(std::uint32_t mip = t.FirstResidentMip; mip < t.TailMip && Magnification(t, mip) < magnification; ++mip)
+			freeable += t.MipBytes[mip];
+	}
+	if(used + bytes > mSettings.MemoryBudget + freeable)
+		return false;
+
+	while(mResidentBytes + mLoadingBytes + bytes > mSettings.MemoryBudget)
+		Evict(*FindVictim(texture, magnification));
+	return true;
+}
+
+void TextureStreamer::Update(std::vector<TextureResidencyChange>& changes)
+{
+	//
+	// Apply the finished loads.
+	//
+
+	std::vector<MipLoad> finished;
+	{
+		std::lock_guard<std::mutex> lock(mFinishedMutex);
+		finished.swap(mFinished);
+	}
+
+	for(const MipLoad& load : finished)
+	{
+		StreamedTexture& t = *mTextures[load.Texture];
+		MarkChanged(t);
+		for(std::uint32_t mip = load.FirstMip; mip < load.EndMip; ++mip)
+		{
+			mLoadingBytes -= t.MipBytes[mip];
+			mResidentBytes += t.MipBytes[mip];
+		}
+		t.FirstResidentMip = load.FirstMip;
+		--mLoadsInFlight;
+		++mLoadCount;
+	}
+
+	//
+	// Queue the next finer mip of every texture with its tail in that needs more, most
+	// magnified first, and start what fits.
+	//
+
+	std::priority_queue<MipCandidate> candidates;
+	for(std::uint32_t i = 0; i < (std::uint32_t)mTextures.size(); ++i)
+	{
+		StreamedTexture& t = *mTextures[i];
+		if(t.FirstResidentMip == t.MipCount || t.LoadingMip != t.FirstResidentMip)
+			continue;
+		if(t.FirstResidentMip > DesiredMip(i))
+			candidates.push({ Magnification(t, t.FirstResidentMip - 1), i });
+	}
+
+	while(!candidates.empty() && mLoadsInFlight < mSettings.MaxLoadsInFlight)
+	{
+		MipCandidate candidate = candidates.top();
+		candidates.pop();
+
+		StreamedTexture& t = *mTextures[candidate.Texture];
+		std::uint32_t mip = t.FirstResidentMip - 1;
+		if(EvictFor(candidate.Texture, candidate.Magnification, t.MipBytes[mip]))
+			StartLoad(candidate.Texture, mip, mip + 1);
+	}
+
+	// A budget lowered below what is resident evicts down to it, least magnified first.
+	while(mResidentBytes + mLoadingBytes > mSettings.MemoryBudget)
+	{
+		StreamedTexture* victim = FindVictim(InvalidTexture, std::numeric_limits<float>::max());
+		if(victim == nullptr)
+			break;
+		Evict(*victim);
+	}
+
+	for(std::uint32_t i = 0; i < (std::uint32_t)mTextures.size(); ++i)
+	{
+		StreamedTexture& t = *mTextures[i];
+		if(t.Changed && t.OldFirstMip != t.FirstResidentMip)
+		{
+			TextureResidencyChange change;
+			change.Texture = i;
+			change.OldFirstMip = t.OldFirstMip;
+			change.NewFirstMip = t.FirstResidentMip;
+			changes.push_back(change);
+		}
+		t.Changed = false;
+	}
+}
+
+void TextureStreamer::Wait()
+{
+	mIo->Wait();
+}
@@ -0,0 +1,166 @@
+//***************************************************************************************
+// TextureStreamer.h
+//
+// Decides which mips of a set of DDS textures are resident, without Direct3D.  Each
+// texture first loads its tail, the mips no larger than TailSize, which stay resident.
+// After that it streams one finer mip at a time for as long as the renderer reports the
+// texture needs more texels on screen than it has.  A priority queue orders these loads
+// by how magnified each texture is.  When the next load would go over the memory budget,
+// the finest mips of the least magnified textures are evicted to make room.
+//
+// Loads run on I/O threads.  A load reads a mip's pages out of the file's mapping, so
+// once it finishes the renderer can copy the mip from File(texture) without waiting on
+// the disk.  Update runs on the renderer's thread.  It applies finished loads, starts new
+// ones and reports every texture whose resident mips changed.
+//***************************************************************************************
+
+#pragma once
+
+#include "DdsFile.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TextureStreamerSettings
+{
+	// Bytes of texture data that may be resident.  The tails are always resident and
+	// count against it, even past it.
+	std::uint64_t MemoryBudget = 64ull << 20;
+
+	// Mips no wider or taller than this make up a texture's tail.
+	std::uint32_t TailSize = 64;
+
+	unsigned int IoThreadCount = 2;
+
+	// Mip loads start only while fewer loads than this are in flight; tails start when
+	// they are added.  Keeping it low lets a change of view reorder the loads not started.
+	std::uint32_t MaxLoadsInFlight = 4;
+};
+
+// The resident mips of Texture went from [OldFirstMip, MipCount) to [NewFirstMip,
+// MipCount).  A first mip of MipCount means nothing was resident.  When NewFirstMip is
+// the smaller, mips [NewFirstMip, OldFirstMip) were loaded; when it is the larger, mips
+// were evicted.
+struct TextureResidencyChange
+{
+	std::uint32_t Texture = 0;
+	std::uint32_t OldFirstMip = 0;
+	std::uint32_t NewFirstMip = 0;
+};
+
+class TextureStreamer
+{
+public:
+	static const std::uint32_t InvalidTexture = 0xffffffff;
+
+	explicit TextureStreamer(const TextureStreamerSettings& settings = TextureStreamerSettings());
+	TextureStreamer(const TextureStreamer& rhs) = delete;
+	TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+	~TextureStreamer();
+
+	// Maps and parses filename and starts loading its tail.  Returns the texture's index,
+	// or InvalidTexture if the file cannot be opened or parsed.
+	std::uint32_t Add(const std::string& filename, DdsError* error = nullptr);
+#if defined(_WIN32)
+	std::uint32_t Add(const std::wstring& filename, DdsError* error = nullptr);
+#endif
+
+	std::uint32_t TextureCount()const { return (std::uint32_t)mTextures.size(); }
+	const DdsFile& File(std::uint32_t texture)const { return mTextures[texture]->File; }
+
+	//
+	// The screen-space estimate.  Each frame, ClearRequests and then Request every texture
+	// in view with how many texels across it would take to cover its use on screen with a
+	// texel per pixel: its size in pixels divided by how often it repeats.  The largest
+	// request of the frame counts.  A texture not requested is not needed beyond its tail.
+	//
+
+	void ClearRequests();
+	void Request(std::uint32_t texture, float texels);
+
+	// Applies finished loads, evicts and starts loads, and appends the textures whose
+	// resident mips changed since the last call to changes, one entry per texture.
+	void Update(std::vector<TextureResidencyChange>& changes);
+
+	// Blocks until the loads in flight have finished; the next Update applies them.
+	void Wait();
+
+	void SetMemoryBudget(std::uint64_t bytes) { mSettings.MemoryBudget = bytes; }
+	std::uint64_t MemoryBudget()const { return mSettings.MemoryBudget; }
+
+	std::uint32_t FirstResidentMip(std::uint32_t texture)const { return mTextures[texture]->FirstResidentMip; }
+	std::uint32_t TailMip(std::uint32_t texture)const { return mTextures[texture]->TailMip; }
+
+	// The finest mip the last requests call for.
+	std::uint32_t DesiredMip(std::uint32_t texture)const;
+
+	// Bytes of the resident mips, and of every mip of every texture.
+	std::uint64_t ResidentBytes()const { return mResidentBytes; }
+	std::uint64_t TotalBytes()const { return mTotalBytes; }
+
+	std::uint64_t LoadCount()const { return mLoadCount; }
+	std::uint64_t EvictionCount()const { return mEvictionCount; }
+	std::uint32_t LoadsInFlight()const { return mLoadsInFlight; }
+
+private:
+	struct StreamedTexture
+	{
+		DdsFile File;
+		std::uint32_t MipCount = 0;
+		std::uint32_t TailMip = 0;
+
+		// MipCount until the tail is in.
+		std::uint32_t FirstResidentMip = 0;
+
+		// The first mip of the load in flight, or FirstResidentMip if there is none.
+		std::uint32_t LoadingMip = 0;
+
+		// The largest request since ClearRequests.
+		float Texels = 0.0f;
+
+		// Bytes of each mip over all the array slices.
+		std::vector<std::uint64_t> MipBytes;
+
+		// Whether Update has changed FirstResidentMip yet, and what it was before.
+		bool Changed = false;
+		std::uint32_t OldFirstMip = 0;
+	};
+
+	struct MipLoad
+	{
+		std::uint32_t Texture;
+		std::uint32_t FirstMip;
+		std::uint32_t EndMip;
+	};
+
+	std::uint32_t AddFile(std::unique_ptr<StreamedTexture> texture);
+	void StartLoad(std::uint32_t texture, std::uint32_t firstMip, std::uint32_t endMip);
+	float Magnification(const StreamedTexture& texture, std::uint32_t mip)const;
+	void MarkChanged(StreamedTexture& texture);
+	StreamedTexture* FindVictim(std::uint32_t texture, float magnification);
+	void Evict(StreamedTexture& texture);
+
+	// Evicts mips less magnified than magnification, from textures other than texture,
+	// until bytes more fit in the budget.  False if they cannot be made to fit.
+	bool EvictFor(std::uint32_t texture, float magnification, std::uint64_t bytes);
+
+	TextureStreamerSettings mSettings;
+	std::vector<std::unique_ptr<StreamedTexture>> mTextures;
+
+	std::uint64_t mResidentBytes = 0;
+	std::uint64_t mLoadingBytes = 0;
+	std::uint64_t mTotalBytes = 0;
+	std::uint32_t mLoadsInFlight = 0;
+	std::uint64_t mLoadCount = 0;
+	std::uint64_t mEvictionCount = 0;
+
+	// Loads the I/O threads have finished and Update has not yet applied.
+	std::mutex mFinishedMutex;
+	std::vector<MipLoad> mFinished;
+
+	// Last, so it is destroyed first and no I/O thread outlives what it touches.
+	std::unique_ptr<ThreadPool> mIo;
+};
@@ -0,0 +1,167 @@
+//***************************************************************************************
+// ThreadPool.cpp
+//***************************************************************************************
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+	// The pool whose worker this thread is, and its index there.
+	thread_local const ThreadPool* gThreadPool = nullptr;
+	thread_local unsigned int gThreadIndex = 0;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if(threadCount == 0)
+	{
+		unsigned int hw = std::thread::hardware_concurrency();
+		threadCount = hw > 1 ? hw - 1 : 1;
+	}
+
+	mWorkers.reserve(threadCount);
+	for(unsigned int i = 0; i < threadCount; ++i)
+		mWorkers.emplace_back(&ThreadPool::WorkerMain, this, i + 1);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mTaskReady.notify_all();
+
+	for(auto& t : mWorkers)
+		t.join();
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTasks.push_back(std::move(task));
+		++mPendingTasks;
+	}
+	mTaskReady.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mTasksDone.wait(lock, [this] { return mPendingTasks == 0; });
+}
+
+void ThreadPool::ParallelFor(int first, int last, const std::function<void(int)>& func)
+{
+	ParallelForRange(first, last, 0, [&func](int begin, int end)
+	{
+		for(int i = begin; i < end; ++i)
+			func(i);
+	});
+}
+
+void ThreadPool::ParallelForRange(int first, int last, int grainSize,
+	const std::function<void(int, int)>& func)
+{
+	const int count = last - first;
+	if(count <= 0)
+		return;
+
+	const int threads = (int)ConcurrencyLevel();
+	if(grainSize <= 0)
+		grainSize = (count + threads - 1) / threads;
+
+	const int chunkCount = (count + grainSize - 1) / grainSize;
+
+	// Pool tasks that fan out again would wait on helpers queued behind themselves, so
+	// nested calls from one of this pool's workers just run the whole range inline.
+	if(chunkCount == 1 || mWorkers.empty() || OwnsCurrentThread())
+	{
+		func(first, last);
+		return;
+	}
+
+	// Every participating thread pulls chunks off a shared counter until none are left,
+	// so uneven chunk costs balance out.  The calling thread takes part as well.
+	std::atomic<int> nextChunk(0);
+	auto drain = [&]()
+	{
+		for(int c = nextChunk++; c < chunkCount; c = nextChunk++)
+		{
+			int begin = first + c*grainSize;
+			int end = std::min(begin + grainSize, last);
+			func(begin, end);
+		}
+	};
+
+	// The helpers reference locals on this stack frame, so do not return until every
+	// one of them has left drain().
+	const int helpers = std::min(chunkCount - 1, (int)mWorkers.size());
+	int helpersDone = 0;
+	std::mutex doneMutex;
+	std::condition_variable doneCV;
+
+	for(int i = 0; i < helpers; ++i)
+	{
+		Enqueue([&]()
+		{
+			drain();
+
+			std::lock_guard<std::mutex> lock(doneMutex);
+			if(++helpersDone == helpers)
+				doneCV.notify_one();
+		});
+	}
+
+	drain();
+
+	std::unique_lock<std::mutex> lock(doneMutex);
+	doneCV.wait(lock, [&] { return helpersDone == helpers; });
+}
+
+unsigned int ThreadPool::CurrentThreadIndex()const
+{
+	return OwnsCurrentThread() ? gThreadIndex : 0;
+}
+
+bool ThreadPool::OwnsCurrentThread()const
+{
+	return gThreadPool == this;
+}
+
+ThreadPool& ThreadPool::Default()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::WorkerMain(unsigned int index)
+{
+	gThreadPool = this;
+	gThreadIndex = index;
+
+	for(;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mTaskReady.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+
+			if(mStopping && mTasks.empty())
+				return;
+
+			task = std::move(mTasks.front());
+			mTasks.pop_front();
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if(--mPendingTasks == 0)
+				mTasksDone.notify_all();
+		}
+	}
+}
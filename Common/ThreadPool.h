@@ -0,0 +1,75 @@
+//***************************************************************************************
+// ThreadPool.h
+//
+// Small portable worker pool built on std::thread.  Used by the CPU-side simulation and
+// processing code in place of concurrency::parallel_for so the same code runs on
+// platforms without the Windows PPL.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// threadCount is the number of worker threads to spawn.  Zero picks one worker less
+	// than the hardware concurrency, since the calling thread also does work in ParallelFor.
+	explicit ThreadPool(unsigned int threadCount = 0);
+	ThreadPool(const ThreadPool& rhs) = delete;
+	ThreadPool& operator=(const ThreadPool& rhs) = delete;
+	~ThreadPool();
+
+	unsigned int WorkerCount()const { return (unsigned int)mWorkers.size(); }
+
+	// Number of threads that can run a ParallelFor body at the same time (workers plus
+	// the calling thread).  Use this to size per-thread scratch storage.
+	unsigned int ConcurrencyLevel()const { return WorkerCount() + 1; }
+
+	// Queues a task to run on a worker thread.
+	void Enqueue(std::function<void()> task);
+
+	// Blocks until every task queued with Enqueue has finished.
+	void Wait();
+
+	// Calls func(i) for every i in [first, last) and returns when all calls are done.
+	// When called from one of this pool's own tasks the loop runs on the calling thread;
+	// workers of other pools fan out like any other caller.
+	void ParallelFor(int first, int last, const std::function<void(int)>& func);
+
+	// Splits [first, last) into contiguous ranges of at most grainSize elements and calls
+	// func(begin, end) for each range.  A grainSize <= 0 picks one range per thread.
+	void ParallelForRange(int first, int last, int grainSize,
+		const std::function<void(int, int)>& func);
+
+	// Index of the calling thread in [0, ConcurrencyLevel()).  This pool's workers return
+	// 1..WorkerCount(); any other thread, including a worker of another pool, returns 0.
+	unsigned int CurrentThreadIndex()const;
+
+	// True on this pool's worker threads.
+	bool OwnsCurrentThread()const;
+
+	// Shared pool sized to the machine, created on first use.
+	static ThreadPool& Default();
+
+private:
+	void WorkerMain(unsigned int index);
+
+private:
+	std::vector<std::thread> mWorkers;
+	std::deque<std::function<void()>> mTasks;
+
+	std::mutex mMutex;
+	std::condition_variable mTaskReady;
+	std::condition_variable mTasksDone;
+
+	std::uint32_t mPendingTasks = 0;
+	bool mStopping = false;
+};
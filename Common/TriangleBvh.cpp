@@ -0,0 +1,390 @@
+//***************************************************************************************
+// TriangleBvh.cpp
+//***************************************************************************************
+
+#include "TriangleBvh.h"
+#include "MathHelper.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+using namespace DirectX;
+
+namespace
+{
+	float Component(const XMFLOAT3& v, int axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+
+	// Half the surface area of a box, which is all the SAH needs to compare splits.
+	float HalfArea(FXMVECTOR boxMin, FXMVECTOR boxMax)
+	{
+		XMFLOAT3 d;
+		XMStoreFloat3(&d, XMVectorMax(XMVectorSubtract(boxMax, boxMin), XMVectorZero()));
+		return d.x*d.y + d.y*d.z + d.z*d.x;
+	}
+
+	// Lanes of a degenerate triangle: all corners at the origin, so the determinant is 0.
+	const XMFLOAT4 ZeroLanes(0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+void TriangleBvh::Build(const void* vertices, std::uint32_t vertexStride, const std::uint32_t* indices,
+	std::uint32_t triangleCount, std::int32_t baseVertex)
+{
+	mNodes.clear();
+	mPackets.clear();
+	mTriangleCount = triangleCount;
+
+	if(triangleCount == 0)
+		return;
+
+	BuildContext context;
+	context.Corners.resize(3*(size_t)triangleCount);
+	context.Triangles.resize(triangleCount);
+	context.Order.resize(triangleCount);
+	std::iota(context.Order.begin(), context.Order.end(), 0u);
+
+	const char* vertexBytes = static_cast<const char*>(vertices);
+	for(std::uint32_t t = 0; t < triangleCount; ++t)
+	{
+		XMVECTOR p[3];
+		for(int k = 0; k < 3; ++k)
+		{
+			XMFLOAT3& corner = context.Corners[3*(size_t)t + k];
+			std::memcpy(&corner, vertexBytes + (std::int64_t)(indices[3*(size_t)t + k] + baseVertex)*vertexStride, sizeof(XMFLOAT3));
+			p[k] = XMLoadFloat3(&corner);
+		}
+
+		XMVECTOR boxMin = XMVectorMin(p[0], XMVectorMin(p[1], p[2]));
+		XMVECTOR boxMax = XMVectorMax(p[0], XMVectorMax(p[1], p[2]));
+
+		BuildTriangle& tri = context.Triangles[t];
+		XMStoreFloat3(&tri.Min, boxMin);
+		XMStoreFloat3(&tri.Max, boxMax);
+		XMStoreFloat3(&tri.Centroid, XMVectorScale(XMVectorAdd(boxMin, boxMax), 0.5f));
+	}
+
+	// Every split leaves at least one triangle on each side and leaves hold at least one,
+	// so there are fewer than 2n nodes.
+	mNodes.reserve(2*(size_t)triangleCount);
+	mPackets.reserve((triangleCount + MaxLeafSize - 1) / MaxLeafSize * 2);
+	BuildNode(0, triangleCount, 0, context);
+}
+
+void TriangleBvh::BuildNode(std::uint32_t first, std::uint32_t count, std::uint32_t depth, BuildContext& context)
+{
+	std::uint32_t index = (std::uint32_t)mNodes.size();
+
+	XMVECTOR boxMin = XMLoadFloat3(&context.Triangles[context.Order[first]].Min);
+	XMVECTOR boxMax = XMLoadFloat3(&context.Triangles[context.Order[first]].Max);
+	for(std::uint32_t i = first + 1; i < first + count; ++i)
+	{
+		const BuildTriangle& tri = context.Triangles[context.Order[i]];
+		boxMin = XMVectorMin(boxMin, XMLoadFloat3(&tri.Min));
+		boxMax = XMVectorMax(boxMax, XMLoadFloat3(&tri.Max));
+	}
+
+	Node node;
+	XMStoreFloat3(&node.Min, boxMin);
+	XMStoreFloat3(&node.Max, boxMax);
+	node.Skip = index + 1;
+	node.Packet = NoPacket;
+	mNodes.push_back(node);
+
+	if(count <= MaxLeafSize)
+	{
+		TrianglePacket packet;
+		for(int k = 0; k < 3; ++k)
+		{
+			packet.P0[k] = ZeroLanes;
+			packet.Edge1[k] = ZeroLanes;
+			packet.Edge2[k] = ZeroLanes;
+		}
+
+		for(std::uint32_t lane = 0; lane < 4; ++lane)
+		{
+			packet.Triangle[lane] = lane < count ? context.Order[first + lane] : 0;
+			if(lane >= count)
+				continue;
+
+			const XMFLOAT3* p = &context.Corners[3*(size_t)packet.Triangle[lane]];
+			const XMFLOAT3 e1(p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z);
+			const XMFLOAT3 e2(p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z);
+			for(int k = 0; k < 3; ++k)
+			{
+				(&packet.P0[k].x)[lane] = Component(p[0], k);
+				(&packet.Edge1[k].x)[lane] = Component(e1, k);
+				(&packet.Edge2[k].x)[lane] = Component(e2, k);
+			}
+		}
+
+		mNodes[index].Packet = (std::uint32_t)mPackets.size();
+		mPackets.push_back(packet);
+		return;
+	}
+
+	std::uint32_t split = depth < MaxSahDepth ? SplitSah(first, count, context) : 0;
+	if(split == 0)
+		split = SplitMedian(first, count, context);
+
+	BuildNode(first, split, depth + 1, context);
+	BuildNode(first + split, count - split, depth + 1, context);
+
+	mNodes[index].Skip = (std::uint32_t)mNodes.size();
+}
+
+std::uint32_t TriangleBvh::SplitSah(std::uint32_t first, std::uint32_t count, BuildContext& context)const
+{
+	const BuildTriangle* triangles = context.Triangles.data();
+	std::uint32_t* order = context.Order.data() + first;
+
+	XMVECTOR cmin = XMLoadFloat3(&triangles[order[0]].Centroid);
+	XMVECTOR cmax = cmin;
+	for(std::uint32_t i = 1; i < count; ++i)
+	{
+		XMVECTOR c = XMLoadFloat3(&triangles[order[i]].Centroid);
+		cmin = XMVectorMin(cmin, c);
+		cmax = XMVectorMax(cmax, c);
+	}
+
+	XMFLOAT3 lo, hi;
+	XMStoreFloat3(&lo, cmin);
+	XMStoreFloat3(&hi, cmax);
+
+	struct Bin
+	{
+		XMVECTOR Min;
+		XMVECTOR Max;
+		std::uint32_t Count;
+	};
+
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	std::uint32_t bestBin = 0;
+
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		const float axisMin = Component(lo, axis);
+		const float axisExtent = Component(hi, axis) - axisMin;
+		if(axisExtent <= 0.0f)
+			continue;
+		const float binScale = SahBinCount / axisExtent;
+
+		Bin bins[SahBinCount];
+		for(auto& bin : bins)
+		{
+			bin.Min = XMVectorReplicate(FLT_MAX);
+			bin.Max = XMVectorReplicate(-FLT_MAX);
+			bin.Count = 0;
+		}
+
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			const BuildTriangle& tri = triangles[order[i]];
+			std::uint32_t b = MathHelper::Min((std::uint32_t)((Component(tri.Centroid, axis) - axisMin)*binScale), SahBinCount - 1);
+			bins[b].Min = XMVectorMin(bins[b].Min, XMLoadFloat3(&tri.Min));
+			bins[b].Max = XMVectorMax(bins[b].Max, XMLoadFloat3(&tri.Max));
+			++bins[b].Count;
+		}
+
+		// Sweep from the right to get the cost of everything right of each boundary, then
+		// from the left to total it up.  Splitting after bin b puts bins [0, b] first.
+		float rightCost[SahBinCount];
+		XMVECTOR rmin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR rmax = XMVectorReplicate(-FLT_MAX);
+		std::uint32_t rcount = 0;
+		for(std::uint32_t b = SahBinCount - 1; b > 0; --b)
+		{
+			rmin = XMVectorMin(rmin, bins[b].Min);
+			rmax = XMVectorMax(rmax, bins[b].Max);
+			rcount += bins[b].Count;
+			rightCost[b] = rcount*HalfArea(rmin, rmax);
+		}
+
+		XMVECTOR lmin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR lmax = XMVectorReplicate(-FLT_MAX);
+		std::uint32_t lcount = 0;
+		for(std::uint32_t b = 0; b + 1 < SahBinCount; ++b)
+		{
+			lmin = XMVectorMin(lmin, bins[b].Min);
+			lmax = XMVectorMax(lmax, bins[b].Max);
+			lcount += bins[b].Count;
+			if(lcount == 0 || lcount == count)
+				continue;
+
+			float cost = lcount*HalfArea(lmin, lmax) + rightCost[b + 1];
+			if(cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	if(bestAxis < 0)
+		return 0;
+
+	const float axisMin = Component(lo, bestAxis);
+	const float binScale = SahBinCount / (Component(hi, bestAxis) - axisMin);
+	std::uint32_t* middle = std::partition(order, order + count, [&](std::uint32_t t)
+	{
+		std::uint32_t b = MathHelper::Min((std::uint32_t)((Component(triangles[t].Centroid, bestAxis) - axisMin)*binScale), SahBinCount - 1);
+		return b <= bestBin;
+	});
+
+	return (std::uint32_t)(middle - order);
+}
+
+std::uint32_t TriangleBvh::SplitMedian(std::uint32_t first, std::uint32_t count, BuildContext& context)const
+{
+	const BuildTriangle* triangles = context.Triangles.data();
+	std::uint32_t* order = context.Order.data() + first;
+
+	XMVECTOR cmin = XMLoadFloat3(&triangles[order[0]].Centroid);
+	XMVECTOR cmax = cmin;
+	for(std::uint32_t i = 1; i < count; ++i)
+	{
+		XMVECTOR c = XMLoadFloat3(&triangles[order[i]].Centroid);
+		cmin = XMVectorMin(cmin, c);
+		cmax = XMVectorMax(cmax, c);
+	}
+
+	XMFLOAT3 spread;
+	XMStoreFloat3(&spread, XMVectorSubtract(cmax, cmin));
+
+	int axis = 0;
+	if(spread.y > spread.x)
+		axis = 1;
+	if(spread.z > Component(spread, axis))
+		axis = 2;
+
+	std::uint32_t half = count / 2;
+	std::nth_element(order, order + half, order + count, [triangles, axis](std::uint32_t a, std::uint32_t b)
+	{
+		return Component(triangles[a].Centroid, axis) < Component(triangles[b].Centroid, axis);
+	});
+
+	return half;
+}
+
+BoundingBox TriangleBvh::Bounds()const
+{
+	BoundingBox box;
+	if(!mNodes.empty())
+		BoundingBox::CreateFromPoints(box, XMLoadFloat3(&mNodes[0].Min), XMLoadFloat3(&mNodes[0].Max));
+	return box;
+}
+
+bool TriangleBvh::Intersect(FXMVECTOR origin, FXMVECTOR direction, TriangleRayHit& hit, float maxT)const
+{
+	const XMVECTOR invDirection = XMVectorReciprocal(direction);
+
+	const XMVECTOR rayOrigin[3] = { XMVectorSplatX(origin), XMVectorSplatY(origin), XMVectorSplatZ(origin) };
+	const XMVECTOR rayDirection[3] = { XMVectorSplatX(direction), XMVectorSplatY(direction), XMVectorSplatZ(direction) };
+
+	hit.T = maxT;
+	bool found = false;
+
+	const std::uint32_t nodeCount = (std::uint32_t)mNodes.size();
+	std::uint32_t index = 0;
+	while(index < nodeCount)
+	{
+		const Node& node = mNodes[index];
+
+		// Slab test: the ray is inside the box between the largest entry and the smallest
+		// exit distance over the three axes.
+		XMVECTOR t0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&node.Min), origin), invDirection);
+		XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&node.Max), origin), invDirection);
+		XMFLOAT3 enter, exit;
+		XMStoreFloat3(&enter, XMVectorMin(t0, t1));
+		XMStoreFloat3(&exit, XMVectorMax(t0, t1));
+
+		float tEnter = MathHelper::Max(MathHelper::Max(enter.x, enter.y), MathHelper::Max(enter.z, 0.0f));
+		float tExit = MathHelper::Min(MathHelper::Min(exit.x, exit.y), exit.z);
+
+		// Boxes entered beyond the nearest hit so far cannot hold a nearer one.
+		if(tEnter > tExit || tEnter >= hit.T)
+		{
+			index = node.Skip;
+			continue;
+		}
+
+		if(node.Packet != NoPacket)
+			found = IntersectPacket(mPackets[node.Packet], rayOrigin, rayDirection, hit) || found;
+
+		++index;
+	}
+
+	return found;
+}
+
+bool TriangleBvh::IntersectPacket(const TrianglePacket& packet, const XMVECTOR origin[3],
+	const XMVECTOR direction[3], TriangleRayHit& hit)
+{
+	const XMVECTOR e1x = XMLoadFloat4(&packet.Edge1[0]);
+	const XMVECTOR e1y = XMLoadFloat4(&packet.Edge1[1]);
+	const XMVECTOR e1z = XMLoadFloat4(&packet.Edge1[2]);
+	const XMVECTOR e2x = XMLoadFloat4(&packet.Edge2[0]);
+	const XMVECTOR e2y = XMLoadFloat4(&packet.Edge2[1]);
+	const XMVECTOR e2z = XMLoadFloat4(&packet.Edge2[2]);
+	const XMVECTOR& dx = direction[0];
+	const XMVECTOR& dy = direction[1];
+	const XMVECTOR& dz = direction[2];
+
+	// Moller-Trumbore on four triangles at once, as TriangleTests::Intersects does for one.
+	// p = d x e2
+	XMVECTOR px = XMVectorSubtract(XMVectorMultiply(dy, e2z), XMVectorMultiply(dz, e2y));
+	XMVECTOR py = XMVectorSubtract(XMVectorMultiply(dz, e2x), XMVectorMultiply(dx, e2z));
+	XMVECTOR pz = XMVectorSubtract(XMVectorMultiply(dx, e2y), XMVectorMultiply(dy, e2x));
+
+	XMVECTOR det = XMVectorAdd(XMVectorAdd(XMVectorMultiply(e1x, px), XMVectorMultiply(e1y, py)), XMVectorMultiply(e1z, pz));
+	XMVECTOR invDet = XMVectorReciprocal(det);
+
+	// s = origin - p0
+	XMVECTOR sx = XMVectorSubtract(origin[0], XMLoadFloat4(&packet.P0[0]));
+	XMVECTOR sy = XMVectorSubtract(origin[1], XMLoadFloat4(&packet.P0[1]));
+	XMVECTOR sz = XMVectorSubtract(origin[2], XMLoadFloat4(&packet.P0[2]));
+
+	XMVECTOR u = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(sx, px), XMVectorMultiply(sy, py)), XMVectorMultiply(sz, pz)), invDet);
+
+	// q = s x e1
+	XMVECTOR qx = XMVectorSubtract(XMVectorMultiply(sy, e1z), XMVectorMultiply(sz, e1y));
+	XMVECTOR qy = XMVectorSubtract(XMVectorMultiply(sz, e1x), XMVectorMultiply(sx, e1z));
+	XMVECTOR qz = XMVectorSubtract(XMVectorMultiply(sx, e1y), XMVectorMultiply(sy, e1x));
+
+	XMVECTOR v = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(dx, qx), XMVectorMultiply(dy, qy)), XMVectorMultiply(dz, qz)), invDet);
+	XMVECTOR t = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(e2x, qx), XMVectorMultiply(e2y, qy)), XMVectorMultiply(e2z, qz)), invDet);
+
+	// Degenerate triangles and padding lanes have a zero determinant; their u, v and t are
+	// infinite or NaN and are dropped by the mask.
+	const XMVECTOR zero = XMVectorZero();
+	XMVECTOR valid = XMVectorGreater(XMVectorAbs(det), XMVectorReplicate(1e-20f));
+	valid = XMVectorAndInt(valid, XMVectorGreaterOrEqual(u, zero));
+	valid = XMVectorAndInt(valid, XMVectorGreaterOrEqual(v, zero));
+	valid = XMVectorAndInt(valid, XMVectorLessOrEqual(XMVectorAdd(u, v), XMVectorSplatOne()));
+	valid = XMVectorAndInt(valid, XMVectorGreaterOrEqual(t, zero));
+	valid = XMVectorAndInt(valid, XMVectorLess(t, XMVectorReplicate(hit.T)));
+
+	XMFLOAT4 laneT, laneU, laneV;
+	XMStoreFloat4(&laneT, XMVectorSelect(XMVectorReplicate(FLT_MAX), t, valid));
+	XMStoreFloat4(&laneU, u);
+	XMStoreFloat4(&laneV, v);
+
+	bool nearer = false;
+	for(int lane = 0; lane < 4; ++lane)
+	{
+		float laneHitT = (&laneT.x)[lane];
+		if(laneHitT < hit.T)
+		{
+			hit.T = laneHitT;
+			hit.Triangle = packet.Triangle[lane];
+			hit.U = (&laneU.x)[lane];
+			hit.V = (&laneV.x)[lane];
+			nearer = true;
+		}
+	}
+
+	return nearer;
+}
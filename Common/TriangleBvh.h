@@ -0,0 +1,118 @@
+//***************************************************************************************
+// TriangleBvh.h
+//
+// Bounding volume hierarchy over the triangles of one mesh for ray picking.  The tree is
+// built once with binned surface area heuristic (SAH) splits and stored depth first with
+// a skip index per node, so a ray walks it in one loop without a stack, jumping past every
+// subtree whose box it misses or enters beyond the nearest hit found so far.
+// Each leaf holds up to four triangles in structure-of-arrays form and tests them with
+// one 4-wide Moller-Trumbore test.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+// Nearest ray hit.  The point hit is (1 - U - V)*p0 + U*p1 + V*p2 for the triangle's
+// corners in index order, and Origin + T*Direction along the ray.
+struct TriangleRayHit
+{
+	float T = 0.0f;
+	std::uint32_t Triangle = 0;
+	float U = 0.0f;
+	float V = 0.0f;
+};
+
+class TriangleBvh
+{
+public:
+	// Leaves hold at most this many triangles, one 4-wide test.
+	static const std::uint32_t MaxLeafSize = 4;
+
+	// Number of buckets per axis the SAH split search sorts triangle centroids into.
+	static const std::uint32_t SahBinCount = 16;
+
+	// Builds the tree over triangles [0, triangleCount) of indices, three indices per
+	// triangle.  Vertex i's position is the XMFLOAT3 at the start of vertices + i*vertexStride,
+	// so an interleaved vertex buffer can be passed as is.  baseVertex is added to every
+	// index, as in DrawIndexedInstanced.
+	void Build(const void* vertices, std::uint32_t vertexStride, const std::uint32_t* indices,
+		std::uint32_t triangleCount, std::int32_t baseVertex = 0);
+
+	std::uint32_t TriangleCount()const { return mTriangleCount; }
+	std::uint32_t NodeCount()const { return (std::uint32_t)mNodes.size(); }
+
+	// Bounds of the whole mesh.
+	DirectX::BoundingBox Bounds()const;
+
+	// Finds the nearest triangle the ray hits at T in [0, maxT).  direction need not be
+	// unit length; T is measured in multiples of it.  Triangles are hit from both sides.
+	// Returns false if there is no hit.
+	bool Intersect(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, TriangleRayHit& hit,
+		float maxT = FLT_MAX)const;
+
+private:
+	struct Node
+	{
+		DirectX::XMFLOAT3 Min;
+		// Index of the node after this subtree, where the walk continues when the ray
+		// misses this node.  The first child of an interior node directly follows it.
+		std::uint32_t Skip;
+		DirectX::XMFLOAT3 Max;
+		// Index of the leaf's packet in mPackets, or NoPacket for interior nodes.
+		std::uint32_t Packet;
+	};
+
+	// Up to four triangles as first corner and two edges, one triangle per lane: P0[0]
+	// holds the four x coordinates and so on.  Unused lanes hold a degenerate triangle
+	// that no ray hits.
+	struct TrianglePacket
+	{
+		DirectX::XMFLOAT4 P0[3];
+		DirectX::XMFLOAT4 Edge1[3];
+		DirectX::XMFLOAT4 Edge2[3];
+		std::uint32_t Triangle[4];
+	};
+
+	struct BuildTriangle
+	{
+		DirectX::XMFLOAT3 Min;
+		DirectX::XMFLOAT3 Max;
+		DirectX::XMFLOAT3 Centroid;
+	};
+
+	// Scratch state of Build.  Leaves own contiguous ranges of Order.
+	struct BuildContext
+	{
+		std::vector<DirectX::XMFLOAT3> Corners;
+		std::vector<BuildTriangle> Triangles;
+		std::vector<std::uint32_t> Order;
+	};
+
+	static const std::uint32_t NoPacket = 0xffffffff;
+	static const std::uint32_t MaxSahDepth = 48;
+
+	void BuildNode(std::uint32_t first, std::uint32_t count, std::uint32_t depth, BuildContext& context);
+
+	// Partitions context.Order[first, first + count) by the cheapest SAH split and returns
+	// the size of the first part, or 0 if every centroid is in the same place.
+	std::uint32_t SplitSah(std::uint32_t first, std::uint32_t count, BuildContext& context)const;
+
+	// Splits at the median centroid along the longest axis.  Used past MaxSahDepth so a
+	// run of lopsided SAH splits cannot make the tree deep.
+	std::uint32_t SplitMedian(std::uint32_t first, std::uint32_t count, BuildContext& context)const;
+
+	// Tests the ray, given as x, y and z splatted across lanes, against a leaf's triangles
+	// and updates hit if one of them is nearer.  Returns true if it did.
+	static bool IntersectPacket(const TrianglePacket& packet, const DirectX::XMVECTOR origin[3],
+		const DirectX::XMVECTOR direction[3], TriangleRayHit& hit);
+
+	std::vector<Node> mNodes;
+	std::vector<TrianglePacket> mPackets;
+
+	std::uint32_t mTriangleCount = 0;
+};
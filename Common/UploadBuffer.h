@@ -62,6 +62,18 @@ public:
         return mUploadBuffer.Get();
     }
 
+    // Start of the mapped elements, ElementByteSize() apart.  Upload heaps are
+    // write-combined: write whole runs in order and never read them back.
+    BYTE* MappedData()const
+    {
+        return mMappedData;
+    }
+
+    UINT ElementByteSize()const
+    {
+        return mElementByteSize;
+    }
+
     void CopyData(int elementIndex, const T& data) //  Ư ׸ . CPU ε   ؾ  (EX.þ  ) 
     {
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
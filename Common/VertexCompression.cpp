@@ -0,0 +1,323 @@
+//***************************************************************************************
+// VertexCompression.cpp
+//***************************************************************************************
+
+#include "VertexCompression.h"
+#include "MathHelper.h"
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	template<typename T>
+	const T& StreamAt(const T* stream, std::size_t stride, std::uint32_t i)
+	{
+		return *(const T*)((const char*)stream + i*stride);
+	}
+
+	float SnormToFloat(std::int16_t c)
+	{
+		return MathHelper::Max(c / 32767.0f, -1.0f);
+	}
+
+	// atan2 keeps its precision for tiny angles, where acos of the dot product does not.
+	float AngleDegrees(FXMVECTOR a, FXMVECTOR b)
+	{
+		float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(a, b)));
+		float cosine = XMVectorGetX(XMVector3Dot(a, b));
+		return XMConvertToDegrees(atan2f(sine, cosine));
+	}
+
+	// Bytes of the full precision attributes streams holds per vertex.
+	std::size_t RawVertexSize(const VertexStreams& streams)
+	{
+		return (streams.Positions ? sizeof(XMFLOAT3) : 0) + (streams.Normals ? sizeof(XMFLOAT3) : 0) +
+			(streams.Tangents ? sizeof(XMFLOAT3) : 0) + (streams.TexCoords ? sizeof(XMFLOAT2) : 0) +
+			(streams.BoneWeights ? sizeof(XMFLOAT3) : 0) + (streams.BoneIndices ? 4 : 0);
+	}
+
+	// Packs the attributes every packed vertex layout shares and folds their errors into
+	// report.
+	template<typename Packed>
+	void PackCommon(const VertexStreams& streams, std::uint32_t i, const PositionQuantization& quantization,
+		Packed& out, VertexCompressionReport* report)
+	{
+		const std::size_t stride = streams.Stride;
+
+		XMFLOAT3 p = StreamAt(streams.Positions, stride, i);
+		PackPosition(p, quantization, out.Position);
+
+		XMFLOAT3 zero(0.0f, 0.0f, 0.0f);
+		XMFLOAT3 n = streams.Normals ? StreamAt(streams.Normals, stride, i) : zero;
+		XMFLOAT3 t = streams.Tangents ? StreamAt(streams.Tangents, stride, i) : zero;
+		PackUnitVector(n, out.Normal);
+		PackUnitVector(t, out.TangentU);
+
+		XMFLOAT2 uv = streams.TexCoords ? StreamAt(streams.TexCoords, stride, i) : XMFLOAT2(0.0f, 0.0f);
+		PackTexCoord(uv, out.TexC);
+
+		if(report == nullptr)
+			return;
+
+		XMFLOAT3 decoded = UnpackPosition(out.Position, quantization);
+		report->MaxPositionError = MathHelper::Max(report->MaxPositionError,
+			XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&decoded), XMLoadFloat3(&p)))));
+
+		// Zero vectors have no direction to lose.
+		if(XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&n))) > 0.0f)
+		{
+			XMFLOAT3 nd = UnpackUnitVector(out.Normal);
+			report->MaxNormalError = MathHelper::Max(report->MaxNormalError,
+				AngleDegrees(XMVector3Normalize(XMLoadFloat3(&n)), XMLoadFloat3(&nd)));
+		}
+		if(XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&t))) > 0.0f)
+		{
+			XMFLOAT3 td = UnpackUnitVector(out.TangentU);
+			report->MaxTangentError = MathHelper::Max(report->MaxTangentError,
+				AngleDegrees(XMVector3Normalize(XMLoadFloat3(&t)), XMLoadFloat3(&td)));
+		}
+
+		XMFLOAT2 uvd = UnpackTexCoord(out.TexC);
+		report->MaxTexCoordError = MathHelper::Max(report->MaxTexCoordError,
+			MathHelper::Max(fabsf(uvd.x - uv.x), fabsf(uvd.y - uv.y)));
+	}
+}
+
+VertexStreams GetVertexStreams(const GeometryGenerator::MeshData& meshData)
+{
+	VertexStreams streams;
+	streams.Count = (std::uint32_t)meshData.Vertices.size();
+	streams.Stride = sizeof(GeometryGenerator::Vertex);
+	if(streams.Count > 0)
+	{
+		streams.Positions = &meshData.Vertices[0].Position;
+		streams.Normals = &meshData.Vertices[0].Normal;
+		streams.Tangents = &meshData.Vertices[0].TangentU;
+		streams.TexCoords = &meshData.Vertices[0].TexC;
+	}
+	return streams;
+}
+
+PositionQuantization ComputePositionQuantization(const VertexStreams& streams)
+{
+	PositionQuantization quantization;
+	if(streams.Positions == nullptr || streams.Count == 0)
+		return quantization;
+
+	XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+	for(std::uint32_t i = 0; i < streams.Count; ++i)
+	{
+		XMVECTOR p = XMLoadFloat3(&StreamAt(streams.Positions, streams.Stride, i));
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+
+	XMStoreFloat3(&quantization.Offset, vMin);
+	XMStoreFloat3(&quantization.Scale, XMVectorSubtract(vMax, vMin));
+	return quantization;
+}
+
+bool PackVertices(const VertexStreams& streams, std::vector<PackedVertex>& packed,
+	PositionQuantization& quantization, VertexCompressionReport* report)
+{
+	packed.clear();
+	if(streams.Positions == nullptr)
+		return false;
+
+	quantization = ComputePositionQuantization(streams);
+	if(report != nullptr)
+	{
+		*report = VertexCompressionReport();
+		report->RawBytes = streams.Count*RawVertexSize(streams);
+		report->PackedBytes = streams.Count*sizeof(PackedVertex);
+	}
+
+	packed.resize(streams.Count);
+	for(std::uint32_t i = 0; i < streams.Count; ++i)
+		PackCommon(streams, i, quantization, packed[i], report);
+
+	return true;
+}
+
+bool PackSkinnedVertices(const VertexStreams& streams, std::vector<PackedSkinnedVertex>& packed,
+	PositionQuantization& quantization, VertexCompressionReport* report)
+{
+	packed.clear();
+	if(streams.Positions == nullptr)
+		return false;
+
+	quantization = ComputePositionQuantization(streams);
+	if(report != nullptr)
+	{
+		*report = VertexCompressionReport();
+		report->RawBytes = streams.Count*RawVertexSize(streams);
+		report->PackedBytes = streams.Count*sizeof(PackedSkinnedVertex);
+	}
+
+	packed.resize(streams.Count);
+	for(std::uint32_t i = 0; i < streams.Count; ++i)
+	{
+		PackedSkinnedVertex& out = packed[i];
+		PackCommon(streams, i, quantization, out, report);
+
+		XMFLOAT3 weights = streams.BoneWeights ? StreamAt(streams.BoneWeights, streams.Stride, i) : XMFLOAT3(1.0f, 0.0f, 0.0f);
+		PackBoneWeights(weights, out.BoneWeights);
+
+		for(int k = 0; k < 4; ++k)
+			out.BoneIndices[k] = streams.BoneIndices ? (&StreamAt(streams.BoneIndices, streams.Stride, i))[k] : 0;
+
+		if(report != nullptr)
+		{
+			XMFLOAT4 decoded = UnpackBoneWeights(out.BoneWeights);
+			float w3 = 1.0f - weights.x - weights.y - weights.z;
+			report->MaxBoneWeightError = MathHelper::Max(report->MaxBoneWeightError,
+				MathHelper::Max(MathHelper::Max(fabsf(decoded.x - weights.x), fabsf(decoded.y - weights.y)),
+					MathHelper::Max(fabsf(decoded.z - weights.z), fabsf(decoded.w - w3))));
+		}
+	}
+
+	return true;
+}
+
+void PackPosition(const XMFLOAT3& p, const PositionQuantization& quantization, std::uint16_t packed[4])
+{
+	const float v[3] = { p.x, p.y, p.z };
+	const float offset[3] = { quantization.Offset.x, quantization.Offset.y, quantization.Offset.z };
+	const float scale[3] = { quantization.Scale.x, quantization.Scale.y, quantization.Scale.z };
+
+	for(int k = 0; k < 3; ++k)
+	{
+		float t = scale[k] > 0.0f ? MathHelper::Clamp((v[k] - offset[k]) / scale[k], 0.0f, 1.0f) : 0.0f;
+		packed[k] = (std::uint16_t)(t*65535.0f + 0.5f);
+	}
+	packed[3] = 0;
+}
+
+XMFLOAT3 UnpackPosition(const std::uint16_t packed[4], const PositionQuantization& quantization)
+{
+	return XMFLOAT3(
+		quantization.Offset.x + quantization.Scale.x*(packed[0] / 65535.0f),
+		quantization.Offset.y + quantization.Scale.y*(packed[1] / 65535.0f),
+		quantization.Offset.z + quantization.Scale.z*(packed[2] / 65535.0f));
+}
+
+void PackUnitVector(const XMFLOAT3& v, std::int16_t packed[2])
+{
+	packed[0] = packed[1] = 0;
+
+	float l1 = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+	if(l1 == 0.0f)
+		return;
+
+	// Project onto the octahedron |x|+|y|+|z| = 1 and unfold the lower half over the
+	// corners of the square.
+	float u = v.x / l1;
+	float w = v.y / l1;
+	if(v.z < 0.0f)
+	{
+		float foldedU = (1.0f - fabsf(w))*(u >= 0.0f ? 1.0f : -1.0f);
+		float foldedW = (1.0f - fabsf(u))*(w >= 0.0f ? 1.0f : -1.0f);
+		u = foldedU;
+		w = foldedW;
+	}
+
+	// Plain rounding of (u, w) is not always the closest direction, so try the four
+	// codes around it.
+	XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&v));
+	float baseU = floorf(u*32767.0f);
+	float baseW = floorf(w*32767.0f);
+	float bestDot = -FLT_MAX;
+	for(int du = 0; du < 2; ++du)
+	{
+		for(int dw = 0; dw < 2; ++dw)
+		{
+			std::int16_t code[2] = {
+				(std::int16_t)MathHelper::Clamp(baseU + du, -32767.0f, 32767.0f),
+				(std::int16_t)MathHelper::Clamp(baseW + dw, -32767.0f, 32767.0f) };
+
+			XMFLOAT3 decoded = UnpackUnitVector(code);
+			float dot = XMVectorGetX(XMVector3Dot(n, XMLoadFloat3(&decoded)));
+			if(dot > bestDot)
+			{
+				bestDot = dot;
+				packed[0] = code[0];
+				packed[1] = code[1];
+			}
+		}
+	}
+}
+
+XMFLOAT3 UnpackUnitVector(const std::int16_t packed[2])
+{
+	float x = SnormToFloat(packed[0]);
+	float y = SnormToFloat(packed[1]);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Fold the corners back under the lower half.
+	float t = MathHelper::Max(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	XMFLOAT3 v;
+	XMStoreFloat3(&v, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+	return v;
+}
+
+void PackTexCoord(const XMFLOAT2& uv, HALF packed[2])
+{
+	packed[0] = XMConvertFloatToHalf(uv.x);
+	packed[1] = XMConvertFloatToHalf(uv.y);
+}
+
+XMFLOAT2 UnpackTexCoord(const HALF packed[2])
+{
+	return XMFLOAT2(XMConvertHalfToFloat(packed[0]), XMConvertHalfToFloat(packed[1]));
+}
+
+void PackBoneWeights(const XMFLOAT3& weights, std::uint8_t packed[4])
+{
+	float w[4] = { weights.x, weights.y, weights.z, 1.0f - weights.x - weights.y - weights.z };
+	float sum = 0.0f;
+	for(int k = 0; k < 4; ++k)
+	{
+		w[k] = MathHelper::Max(w[k], 0.0f);
+		sum += w[k];
+	}
+
+	packed[0] = packed[1] = packed[2] = packed[3] = 0;
+	if(sum == 0.0f)
+		return;
+
+	// Round down, then hand the units that are left to the weights that lost the most, so
+	// the sum stays exactly 255 and the skinned position is never scaled.
+	float remainder[4];
+	int left = 255;
+	for(int k = 0; k < 4; ++k)
+	{
+		float scaled = w[k] / sum*255.0f;
+		packed[k] = (std::uint8_t)MathHelper::Min(floorf(scaled), 255.0f);
+		remainder[k] = scaled - packed[k];
+		left -= packed[k];
+	}
+
+	for(; left > 0; --left)
+	{
+		int best = 0;
+		for(int k = 1; k < 4; ++k)
+		{
+			if(remainder[k] > remainder[best])
+				best = k;
+		}
+		++packed[best];
+		remainder[best] -= 1.0f;
+	}
+}
+
+XMFLOAT4 UnpackBoneWeights(const std::uint8_t packed[4])
+{
+	return XMFLOAT4(packed[0] / 255.0f, packed[1] / 255.0f, packed[2] / 255.0f, packed[3] / 255.0f);
+}
@@ -0,0 +1,106 @@
+//***************************************************************************************
+// VertexCompression.h
+//
+// Packs full precision vertices into compact formats the input assembler expands for free:
+//   - positions as 16-bit UNORM within the mesh's bounding box, decoded by one multiply
+//     add with the box's offset and scale,
+//   - normals and tangents as 2x16-bit SNORM octahedral unit vectors (Cigolle et al.
+//     2014), rounded to the nearest of the four surrounding codes,
+//   - texture coordinates as half floats,
+//   - bone weights as four UNORM8 that sum to exactly 255.
+// A GeometryGenerator::Vertex shrinks from 44 bytes to 20 and a skinned M3D vertex from 60
+// to 28.  The Unpack functions decode on the CPU exactly as VertexCompression.hlsl does on
+// the GPU.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <DirectXPackedVector.h>
+
+// Input layout: POSITION R16G16B16A16_UNORM, NORMAL R16G16_SNORM, TANGENT R16G16_SNORM,
+// TEXCOORD R16G16_FLOAT.
+struct PackedVertex
+{
+	// x, y, z; w is padding, as DXGI has no three component 16-bit format.
+	std::uint16_t Position[4];
+	std::int16_t Normal[2];
+	std::int16_t TangentU[2];
+	DirectX::PackedVector::HALF TexC[2];
+};
+
+// PackedVertex followed by WEIGHTS R8G8B8A8_UNORM and BONEINDICES R8G8B8A8_UINT.
+struct PackedSkinnedVertex
+{
+	std::uint16_t Position[4];
+	std::int16_t Normal[2];
+	std::int16_t TangentU[2];
+	DirectX::PackedVector::HALF TexC[2];
+	std::uint8_t BoneWeights[4];
+	std::uint8_t BoneIndices[4];
+};
+
+// Where the attributes of vertex i are: each pointer is advanced by i*Stride bytes.  Null
+// attributes are packed as zero.
+struct VertexStreams
+{
+	std::uint32_t Count = 0;
+	std::size_t Stride = 0;
+
+	const DirectX::XMFLOAT3* Positions = nullptr;
+	const DirectX::XMFLOAT3* Normals = nullptr;
+	const DirectX::XMFLOAT3* Tangents = nullptr;
+	const DirectX::XMFLOAT2* TexCoords = nullptr;
+
+	// Three weights; the fourth is one minus their sum.
+	const DirectX::XMFLOAT3* BoneWeights = nullptr;
+	const std::uint8_t* BoneIndices = nullptr;
+};
+
+VertexStreams GetVertexStreams(const GeometryGenerator::MeshData& meshData);
+
+// A packed position q decodes to Offset + Scale*q/65535.
+struct PositionQuantization
+{
+	DirectX::XMFLOAT3 Offset = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 Scale = { 0.0f, 0.0f, 0.0f };
+};
+
+// The bounding box of the positions as a quantization.
+PositionQuantization ComputePositionQuantization(const VertexStreams& streams);
+
+// Size and largest round trip error of one packing.  RawBytes counts the full precision
+// attributes the streams hold, whatever else their vertices carry.
+struct VertexCompressionReport
+{
+	std::size_t RawBytes = 0;
+	std::size_t PackedBytes = 0;
+
+	// In position units, degrees, texture units and weight.
+	float MaxPositionError = 0.0f;
+	float MaxNormalError = 0.0f;
+	float MaxTangentError = 0.0f;
+	float MaxTexCoordError = 0.0f;
+	float MaxBoneWeightError = 0.0f;
+};
+
+// Packs every vertex of streams, quantizing positions with ComputePositionQuantization,
+// which is stored in quantization for the shader.  Returns false if streams has no
+// positions.
+bool PackVertices(const VertexStreams& streams, std::vector<PackedVertex>& packed,
+	PositionQuantization& quantization, VertexCompressionReport* report = nullptr);
+bool PackSkinnedVertices(const VertexStreams& streams, std::vector<PackedSkinnedVertex>& packed,
+	PositionQuantization& quantization, VertexCompressionReport* report = nullptr);
+
+void PackPosition(const DirectX::XMFLOAT3& p, const PositionQuantization& quantization, std::uint16_t packed[4]);
+DirectX::XMFLOAT3 UnpackPosition(const std::uint16_t packed[4], const PositionQuantization& quantization);
+
+// v need not be unit length; the zero vector packs as +z.
+void PackUnitVector(const DirectX::XMFLOAT3& v, std::int16_t packed[2]);
+DirectX::XMFLOAT3 UnpackUnitVector(const std::int16_t packed[2]);
+
+void PackTexCoord(const DirectX::XMFLOAT2& uv, DirectX::PackedVector::HALF packed[2]);
+DirectX::XMFLOAT2 UnpackTexCoord(const DirectX::PackedVector::HALF packed[2]);
+
+void PackBoneWeights(const DirectX::XMFLOAT3& weights, std::uint8_t packed[4]);
+DirectX::XMFLOAT4 UnpackBoneWeights(const std::uint8_t packed[4]);
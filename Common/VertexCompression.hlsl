@@ -0,0 +1,25 @@
+//***************************************************************************************
+// VertexCompression.hlsl
+//
+// Decodes the vertex formats of VertexCompression.h.  The input assembler has already
+// turned the UNORM, SNORM and half float elements into floats, so only the position's
+// bounding box and the octahedral unit vectors are left to undo.
+//***************************************************************************************
+
+// positionOffset and positionScale are the mesh's PositionQuantization.
+float3 DecodePosition(float3 packedPos, float3 positionOffset, float3 positionScale)
+{
+    return positionOffset + positionScale*packedPos;
+}
+
+// Octahedral unit vector; matches UnpackUnitVector.
+float3 DecodeUnitVector(float2 packedDir)
+{
+    float3 v = float3(packedDir, 1.0f - abs(packedDir.x) - abs(packedDir.y));
+
+    // Fold the corners back under the lower half.
+    float t = max(-v.z, 0.0f);
+    v.xy += v.xy >= 0.0f ? -t : t;
+
+    return normalize(v);
+}
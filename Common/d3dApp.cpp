@@ -34,6 +34,10 @@ D3DApp::D3DApp(HINSTANCE hInstance)
     // Only one D3DApp can be constructed.
     assert(mApp == nullptr);
     mApp = this;
+
+	mUpdateScope = mTelemetry.RegisterScope("Update");
+	mDrawScope = mTelemetry.RegisterScope("Draw");
+	mTelemetry.SetHistoryCapacity(1 << 16);
 }
 
 D3DApp::~D3DApp()
@@ -79,7 +83,36 @@ int D3DApp::Run()	// 
 {					//  ޼ Win32 PeekMessageԼ Ѵ.  ޼   4.4.3 Դ.
 	MSG msg = {0};
  
-	mTimer.Reset();
+	// Millisecond sleeps, so frame pacing to a target rate is not rounded up to the
+	// default 15.6 ms scheduler tick.
+	timeBeginPeriod(1);
+
+	// Initialize has compiled the app's shaders by now; store the new ones in one write.
+	d3dUtil::FlushShaderCache();
+
+	mFrameLoop.Reset();
+	mFrameStatsTime = 0.0f;
+
+#if PROFILER_ENABLED
+	Profiler::Get().SetThreadName("Main");
+#endif
+
+	auto update = [this](const GameTimer& gt)
+	{
+		PROFILE_SCOPE("Update");
+		FrameTelemetry::ScopeTimer scope(mTelemetry, mUpdateScope);
+		Update(gt);
+	};
+	auto draw = [this](const GameTimer& gt)
+	{
+		{
+			PROFILE_SCOPE("Draw");
+			FrameTelemetry::ScopeTimer scope(mTelemetry, mDrawScope);
+			Draw(gt);
+		}
+		mTelemetry.EndFrame();
+		CalculateFrameStats();
+	};
 
 	while(msg.message != WM_QUIT)
 	{
@@ -90,23 +123,23 @@ int D3DApp::Run()	// 
             DispatchMessage( &msg );
 		}
 		// Otherwise, do animation/game stuff.
-		else
+		else if( !mAppPaused )
         {	
-			mTimer.Tick();
-
-			if( !mAppPaused )
-			{
-				CalculateFrameStats();
-				Update(mTimer);	
-                Draw(mTimer);
-			}
-			else
-			{
-				Sleep(100);
-			}
+			PROFILE_SCOPE("Frame");
+			mTelemetry.BeginFrame();
+			mFrameLoop.RunFrame(update, draw);
         }
+		// Only a message can unpause the application, so sleep until one arrives.
+		else
+		{
+			WaitMessage();
+		}
     }
 
+	timeEndPeriod(1);
+
+	d3dUtil::FlushShaderCache();
+
 	return (int)msg.wParam;
 }
 
@@ -253,6 +286,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		{
 			mAppPaused = true;
 			mTimer.Stop();
+			mTelemetry.Pause();
 		}
 		else
 		{
@@ -272,6 +306,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			{
 				mAppPaused = true;
 				mMinimized = true;
+				mTelemetry.Pause();
 				mMaximized = false;
 			}
 			else if( wParam == SIZE_MAXIMIZED )
@@ -323,6 +358,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		mAppPaused = true;
 		mResizing  = true;
 		mTimer.Stop();
+		mTelemetry.Pause();
 		return 0;
 
 	// WM_EXITSIZEMOVE is sent when the user releases the resize bars. ڰ ũ  ׵θ 
@@ -371,6 +407,29 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
         else if((int)wParam == VK_F2)
             Set4xMsaaState(!m4xMsaaState);
+		else if((int)wParam == VK_F3)
+		{
+			mTelemetry.Drain();
+			bool written = mTelemetry.WriteCsv("FrameTimes.csv") && mTelemetry.WriteJson("FrameTimes.json");
+			OutputDebugStringA(written ? "Wrote FrameTimes.csv and FrameTimes.json.\n" : "Could not write the frame times.\n");
+		}
+#if PROFILER_ENABLED
+		// F4 starts a profiler capture and F4 again ends it and writes Trace.json.
+		else if((int)wParam == VK_F4)
+		{
+			Profiler& profiler = Profiler::Get();
+			if(!profiler.Capturing())
+			{
+				profiler.BeginCapture();
+			}
+			else
+			{
+				profiler.EndCapture();
+				bool written = profiler.WriteChromeTrace("Trace.json");
+				OutputDebugStringA(written ? "Wrote Trace.json.\n" : "Could not write Trace.json.\n");
+			}
+		}
+#endif
 
         return 0;
 	}
@@ -585,29 +644,33 @@ void D3DApp::CalculateFrameStats() // 
 	// ϴ  ɸ  ð Ѵ. ,
 	//  ġ â ٿ ߰Ѵ.
     
-	static int frameCnt = 0;
-	static float timeElapsed = 0.0f;
+	// The frame times come from mTelemetry, which keeps every frame rather than a count,
+	// so the caption shows the slowest frames of the second along with the average.
+	mTelemetry.Drain();
 
-	frameCnt++;
-
-	// 1ʵ    Ѵ.
-	if( (mTimer.TotalTime() - timeElapsed) >= 1.0f )
+	if( (mTimer.TotalTime() - mFrameStatsTime) >= 1.0f )
 	{
-		float fps = (float)frameCnt; // fps = frameCnt / 1
-		float mspf = 1000.0f / fps;  // и  ٲٱ  1000ms/1s  Ѵ.
+		FrameStats frame = mTelemetry.WindowStats(FrameTelemetry::FrameScope);
+		FrameStats cpu = mTelemetry.WindowStats(FrameTelemetry::CpuScope);
+		if(frame.Count > 0)
+		{
+			float fps = (float)(1000.0 / frame.MeanMs);
+			float mspf = (float)frame.MeanMs;
 
-        wstring fpsStr = to_wstring(fps);
-        wstring mspfStr = to_wstring(mspf);
+			wchar_t tailStr[128];
+			swprintf_s(tailStr, L"   p99: %.2f   max: %.2f   cpu p99: %.2f",
+				frame.P99Ms, frame.MaxMs, cpu.P99Ms);
 
-        wstring windowText = mMainWndCaption +
-            L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+			wstring windowText = mMainWndCaption +
+				L"    fps: " + to_wstring(fps) +
+				L"   mspf: " + to_wstring(mspf) + tailStr;
+
+			SetWindowText(mhMainWnd, windowText.c_str());
+		}
 
-        SetWindowText(mhMainWnd, windowText.c_str());
-		
-		// Reset for next average.
-		frameCnt = 0;
-		timeElapsed += 1.0f;
+		// Reset for next second.
+		mTelemetry.ResetWindow();
+		mFrameStatsTime += 1.0f;
 	}
 }
 
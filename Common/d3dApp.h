@@ -11,11 +11,14 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "FrameLoop.h"
+#include "FrameTelemetry.h"
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
 #pragma comment(lib, "D3D12.lib")
 #pragma comment(lib, "dxgi.lib")
+#pragma comment(lib, "winmm.lib")
 
 class D3DApp
 {
@@ -90,6 +93,18 @@ protected:
 
 	// Used to keep track of the delta-time(ð) and game time( ü ð) ( 4.4).
 	GameTimer mTimer;
+
+	// Runs Update and Draw off mTimer.  Set its FrameLoopSettings in the constructor for a
+	// fixed timestep or a target frame rate.
+	FrameLoop mFrameLoop{ mTimer };
+
+	// Times every frame and its Update and Draw; CalculateFrameStats shows the last
+	// second in the caption and F3 writes FrameTimes.csv and FrameTimes.json.  Register
+	// scopes for sub-stages in the derived constructor.
+	FrameTelemetry mTelemetry;
+	std::uint32_t mUpdateScope = FrameTelemetry::InvalidScope;
+	std::uint32_t mDrawScope = FrameTelemetry::InvalidScope;
+	float mFrameStatsTime = 0.0f;
 	
     Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory;
     Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;
@@ -1,10 +1,98 @@
 
 #include "d3dUtil.h"
+#include "ShaderCache.h"
+#include "ThreadPool.h"
 #include <comdef.h>
 #include <fstream>
+#include <mutex>
 
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+	std::string WStringToAnsi(const std::wstring& str)
+	{
+		int size = WideCharToMultiByte(CP_ACP, 0, str.c_str(), -1, nullptr, 0, nullptr, nullptr);
+		std::string result(size > 0 ? size - 1 : 0, '\0');
+		if(size > 1)
+			WideCharToMultiByte(CP_ACP, 0, str.c_str(), -1, &result[0], size, nullptr, nullptr);
+		return result;
+	}
+
+	// D3DCompileFromFile behind the shader cache's compiler interface.  Called from the
+	// cache's pool threads; the compiler is thread safe.
+	class D3DShaderCompiler : public ShaderCompiler
+	{
+	public:
+		std::string Version()const override
+		{
+			return "d3dcompiler " + std::to_string(D3D_COMPILER_VERSION);
+		}
+
+		bool Compile(const ShaderCompileRequest& request,
+			std::vector<std::uint8_t>& bytecode, std::string& messages) override
+		{
+			std::vector<D3D_SHADER_MACRO> macros;
+			for(const auto& define : request.Defines)
+				macros.push_back({ define.Name.c_str(), define.Definition.c_str() });
+			macros.push_back({ nullptr, nullptr });
+
+			ComPtr<ID3DBlob> byteCode = nullptr;
+			ComPtr<ID3DBlob> errors;
+			// 6.7 ̴ 
+			// 1. pFileName:  HLSL ҽ ڵ带  .hlsl  ̸.
+			// 2. pDefines:  ɼ,  å  . ڼ  SDK ȭ 
+			// 3. pInclude:  ɼ,  å  . ڼ  SDK ȭ 
+			// 4. pEntrypoint: ̴ α׷  Լ ̸. ϳ .hlsl Ͽ   ̴ α׷   Ƿ
+			// (̸׸  ̴ ϳ ȼ ̴ ϳ),  Ư ̴   ־ Ѵ.
+			// 5. pTarget:  ̴ α׷    Ÿ ڿ.  å  5.0 5.1 Ѵ.
+			// (a) vs_5_0 vs_5_1:   ̴ 5.0 5.1
+			// (b) hs_5_0 hs_5_1:  (14.2) ̴ 5.0 5.1
+			// (c) ds_5_0 ds_5_1:  (14.4) ̴ 5.0 5.1
+			// (d) gs_5_0 gs_5_1:  ( 12) ̴ 5.0 5.1
+			// (e) ps_5_0 ps_5_1:  ȼ ̴ 5.0 5.1
+			// (f) cs_5_0 cs_5_1:  ( 13) ̴ 5.0 5.1
+			// 6. Flags1: ̴ ڵ    ϴ ÷׵. SDK  ÷װ  å ΰ
+			// (a) D3DCOMPILE_DEBUG: ̴  忡  Ѵ.
+			// (b) D3DCOMPILE_SKIP_OPTIMIZATION: ȭ Ѵ(뿡 ).
+			// 7. Flags2: ȿ(effect) Ͽ   ɼ,  å  ʴ´.
+			// 8. ppCode: ϵ ̴  Ʈڵ(shader object bytecode)  ID3DBlobü ͸  Ű ؼ ش.
+			// 9. ppErrorMsgs:   ߻   ޽ ڿ  ID3DBlob ü ͸  Ű ؼ ش.
+			// ID3DBlob  ޸ ۸ Ÿ ,   ޼带 Ѵ.
+			// (a) LPVOID GetBufferPointer: ۸ Ű void* ͸ ش.  Ͽ  ü  Ϸ    ĳؾ Ѵ.
+			// (b) SIZE_T GetBufferSize:  ũ(Ʈ ) ش.
+			HRESULT hr = D3DCompileFromFile(AnsiToWString(request.Filename).c_str(), macros.data(),
+				D3D_COMPILE_STANDARD_FILE_INCLUDE, request.EntryPoint.c_str(), request.Target.c_str(),
+				request.Flags, 0, &byteCode, &errors);
+
+			if(errors != nullptr)
+				messages.assign((const char*)errors->GetBufferPointer(), errors->GetBufferSize());
+			if(FAILED(hr))
+				return false;
+
+			const std::uint8_t* p = (const std::uint8_t*)byteCode->GetBufferPointer();
+			bytecode.assign(p, p + byteCode->GetBufferSize());
+			return true;
+		}
+	};
+
+	std::mutex gShaderCacheMutex;
+
+	// Opened on first use, and only ever used under gShaderCacheMutex.
+	ShaderCache& GetShaderCache()
+	{
+		static D3DShaderCompiler compiler;
+		static ShaderCache cache(compiler);
+		static bool opened = false;
+		if(!opened)
+		{
+			cache.Open("ShaderCache.bin");
+			opened = true;
+		}
+		return cache;
+	}
+}
+
 DxException::DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber) :
     ErrorCode(hr),
     FunctionName(functionName),
@@ -99,6 +187,11 @@ ComPtr<ID3DBlob> d3dUtil::CompileShader(
 	const D3D_SHADER_MACRO* defines,
 	const std::string& entrypoint,
 	const std::string& target)
+{
+	return CompileShaders({ { filename, defines, entrypoint, target } })[0];
+}
+
+std::vector<ComPtr<ID3DBlob>> d3dUtil::CompileShaders(const std::vector<ShaderDesc>& shaders)
 {
     //  忡   ÷׵ Ѵ.
 	UINT compileFlags = 0;
@@ -106,44 +199,46 @@ ComPtr<ID3DBlob> d3dUtil::CompileShader(
 	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
 
-	HRESULT hr = S_OK;
-
-	ComPtr<ID3DBlob> byteCode = nullptr;
-	ComPtr<ID3DBlob> errors;
-    // 6.7 ̴ 
-    // 1. pFileName:  HLSL ҽ ڵ带  .hlsl  ̸.
-    // 2. pDefines:  ɼ,  å  . ڼ  SDK ȭ 
-    // 3. pInclude:  ɼ,  å  . ڼ  SDK ȭ 
-    // 4. pEntrypoint: ̴ α׷  Լ ̸. ϳ .hlsl Ͽ   ̴ α׷   Ƿ
-    // (̸׸  ̴ ϳ ȼ ̴ ϳ),  Ư ̴   ־ Ѵ.
-    // 5. pTarget:  ̴ α׷    Ÿ ڿ.  å  5.0 5.1 Ѵ.
-    // (a) vs_5_0 vs_5_1:   ̴ 5.0 5.1
-    // (b) hs_5_0 hs_5_1:  (14.2) ̴ 5.0 5.1
-    // (c) ds_5_0 ds_5_1:  (14.4) ̴ 5.0 5.1
-    // (d) gs_5_0 gs_5_1:  ( 12) ̴ 5.0 5.1
-    // (e) ps_5_0 ps_5_1:  ȼ ̴ 5.0 5.1
-    // (f) cs_5_0 cs_5_1:  ( 13) ̴ 5.0 5.1
-    // 6. Flags1: ̴ ڵ    ϴ ÷׵. SDK  ÷װ  å ΰ
-    // (a) D3DCOMPILE_DEBUG: ̴  忡  Ѵ.
-    // (b) D3DCOMPILE_SKIP_OPTIMIZATION: ȭ Ѵ(뿡 ).
-    // 7. Flags2: ȿ(effect) Ͽ   ɼ,  å  ʴ´.
-    // 8. ppCode: ϵ ̴  Ʈڵ(shader object bytecode)  ID3DBlobü ͸  Ű ؼ ش.
-    // 9. ppErrorMsgs:   ߻   ޽ ڿ  ID3DBlob ü ͸  Ű ؼ ش.
-    // ID3DBlob  ޸ ۸ Ÿ ,   ޼带 Ѵ.
-    // (a) LPVOID GetBufferPointer: ۸ Ű void* ͸ ش.  Ͽ  ü  Ϸ    ĳؾ Ѵ.
-    // (b) SIZE_T GetBufferSize:  ũ(Ʈ ) ش.
-	hr = D3DCompileFromFile(filename.c_str(), defines, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		entrypoint.c_str(), target.c_str(), compileFlags, 0, &byteCode, &errors);
-    //  ޽  â Ѵ.
-    // HLSL  ޽  ޽ ppErrorMsgs Ű ؼ ȯȴ. ⼱ errors
-	if(errors != nullptr)
-		OutputDebugStringA((char*)errors->GetBufferPointer());
-
-	ThrowIfFailed(hr);
+	std::vector<ShaderCompileRequest> requests(shaders.size());
+	for(size_t i = 0; i < shaders.size(); ++i)
+	{
+		requests[i].Filename = WStringToAnsi(shaders[i].Filename);
+		for(const D3D_SHADER_MACRO* d = shaders[i].Defines; d != nullptr && d->Name != nullptr; ++d)
+			requests[i].Defines.push_back({ d->Name, d->Definition != nullptr ? d->Definition : "" });
+		requests[i].EntryPoint = shaders[i].EntryPoint;
+		requests[i].Target = shaders[i].Target;
+		requests[i].Flags = compileFlags;
+	}
+
+	std::lock_guard<std::mutex> lock(gShaderCacheMutex);
+	ShaderCache& cache = GetShaderCache();
+	cache.Build(requests, ThreadPool::Default());
+
+	std::vector<ComPtr<ID3DBlob>> byteCode(shaders.size());
+	for(size_t i = 0; i < shaders.size(); ++i)
+	{
+		//  ޽  â Ѵ.
+		// HLSL  ޽  ޽ ppErrorMsgs Ű ؼ ȯȴ. ⼱ errors
+		if(!cache.Messages(i).empty())
+			OutputDebugStringA(cache.Messages(i).c_str());
+
+		if(!cache.Succeeded(i))
+			throw DxException(E_FAIL, L"D3DCompileFromFile(" + shaders[i].Filename + L")", AnsiToWString(__FILE__), __LINE__);
+
+		ThrowIfFailed(D3DCreateBlob(cache.BytecodeSize(i), byteCode[i].GetAddressOf()));
+		std::memcpy(byteCode[i]->GetBufferPointer(), cache.Bytecode(i), cache.BytecodeSize(i));
+	}
 
 	return byteCode;
 }
 
+void d3dUtil::FlushShaderCache()
+{
+	// A store that cannot be written only costs the next launch the compiles.
+	std::lock_guard<std::mutex> lock(gShaderCacheMutex);
+	GetShaderCache().Save();
+}
+
 std::wstring DxException::ToString()const
 {
     // Get the string description of the error code.
@@ -28,6 +28,7 @@
 #include "d3dx12.h"
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
+#include "Profiler.h"
 
 extern const int gNumFrameResources;
 
@@ -125,11 +126,32 @@ public:
         UINT64 byteSize,
         Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
 
+	// Goes through the shader cache, as CompileShaders does.
 	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
 		const std::wstring& filename,
 		const D3D_SHADER_MACRO* defines,
 		const std::string& entrypoint,
 		const std::string& target);
+
+	struct ShaderDesc
+	{
+		std::wstring Filename;
+		const D3D_SHADER_MACRO* Defines;
+		std::string EntryPoint;
+		std::string Target;
+	};
+
+	// Compiles shaders through a ShaderCache stored in ShaderCache.bin in the working
+	// directory.  Shaders whose source, includes, defines and flags are unchanged since
+	// they were cached load from the store; the rest compile in parallel on
+	// ThreadPool::Default.  Returns the bytecode in the order of shaders, and throws if
+	// any shader fails to compile.  New bytecode is kept in memory until FlushShaderCache.
+	static std::vector<Microsoft::WRL::ComPtr<ID3DBlob>> CompileShaders(const std::vector<ShaderDesc>& shaders);
+
+	// Writes the shaders compiled since the last flush to ShaderCache.bin, if there are
+	// any, so an app that compiles one shader at a time still rewrites the store once.
+	// D3DApp::Run calls it before its first frame and after its last.
+	static void FlushShaderCache();
 };
 // ȯ и ϴ ̸ ܸ µ,  ܿ  ȣ,  Ų Լ ȣ ǥİ  ǥ ִ  ̸   ȣ ִ.
 class DxException